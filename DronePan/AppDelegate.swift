@@ -30,10 +30,34 @@ class AppDelegate: UIResponder, UIApplicationDelegate, Analytics {
     var version : String!
 
     func application(application: UIApplication, didFinishLaunchingWithOptions launchOptions: [NSObject:AnyObject]?) -> Bool {
+        let profiler = StartupProfiler.sharedInstance
+        profiler.mark("launch")
+
         UIApplication.sharedApplication().idleTimerDisabled = true
 
         version = ControllerUtils.buildVersion() ?? "Unknown version"
-        
+
+        profiler.measure("loggers") {
+            self.addLoggers()
+        }
+
+        DDLogInfo("DronePan launched")
+
+        DDLogInfo("Running version \(version)")
+
+        // Build the decoder and parse the model config while the UI loads and the SDK registers
+        dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0)) {
+            profiler.measure("videoPreviewer") {
+                VideoPreviewer.instance()
+            }
+        }
+
+        dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0)) {
+            profiler.measure("modelConfig") {
+                ModelConfig.sharedInstance
+            }
+        }
+
         let defaults = NSUserDefaults.standardUserDefaults()
         let appDefaults = [
             "analyticsOK": false,
@@ -47,10 +71,18 @@ class AppDelegate: UIResponder, UIApplicationDelegate, Analytics {
         if !hasOpted {
             showAnalyticsOpt()
         } else {
-            addRemoteLogger()
-            startAnalytics()
+            dispatch_async(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0)) {
+                profiler.measure("analytics") {
+                    self.addRemoteLogger()
+                    self.startAnalytics()
+                }
+            }
         }
 
+        return true
+    }
+
+    func addLoggers() {
         let logFormatter = LogFormatter()
 
         DDTTYLogger.sharedInstance().logFormatter = logFormatter
@@ -66,12 +98,6 @@ class AppDelegate: UIResponder, UIApplicationDelegate, Analytics {
         fileLogger!.logFormatter = logFormatter
 
         DDLog.addLogger(fileLogger!, withLevel: .Debug)
-
-        DDLogInfo("DronePan launched")
-
-        DDLogInfo("Running version \(version)")
-
-        return true
     }
     
     func addRemoteLogger() {
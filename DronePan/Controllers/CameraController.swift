@@ -14,6 +14,7 @@
  */
 
 import Foundation
+import QuartzCore
 
 import DJISDK
 import CocoaLumberjackSwift
@@ -31,7 +32,10 @@ protocol CameraControllerDelegate {
 
     func cameraControllerReset()
 
-    func cameraControllerNewMedia(filename: String)
+    // Time tags are on the video clock so they can be matched to the video frames
+    func cameraControllerShutterFired(timeTag: UInt64)
+
+    func cameraControllerNewMedia(filename: String, timeTag: UInt64)
     
     func cameraExposureValuesUpdated(iso iso: UInt, aperture: DJICameraAperture, shutter: DJICameraShutterSpeed, compensation: DJICameraExposureCompensation)
     
@@ -49,6 +53,15 @@ class CameraController: NSObject, DJICameraDelegate {
     var delegate: CameraControllerDelegate?
     var videoDelegate: VideoControllerDelegate?
 
+    // When set the shutter fires as soon as the video has settled and the photo delay is only the longest wait
+    var settleMonitor: FrameSettleMonitor?
+
+    // Measured scene brightness of the live view, logged with each shot
+    var exposureMonitor: DJIVideoExposureMonitor?
+
+    // Share of crushed shadows and of clipped highlights above which a scene needs bracketing
+    let bracketingClipLimit: Float = 0.02
+
     var status: ControllerStatus = .Normal
 
     let maxCount = 5
@@ -229,11 +242,22 @@ class CameraController: NSObject, DJICameraDelegate {
         }
         
         if(counter == 0){
-            // Only sleep on first attempt at taking photo
-            DDLogDebug("Sleep for \(photoDelayTime) second(s) before taking photo")
-            NSThread.sleepForTimeInterval(photoDelayTime)
+            // Only wait on first attempt at taking photo
+            if let settleMonitor = self.settleMonitor {
+                DDLogDebug("Wait up to \(photoDelayTime) second(s) for the view to settle before taking photo")
+
+                let start = CACurrentMediaTime()
+                let settled = settleMonitor.waitUntilSettled(photoDelayTime)
+
+                DDLogDebug(String(format: "View %@ after %.2f second(s)", settled ? "settled" : "did not settle", CACurrentMediaTime() - start))
+            } else {
+                DDLogDebug("Sleep for \(photoDelayTime) second(s) before taking photo")
+                NSThread.sleepForTimeInterval(photoDelayTime)
+            }
         }
         
+        self.delegate?.cameraControllerShutterFired(videoClockTimeTag())
+
         self.camera.startShootPhoto(djiPhotoMode) {
             (error) in
                 if let e = error {
@@ -337,9 +361,20 @@ class CameraController: NSObject, DJICameraDelegate {
     }
 
     func camera(camera: DJICamera, didGenerateNewMediaFile newMedia: DJIMedia) {
+        let timeTag = videoClockTimeTag()
+
         DDLogDebug("Camera Controller didGenerateNewMediaFile")
 
-        self.delegate?.cameraControllerNewMedia(newMedia.fileName)
+        if let latest = self.exposureMonitor?.latestStatistics {
+            let stats = latest.statistics
+
+            DDLogInfo(String(format: "Shot exposure %@ - mean %.1f p5 %d median %d p95 %d shadows %.1f%% highlights %.1f%% bracketing %@",
+                newMedia.fileName, stats.mean, stats.percentile5, stats.median, stats.percentile95,
+                stats.shadowFraction * 100, stats.highlightFraction * 100,
+                latest.exceedsDynamicRangeWithClipLimit(bracketingClipLimit) ? "suggested" : "not needed"))
+        }
+
+        self.delegate?.cameraControllerNewMedia(newMedia.fileName, timeTag: timeTag)
 
         self.tookShot = true
     }
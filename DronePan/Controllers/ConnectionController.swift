@@ -73,10 +73,13 @@ protocol ConnectionControllerDiagnosticsDelegate {
     var firmwareVersion: String?
 
     func start() {
+        StartupProfiler.sharedInstance.begin("sdkRegistration")
         DJISDKManager.registerApp(appKey, withDelegate: self)
     }
 
     @objc func sdkManagerDidRegisterAppWithError(error: NSError?) {
+        StartupProfiler.sharedInstance.end("sdkRegistration")
+
         if let error = error {
             DDLogWarn("Registration failed with \(error)")
 
@@ -102,6 +105,8 @@ protocol ConnectionControllerDiagnosticsDelegate {
         if let product = newProduct {
             DDLogInfo("Connected to \(self.model)")
 
+            StartupProfiler.sharedInstance.mark("productConnected")
+
             if let model = product.model {
                 trackEvent(category: "Connection", action: "New Product", label: model)
             }
@@ -14,6 +14,7 @@
  */
 
 import Foundation
+import QuartzCore
 
 import DJISDK
 import CocoaLumberjackSwift
@@ -61,6 +62,9 @@ class GimbalController: NSObject, DJIGimbalDelegate, Analytics {
 
     var supportsRangeExtension = false
 
+    // When set a move completes as soon as the picture is still and the attitude reached
+    var motionMonitor: GlobalMotionMonitor?
+
     let gimbalWorkQueue = dispatch_queue_create("com.dronepan.queue.gimbal", DISPATCH_QUEUE_CONCURRENT)
 
     init(gimbal: DJIGimbal, gimbalYawIsRelativeToAircraft: Bool = false, allowsAboveHorizon: Bool = true) {
@@ -428,19 +432,49 @@ class GimbalController: NSObject, DJIGimbalDelegate, Analytics {
             return
         }
 
-        delay(gimbal.completionTimeForControlAngleAction + 0.5) {
-            if !self.check(pitch: pitch, yaw: yaw, roll: roll) {
-                DDLogWarn("Gimbal Controller setAttitude hasn't completed yet count: \(counter)")
+        let timeout = gimbal.completionTimeForControlAngleAction + 0.5
 
-                self.setAttitude(nextCount, pitch: pitch, yaw: yaw, roll: roll)
-            } else {
-                DDLogDebug("Gimbal Controller setAttitude - OK")
+        if let motionMonitor = self.motionMonitor {
+            dispatch_async(self.gimbalWorkQueue) {
+                let start = CACurrentMediaTime()
 
-                self.delegate?.gimbalControllerCompleted()
+                // The picture is still before the gimbal starts to move as well, so the attitude must be reached too
+                while self.status == .Normal && CACurrentMediaTime() - start < timeout {
+                    if motionMonitor.waitUntilStill(timeout - (CACurrentMediaTime() - start)) && self.check(pitch: pitch, yaw: yaw, roll: roll) {
+                        DDLogDebug(String(format: "Gimbal Controller setAttitude - OK - picture still after %.2f second(s)", CACurrentMediaTime() - start))
+
+                        self.delegate?.gimbalControllerCompleted()
+                        return
+                    }
+                }
+
+                if (self.status != .Normal) {
+                    DDLogDebug("Gimbal Controller setAttitude - status was \(self.status) while waiting for the picture - returning")
+
+                    return
+                }
+
+                self.checkAttitude(counter, pitch: pitch, yaw: yaw, roll: roll)
+            }
+        } else {
+            delay(timeout) {
+                self.checkAttitude(counter, pitch: pitch, yaw: yaw, roll: roll)
             }
         }
     }
 
+    private func checkAttitude(counter: Int, pitch: Float, yaw: Float, roll: Float) {
+        if !self.check(pitch: pitch, yaw: yaw, roll: roll) {
+            DDLogWarn("Gimbal Controller setAttitude hasn't completed yet count: \(counter)")
+
+            self.setAttitude(counter + 1, pitch: pitch, yaw: yaw, roll: roll)
+        } else {
+            DDLogDebug("Gimbal Controller setAttitude - OK")
+
+            self.delegate?.gimbalControllerCompleted()
+        }
+    }
+
     @objc func gimbal(gimbal: DJIGimbal, didUpdateGimbalState gimbalState: DJIGimbalState) {
         let atti = gimbalState.attitudeInDegrees
 
@@ -120,6 +120,35 @@ class PanoramaController: Analytics {
     var yawDestination = 0.0
     var yawSpeed = 0.0
 
+    var overlapVerifier: ShotOverlapVerifier?
+
+    var thumbnailDecoder: DJIVideoThumbnailDecoder?
+
+    // Thumbnail of the shot whose media has not arrived yet, only used on the main queue
+    var pendingShotThumbnail: ShotThumbnail?
+
+    // Links each still to the video frame and attitude at its exposure
+    var frameTimeline: FrameTimeline?
+
+    var lastShutterTimeTag: UInt64? = nil
+
+    // Stitched from the video while the mission runs
+    var panoramaPreview: PanoramaPreview?
+
+    // Commanded pitch and yaw of the photo being taken
+    var previewShot: (pitch: Double, yaw: Double)?
+
+    // Most corrective shots added to one panorama
+    let maxCorrectiveShots = 6
+
+    let overlapQueue = dispatch_queue_create("com.dronepan.overlap", DISPATCH_QUEUE_SERIAL)
+    let overlapDispatchGroup = dispatch_group_create()
+
+    var currentShot: (position: ShotPosition, pitch: Double, yaw: Double)?
+    var plannedShots: [ShotPosition: (pitch: Double, yaw: Double)] = [:]
+    var correctiveShots: [(pitch: Double, yaw: Double)] = []
+    var correctiveShotCount = 0
+
     func pitchesForLoop(maxPitch maxPitch: Double, maxPitchEnabled: Bool, type: ProductType, rowCount: Int) -> Array<Double> {
         let min: Double = -90
         let max: Double = maxPitchEnabled ? maxPitch : 0
@@ -152,6 +181,18 @@ class PanoramaController: Analytics {
     func headingTo360(heading: Double) -> Double {
         return heading >= 0 ? heading : heading + 360.0
     }
+
+    // Shorter turn between two headings - positive is clockwise
+    func yawTurn(from from: Double, to: Double) -> Double {
+        return fmod(fmod(to - from, 360.0) + 540.0, 360.0) - 180.0
+    }
+
+    // Heading half way along the shorter turn between two headings
+    func midpointYaw(from from: Double, to: Double) -> Double {
+        let turn = yawTurn(from: from, to: to)
+
+        return fmod(from + turn / 2 + 360.0, 360.0)
+    }
 }
 
 // MARK: - Main Logic
@@ -323,6 +364,9 @@ extension PanoramaController {
             self.totalCount = ModelSettings.numberOfImagesForCurrentSettings(model)
             self.currentCount = 0
 
+            self.resetOverlapVerification()
+            self.panoramaPreview?.reset()
+
             DDLogDebug("PanoLoop: starting")
 
             dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), {
@@ -334,8 +378,11 @@ extension PanoramaController {
                 DDLogDebug("PanoLoop: resetGimbal")
                 self.resetGimbal()
 
+                // The column of shots is taken at the heading reached by the previous yaw
+                var columnYaw = self.headingTo360(self.currentHeading)
+
                 // Loop through the yaws
-                for yaw in yaws {
+                for (column, yaw) in yaws.enumerate() {
                     DDLogDebug("PanoLoop: YawLoop: \(yaw)")
 
                     // If the user has stopped the pano we'll break
@@ -346,7 +393,7 @@ extension PanoramaController {
                     }
 
                     // Loop through the gimbal pitches
-                    for pitch in pitches {
+                    for (row, pitch) in pitches.enumerate() {
                         DDLogDebug("PanoLoop: YawLoop: \(yaw), PitchLoop: \(pitch)")
 
                         // If the user has stopped the pano we'll break
@@ -360,35 +407,30 @@ extension PanoramaController {
                         self.setPitch(pitch)
 
                         DDLogDebug("PanoLoop: YawLoop: \(yaw), PitchLoop: \(pitch)- take photo")
+                        self.planShot(ShotPosition(column: column, row: row), pitch: pitch, yaw: columnYaw)
+                        self.aimPreview(pitch: pitch, yaw: columnYaw)
                         self.takeASnap(photoDelayTime)
+                        self.endShot()
 
                     }
                     // End the gimbal pitch loop
 
+                    // Fill the gaps the column left before moving on
+                    if self.panoRunning.state {
+                        self.takeCorrectiveShots(yaw: columnYaw, aircraftYaw: aircraftYaw, photoDelayTime: photoDelayTime)
+                    }
+
                     // Now we yaw after a column of photos has been taken
                     if (aircraftYaw) {
                         DDLogDebug("PanoLoop: YawLoop: \(yaw) - AC yaw")
 
-                        self.yawSpeed = 30 // This represents 30m/sec
-                        self.yawDestination = yaw
-
-                        // Calling this on a timer as it improves the accuracy of aircraft yaw
-                        dispatch_sync(self.droneCommandsQueue, {
-                            let timer = NSTimer.scheduledTimerWithTimeInterval(0.1,
-                                    target: self,
-                                    selector: #selector(PanoramaController.yawAircraftUsingVelocity(_:)),
-                            userInfo: nil,
-                            repeats: true)
-
-                            NSRunLoop.currentRunLoop().addTimer(timer, forMode: NSDefaultRunLoopMode)
-                            NSRunLoop.currentRunLoop().runUntilDate(NSDate(timeIntervalSinceNow: 5))
-
-                            timer.invalidate()
-                        })
+                        self.yawAircraft(yaw)
                     } else {
                         DDLogDebug("PanoLoop: YawLoop: \(yaw) - gimbal yaw")
                         self.setYaw(yaw)
                     }
+
+                    columnYaw = yaw
                 } // End yaw loop
 
                 // Take the final zenith/nadir shots and then reset the gimbal back
@@ -401,32 +443,18 @@ extension PanoramaController {
                         // Now we yaw after a column of photos has been taken
                         if (aircraftYaw) {
                             DDLogDebug("PanoLoop: NadirYawLoop: \(yaw) - AC yaw")
-                            
-                            self.yawSpeed = 30 // This represents 30m/sec
-                            self.yawDestination = yaw
-                            
-                            // Calling this on a timer as it improves the accuracy of aircraft yaw
-                            dispatch_sync(self.droneCommandsQueue, {
-                                let timer = NSTimer.scheduledTimerWithTimeInterval(0.1,
-                                    target: self,
-                                    selector: #selector(PanoramaController.yawAircraftUsingVelocity(_:)),
-                                    userInfo: nil,
-                                    repeats: true)
-                                
-                                NSRunLoop.currentRunLoop().addTimer(timer, forMode: NSDefaultRunLoopMode)
-                                NSRunLoop.currentRunLoop().runUntilDate(NSDate(timeIntervalSinceNow: 5))
-                                
-                                timer.invalidate()
-                            })
+                            self.yawAircraft(yaw)
                         } else {
                             DDLogDebug("PanoLoop: NadirYawLoop: \(yaw) - gimbal yaw")
                             self.setYaw(yaw)
                         }
 
                         DDLogDebug("PanoLoop: NadirYawLoop: \(yaw) - take photo")
+                        self.aimPreview(pitch: -90.0, yaw: yaw)
                         self.takeASnap(photoDelayTime)
                     }
 
+                    self.currentPanorama?.preview = self.panoramaPreview?.image()
                     self.currentPanorama?.finish()
                     
                     // Add this back in when we have the pano overview ready when pano is completed
@@ -476,6 +504,8 @@ extension PanoramaController {
     func resetGimbal() {
         DDLogDebug("Reset gimbal")
 
+        self.closeShotThumbnail()
+
         if let c = self.gimbalController {
             self.gimbalDispatchGroup.enter()
             DDLogDebug("Reset gimbal - send")
@@ -488,6 +518,8 @@ extension PanoramaController {
     func setPitch(pitch: Double) {
         DDLogDebug("Set pitch \(pitch)")
 
+        self.closeShotThumbnail()
+
         if let c = self.gimbalController {
             self.gimbalDispatchGroup.enter()
             DDLogDebug("Set pitch \(pitch) - send")
@@ -501,6 +533,8 @@ extension PanoramaController {
     func setYaw(yaw: Double) {
         DDLogDebug("Set yaw \(yaw)")
 
+        self.closeShotThumbnail()
+
         if let c = self.gimbalController {
             self.gimbalDispatchGroup.enter()
             DDLogDebug("Set yaw \(yaw) - send")
@@ -510,6 +544,28 @@ extension PanoramaController {
         }
     }
 
+    func yawAircraft(yaw: Double) {
+        self.closeShotThumbnail()
+
+        // Corrective shots may lie behind the current heading
+        self.yawSpeed = yawTurn(from: self.currentHeading, to: yaw) < 0 ? -30 : 30 // This represents 30m/sec
+        self.yawDestination = yaw
+
+        // Calling this on a timer as it improves the accuracy of aircraft yaw
+        dispatch_sync(self.droneCommandsQueue, {
+            let timer = NSTimer.scheduledTimerWithTimeInterval(0.1,
+                    target: self,
+                    selector: #selector(PanoramaController.yawAircraftUsingVelocity(_:)),
+                    userInfo: nil,
+                    repeats: true)
+
+            NSRunLoop.currentRunLoop().addTimer(timer, forMode: NSDefaultRunLoopMode)
+            NSRunLoop.currentRunLoop().runUntilDate(NSDate(timeIntervalSinceNow: 5))
+
+            timer.invalidate()
+        })
+    }
+
     @objc func yawAircraftUsingVelocity(timer: NSTimer) {
         if let c = self.flightController {
             c.yaw(self.yawSpeed)
@@ -529,14 +585,246 @@ extension PanoramaController {
     }
 }
 
+// MARK: - Overlap Verification
+
+extension PanoramaController {
+    func resetOverlapVerification() {
+        self.overlapVerifier?.reset()
+
+        dispatch_sync(overlapQueue) {
+            self.currentShot = nil
+            self.plannedShots.removeAll()
+            self.correctiveShots.removeAll()
+            self.correctiveShotCount = 0
+        }
+    }
+
+    // The next photo is the shot at this position of the plan
+    func planShot(position: ShotPosition, pitch: Double, yaw: Double) {
+        dispatch_sync(overlapQueue) {
+            self.currentShot = (position: position, pitch: pitch, yaw: yaw)
+            self.plannedShots[position] = (pitch: pitch, yaw: yaw)
+        }
+    }
+
+    // A shot whose photo never arrived must not take the next photo as its own
+    func endShot() {
+        dispatch_sync(overlapQueue) {
+            if let shot = self.currentShot {
+                DDLogWarn("No photo arrived for shot C\(shot.position.column) R\(shot.position.row)")
+
+                self.currentShot = nil
+            }
+        }
+    }
+
+    func aimPreview(pitch pitch: Double, yaw: Double) {
+        dispatch_sync(overlapQueue) {
+            self.previewShot = (pitch: pitch, yaw: yaw)
+        }
+    }
+
+    private func addShotToPreview() {
+        var shot: (pitch: Double, yaw: Double)? = nil
+
+        dispatch_sync(overlapQueue) {
+            // Bracketing stores several files for one shot - only the first is blended
+            shot = self.previewShot
+            self.previewShot = nil
+        }
+
+        if let shot = shot {
+            self.panoramaPreview?.addShot(pitch: shot.pitch, yaw: shot.yaw)
+        }
+    }
+
+    private func recordAttitude() {
+        let attitude = TimedAttitude(gimbalPitch: Double(lastGimbalPitch), gimbalYaw: Double(lastGimbalYaw),
+                                     gimbalRoll: Double(lastGimbalRoll), aircraftYaw: Double(lastACYaw))
+
+        self.frameTimeline?.addAttitude(attitude, timeTag: videoClockTimeTag())
+    }
+
+    private func verifyOverlap() {
+        guard let verifier = self.overlapVerifier else {
+            return
+        }
+
+        var planned: (position: ShotPosition, pitch: Double, yaw: Double)? = nil
+
+        dispatch_sync(overlapQueue) {
+            // Bracketing stores several files for one shot - only the first is kept
+            planned = self.currentShot
+            self.currentShot = nil
+        }
+
+        guard let shot = planned else {
+            return
+        }
+
+        // The capture waits for the next frame, the camera callback and the overlap queue must not
+        dispatch_group_async(overlapDispatchGroup, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0)) {
+            if verifier.captureShot(shot.position) {
+                dispatch_group_async(self.overlapDispatchGroup, self.overlapQueue) {
+                    self.checkOverlaps(shot)
+                }
+            }
+        }
+    }
+
+    private func checkOverlaps(shot: (position: ShotPosition, pitch: Double, yaw: Double)) {
+        guard let verifier = self.overlapVerifier else {
+            return
+        }
+
+        let overlaps = verifier.verifyShot(shot.position)
+
+        for overlap in overlaps {
+            DDLogInfo(String(format: "Shot overlap C%d R%d with C%d R%d - %.0f%% shift %.1f, %.1f peak %.3f%@",
+                shot.position.column, shot.position.row, overlap.neighbour.column, overlap.neighbour.row,
+                overlap.overlap * 100, overlap.dx, overlap.dy, overlap.peak, overlap.reliable ? "" : " - unreliable"))
+        }
+
+        for overlap in verifier.shortfalls(overlaps) {
+            guard let neighbour = self.plannedShots[overlap.neighbour] else {
+                continue
+            }
+
+            if self.correctiveShotCount >= self.maxCorrectiveShots {
+                DDLogWarn("Shot overlap too small but \(self.maxCorrectiveShots) corrective shots already taken")
+
+                break
+            }
+
+            let pitch = (shot.pitch + neighbour.pitch) / 2
+            let yaw = self.midpointYaw(from: neighbour.yaw, to: shot.yaw)
+
+            DDLogInfo("Queue corrective shot at pitch \(pitch) yaw \(yaw)")
+
+            self.trackEvent(category: "Panorama", action: "Overlap", label: "Corrective shot for overlap \(Int(overlap.overlap * 100))%")
+
+            self.correctiveShots.append((pitch: pitch, yaw: yaw))
+            self.correctiveShotCount += 1
+
+            self.totalCount += 1
+            self.delegate?.panoCountChanged(self.currentCount, total: self.totalCount)
+        }
+    }
+
+    func takeCorrectiveShots(yaw yaw: Double, aircraftYaw: Bool, photoDelayTime: Double) {
+        // The last shot of the column may still be being verified
+        dispatch_group_wait(overlapDispatchGroup, dispatch_time(DISPATCH_TIME_NOW, Int64(5 * NSEC_PER_SEC)))
+
+        var shots: [(pitch: Double, yaw: Double)] = []
+
+        dispatch_sync(overlapQueue) {
+            shots = self.correctiveShots
+            self.correctiveShots.removeAll()
+        }
+
+        if shots.isEmpty {
+            return
+        }
+
+        self.delegate?.postUserMessage("Overlap too small - taking \(shots.count) corrective shot(s)")
+
+        // Shots within the column first so that the heading only changes once
+        var currentYaw = yaw
+
+        for shot in shots.filter({ $0.yaw == yaw }) + shots.filter({ $0.yaw != yaw }) {
+            if !self.panoRunning.state {
+                break
+            }
+
+            if shot.yaw != currentYaw {
+                DDLogDebug("PanoLoop: Corrective shot - yaw \(shot.yaw)")
+
+                if aircraftYaw {
+                    self.yawAircraft(shot.yaw)
+                } else {
+                    self.setYaw(shot.yaw)
+                }
+
+                currentYaw = shot.yaw
+            }
+
+            DDLogDebug("PanoLoop: Corrective shot - pitch \(shot.pitch)")
+            self.setPitch(shot.pitch)
+
+            DDLogDebug("PanoLoop: Corrective shot - take photo")
+            self.aimPreview(pitch: shot.pitch, yaw: shot.yaw)
+            self.takeASnap(photoDelayTime)
+        }
+    }
+}
+
+// MARK: - Shot Thumbnails
+
+// Thumbnail of one shot, the keyframe usually arrives before the filename of the shot is known
+class ShotThumbnail {
+    weak var panorama: Panorama?
+
+    var image: UIImage? {
+        didSet {
+            attach()
+        }
+    }
+
+    var filename: String? {
+        didSet {
+            attach()
+        }
+    }
+
+    init(panorama: Panorama) {
+        self.panorama = panorama
+    }
+
+    private func attach() {
+        if let panorama = panorama, image = image, filename = filename {
+            DDLogDebug("Thumbnail for \(filename)")
+
+            panorama.addThumbnail(image, forFilename: filename)
+        }
+    }
+}
+
+extension PanoramaController {
+    // Only a keyframe from the shutter to the next gimbal or aircraft move shows the view of the shot
+    func requestShotThumbnail(shutterTimeTag: UInt64) {
+        guard let panorama = self.currentPanorama, thumbnailDecoder = self.thumbnailDecoder else {
+            return
+        }
+
+        let shot = ShotThumbnail(panorama: panorama)
+
+        dispatch_async(dispatch_get_main_queue()) {
+            self.pendingShotThumbnail = shot
+        }
+
+        thumbnailDecoder.requestThumbnailAfterTimeTag(shutterTimeTag, handler: {
+            thumbnail in
+
+            shot.image = thumbnail.image
+        }, queue: dispatch_get_main_queue())
+    }
+
+    // A keyframe after the view starts to move is not used, the shot is left without a thumbnail
+    func closeShotThumbnail() {
+        self.thumbnailDecoder?.closeThumbnailRequestsAtTimeTag(videoClockTimeTag())
+    }
+}
+
 // MARK: - Camera Controller Delegate
 
 extension PanoramaController: CameraControllerDelegate {
-    func setCamera(camera: DJICamera?, preview: VideoControllerDelegate? = nil) {
+    func setCamera(camera: DJICamera?, preview: VideoControllerDelegate? = nil, settleMonitor: FrameSettleMonitor? = nil, exposureMonitor: DJIVideoExposureMonitor? = nil) {
         if let camera = camera {
             self.cameraController = CameraController(camera: camera)
             self.cameraController!.model = self.model!
             self.cameraController!.delegate = self
+            self.cameraController!.settleMonitor = settleMonitor
+            self.cameraController!.exposureMonitor = exposureMonitor
 
             if let preview = preview {
                 self.cameraController!.videoDelegate = preview
@@ -612,10 +900,47 @@ extension PanoramaController: CameraControllerDelegate {
         }
     }
 
-    func cameraControllerNewMedia(filename: String) {
-        DDLogInfo("Shot taken: \(filename) ACY: \(lastACYaw) GP: \(lastGimbalPitch) GY: \(lastGimbalYaw) GR: \(lastGimbalRoll)")
-        
+    func cameraControllerShutterFired(timeTag: UInt64) {
+        dispatch_sync(overlapQueue) {
+            self.lastShutterTimeTag = timeTag
+        }
+
+        self.requestShotThumbnail(timeTag)
+    }
+
+    func cameraControllerNewMedia(filename: String, timeTag: UInt64) {
+        var shutterTimeTag = timeTag
+
+        dispatch_sync(overlapQueue) {
+            if let lastShutterTimeTag = self.lastShutterTimeTag where lastShutterTimeTag <= timeTag {
+                shutterTimeTag = lastShutterTimeTag
+            }
+        }
+
+        let link = self.frameTimeline?.linkStill(filename, shutterTimeTag: shutterTimeTag, mediaTimeTag: timeTag)
+
+        if let link = link {
+            self.currentPanorama?.addStill(link)
+        }
+
+        // The attitude at the exposure is more accurate than the last one reported
+        if let link = link, attitude = link.attitude {
+            DDLogInfo(String(format: "Shot taken: %@ frame: %@ delay: %.2fs ACY: %.1f GP: %.1f GY: %.1f GR: %.1f", filename,
+                link.frameUUID.map { "\($0)" } ?? "none", Double(timeTag - shutterTimeTag) / 1000000,
+                attitude.aircraftYaw, attitude.gimbalPitch, attitude.gimbalYaw, attitude.gimbalRoll))
+        } else {
+            DDLogInfo("Shot taken: \(filename) ACY: \(lastACYaw) GP: \(lastGimbalPitch) GY: \(lastGimbalYaw) GR: \(lastGimbalRoll)")
+        }
+
         self.currentPanorama?.addFilename(filename)
+
+        dispatch_async(dispatch_get_main_queue()) {
+            self.pendingShotThumbnail?.filename = filename
+            self.pendingShotThumbnail = nil
+        }
+
+        self.addShotToPreview()
+        self.verifyOverlap()
     }
     
     func cameraExposureModeUpdated(mode: DJICameraExposureMode) {
@@ -664,18 +989,11 @@ extension PanoramaController: FlightControllerDelegate {
     func flightControllerUpdateHeading(compassHeading: Double) {
         self.currentHeading = self.headingTo360(compassHeading)
 
-        var diff = 0.0
-
-        if (self.yawDestination > self.currentHeading) {
-            diff = fabs(self.yawDestination) - fabs(self.currentHeading)
-            self.yawSpeed = diff * 0.5
-        } else {
-            // This happens when the current heading is 340 and destination is 40, for example
-            diff = fabs(self.currentHeading) - fabs(self.yawDestination)
-            self.yawSpeed = fmod(360.0, diff) * 0.5
-        }
+        // Turn the shorter way, 340 to 40 goes clockwise and 40 to 20 anticlockwise
+        self.yawSpeed = yawTurn(from: self.currentHeading, to: self.yawDestination) * 0.5
 
         self.lastACYaw = Float(self.currentHeading)
+        self.recordAttitude()
         self.delegate?.aircraftYawChanged(lastACYaw)
         self.gimbalController?.setACYaw(self.lastACYaw)
     }
@@ -711,13 +1029,14 @@ extension PanoramaController: FlightControllerDelegate {
 // MARK: - Gimbal Controller Delegate
 
 extension PanoramaController: GimbalControllerDelegate {
-    func setGimbal(gimbal: DJIGimbal?) {
+    func setGimbal(gimbal: DJIGimbal?, motionMonitor: GlobalMotionMonitor? = nil) {
         if let gimbal = gimbal {
             self.gimbalController = GimbalController(gimbal: gimbal,
                                                      gimbalYawIsRelativeToAircraft: ControllerUtils.gimbalYawIsRelativeToAircraft(self.model),
                                                      allowsAboveHorizon: ModelConfig.allowsAboveHorizon(self.model ?? ""))
             
             self.gimbalController!.delegate = self
+            self.gimbalController!.motionMonitor = motionMonitor
             
             if let model = self.model, maxPitch = self.gimbalController?.getMaxPitch() {
                 ModelSettings.updateSettings(model, settings: [.MaxPitch: maxPitch])
@@ -765,6 +1084,7 @@ extension PanoramaController: GimbalControllerDelegate {
         lastGimbalPitch = pitch
         lastGimbalYaw = yaw
         lastGimbalRoll = roll
+        self.recordAttitude()
 
         self.delegate?.gimbalAttitudeChanged(pitch: pitch, yaw: yaw, roll: roll)
     }
@@ -27,6 +27,22 @@ enum DecoderType {
 class PreviewController: VideoControllerDelegate {
     let previewer: VideoPreviewerWrapper
 
+    var receivedVideo = false
+
+    let settleMonitor = FrameSettleMonitor()
+
+    let exposureMonitor = DJIVideoExposureMonitor()
+
+    let motionMonitor = GlobalMotionMonitor()
+
+    let overlapVerifier = ShotOverlapVerifier()
+
+    let thumbnailDecoder = DJIVideoThumbnailDecoder()
+
+    let frameTimeline = FrameTimeline()
+
+    let panoramaPreview = PanoramaPreview()
+
     init(previewer : VideoPreviewerWrapper) {
         self.previewer = previewer
     }
@@ -34,9 +50,23 @@ class PreviewController: VideoControllerDelegate {
     func startWithView(view: UIView) {
         previewer.start()
         previewer.setView(view)
+        previewer.registFrameProcessor(settleMonitor)
+        previewer.registFrameProcessor(exposureMonitor)
+        previewer.registFrameProcessor(motionMonitor)
+        previewer.registFrameProcessor(overlapVerifier)
+        previewer.registStreamProcessor(thumbnailDecoder)
+        previewer.registFrameProcessor(frameTimeline)
+        previewer.registFrameProcessor(panoramaPreview)
     }
 
     func removeFromView() {
+        previewer.unregistProcessor(settleMonitor)
+        previewer.unregistProcessor(exposureMonitor)
+        previewer.unregistProcessor(motionMonitor)
+        previewer.unregistProcessor(overlapVerifier)
+        previewer.unregistProcessor(thumbnailDecoder)
+        previewer.unregistProcessor(frameTimeline)
+        previewer.unregistProcessor(panoramaPreview)
         previewer.unSetView()
     }
 
@@ -64,6 +94,14 @@ class PreviewController: VideoControllerDelegate {
     }
 
     func cameraReceivedVideo(videoBuffer: UnsafeMutablePointer<UInt8>, size: Int) {
+        if !receivedVideo {
+            receivedVideo = true
+
+            let profiler = StartupProfiler.sharedInstance
+            profiler.mark("firstVideoData")
+            profiler.logTimeline()
+        }
+
         let pBuffer = UnsafeMutablePointer<UInt8>.alloc(size)
         memcpy(pBuffer, videoBuffer, size)
         previewer.push(pBuffer, length: Int32(size))
@@ -14,6 +14,7 @@
  */
 
 import Foundation
+import UIKit
 import CocoaLumberjackSwift
 
 class Panorama {
@@ -22,6 +23,15 @@ class Panorama {
     
     var imageList : [String] = []
     
+    // Preview of each shot by filename, filled in as the keyframes are decoded
+    var thumbnails : [String: UIImage] = [:]
+    
+    // Video frame and attitude at the exposure of each shot by filename
+    var stills : [String: StillFrameLink] = [:]
+    
+    // Equirectangular preview stitched from the video during the mission
+    var preview : UIImage?
+    
     init() {
         self.startTime = NSDate()
     }
@@ -33,4 +43,12 @@ class Panorama {
     func addFilename(filename: String) {
         imageList.append(filename)
     }
+    
+    func addThumbnail(thumbnail: UIImage, forFilename filename: String) {
+        thumbnails[filename] = thumbnail
+    }
+    
+    func addStill(link: StillFrameLink) {
+        stills[link.filename] = link
+    }
 }
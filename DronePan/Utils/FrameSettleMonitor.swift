@@ -0,0 +1,151 @@
+/*
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import Foundation
+import QuartzCore
+import CocoaLumberjackSwift
+
+struct FrameSettleSample {
+    // Laplacian variance of the frame, drops when the picture is blurred
+    let sharpness: Double
+
+    // Mean luma difference to the previous frame, nil when there was no previous frame
+    let motion: Double?
+}
+
+/**
+ * Watches the decoded video and tells when the picture has settled - still and with a steady sharpness - so that
+ * a shot can be taken as soon as the gimbal and airframe stop moving instead of after a fixed delay.
+ */
+class FrameSettleMonitor: NSObject, VideoFrameProcessor {
+    // Consecutive frames that must be still
+    let windowSize: Int
+
+    // Mean luma difference between frames below which the picture is still
+    let maxMotion: Double
+
+    // Allowed spread of the sharpness within the window relative to its mean
+    let sharpnessTolerance: Double
+
+    var enabled = true
+
+    private let frames = FrameWaiter(label: "FrameSettleMonitor")
+
+    private var samples: [FrameSettleSample] = []
+
+    init(windowSize: Int = 5, maxMotion: Double = 1.5, sharpnessTolerance: Double = 0.15) {
+        self.windowSize = windowSize
+        self.maxMotion = maxMotion
+        self.sharpnessTolerance = sharpnessTolerance
+    }
+
+    var settled: Bool {
+        var result = false
+
+        dispatch_sync(frames.queue) {
+            result = self.isSettled()
+        }
+
+        return result
+    }
+
+    /**
+     * Block until the picture has settled. Frames decoded before the call are ignored as they may show the movement
+     * that is just ending.
+     *
+     * - parameter timeout: longest wait in seconds
+     * - returns: false if the picture did not settle in time
+     */
+    func waitUntilSettled(timeout: Double) -> Bool {
+        return frames.wait(timeout) {
+            self.samples.removeAll()
+        }
+    }
+
+    func addSample(sample: FrameSettleSample) {
+        dispatch_sync(frames.queue) {
+            self.samples.append(sample)
+
+            if self.samples.count > self.windowSize {
+                self.samples.removeFirst(self.samples.count - self.windowSize)
+            }
+
+            if self.frames.hasWaiters && self.isSettled() {
+                DDLogDebug("Frame settle monitor - settled with sharpness \(sample.sharpness)")
+
+                self.frames.signalWaiters()
+            }
+        }
+    }
+
+    // Must be called on frames.queue
+    private func isSettled() -> Bool {
+        if samples.count < windowSize {
+            return false
+        }
+
+        for sample in samples {
+            guard let motion = sample.motion where motion <= maxMotion else {
+                return false
+            }
+        }
+
+        let sharpness = samples.map { $0.sharpness }
+        let mean = sharpness.reduce(0, combine: +) / Double(sharpness.count)
+
+        guard let high = sharpness.maxElement(), low = sharpness.minElement() where mean > 0 else {
+            return false
+        }
+
+        return (high - low) <= sharpnessTolerance * mean
+    }
+
+    // MARK: - Video Frame Processor
+
+    func videoProcessorEnabled() -> Bool {
+        return enabled
+    }
+
+    func videoProcessorPyramidLevel() -> Int32 {
+        return 1
+    }
+
+    func videoProcessPyramidLevel(level: UnsafeMutablePointer<VideoFramePyramidLevel>, frame: UnsafeMutablePointer<VideoFrameYUV>) {
+        let luma = level.memory.luma
+        let width = level.memory.width
+        let height = level.memory.height
+
+        let sharpness = lumaLaplacianVariance(luma, width, width, height)
+
+        if sharpness < 0 {
+            return
+        }
+
+        var motion: Double? = nil
+
+        frames.compareWithPrevious(level) { previousLuma in
+            motion = lumaMeanAbsoluteDifference(luma, width, previousLuma, width, width, height)
+        }
+
+        addSample(FrameSettleSample(sharpness: sharpness, motion: motion))
+    }
+
+    func videoProcessFrame(frame: UnsafeMutablePointer<VideoFrameYUV>) {
+        // Frames arrive as pyramid levels
+    }
+
+    func videoProcessFailedFrame() {
+    }
+}
@@ -0,0 +1,229 @@
+/*
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import Foundation
+
+// Gimbal and aircraft angles at one instant of the video clock
+struct TimedAttitude {
+    let gimbalPitch: Double
+    let gimbalYaw: Double
+    let gimbalRoll: Double
+    let aircraftYaw: Double
+}
+
+// A still linked to the video frame nearest its exposure
+struct StillFrameLink {
+    let filename: String
+
+    // Video clock time tags in microseconds
+    let shutterTimeTag: UInt64
+    let mediaTimeTag: UInt64
+
+    let frameUUID: UInt32?
+    let frameTimeTag: UInt64?
+
+    let attitude: TimedAttitude?
+}
+
+/**
+ * Short history of the decoded video frames and of the gimbal and aircraft attitude, both stamped on the video clock
+ * (videoClockTimeTag), so that a shutter event stamped on the same clock can be matched to the frame that shows it.
+ */
+class FrameTimeline: NSObject, VideoFrameProcessor {
+    // Number of frames and of attitude samples kept
+    let capacity: Int
+
+    // Time from the exposure to the arrival of the frame that shows it - the live view lags the camera
+    var videoLatency: UInt64 = 0
+
+    var enabled = true
+
+    private let queue = dispatch_queue_create("FrameTimeline", DISPATCH_QUEUE_SERIAL)
+
+    // Both are kept in time tag order
+    private var frames: [(uuid: UInt32, timeTag: UInt64)] = []
+    private var attitudes: [(timeTag: UInt64, attitude: TimedAttitude)] = []
+
+    init(capacity: Int = 300) {
+        self.capacity = capacity
+    }
+
+    func now() -> UInt64 {
+        return videoClockTimeTag()
+    }
+
+    func reset() {
+        dispatch_sync(queue) {
+            self.frames.removeAll()
+            self.attitudes.removeAll()
+        }
+    }
+
+    func addFrame(uuid: UInt32, timeTag: UInt64) {
+        dispatch_sync(queue) {
+            var index = self.frames.count
+
+            while index > 0 && self.frames[index - 1].timeTag > timeTag {
+                index -= 1
+            }
+
+            self.frames.insert((uuid: uuid, timeTag: timeTag), atIndex: index)
+
+            if self.frames.count > self.capacity {
+                self.frames.removeFirst(self.frames.count - self.capacity)
+            }
+        }
+    }
+
+    func addAttitude(attitude: TimedAttitude, timeTag: UInt64) {
+        dispatch_sync(queue) {
+            var index = self.attitudes.count
+
+            while index > 0 && self.attitudes[index - 1].timeTag > timeTag {
+                index -= 1
+            }
+
+            self.attitudes.insert((timeTag: timeTag, attitude: attitude), atIndex: index)
+
+            if self.attitudes.count > self.capacity {
+                self.attitudes.removeFirst(self.attitudes.count - self.capacity)
+            }
+        }
+    }
+
+    // Frame whose time tag is closest to the given one
+    func nearestFrame(timeTag: UInt64) -> (uuid: UInt32, timeTag: UInt64)? {
+        var result: (uuid: UInt32, timeTag: UInt64)? = nil
+
+        dispatch_sync(queue) {
+            let index = self.firstIndex(self.frames.map { $0.timeTag }, notBefore: timeTag)
+
+            for candidate in [index - 1, index] where candidate >= 0 && candidate < self.frames.count {
+                let frame = self.frames[candidate]
+
+                if let best = result where self.distance(best.timeTag, timeTag) <= self.distance(frame.timeTag, timeTag) {
+                    continue
+                }
+
+                result = frame
+            }
+        }
+
+        return result
+    }
+
+    /**
+     * Attitude interpolated between the samples around the time tag. Yaws are interpolated the short way round.
+     *
+     * - returns: the first or last sample outside the recorded span, nil without samples
+     */
+    func attitude(timeTag: UInt64) -> TimedAttitude? {
+        var result: TimedAttitude? = nil
+
+        dispatch_sync(queue) {
+            guard let first = self.attitudes.first, last = self.attitudes.last else {
+                return
+            }
+
+            let index = self.firstIndex(self.attitudes.map { $0.timeTag }, notBefore: timeTag)
+
+            if index == 0 {
+                result = first.attitude
+                return
+            }
+
+            if index == self.attitudes.count {
+                result = last.attitude
+                return
+            }
+
+            let before = self.attitudes[index - 1]
+            let after = self.attitudes[index]
+
+            let span = Double(after.timeTag - before.timeTag)
+            let fraction = span > 0 ? Double(timeTag - before.timeTag) / span : 0
+
+            result = TimedAttitude(gimbalPitch: self.interpolate(before.attitude.gimbalPitch, after.attitude.gimbalPitch, fraction),
+                                   gimbalYaw: self.interpolateAngle(before.attitude.gimbalYaw, after.attitude.gimbalYaw, fraction),
+                                   gimbalRoll: self.interpolate(before.attitude.gimbalRoll, after.attitude.gimbalRoll, fraction),
+                                   aircraftYaw: self.interpolateAngle(before.attitude.aircraftYaw, after.attitude.aircraftYaw, fraction))
+        }
+
+        return result
+    }
+
+    /**
+     * Link a still to the frame nearest its exposure. The exposure is taken to be at the shutter event, the frame
+     * showing it arrives videoLatency later.
+     */
+    func linkStill(filename: String, shutterTimeTag: UInt64, mediaTimeTag: UInt64) -> StillFrameLink {
+        let frame = nearestFrame(shutterTimeTag + videoLatency)
+
+        return StillFrameLink(filename: filename, shutterTimeTag: shutterTimeTag, mediaTimeTag: mediaTimeTag,
+                              frameUUID: frame?.uuid, frameTimeTag: frame?.timeTag, attitude: attitude(shutterTimeTag))
+    }
+
+    private func firstIndex(timeTags: [UInt64], notBefore timeTag: UInt64) -> Int {
+        var low = 0
+        var high = timeTags.count
+
+        while low < high {
+            let middle = (low + high) / 2
+
+            if timeTags[middle] < timeTag {
+                low = middle + 1
+            } else {
+                high = middle
+            }
+        }
+
+        return low
+    }
+
+    private func distance(lhs: UInt64, _ rhs: UInt64) -> UInt64 {
+        return lhs > rhs ? lhs - rhs : rhs - lhs
+    }
+
+    private func interpolate(from: Double, _ to: Double, _ fraction: Double) -> Double {
+        return from + (to - from) * fraction
+    }
+
+    // The result keeps the range of the inputs - gimbal yaws are -180 to 180, aircraft headings 0 to 360
+    private func interpolateAngle(from: Double, _ to: Double, _ fraction: Double) -> Double {
+        let turn = fmod(to - from + 540.0, 360.0) - 180.0
+        let angle = fmod(from + turn * fraction + 360.0, 360.0)
+
+        if from >= 0 && to >= 0 {
+            return angle
+        }
+
+        return angle > 180.0 ? angle - 360.0 : angle
+    }
+
+    // MARK: - Video Frame Processor
+
+    func videoProcessorEnabled() -> Bool {
+        return enabled
+    }
+
+    func videoProcessFrame(frame: UnsafeMutablePointer<VideoFrameYUV>) {
+        if frame.memory.frame_uuid != UInt32(H264_FRAME_INVALIED_UUID) && frame.memory.time_tag != 0 {
+            addFrame(frame.memory.frame_uuid, timeTag: frame.memory.time_tag)
+        }
+    }
+
+    func videoProcessFailedFrame() {
+    }
+}
@@ -0,0 +1,100 @@
+/*
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import Foundation
+
+/**
+ * Shared plumbing of the monitors that watch the decoded video: a serial queue guarding their state, the threads
+ * blocked until a condition holds, and a copy of the previous pyramid level to compare the next one with.
+ */
+class FrameWaiter {
+    let queue: dispatch_queue_t
+
+    private var waiters: [dispatch_semaphore_t] = []
+
+    private var previousLuma: [UInt8] = []
+    private var previousWidth = 0
+    private var previousHeight = 0
+
+    init(label: String) {
+        queue = dispatch_queue_create(label, DISPATCH_QUEUE_SERIAL)
+    }
+
+    // Must be called on queue
+    var hasWaiters: Bool {
+        return !waiters.isEmpty
+    }
+
+    /**
+     * Block until `signalWaiters` is called.
+     *
+     * - parameter timeout: longest wait in seconds
+     * - parameter reset: run on the queue before the wait starts
+     * - returns: false if nothing signalled in time
+     */
+    func wait(timeout: Double, reset: () -> ()) -> Bool {
+        let semaphore = dispatch_semaphore_create(0)
+
+        dispatch_sync(queue) {
+            reset()
+            self.waiters.append(semaphore)
+        }
+
+        let result = dispatch_semaphore_wait(semaphore, dispatch_time(DISPATCH_TIME_NOW, Int64(timeout * Double(NSEC_PER_SEC))))
+
+        if result != 0 {
+            dispatch_sync(queue) {
+                self.waiters = self.waiters.filter { $0 !== semaphore }
+            }
+        }
+
+        return result == 0
+    }
+
+    // Must be called on queue
+    func signalWaiters() {
+        for waiter in waiters {
+            dispatch_semaphore_signal(waiter)
+        }
+
+        waiters.removeAll()
+    }
+
+    /**
+     * Hand the previous level to `compare` when it has the same size, then keep a copy of this level for the next call.
+     *
+     * Levels arrive one at a time, from the decode thread or, once the monitor is demoted, from its lane queue, so
+     * the previous level needs no lock.
+     */
+    func compareWithPrevious(level: UnsafeMutablePointer<VideoFramePyramidLevel>, compare: UnsafePointer<UInt8> -> ()) {
+        let luma = level.memory.luma
+        let width = Int(level.memory.width)
+        let height = Int(level.memory.height)
+
+        if width == previousWidth && height == previousHeight {
+            previousLuma.withUnsafeBufferPointer { buffer in
+                compare(buffer.baseAddress)
+            }
+        } else {
+            previousLuma = [UInt8](count: width * height, repeatedValue: 0)
+            previousWidth = width
+            previousHeight = height
+        }
+
+        previousLuma.withUnsafeMutableBufferPointer { buffer in
+            memcpy(buffer.baseAddress, luma, width * height)
+        }
+    }
+}
@@ -0,0 +1,128 @@
+/*
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import Foundation
+import CocoaLumberjackSwift
+
+/**
+ * Estimates the global motion between consecutive decoded frames and tells when the picture has stopped moving, so
+ * that a gimbal step can complete as soon as the view is still instead of after a worst case timer.
+ */
+class GlobalMotionMonitor: NSObject, VideoFrameProcessor {
+    // Largest motion per frame in pixels of the decoded frame that counts as still
+    let maxShift: Double
+
+    // Consecutive still frames needed
+    let stillFrames: Int
+
+    // Largest motion per frame measured, in pixels of the pyramid level
+    let searchRange: Int32 = 4
+
+    var enabled = true
+
+    private let frames = FrameWaiter(label: "GlobalMotionMonitor")
+
+    private var stillCount = 0
+    private var lastShift: Double? = nil
+
+    init(maxShift: Double = 1.0, stillFrames: Int = 3) {
+        self.maxShift = maxShift
+        self.stillFrames = stillFrames
+    }
+
+    var still: Bool {
+        var result = false
+
+        dispatch_sync(frames.queue) {
+            result = self.stillCount >= self.stillFrames
+        }
+
+        return result
+    }
+
+    // Motion of the last frame in pixels of the decoded frame, nil when it was too fast to measure
+    var latestShift: Double? {
+        var result: Double? = nil
+
+        dispatch_sync(frames.queue) {
+            result = self.lastShift
+        }
+
+        return result
+    }
+
+    /**
+     * Block until the picture is still. Frames decoded before the call are ignored.
+     *
+     * - parameter timeout: longest wait in seconds
+     * - returns: false if the picture did not come to rest in time
+     */
+    func waitUntilStill(timeout: Double) -> Bool {
+        return frames.wait(timeout) {
+            self.stillCount = 0
+        }
+    }
+
+    func addShift(shift: Double?) {
+        dispatch_sync(frames.queue) {
+            self.lastShift = shift
+
+            if let shift = shift where shift <= self.maxShift {
+                self.stillCount += 1
+            } else {
+                self.stillCount = 0
+            }
+
+            if self.stillCount >= self.stillFrames && self.frames.hasWaiters {
+                DDLogDebug("Global motion monitor - still after \(self.stillCount) frames")
+
+                self.frames.signalWaiters()
+            }
+        }
+    }
+
+    // MARK: - Video Frame Processor
+
+    func videoProcessorEnabled() -> Bool {
+        return enabled
+    }
+
+    func videoProcessorPyramidLevel() -> Int32 {
+        return 1
+    }
+
+    func videoProcessPyramidLevel(level: UnsafeMutablePointer<VideoFramePyramidLevel>, frame: UnsafeMutablePointer<VideoFrameYUV>) {
+        let luma = level.memory.luma
+        let width = level.memory.width
+        let height = level.memory.height
+
+        frames.compareWithPrevious(level) { previousLuma in
+            var motion = VideoGlobalMotion()
+
+            if estimateGlobalMotion(previousLuma, width, luma, width, width, height, self.searchRange, &motion) == 0 {
+                let scale = Double(frame.memory.width) / Double(width)
+
+                self.addShift(motion.atSearchLimit ? nil : hypot(Double(motion.dx), Double(motion.dy)) * scale)
+            }
+        }
+    }
+
+    func videoProcessFrame(frame: UnsafeMutablePointer<VideoFrameYUV>) {
+        // Frames arrive as pyramid levels
+    }
+
+    func videoProcessFailedFrame() {
+    }
+}
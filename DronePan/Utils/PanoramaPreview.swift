@@ -0,0 +1,227 @@
+/*
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import Foundation
+import UIKit
+import QuartzCore
+
+import CocoaLumberjackSwift
+
+/**
+ * Low resolution equirectangular preview of the panorama, stitched while the mission runs. The decoded frame after
+ * each shot is reprojected with the commanded gimbal pitch and yaw through a remap table built once per pitch, and
+ * blended into the canvas on a background queue so the capture loop never waits for it.
+ */
+class PanoramaPreview: NSObject, VideoFrameProcessor {
+    let canvasWidth: Int32
+
+    // Horizontal field of view of the live view
+    let horizontalFov: Float
+
+    var enabled = true
+
+    private struct Shot {
+        let pitch: Double
+        let yaw: Double
+    }
+
+    private let queue = dispatch_queue_create("PanoramaPreview", DISPATCH_QUEUE_SERIAL)
+    private let blendQueue = dispatch_queue_create("PanoramaPreview.blend", DISPATCH_QUEUE_SERIAL)
+
+    // Shots waiting for the next decoded frame
+    private var pendingShots: [Shot] = []
+
+    // Only touched on the blend queue
+    private var canvas = VideoPanoramaCanvas()
+    private var remaps: [Int: VideoPanoramaRemap] = [:]
+    private var originYaw: Double? = nil
+    private var blendedShots = 0
+
+    init(canvasWidth: Int32 = 1024, horizontalFov: Float = 84) {
+        self.canvasWidth = canvasWidth
+        self.horizontalFov = horizontalFov
+
+        super.init()
+
+        dispatch_set_target_queue(blendQueue, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0))
+
+        if createPanoramaCanvas(canvasWidth, canvasWidth / 2, &canvas) != 0 {
+            DDLogWarn("Panorama preview - unable to allocate the canvas")
+        }
+    }
+
+    deinit {
+        for (_, remap) in remaps {
+            var remap = remap
+
+            freePanoramaRemap(&remap)
+        }
+
+        freePanoramaCanvas(&canvas)
+    }
+
+    var shotCount: Int {
+        var result = 0
+
+        dispatch_sync(blendQueue) {
+            result = self.blendedShots
+        }
+
+        return result
+    }
+
+    // Start a new panorama, the yaw of its first shot becomes the canvas center
+    func reset() {
+        dispatch_sync(queue) {
+            self.pendingShots.removeAll()
+        }
+
+        dispatch_async(blendQueue) {
+            clearPanoramaCanvas(&self.canvas)
+            self.originYaw = nil
+            self.blendedShots = 0
+        }
+    }
+
+    // The next decoded frame shows the shot taken at this pitch and yaw
+    func addShot(pitch pitch: Double, yaw: Double) {
+        dispatch_sync(queue) {
+            self.pendingShots.append(Shot(pitch: pitch, yaw: yaw))
+        }
+    }
+
+    // The canvas once all the shots so far are blended, at half the canvas size
+    func image() -> UIImage? {
+        var result: UIImage? = nil
+
+        dispatch_sync(blendQueue) {
+            guard self.canvas.luma != nil else {
+                return
+            }
+
+            var frame = VideoFrameYUV()
+            frame.frameType = UInt8(VPFrameType.YUV420Planer.rawValue)
+            frame.luma = self.canvas.luma
+            frame.chromaB = self.canvas.chromaB
+            frame.chromaR = self.canvas.chromaR
+            frame.width = self.canvas.width
+            frame.height = self.canvas.height
+            frame.lumaSlice = self.canvas.width
+            frame.chromaBSlice = self.canvas.width / 2
+            frame.chromaRSlice = self.canvas.width / 2
+
+            result = DJIVideoThumbnail(ofFrame: &frame, maxWidth: self.canvas.width / 2)?.image
+        }
+
+        return result
+    }
+
+    func blendFrame(luma: [UInt8], chromaB: [UInt8], chromaR: [UInt8], width: Int32, height: Int32, shots: [(pitch: Double, yaw: Double)]) {
+        dispatch_async(blendQueue) {
+            guard self.canvas.luma != nil else {
+                return
+            }
+
+            for shot in shots {
+                // Pitches are commanded in whole degrees, a tenth is plenty to tell the rows apart
+                let key = Int(round(shot.pitch * 10))
+
+                if let remap = self.remaps[key] where remap.sourceWidth != width || remap.sourceHeight != height {
+                    var stale = remap
+
+                    freePanoramaRemap(&stale)
+                    self.remaps[key] = nil
+                }
+
+                if self.remaps[key] == nil {
+                    var remap = VideoPanoramaRemap()
+
+                    if buildPanoramaRemap(self.canvas.width, self.canvas.height, width, height, self.horizontalFov, Float(shot.pitch), &remap) != 0 {
+                        continue
+                    }
+
+                    self.remaps[key] = remap
+                }
+
+                guard var remap = self.remaps[key] else {
+                    continue
+                }
+
+                let origin = self.originYaw ?? shot.yaw
+                self.originYaw = origin
+
+                let start = CACurrentMediaTime()
+
+                luma.withUnsafeBufferPointer { lumaBuffer in
+                    chromaB.withUnsafeBufferPointer { chromaBBuffer in
+                        chromaR.withUnsafeBufferPointer { chromaRBuffer in
+                            var level = VideoFramePyramidLevel(luma: UnsafeMutablePointer(lumaBuffer.baseAddress),
+                                                               chromaB: UnsafeMutablePointer(chromaBBuffer.baseAddress),
+                                                               chromaR: UnsafeMutablePointer(chromaRBuffer.baseAddress),
+                                                               width: width, height: height, level: 0)
+
+                            blendPanoramaShot(&self.canvas, &remap, &level, Float(shot.yaw - origin))
+                        }
+                    }
+                }
+
+                self.blendedShots += 1
+
+                DDLogDebug(String(format: "Panorama preview - blended pitch %.1f yaw %.1f in %.1fms",
+                    shot.pitch, shot.yaw, (CACurrentMediaTime() - start) * 1000))
+            }
+        }
+    }
+
+    // MARK: - Video Frame Processor
+
+    func videoProcessorEnabled() -> Bool {
+        return enabled
+    }
+
+    func videoProcessorPyramidLevel() -> Int32 {
+        return 1
+    }
+
+    func videoProcessPyramidLevel(level: UnsafeMutablePointer<VideoFramePyramidLevel>, frame: UnsafeMutablePointer<VideoFrameYUV>) {
+        var shots: [Shot] = []
+
+        dispatch_sync(queue) {
+            shots = self.pendingShots
+            self.pendingShots.removeAll()
+        }
+
+        if shots.isEmpty {
+            return
+        }
+
+        // Only the frame of a shot is copied, the blend queue owns the copy
+        let width = level.memory.width
+        let height = level.memory.height
+        let chromaCount = Int(width / 2) * Int(height / 2)
+
+        blendFrame(Array(UnsafeBufferPointer(start: level.memory.luma, count: Int(width) * Int(height))),
+                   chromaB: Array(UnsafeBufferPointer(start: level.memory.chromaB, count: chromaCount)),
+                   chromaR: Array(UnsafeBufferPointer(start: level.memory.chromaR, count: chromaCount)),
+                   width: width, height: height, shots: shots.map { (pitch: $0.pitch, yaw: $0.yaw) })
+    }
+
+    func videoProcessFrame(frame: UnsafeMutablePointer<VideoFrameYUV>) {
+        // Frames arrive as pyramid levels
+    }
+
+    func videoProcessFailedFrame() {
+    }
+}
@@ -0,0 +1,229 @@
+/*
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import Foundation
+
+// Place of a shot in the panorama plan - columns are yaw steps, rows are pitch steps in the order they are shot
+struct ShotPosition: Hashable {
+    let column: Int
+    let row: Int
+
+    var hashValue: Int {
+        return column.hashValue ^ (row.hashValue << 16)
+    }
+}
+
+func ==(lhs: ShotPosition, rhs: ShotPosition) -> Bool {
+    return lhs.column == rhs.column && lhs.row == rhs.row
+}
+
+struct ShotOverlap {
+    let neighbour: ShotPosition
+
+    // Fraction of the picture shared with the neighbour
+    let overlap: Double
+
+    // Picture shift from the neighbour in pixels of the pyramid level
+    let dx: Double
+    let dy: Double
+
+    // Height of the correlation peak - a low peak means the pictures could not be matched
+    let peak: Double
+
+    let reliable: Bool
+}
+
+/**
+ * Keeps the preview frame of every panorama shot and measures the overlap of each new shot with the shots next to
+ * it in the plan by phase correlation, so that a gap can be shot again while the aircraft is still in the air.
+ */
+class ShotOverlapVerifier: NSObject, VideoFrameProcessor {
+    // Overlap below which a shot needs a corrective shot
+    let minOverlap: Double
+
+    // Correlation peak below which the measurement is not trusted
+    let minPeak: Double
+
+    // Transform size, the pyramid level is resampled to size x size
+    let size: Int32
+
+    var enabled = true
+
+    private struct Frame {
+        let luma: [UInt8]
+        let width: Int
+        let height: Int
+    }
+
+    private let queue = dispatch_queue_create("ShotOverlapVerifier", DISPATCH_QUEUE_SERIAL)
+
+    // Signalled once per capture, the decode thread polls it without a lock and copies no frame while it is 0
+    private let captureRequested = dispatch_semaphore_create(0)
+    private let captureDone = dispatch_semaphore_create(0)
+
+    // Only touched on the queue
+    private var pendingCapture: ShotPosition? = nil
+    private var shots: [ShotPosition: Frame] = [:]
+
+    init(minOverlap: Double = 0.2, minPeak: Double = 0.06, size: Int32 = 128) {
+        self.minOverlap = minOverlap
+        self.minPeak = minPeak
+        self.size = size
+    }
+
+    var shotCount: Int {
+        var result = 0
+
+        dispatch_sync(queue) {
+            result = self.shots.count
+        }
+
+        return result
+    }
+
+    // Forget the shots of the last panorama
+    func reset() {
+        dispatch_sync(queue) {
+            self.shots.removeAll()
+        }
+    }
+
+    /**
+     * Keep the next decoded frame as the preview of a shot. Blocks until the frame arrives.
+     *
+     * - parameter timeout: longest wait for the frame in seconds
+     * - returns: false if no frame was decoded in time
+     */
+    func captureShot(position: ShotPosition, timeout: NSTimeInterval = 0.5) -> Bool {
+        dispatch_sync(queue) {
+            self.pendingCapture = position
+        }
+
+        dispatch_semaphore_signal(captureRequested)
+
+        if dispatch_semaphore_wait(captureDone, dispatch_time(DISPATCH_TIME_NOW, Int64(timeout * Double(NSEC_PER_SEC)))) == 0 {
+            return true
+        }
+
+        var captured = false
+
+        dispatch_sync(queue) {
+            // The frame may have arrived since the wait ended
+            captured = self.pendingCapture == nil
+            self.pendingCapture = nil
+        }
+
+        if captured {
+            dispatch_semaphore_wait(captureDone, DISPATCH_TIME_FOREVER)
+        }
+
+        return captured
+    }
+
+    // Copies the frame only when a capture waits for it
+    func addFrame(luma: UnsafePointer<UInt8>, width: Int, height: Int) {
+        if dispatch_semaphore_wait(captureRequested, DISPATCH_TIME_NOW) != 0 {
+            return
+        }
+
+        let frame = Frame(luma: Array(UnsafeBufferPointer(start: luma, count: width * height)), width: width, height: height)
+
+        dispatch_sync(queue) {
+            // Nothing to do for a capture that timed out
+            if let position = self.pendingCapture {
+                self.shots[position] = frame
+                self.pendingCapture = nil
+
+                dispatch_semaphore_signal(self.captureDone)
+            }
+        }
+    }
+
+    /**
+     * Measure the overlap of a captured shot with the captured shots before it in the same column and in the same row.
+     * The neighbours are registered concurrently.
+     */
+    func verifyShot(position: ShotPosition) -> [ShotOverlap] {
+        var shot: Frame? = nil
+        var neighbours: [(ShotPosition, Frame)] = []
+
+        dispatch_sync(queue) {
+            shot = self.shots[position]
+
+            for neighbour in [ShotPosition(column: position.column, row: position.row - 1), ShotPosition(column: position.column - 1, row: position.row)] {
+                if let frame = self.shots[neighbour] {
+                    neighbours.append((neighbour, frame))
+                }
+            }
+        }
+
+        guard let current = shot else {
+            return []
+        }
+
+        var correlations = [VideoPhaseCorrelation](count: neighbours.count, repeatedValue: VideoPhaseCorrelation())
+        var results = [Int32](count: neighbours.count, repeatedValue: -1)
+
+        correlations.withUnsafeMutableBufferPointer { correlationBuffer in
+            results.withUnsafeMutableBufferPointer { resultBuffer in
+                let correlationBase = correlationBuffer.baseAddress
+                let resultBase = resultBuffer.baseAddress
+
+                dispatch_apply(neighbours.count, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0)) { index in
+                    let neighbour = neighbours[index].1
+
+                    if neighbour.width == current.width && neighbour.height == current.height {
+                        resultBase[index] = phaseCorrelateLuma(neighbour.luma, Int32(neighbour.width), current.luma, Int32(current.width),
+                                                               Int32(current.width), Int32(current.height), self.size, correlationBase + index)
+                    }
+                }
+            }
+        }
+
+        return neighbours.indices.filter { results[$0] == 0 }.map { index in
+            let correlation = correlations[index]
+
+            return ShotOverlap(neighbour: neighbours[index].0, overlap: Double(correlation.overlap),
+                               dx: Double(correlation.dx), dy: Double(correlation.dy), peak: Double(correlation.peak),
+                               reliable: Double(correlation.peak) >= self.minPeak)
+        }
+    }
+
+    // Overlaps that were measured reliably and fall short
+    func shortfalls(overlaps: [ShotOverlap]) -> [ShotOverlap] {
+        return overlaps.filter { $0.reliable && $0.overlap < self.minOverlap }
+    }
+
+    // MARK: - Video Frame Processor
+
+    func videoProcessorEnabled() -> Bool {
+        return enabled
+    }
+
+    func videoProcessorPyramidLevel() -> Int32 {
+        return 1
+    }
+
+    func videoProcessPyramidLevel(level: UnsafeMutablePointer<VideoFramePyramidLevel>, frame: UnsafeMutablePointer<VideoFrameYUV>) {
+        addFrame(level.memory.luma, width: Int(level.memory.width), height: Int(level.memory.height))
+    }
+
+    func videoProcessFrame(frame: UnsafeMutablePointer<VideoFrameYUV>) {
+        // Frames arrive as pyramid levels
+    }
+
+    func videoProcessFailedFrame() {
+    }
+}
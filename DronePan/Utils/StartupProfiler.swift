@@ -0,0 +1,109 @@
+/*
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import Foundation
+import QuartzCore
+import CocoaLumberjackSwift
+
+struct StartupEvent {
+    let name: String
+
+    // Seconds since launch
+    let start: CFTimeInterval
+
+    // nil for a milestone
+    let duration: CFTimeInterval?
+}
+
+/**
+ * Records a timeline of how long each subsystem takes to start, relative to app launch.
+ * Safe to call from any thread.
+ */
+class StartupProfiler {
+    static let sharedInstance = StartupProfiler()
+
+    let launchTime: CFTimeInterval
+
+    private let queue = dispatch_queue_create("StartupProfiler", DISPATCH_QUEUE_SERIAL)
+
+    private var running: [String: CFTimeInterval] = [:]
+    private var events: [StartupEvent] = []
+
+    init(launchTime: CFTimeInterval = CACurrentMediaTime()) {
+        self.launchTime = launchTime
+    }
+
+    func begin(name: String) {
+        let now = CACurrentMediaTime()
+
+        dispatch_sync(queue) {
+            self.running[name] = now
+        }
+    }
+
+    func end(name: String) {
+        let now = CACurrentMediaTime()
+
+        dispatch_sync(queue) {
+            guard let start = self.running.removeValueForKey(name) else {
+                DDLogWarn("Startup profiler - \(name) ended without begin")
+                return
+            }
+
+            self.events.append(StartupEvent(name: name, start: start - self.launchTime, duration: now - start))
+        }
+    }
+
+    func measure<T>(name: String, @noescape block: () -> T) -> T {
+        begin(name)
+        let result = block()
+        end(name)
+
+        return result
+    }
+
+    // Only the first mark of a name is kept so repeated calls from per frame code are cheap no-ops
+    func mark(name: String) {
+        let now = CACurrentMediaTime()
+
+        dispatch_sync(queue) {
+            if self.events.contains({ $0.name == name }) {
+                return
+            }
+
+            self.events.append(StartupEvent(name: name, start: now - self.launchTime, duration: nil))
+        }
+    }
+
+    func timeline() -> [StartupEvent] {
+        var result: [StartupEvent] = []
+
+        dispatch_sync(queue) {
+            result = self.events.sort { $0.start < $1.start }
+        }
+
+        return result
+    }
+
+    func logTimeline() {
+        for event in timeline() {
+            if let duration = event.duration {
+                DDLogInfo(String(format: "Startup %@ at %.0fms took %.1fms", event.name, event.start * 1000, duration * 1000))
+            } else {
+                DDLogInfo(String(format: "Startup %@ at %.0fms", event.name, event.start * 1000))
+            }
+        }
+    }
+}
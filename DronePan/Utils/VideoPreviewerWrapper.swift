@@ -26,6 +26,12 @@ protocol VideoPreviewerWrapper {
     func setDecoderWithProduct(product: DJIBaseProduct, andDecoderType decoder: VideoPreviewerDecoderType) -> Bool
     
     func push(videoData: UnsafeMutablePointer<UInt8>, length len: Int32)
+    
+    func registFrameProcessor(processor: VideoFrameProcessor)
+    
+    func registStreamProcessor(processor: VideoStreamProcessor)
+    
+    func unregistProcessor(processor: AnyObject)
 }
 
 
@@ -49,4 +55,16 @@ class VideoPreviewerInstance : VideoPreviewerWrapper {
     func push(videoData: UnsafeMutablePointer<UInt8>, length len: Int32) {
         VideoPreviewer.instance().push(videoData, length: len)
     }
+    
+    func registFrameProcessor(processor: VideoFrameProcessor) {
+        VideoPreviewer.instance().registFrameProcessor(processor)
+    }
+    
+    func registStreamProcessor(processor: VideoStreamProcessor) {
+        VideoPreviewer.instance().registStreamProcessor(processor)
+    }
+    
+    func unregistProcessor(processor: AnyObject) {
+        VideoPreviewer.instance().unregistProcessor(processor)
+    }
 }
\ No newline at end of file
@@ -8,6 +8,7 @@
 #define DJI_STREAM_COMMON_H
 #import <Foundation/Foundation.h>
 #import <UIKit/UIKit.h>
+#import "DJIVideoFrameRaw.h"
 
 #define H264_FRAME_INVALIED_UUID (0)
 
@@ -17,27 +18,6 @@ typedef enum : NSUInteger {
     VPFrameTypeRGBA = 2,
 } VPFrameType;
 
-typedef struct{
-    uint16_t width;
-    uint16_t height;
-    
-    uint16_t fps;
-    uint16_t reserved;
-    
-    uint16_t frame_index;
-    uint16_t max_frame_index_plus_one;
-    
-    union{
-        struct{
-            int has_sps :1;
-            int has_pps :1;
-            int has_idr :1;
-        } frame_flag;
-        uint32_t value;
-    };
-    
-} VideoFrameH264BasicInfo;
-
 typedef struct{
     uint32_t sampleRate;
     uint8_t channelCount;
@@ -65,10 +45,25 @@ typedef struct
     
 
     uint32_t frame_uuid; //frame id from decoder
+    uint64_t time_tag; //videoClockTimeTag when the raw frame was parsed
+    uint64_t pts; //reconstructed presentation time on the same clock, 0 when unknown
     VideoFrameH264BasicInfo frame_info;
 } VideoFrameYUV;
 #endif
 
+/**
+ *  One level of the down scaled frame pyramid. Planes are packed, the chroma planes are width/2 x height/2.
+ */
+typedef struct
+{
+    uint8_t *luma;
+    uint8_t *chromaB;
+    uint8_t *chromaR;
+    
+    int width, height;
+    int level; //0 is half of the decoded size, each level halves again
+} VideoFramePyramidLevel;
+
 typedef enum : NSUInteger {
     TYPE_TAG_VideoFrameH264Raw = 0,
     TYPE_TAG_AudioFrameAACRaw = 1,
@@ -76,16 +71,6 @@ typedef enum : NSUInteger {
 } TYPE_TAG_VPFrame;
 
 #pragma pack (1)
-typedef struct{
-    uint32_t type_tag:8;//TYPE_TAG_VideoFrameH264Raw
-    uint32_t frame_size:24;
-    uint32_t frame_uuid;
-    uint64_t time_tag; //videoPool 内部相对时间
-    VideoFrameH264BasicInfo frame_info;
-    
-    uint8_t frame_data[0]; //followd by frame data;
-}VideoFrameH264Raw;
-
 typedef struct{
     uint32_t type_tag:8;//TYPE_TAG_AudioFrameAACRaw
     uint32_t frame_size:24;
@@ -109,6 +94,19 @@ typedef enum{
     DJIVideoStreamProcessorType_Modify, //modify data
 } DJIVideoStreamProcessorType;
 
+/**
+ *  What happens to a frame for a passthrough or consume processor whose worker queue is full.
+ */
+typedef NS_ENUM(NSUInteger, DJIVideoStreamBackpressurePolicy){
+    DJIVideoStreamBackpressurePolicy_Default = 0, //drop newest for passthrough, drop until keyframe for consume
+    DJIVideoStreamBackpressurePolicy_DropNewest, //the frame that does not fit is dropped
+    DJIVideoStreamBackpressurePolicy_DropUntilKeyframe, //frames are dropped until the next keyframe that fits, so the stream stays decodable
+    DJIVideoStreamBackpressurePolicy_Block, //the decode thread waits for room, nothing is lost but the preview is delayed
+};
+
+//frames that may wait for a processor worker unless the processor asks for another depth
+#define VIDEO_STREAM_WORKER_DEFAULT_QUEUE_DEPTH (8)
+
 typedef NS_ENUM(NSUInteger, H264EncoderType){
     H264EncoderType_unknown = 0,
     H264EncoderType_DM368_inspire = 1,
@@ -141,6 +139,21 @@ typedef NS_ENUM(NSUInteger, H264EncoderType){
 -(void) streamProcessorInfoChanged:(DJIVideoStreamBasicInfo*)info;
 -(void) streamProcessorPause;
 -(void) streamProcessorReset;
+// drop the decoder's reference state but keep the decoder context alive
+-(void) streamProcessorFlush;
+
+/**
+ *  Passthrough and consume processors run on a worker queue of their own so they never delay the decoder. The
+ *  depth is the number of frames that may wait for the processor, VIDEO_STREAM_WORKER_DEFAULT_QUEUE_DEPTH by default.
+ */
+-(NSUInteger) streamProcessorQueueDepth;
+-(DJIVideoStreamBackpressurePolicy) streamProcessorBackpressurePolicy;
+
+/**
+ *  Modify processors run on the decode thread before the decoders, in ascending order. Processors of the same
+ *  order run in the order they were registered. Default 0.
+ */
+-(int) streamProcessorOrder;
 @end
 
 /**
@@ -152,6 +165,14 @@ typedef NS_ENUM(NSUInteger, H264EncoderType){
 -(BOOL) videoProcessorEnabled;
 -(void) videoProcessFrame:(VideoFrameYUV*)frame;
 -(void) videoProcessFailedFrame;
+
+@optional
+/**
+ *  The pyramid level the processor works on. A processor with a level receives
+ *  `videoProcessPyramidLevel:frame:` instead of `videoProcessFrame:`. Return -1 for the full size frame.
+ */
+-(int) videoProcessorPyramidLevel;
+-(void) videoProcessPyramidLevel:(VideoFramePyramidLevel*)level frame:(VideoFrameYUV*)frame;
 @end
 
 #endif /* DJIVTH264DecoderPublic_h */
@@ -0,0 +1,16 @@
+//
+//  DJIVideoClock.h
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ *  Monotonic clock of the stream. Every raw frame gets its `time_tag` from this clock when it is parsed, so events
+ *  outside the previewer stamped with it can be placed between video frames. It does not jump with the wall clock
+ *  and keeps counting while the device is awake.
+ *
+ *  @return microseconds since an arbitrary point in the past.
+ */
+uint64_t videoClockTimeTag(void);
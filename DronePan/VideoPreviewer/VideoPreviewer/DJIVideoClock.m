@@ -0,0 +1,20 @@
+//
+//  DJIVideoClock.m
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import "DJIVideoClock.h"
+#include <mach/mach_time.h>
+
+uint64_t videoClockTimeTag(void){
+    static mach_timebase_info_data_t timebase = {0};
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        mach_timebase_info(&timebase);
+    });
+
+    //ticks to microseconds, the division first keeps the product from overflowing
+    uint64_t ticks = mach_absolute_time();
+    return (ticks/1000)*timebase.numer/timebase.denom + (ticks%1000)*timebase.numer/timebase.denom/1000;
+}
@@ -0,0 +1,43 @@
+//
+//  DJIVideoColorConvert.h
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "DJIStreamCommon.h"
+
+typedef NS_ENUM(NSUInteger, VideoColorMatrix){
+    VideoColorMatrixBT601 = 0,
+    VideoColorMatrixBT709 = 1,
+};
+
+typedef NS_ENUM(NSUInteger, VideoColorRange){
+    VideoColorRangeLimited = 0, // Y in [16, 235], the range of the aircraft's stream
+    VideoColorRangeFull = 1,
+};
+
+typedef struct{
+    VideoColorMatrix matrix;
+    VideoColorRange range;
+    BOOL bgra; //write BGRA instead of RGBA
+    BOOL halfSize; //average 2x2 luma samples, the output is width/2 x height/2
+} VideoColorConvertOptions;
+
+/**
+ *  Convert a decoded frame to packed 8 bit RGBA or BGRA on the CPU, alpha is 255. Uses NEON or SSE2 when available.
+ *
+ *  @param frame YUV420 planar or semi planar frame.
+ *  @param dst output buffer of at least dstStride*height bytes.
+ *  @param dstStride bytes per row of the output.
+ *  @param options color matrix, range, byte order and down scaling.
+ *
+ *  @return `0` on success, `-1` when the frame format is not supported.
+ */
+int convertYUVFrameToRGBA(const VideoFrameYUV* frame, uint8_t* dst, int dstStride, VideoColorConvertOptions options);
+
+/**
+ *  Scalar implementation of `convertYUVFrameToRGBA`. It is the reference for the vectorized paths, which give the
+ *  same output.
+ */
+int convertYUVFrameToRGBAReference(const VideoFrameYUV* frame, uint8_t* dst, int dstStride, VideoColorConvertOptions options);
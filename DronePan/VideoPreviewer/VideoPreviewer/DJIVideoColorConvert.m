@@ -0,0 +1,279 @@
+//
+//  DJIVideoColorConvert.m
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import "DJIVideoColorConvert.h"
+#import "DJIVideoPyramid.h"
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define COLOR_CONVERT_USE_NEON (1)
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define COLOR_CONVERT_USE_SSE2 (1)
+#endif
+
+//coefficients in Q12
+#define COLOR_COEF_SHIFT (12)
+#define COLOR_COEF_ROUND (1 << (COLOR_COEF_SHIFT - 1))
+
+typedef struct{
+    int16_t yOffset;
+    int16_t y;
+    int16_t rv;
+    int16_t gu;
+    int16_t gv;
+    int16_t bu;
+} ColorCoefficients;
+
+static ColorCoefficients colorCoefficients(VideoColorMatrix matrix, VideoColorRange range){
+    double kr = 0.299, kb = 0.114;
+    if (matrix == VideoColorMatrixBT709) {
+        kr = 0.2126;
+        kb = 0.0722;
+    }
+    double kg = 1.0 - kr - kb;
+    
+    double ys = 1.0, cs = 1.0;
+    int yOffset = 0;
+    if (range == VideoColorRangeLimited) {
+        ys = 255.0/219.0;
+        cs = 255.0/224.0;
+        yOffset = 16;
+    }
+    
+    double scale = (double)(1 << COLOR_COEF_SHIFT);
+    ColorCoefficients coef;
+    coef.yOffset = yOffset;
+    coef.y = (int16_t)lround(ys*scale);
+    coef.rv = (int16_t)lround(2.0*(1.0 - kr)*cs*scale);
+    coef.gu = (int16_t)lround(2.0*(1.0 - kb)*kb/kg*cs*scale);
+    coef.gv = (int16_t)lround(2.0*(1.0 - kr)*kr/kg*cs*scale);
+    coef.bu = (int16_t)lround(2.0*(1.0 - kb)*cs*scale);
+    return coef;
+}
+
+static inline uint8_t clampColor(int value){
+    return value < 0 ? 0 : (value > 255 ? 255 : (uint8_t)value);
+}
+
+static inline void convertPixel(int y, int u, int v, const ColorCoefficients* coef, int bgra, uint8_t* out){
+    int c = coef->y*(y - coef->yOffset) + COLOR_COEF_ROUND;
+    int d = u - 128;
+    int e = v - 128;
+    uint8_t r = clampColor((c + coef->rv*e) >> COLOR_COEF_SHIFT);
+    uint8_t g = clampColor((c - coef->gu*d - coef->gv*e) >> COLOR_COEF_SHIFT);
+    uint8_t b = clampColor((c + coef->bu*d) >> COLOR_COEF_SHIFT);
+    out[0] = bgra ? b : r;
+    out[1] = g;
+    out[2] = bgra ? r : b;
+    out[3] = 255;
+}
+
+/**
+ *  Convert one row. `cr` is NULL when cb and cr are interleaved. With `sharedChroma` two neighbour pixels use the
+ *  same chroma sample, otherwise every pixel has its own. Returns the number of pixels done so the caller finishes
+ *  the rest with the scalar code.
+ */
+static int convertRowSIMD(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, int sharedChroma,
+                          uint8_t* out, int width, const ColorCoefficients* coef, int bgra){
+    int x = 0;
+#if COLOR_CONVERT_USE_NEON
+    const int16x8_t yOffset = vdupq_n_s16(coef->yOffset);
+    const int16x8_t chromaOffset = vdupq_n_s16(128);
+    const uint8x8_t alpha = vdup_n_u8(255);
+    for (; x+8 <= width; x += 8) {
+        uint8x8_t u8, v8;
+        if (sharedChroma) {
+            //4 chroma samples for 8 pixels
+            if (cr) {
+                uint32_t u4, v4;
+                memcpy(&u4, cb + x/2, 4);
+                memcpy(&v4, cr + x/2, 4);
+                u8 = vcreate_u8(u4);
+                v8 = vcreate_u8(v4);
+            }else{
+                uint8x8x2_t pair = vuzp_u8(vld1_u8(cb + x), vdup_n_u8(0));
+                u8 = pair.val[0];
+                v8 = pair.val[1];
+            }
+            u8 = vzip_u8(u8, u8).val[0];
+            v8 = vzip_u8(v8, v8).val[0];
+        }else{
+            if (cr) {
+                u8 = vld1_u8(cb + x);
+                v8 = vld1_u8(cr + x);
+            }else{
+                uint8x8x2_t pair = vld2_u8(cb + 2*x);
+                u8 = pair.val[0];
+                v8 = pair.val[1];
+            }
+        }
+        
+        int16x8_t yy = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(y + x))), yOffset);
+        int16x8_t uu = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(u8)), chromaOffset);
+        int16x8_t vv = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(v8)), chromaOffset);
+        
+        int32x4_t yl = vmull_n_s16(vget_low_s16(yy), coef->y);
+        int32x4_t yh = vmull_n_s16(vget_high_s16(yy), coef->y);
+        
+        int32x4_t rl = vmlal_n_s16(yl, vget_low_s16(vv), coef->rv);
+        int32x4_t rh = vmlal_n_s16(yh, vget_high_s16(vv), coef->rv);
+        int32x4_t gl = vmlsl_n_s16(vmlsl_n_s16(yl, vget_low_s16(uu), coef->gu), vget_low_s16(vv), coef->gv);
+        int32x4_t gh = vmlsl_n_s16(vmlsl_n_s16(yh, vget_high_s16(uu), coef->gu), vget_high_s16(vv), coef->gv);
+        int32x4_t bl = vmlal_n_s16(yl, vget_low_s16(uu), coef->bu);
+        int32x4_t bh = vmlal_n_s16(yh, vget_high_s16(uu), coef->bu);
+        
+        uint8x8x4_t pixels;
+        uint8x8_t r = vqmovn_u16(vcombine_u16(vqrshrun_n_s32(rl, COLOR_COEF_SHIFT), vqrshrun_n_s32(rh, COLOR_COEF_SHIFT)));
+        uint8x8_t g = vqmovn_u16(vcombine_u16(vqrshrun_n_s32(gl, COLOR_COEF_SHIFT), vqrshrun_n_s32(gh, COLOR_COEF_SHIFT)));
+        uint8x8_t b = vqmovn_u16(vcombine_u16(vqrshrun_n_s32(bl, COLOR_COEF_SHIFT), vqrshrun_n_s32(bh, COLOR_COEF_SHIFT)));
+        pixels.val[0] = bgra ? b : r;
+        pixels.val[1] = g;
+        pixels.val[2] = bgra ? r : b;
+        pixels.val[3] = alpha;
+        vst4_u8(out + 4*x, pixels);
+    }
+#elif COLOR_CONVERT_USE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i lowByte = _mm_set1_epi16(0x00ff);
+    const __m128i yOffset = _mm_set1_epi16(coef->yOffset);
+    const __m128i chromaOffset = _mm_set1_epi16(128);
+    const __m128i alpha = _mm_set1_epi8((char)0xff);
+    //madd pairs: (y, 1) and (u, v)
+    const __m128i yCoef = _mm_setr_epi16(coef->y, COLOR_COEF_ROUND, coef->y, COLOR_COEF_ROUND,
+                                         coef->y, COLOR_COEF_ROUND, coef->y, COLOR_COEF_ROUND);
+    const __m128i rCoef = _mm_setr_epi16(0, coef->rv, 0, coef->rv, 0, coef->rv, 0, coef->rv);
+    const __m128i gCoef = _mm_setr_epi16(-coef->gu, -coef->gv, -coef->gu, -coef->gv,
+                                         -coef->gu, -coef->gv, -coef->gu, -coef->gv);
+    const __m128i bCoef = _mm_setr_epi16(coef->bu, 0, coef->bu, 0, coef->bu, 0, coef->bu, 0);
+    
+    for (; x+8 <= width; x += 8) {
+        __m128i uu, vv;
+        if (sharedChroma) {
+            if (cr) {
+                int32_t u4, v4;
+                memcpy(&u4, cb + x/2, 4);
+                memcpy(&v4, cr + x/2, 4);
+                uu = _mm_unpacklo_epi8(_mm_cvtsi32_si128(u4), zero);
+                vv = _mm_unpacklo_epi8(_mm_cvtsi32_si128(v4), zero);
+            }else{
+                __m128i uv = _mm_loadl_epi64((const __m128i*)(cb + x));
+                uu = _mm_and_si128(uv, lowByte);
+                vv = _mm_srli_epi16(uv, 8);
+            }
+            uu = _mm_unpacklo_epi16(uu, uu);
+            vv = _mm_unpacklo_epi16(vv, vv);
+        }else{
+            if (cr) {
+                uu = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(cb + x)), zero);
+                vv = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(cr + x)), zero);
+            }else{
+                __m128i uv = _mm_loadu_si128((const __m128i*)(cb + 2*x));
+                uu = _mm_and_si128(uv, lowByte);
+                vv = _mm_srli_epi16(uv, 8);
+            }
+        }
+        
+        __m128i yy = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(y + x)), zero), yOffset);
+        uu = _mm_sub_epi16(uu, chromaOffset);
+        vv = _mm_sub_epi16(vv, chromaOffset);
+        
+        __m128i yl = _mm_madd_epi16(_mm_unpacklo_epi16(yy, one), yCoef);
+        __m128i yh = _mm_madd_epi16(_mm_unpackhi_epi16(yy, one), yCoef);
+        __m128i uvl = _mm_unpacklo_epi16(uu, vv);
+        __m128i uvh = _mm_unpackhi_epi16(uu, vv);
+        
+        __m128i rl = _mm_srai_epi32(_mm_add_epi32(yl, _mm_madd_epi16(uvl, rCoef)), COLOR_COEF_SHIFT);
+        __m128i rh = _mm_srai_epi32(_mm_add_epi32(yh, _mm_madd_epi16(uvh, rCoef)), COLOR_COEF_SHIFT);
+        __m128i gl = _mm_srai_epi32(_mm_add_epi32(yl, _mm_madd_epi16(uvl, gCoef)), COLOR_COEF_SHIFT);
+        __m128i gh = _mm_srai_epi32(_mm_add_epi32(yh, _mm_madd_epi16(uvh, gCoef)), COLOR_COEF_SHIFT);
+        __m128i bl = _mm_srai_epi32(_mm_add_epi32(yl, _mm_madd_epi16(uvl, bCoef)), COLOR_COEF_SHIFT);
+        __m128i bh = _mm_srai_epi32(_mm_add_epi32(yh, _mm_madd_epi16(uvh, bCoef)), COLOR_COEF_SHIFT);
+        
+        __m128i r = _mm_packus_epi16(_mm_packs_epi32(rl, rh), zero);
+        __m128i g = _mm_packus_epi16(_mm_packs_epi32(gl, gh), zero);
+        __m128i b = _mm_packus_epi16(_mm_packs_epi32(bl, bh), zero);
+        if (bgra) {
+            __m128i t = r;
+            r = b;
+            b = t;
+        }
+        
+        __m128i rg = _mm_unpacklo_epi8(r, g);
+        __m128i ba = _mm_unpacklo_epi8(b, alpha);
+        _mm_storeu_si128((__m128i*)(out + 4*x), _mm_unpacklo_epi16(rg, ba));
+        _mm_storeu_si128((__m128i*)(out + 4*x + 16), _mm_unpackhi_epi16(rg, ba));
+    }
+#endif
+    return x;
+}
+
+static void convertRowScalar(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, int sharedChroma,
+                             uint8_t* out, int start, int width, const ColorCoefficients* coef, int bgra){
+    for (int x=start; x<width; x++) {
+        int c = sharedChroma ? x/2 : x;
+        int u = cr ? cb[c] : cb[2*c];
+        int v = cr ? cr[c] : cb[2*c+1];
+        convertPixel(y[x], u, v, coef, bgra, out + 4*x);
+    }
+}
+
+static int convertFrame(const VideoFrameYUV* frame, uint8_t* dst, int dstStride, VideoColorConvertOptions options, int useSIMD){
+    if (!frame || !dst || !frame->luma || !frame->chromaB) {
+        return -1;
+    }
+    
+    BOOL semiPlanar = (frame->frameType == VPFrameTypeYUV420SemiPlaner);
+    if (!semiPlanar && (frame->frameType != VPFrameTypeYUV420Planer || !frame->chromaR)) {
+        return -1;
+    }
+    
+    ColorCoefficients coef = colorCoefficients(options.matrix, options.range);
+    int lumaStride = frame->lumaSlice ? frame->lumaSlice : frame->width;
+    int chromaBStride = frame->chromaBSlice ? frame->chromaBSlice : (semiPlanar ? frame->width : frame->width/2);
+    int chromaRStride = frame->chromaRSlice ? frame->chromaRSlice : frame->width/2;
+    
+    int width = options.halfSize ? frame->width/2 : frame->width;
+    int height = options.halfSize ? frame->height/2 : frame->height;
+    
+    //at half size the luma row is averaged first, then every pixel has its own chroma sample
+    uint8_t* lumaRow = NULL;
+    if (options.halfSize) {
+        lumaRow = (uint8_t*)malloc(width + 16);
+        if (!lumaRow) {
+            return -1;
+        }
+    }
+    
+    for (int row=0; row<height; row++) {
+        const uint8_t* y = frame->luma + row*lumaStride;
+        int chromaRow = options.halfSize ? row : row/2;
+        const uint8_t* cb = frame->chromaB + chromaRow*chromaBStride;
+        const uint8_t* cr = semiPlanar ? NULL : frame->chromaR + chromaRow*chromaRStride;
+        uint8_t* out = dst + row*dstStride;
+        
+        if (options.halfSize) {
+            downscalePlane2x(frame->luma + 2*row*lumaStride, lumaStride, lumaRow, width, width, 1);
+            y = lumaRow;
+        }
+        
+        int sharedChroma = options.halfSize ? 0 : 1;
+        int done = useSIMD ? convertRowSIMD(y, cb, cr, sharedChroma, out, width, &coef, options.bgra) : 0;
+        convertRowScalar(y, cb, cr, sharedChroma, out, done, width, &coef, options.bgra);
+    }
+    
+    free(lumaRow);
+    return 0;
+}
+
+int convertYUVFrameToRGBA(const VideoFrameYUV* frame, uint8_t* dst, int dstStride, VideoColorConvertOptions options){
+    return convertFrame(frame, dst, dstStride, options, 1);
+}
+
+int convertYUVFrameToRGBAReference(const VideoFrameYUV* frame, uint8_t* dst, int dstStride, VideoColorConvertOptions options){
+    return convertFrame(frame, dst, dstStride, options, 0);
+}
@@ -0,0 +1,68 @@
+//
+//  DJIVideoDecodePool.h
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ *  A stream decoded by the workers of a pool, one frame per step.
+ */
+@protocol DJIVideoDecodePoolStream <NSObject>
+@required
+/**
+ *  The stream has a frame or other work waiting. Called with the pool locked, it must not block.
+ */
+-(BOOL) decodePoolStreamHasWork;
+
+/**
+ *  Handle the next frame. Steps of one stream never run at the same time.
+ */
+-(void) decodePoolStreamStep;
+@end
+
+/**
+ *  Fixed set of decode threads shared by several streams. A worker picks the stream with waiting work that has had
+ *  the smallest share of steps for its priority (stride scheduling), so a busy stream cannot starve the others and a
+ *  stream of priority 2 gets twice the steps of a stream of priority 1 when the workers are all busy.
+ */
+@interface DJIVideoDecodePool : NSObject
+
+/**
+ *  Pool with one worker per active core, shared by the previewers that are not given a pool of their own.
+ */
++(DJIVideoDecodePool*) sharedPool;
+
+-(id) initWithWorkerCount:(NSUInteger)workerCount;
+
+@property (nonatomic, readonly) NSUInteger workerCount;
+
+/**
+ *  @param stream the stream, retained until it is removed.
+ *  @param priority share of the steps under contention, at least 1.
+ */
+-(void) addStream:(id<DJIVideoDecodePoolStream>)stream priority:(NSUInteger)priority;
+
+-(void) setPriority:(NSUInteger)priority ofStream:(id<DJIVideoDecodePoolStream>)stream;
+
+/**
+ *  Remove the stream, returns once no worker runs a step of it. Must not be called from a step.
+ */
+-(void) removeStream:(id<DJIVideoDecodePoolStream>)stream;
+
+/**
+ *  Wake a worker for the stream after it queued work.
+ */
+-(void) signalStream:(id<DJIVideoDecodePoolStream>)stream;
+
+/**
+ *  Steps run for the stream since it was added, 0 for a stream not in the pool.
+ */
+-(NSUInteger) stepCountOfStream:(id<DJIVideoDecodePoolStream>)stream;
+
+/**
+ *  Stop the workers after their current step. Streams still in the pool stop being stepped.
+ */
+-(void) shutdown;
+@end
@@ -0,0 +1,193 @@
+//
+//  DJIVideoDecodePool.m
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import "DJIVideoDecodePool.h"
+#import <pthread.h>
+#import <sys/time.h>
+
+//pass added per step at priority 1
+#define DECODE_POOL_STRIDE (1 << 16)
+//idle workers look for work this often, a stream may have work that was not signalled
+#define DECODE_POOL_IDLE_WAIT_MS (100)
+
+@interface DJIVideoDecodePoolEntry : NSObject
+@property (nonatomic, strong) id<DJIVideoDecodePoolStream> stream;
+@property (nonatomic, assign) NSUInteger priority;
+//virtual time of the stream, the stream with the smallest pass runs next
+@property (nonatomic, assign) uint64_t pass;
+@property (nonatomic, assign) BOOL running;
+@property (nonatomic, assign) NSUInteger steps;
+@end
+
+@implementation DJIVideoDecodePoolEntry
+@end
+
+@interface DJIVideoDecodePool (){
+    pthread_mutex_t _mutex;
+    pthread_cond_t _cond;
+    //pass of the last stream picked, a stream back from idle starts here instead of catching up
+    uint64_t _virtualTime;
+    BOOL _stopped;
+}
+@property (nonatomic, strong) NSMutableArray* entries;
+@property (nonatomic, strong) NSArray* workers;
+@end
+
+@implementation DJIVideoDecodePool
+
++(DJIVideoDecodePool*) sharedPool{
+    static DJIVideoDecodePool* pool = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        pool = [[DJIVideoDecodePool alloc] initWithWorkerCount:[NSProcessInfo processInfo].activeProcessorCount];
+    });
+    return pool;
+}
+
+-(id) initWithWorkerCount:(NSUInteger)workerCount{
+    self = [super init];
+    if (self) {
+        pthread_mutex_init(&_mutex, NULL);
+        pthread_cond_init(&_cond, NULL);
+        _entries = [NSMutableArray array];
+        _workerCount = MAX(1, workerCount);
+
+        NSMutableArray* workers = [NSMutableArray arrayWithCapacity:_workerCount];
+        for (NSUInteger i = 0; i < _workerCount; i++) {
+            NSThread* worker = [[NSThread alloc] initWithTarget:self selector:@selector(workerRunloop) object:nil];
+            worker.name = [NSString stringWithFormat:@"video_decode_pool_%d", (int)i];
+            worker.qualityOfService = NSQualityOfServiceUserInteractive;
+            [workers addObject:worker];
+        }
+        _workers = workers;
+
+        for (NSThread* worker in _workers) {
+            [worker start];
+        }
+    }
+    return self;
+}
+
+-(void) dealloc{
+    pthread_cond_destroy(&_cond);
+    pthread_mutex_destroy(&_mutex);
+}
+
+//called with the mutex held
+-(DJIVideoDecodePoolEntry*) entryOfStream:(id)stream{
+    for (DJIVideoDecodePoolEntry* entry in _entries) {
+        if (entry.stream == stream) {
+            return entry;
+        }
+    }
+    return nil;
+}
+
+-(void) addStream:(id<DJIVideoDecodePoolStream>)stream priority:(NSUInteger)priority{
+    if (!stream) {
+        return;
+    }
+
+    pthread_mutex_lock(&_mutex);
+    if (![self entryOfStream:stream]) {
+        DJIVideoDecodePoolEntry* entry = [[DJIVideoDecodePoolEntry alloc] init];
+        entry.stream = stream;
+        entry.priority = MAX(1, priority);
+        entry.pass = _virtualTime;
+        [_entries addObject:entry];
+        pthread_cond_broadcast(&_cond);
+    }
+    pthread_mutex_unlock(&_mutex);
+}
+
+-(void) setPriority:(NSUInteger)priority ofStream:(id<DJIVideoDecodePoolStream>)stream{
+    pthread_mutex_lock(&_mutex);
+    [self entryOfStream:stream].priority = MAX(1, priority);
+    pthread_mutex_unlock(&_mutex);
+}
+
+-(void) removeStream:(id<DJIVideoDecodePoolStream>)stream{
+    pthread_mutex_lock(&_mutex);
+    DJIVideoDecodePoolEntry* entry = [self entryOfStream:stream];
+    if (entry) {
+        [_entries removeObject:entry];
+        while (entry.running) {
+            pthread_cond_wait(&_cond, &_mutex);
+        }
+    }
+    pthread_mutex_unlock(&_mutex);
+}
+
+-(void) signalStream:(id<DJIVideoDecodePoolStream>)stream{
+    pthread_mutex_lock(&_mutex);
+    pthread_cond_signal(&_cond);
+    pthread_mutex_unlock(&_mutex);
+}
+
+-(NSUInteger) stepCountOfStream:(id<DJIVideoDecodePoolStream>)stream{
+    pthread_mutex_lock(&_mutex);
+    NSUInteger steps = [self entryOfStream:stream].steps;
+    pthread_mutex_unlock(&_mutex);
+    return steps;
+}
+
+-(void) shutdown{
+    pthread_mutex_lock(&_mutex);
+    _stopped = YES;
+    pthread_cond_broadcast(&_cond);
+    pthread_mutex_unlock(&_mutex);
+}
+
+//called with the mutex held
+-(DJIVideoDecodePoolEntry*) nextEntry{
+    DJIVideoDecodePoolEntry* next = nil;
+    for (DJIVideoDecodePoolEntry* entry in _entries) {
+        if (entry.running || (next && MAX(entry.pass, _virtualTime) >= MAX(next.pass, _virtualTime))) {
+            continue;
+        }
+        if ([entry.stream decodePoolStreamHasWork]) {
+            next = entry;
+        }
+    }
+    return next;
+}
+
+-(void) workerRunloop{
+    pthread_mutex_lock(&_mutex);
+    while (!_stopped) {
+        DJIVideoDecodePoolEntry* entry = [self nextEntry];
+        if (!entry) {
+            struct timeval tv;
+            gettimeofday(&tv, NULL);
+
+            long long deadline = (long long)tv.tv_usec*1000 + DECODE_POOL_IDLE_WAIT_MS*1000000LL;
+            struct timespec ts;
+            ts.tv_sec = tv.tv_sec + (time_t)(deadline/1000000000LL);
+            ts.tv_nsec = (long)(deadline%1000000000LL);
+            pthread_cond_timedwait(&_cond, &_mutex, &ts);
+            continue;
+        }
+
+        entry.pass = MAX(entry.pass, _virtualTime);
+        _virtualTime = entry.pass;
+        entry.pass += DECODE_POOL_STRIDE/entry.priority;
+        entry.running = YES;
+        pthread_mutex_unlock(&_mutex);
+
+        @autoreleasepool {
+            [entry.stream decodePoolStreamStep];
+        }
+
+        pthread_mutex_lock(&_mutex);
+        entry.running = NO;
+        entry.steps++;
+        //the stream may have more work for another worker, and removeStream: may be waiting
+        pthread_cond_broadcast(&_cond);
+    }
+    pthread_mutex_unlock(&_mutex);
+}
+
+@end
@@ -0,0 +1,105 @@
+//
+//  DJIVideoExposureStatistics.h
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "DJIStreamCommon.h"
+
+#define VIDEO_LUMA_HISTOGRAM_BINS (256)
+
+typedef struct{
+    uint32_t sampleCount;
+    float mean;
+
+    //luma below which the given share of the samples fall
+    int percentile5;
+    int percentile25;
+    int median;
+    int percentile75;
+    int percentile95;
+
+    float shadowFraction; //fraction of samples at or below the shadow threshold
+    float highlightFraction; //fraction of samples at or above the highlight threshold
+} VideoLumaStatistics;
+
+/**
+ *  256 bin histogram of a luma plane sampled on a grid. Counts go to four interleaved sub histograms that are merged
+ *  with NEON or SSE2 when available, so consecutive samples of the same value do not stall on one counter.
+ *
+ *  @param luma luma plane, usually a level of the frame pyramid.
+ *  @param stride bytes per row of the plane.
+ *  @param width width of the plane.
+ *  @param height height of the plane.
+ *  @param step distance between samples in both directions, 1 samples every pixel.
+ *  @param histogram output of VIDEO_LUMA_HISTOGRAM_BINS counts.
+ *
+ *  @return number of samples, `0` for invalid arguments.
+ */
+uint32_t lumaHistogram(const uint8_t* luma, int stride, int width, int height, int step, uint32_t* histogram);
+
+/**
+ *  Smallest luma at which the cumulative count reaches `fraction` of the samples.
+ */
+int lumaHistogramPercentile(const uint32_t* histogram, float fraction);
+
+/**
+ *  Mean, percentiles and clipped fractions of a histogram.
+ *
+ *  @param histogram VIDEO_LUMA_HISTOGRAM_BINS counts.
+ *  @param shadowThreshold luma at or below which a sample is a crushed shadow.
+ *  @param highlightThreshold luma at or above which a sample is a clipped highlight.
+ *  @param statistics output.
+ */
+void lumaStatisticsFromHistogram(const uint32_t* histogram, int shadowThreshold, int highlightThreshold, VideoLumaStatistics* statistics);
+
+/**
+ *  Luma statistics of one decoded frame.
+ */
+@interface DJIVideoLumaStatistics : NSObject
+@property (nonatomic, readonly) uint32_t frameUUID;
+@property (nonatomic, readonly) VideoLumaStatistics statistics;
+//VIDEO_LUMA_HISTOGRAM_BINS uint32_t counts
+@property (nonatomic, readonly) NSData* histogram;
+
+/**
+ *  Whether the scene is wider than one exposure can hold: both the shadow and the highlight fraction are above the
+ *  limit. Bracketing is worth its cost for such a scene.
+ */
+-(BOOL) exceedsDynamicRangeWithClipLimit:(float)limit;
+@end
+
+typedef void (^VideoLumaStatisticsHandler)(DJIVideoLumaStatistics* statistics);
+
+/**
+ *  Frame processor that measures the luma distribution of the decoded frames and publishes it to subscribers.
+ *  Register it with `registFrameProcessor:`.
+ */
+@interface DJIVideoExposureMonitor : NSObject <VideoFrameProcessor>
+@property (nonatomic, assign) BOOL enabled;
+
+//pyramid level to sample, default 1 (a quarter of the decoded size)
+@property (nonatomic, assign) int pyramidLevel;
+//grid step on the level, default 2
+@property (nonatomic, assign) int sampleStep;
+//measure every nth frame, default 1
+@property (nonatomic, assign) int frameInterval;
+
+//default 16 and 235, the ends of the limited range of the stream
+@property (nonatomic, assign) int shadowThreshold;
+@property (nonatomic, assign) int highlightThreshold;
+
+@property (atomic, readonly) DJIVideoLumaStatistics* latestStatistics;
+
+/**
+ *  Receive the statistics of every measured frame.
+ *
+ *  @param handler called with the statistics.
+ *  @param queue queue for the handler, nil to call it on the decode thread.
+ *
+ *  @return token to pass to `unsubscribe:`.
+ */
+-(id) subscribe:(VideoLumaStatisticsHandler)handler queue:(dispatch_queue_t)queue;
+-(void) unsubscribe:(id)token;
+@end
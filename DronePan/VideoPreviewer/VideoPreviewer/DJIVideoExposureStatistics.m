@@ -0,0 +1,280 @@
+//
+//  DJIVideoExposureStatistics.m
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import "DJIVideoExposureStatistics.h"
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define EXPOSURE_USE_NEON (1)
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define EXPOSURE_USE_SSE2 (1)
+#endif
+
+#define SUB_HISTOGRAM_COUNT (4)
+
+static inline uint64_t loadWord(const uint8_t* p){
+    uint64_t word;
+    memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+uint32_t lumaHistogram(const uint8_t* luma, int stride, int width, int height, int step, uint32_t* histogram){
+    if (!luma || !histogram || width <= 0 || height <= 0 || stride < width || step <= 0) {
+        return 0;
+    }
+
+    uint32_t sub[SUB_HISTOGRAM_COUNT][VIDEO_LUMA_HISTOGRAM_BINS];
+    memset(sub, 0, sizeof(sub));
+
+    uint32_t count = 0;
+    for (int y=0; y<height; y+=step) {
+        const uint8_t* row = luma + y*stride;
+        int x = 0;
+
+        //8 bytes per load, the byte order is little endian on every target
+        if (step == 1) {
+            for (; x+8 <= width; x += 8) {
+                uint64_t word = loadWord(row + x);
+                sub[0][word & 0xff]++;
+                sub[1][(word >> 8) & 0xff]++;
+                sub[2][(word >> 16) & 0xff]++;
+                sub[3][(word >> 24) & 0xff]++;
+                sub[0][(word >> 32) & 0xff]++;
+                sub[1][(word >> 40) & 0xff]++;
+                sub[2][(word >> 48) & 0xff]++;
+                sub[3][word >> 56]++;
+            }
+            count += x;
+        }
+        else if (step == 2) {
+            for (; x+8 <= width; x += 8) {
+                uint64_t word = loadWord(row + x);
+                sub[0][word & 0xff]++;
+                sub[1][(word >> 16) & 0xff]++;
+                sub[2][(word >> 32) & 0xff]++;
+                sub[3][(word >> 48) & 0xff]++;
+            }
+            count += x/2;
+        }
+
+        for (int i=0; x<width; x+=step, i++) {
+            sub[i%SUB_HISTOGRAM_COUNT][row[x]]++;
+            count++;
+        }
+    }
+
+    int bin = 0;
+#if EXPOSURE_USE_NEON
+    for (; bin<VIDEO_LUMA_HISTOGRAM_BINS; bin += 4) {
+        uint32x4_t sum = vaddq_u32(vaddq_u32(vld1q_u32(sub[0] + bin), vld1q_u32(sub[1] + bin)),
+                                   vaddq_u32(vld1q_u32(sub[2] + bin), vld1q_u32(sub[3] + bin)));
+        vst1q_u32(histogram + bin, sum);
+    }
+#elif EXPOSURE_USE_SSE2
+    for (; bin<VIDEO_LUMA_HISTOGRAM_BINS; bin += 4) {
+        __m128i sum = _mm_add_epi32(_mm_add_epi32(_mm_loadu_si128((const __m128i*)(sub[0] + bin)), _mm_loadu_si128((const __m128i*)(sub[1] + bin))),
+                                    _mm_add_epi32(_mm_loadu_si128((const __m128i*)(sub[2] + bin)), _mm_loadu_si128((const __m128i*)(sub[3] + bin))));
+        _mm_storeu_si128((__m128i*)(histogram + bin), sum);
+    }
+#endif
+    for (; bin<VIDEO_LUMA_HISTOGRAM_BINS; bin++) {
+        histogram[bin] = sub[0][bin] + sub[1][bin] + sub[2][bin] + sub[3][bin];
+    }
+
+    return count;
+}
+
+int lumaHistogramPercentile(const uint32_t* histogram, float fraction){
+    uint64_t total = 0;
+    for (int i=0; i<VIDEO_LUMA_HISTOGRAM_BINS; i++) {
+        total += histogram[i];
+    }
+
+    if (total == 0) {
+        return 0;
+    }
+
+    //in whole samples, the slack stops float error from asking for one sample more
+    uint64_t target = (uint64_t)ceil((double)fraction*total - 1e-6);
+    if (target == 0) {
+        target = 1;
+    }
+
+    uint64_t cumulative = 0;
+    for (int i=0; i<VIDEO_LUMA_HISTOGRAM_BINS; i++) {
+        cumulative += histogram[i];
+        if (cumulative >= target) {
+            return i;
+        }
+    }
+    return VIDEO_LUMA_HISTOGRAM_BINS - 1;
+}
+
+void lumaStatisticsFromHistogram(const uint32_t* histogram, int shadowThreshold, int highlightThreshold, VideoLumaStatistics* statistics){
+    memset(statistics, 0, sizeof(VideoLumaStatistics));
+
+    uint64_t total = 0, weighted = 0, shadows = 0, highlights = 0;
+    for (int i=0; i<VIDEO_LUMA_HISTOGRAM_BINS; i++) {
+        total += histogram[i];
+        weighted += (uint64_t)i*histogram[i];
+        if (i <= shadowThreshold) {
+            shadows += histogram[i];
+        }
+        if (i >= highlightThreshold) {
+            highlights += histogram[i];
+        }
+    }
+
+    if (total == 0) {
+        return;
+    }
+
+    statistics->sampleCount = (uint32_t)total;
+    statistics->mean = (float)((double)weighted/total);
+    statistics->percentile5 = lumaHistogramPercentile(histogram, 0.05f);
+    statistics->percentile25 = lumaHistogramPercentile(histogram, 0.25f);
+    statistics->median = lumaHistogramPercentile(histogram, 0.5f);
+    statistics->percentile75 = lumaHistogramPercentile(histogram, 0.75f);
+    statistics->percentile95 = lumaHistogramPercentile(histogram, 0.95f);
+    statistics->shadowFraction = (float)((double)shadows/total);
+    statistics->highlightFraction = (float)((double)highlights/total);
+}
+
+#pragma mark - statistics
+
+@interface DJIVideoLumaStatistics ()
+@property (nonatomic, assign) uint32_t frameUUID;
+@property (nonatomic, assign) VideoLumaStatistics statistics;
+@property (nonatomic, strong) NSData* histogram;
+@end
+
+@implementation DJIVideoLumaStatistics
+
+-(BOOL) exceedsDynamicRangeWithClipLimit:(float)limit{
+    return _statistics.shadowFraction > limit && _statistics.highlightFraction > limit;
+}
+
+@end
+
+#pragma mark - monitor
+
+@interface DJIVideoLumaSubscription : NSObject
+@property (nonatomic, copy) VideoLumaStatisticsHandler handler;
+@property (nonatomic, strong) dispatch_queue_t queue;
+@end
+
+@implementation DJIVideoLumaSubscription
+@end
+
+@interface DJIVideoExposureMonitor (){
+    int _frameCounter;
+}
+@property (nonatomic, strong) NSMutableArray* subscriptions;
+@property (atomic, strong) DJIVideoLumaStatistics* latestStatistics;
+@end
+
+@implementation DJIVideoExposureMonitor
+
+-(id) init{
+    self = [super init];
+    if (self) {
+        _enabled = YES;
+        _pyramidLevel = 1;
+        _sampleStep = 2;
+        _frameInterval = 1;
+        _shadowThreshold = 16;
+        _highlightThreshold = 235;
+        _subscriptions = [NSMutableArray array];
+    }
+    return self;
+}
+
+-(id) subscribe:(VideoLumaStatisticsHandler)handler queue:(dispatch_queue_t)queue{
+    DJIVideoLumaSubscription* subscription = [[DJIVideoLumaSubscription alloc] init];
+    subscription.handler = handler;
+    subscription.queue = queue;
+
+    @synchronized(_subscriptions) {
+        [_subscriptions addObject:subscription];
+    }
+    return subscription;
+}
+
+-(void) unsubscribe:(id)token{
+    if (!token) {
+        return;
+    }
+
+    @synchronized(_subscriptions) {
+        [_subscriptions removeObjectIdenticalTo:token];
+    }
+}
+
+-(BOOL) videoProcessorEnabled{
+    return self.enabled;
+}
+
+-(int) videoProcessorPyramidLevel{
+    return self.pyramidLevel;
+}
+
+-(void) videoProcessFrame:(VideoFrameYUV *)frame{
+    //pyramid level -1, sample the full size luma
+    if (frame->frameType != VPFrameTypeYUV420Planer && frame->frameType != VPFrameTypeYUV420SemiPlaner) {
+        return;
+    }
+
+    int stride = frame->lumaSlice? frame->lumaSlice : frame->width;
+    [self measureLuma:frame->luma stride:stride width:frame->width height:frame->height frameUUID:frame->frame_uuid];
+}
+
+-(void) videoProcessPyramidLevel:(VideoFramePyramidLevel *)level frame:(VideoFrameYUV *)frame{
+    [self measureLuma:level->luma stride:level->width width:level->width height:level->height frameUUID:frame->frame_uuid];
+}
+
+-(void) videoProcessFailedFrame{
+}
+
+-(void) measureLuma:(const uint8_t*)luma stride:(int)stride width:(int)width height:(int)height frameUUID:(uint32_t)uuid{
+    int interval = self.frameInterval > 0? self.frameInterval : 1;
+    if ((_frameCounter++)%interval != 0) {
+        return;
+    }
+
+    NSMutableData* histogram = [NSMutableData dataWithLength:VIDEO_LUMA_HISTOGRAM_BINS*sizeof(uint32_t)];
+    if (0 == lumaHistogram(luma, stride, width, height, self.sampleStep, (uint32_t*)histogram.mutableBytes)) {
+        return;
+    }
+
+    VideoLumaStatistics statistics;
+    lumaStatisticsFromHistogram((const uint32_t*)histogram.bytes, self.shadowThreshold, self.highlightThreshold, &statistics);
+
+    DJIVideoLumaStatistics* result = [[DJIVideoLumaStatistics alloc] init];
+    result.frameUUID = uuid;
+    result.statistics = statistics;
+    result.histogram = histogram;
+    self.latestStatistics = result;
+
+    NSArray* subscriptions = nil;
+    @synchronized(_subscriptions) {
+        subscriptions = [NSArray arrayWithArray:_subscriptions];
+    }
+
+    for (DJIVideoLumaSubscription* subscription in subscriptions) {
+        VideoLumaStatisticsHandler handler = subscription.handler;
+        if (subscription.queue) {
+            dispatch_async(subscription.queue, ^{
+                handler(result);
+            });
+        }
+        else{
+            handler(result);
+        }
+    }
+}
+
+@end
@@ -0,0 +1,151 @@
+//
+//  DJIVideoFrameAnalysis.h
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "DJIStreamCommon.h"
+
+#define VIDEO_ANALYSIS_MAX_REGION_COUNT (64)
+
+typedef struct{
+    int columns; //the plane is split into columns x rows regions, at most VIDEO_ANALYSIS_MAX_REGION_COUNT
+    int rows;
+    int edgeThreshold; //sobel magnitude in luma steps above which a pixel is a peaking edge
+    int clipThreshold; //luma at or above which a pixel is clipped
+    uint8_t* edgeMask; //optional width x height overlay, 255 on edges and 0 elsewhere
+    uint8_t* clipMask; //optional width x height overlay, 255 on clipped pixels and 0 elsewhere
+} VideoFrameAnalysisOptions;
+
+typedef struct{
+    float edgeEnergy; //mean squared sobel magnitude per pixel
+    float edgeFraction; //fraction of pixels above the edge threshold
+    float clippedFraction; //fraction of pixels at or above the clip threshold
+} VideoFrameRegionScore;
+
+typedef struct{
+    int columns, rows;
+    VideoFrameRegionScore regions[VIDEO_ANALYSIS_MAX_REGION_COUNT]; //row major
+    VideoFrameRegionScore total;
+} VideoFrameAnalysisResult;
+
+/**
+ *  Focus peaking and zebra analysis of a luma plane on the CPU, the numeric counterpart of the sobel and over
+ *  exposed shaders in MovieGLView. Uses NEON or SSE2 when available. The one pixel border has no edges.
+ *
+ *  @param luma luma plane, usually a level of the frame pyramid.
+ *  @param stride bytes per row of the plane.
+ *  @param width width of the plane.
+ *  @param height height of the plane.
+ *  @param options region grid, thresholds and optional overlay masks.
+ *  @param result scores per region and for the whole plane.
+ *
+ *  @return `0` on success, `-1` for invalid arguments.
+ */
+int analyzeLumaPlane(const uint8_t* luma, int stride, int width, int height, const VideoFrameAnalysisOptions* options, VideoFrameAnalysisResult* result);
+
+/**
+ *  Scalar implementation of `analyzeLumaPlane`. It is the reference for the vectorized paths, which give the same
+ *  result.
+ */
+int analyzeLumaPlaneReference(const uint8_t* luma, int stride, int width, int height, const VideoFrameAnalysisOptions* options, VideoFrameAnalysisResult* result);
+
+/**
+ *  Edge threshold that marks the same pixels as MovieGLView's `focusWarningThreshold`.
+ */
+int edgeThresholdForFocusWarning(float focusWarningThreshold);
+
+/**
+ *  Clip threshold that marks the same pixels as MovieGLView's `overExposedMark`.
+ */
+int clipThresholdForOverExposedMark(float overExposedMark);
+
+/**
+ *  Variance of the 4 neighbour laplacian over the inside of a luma plane, a cheap sharpness measure. Blur from motion
+ *  or focus lowers it. Uses NEON or SSE2 when available.
+ *
+ *  @return the variance, `-1` for invalid arguments.
+ */
+double lumaLaplacianVariance(const uint8_t* luma, int stride, int width, int height);
+
+/**
+ *  Mean absolute difference of two luma planes of the same size, how much the picture moved between two frames.
+ *  Uses NEON or SSE2 when available.
+ *
+ *  @return the mean difference in luma steps, `-1` for invalid arguments.
+ */
+double lumaMeanAbsoluteDifference(const uint8_t* lumaA, int strideA, const uint8_t* lumaB, int strideB, int width, int height);
+
+#define VIDEO_GLOBAL_MOTION_MAX_SEARCH_RANGE (16)
+
+typedef struct{
+    float dx; //the picture moved right by dx pixels from the previous to the current frame, to sub pixel precision
+    float dy; //the picture moved down by dy pixels
+    float cost; //mean absolute difference at the best shift
+    BOOL atSearchLimit; //the best shift is on the edge of the search window, the real motion may be larger
+} VideoGlobalMotion;
+
+/**
+ *  Global motion between two frames by exhaustive block matching of the inside of the current frame against the
+ *  previous one, refined to sub pixel precision with a V fitted through the neighbouring costs. The matching uses
+ *  NEON or SSE2 when available.
+ *
+ *  @param previous luma plane of the previous frame, usually a level of the frame pyramid.
+ *  @param previousStride bytes per row of the previous plane.
+ *  @param current luma plane of the current frame, the same size.
+ *  @param currentStride bytes per row of the current plane.
+ *  @param width width of the planes, more than 4 x searchRange.
+ *  @param height height of the planes, more than 4 x searchRange.
+ *  @param searchRange largest shift tried in each direction, at most VIDEO_GLOBAL_MOTION_MAX_SEARCH_RANGE.
+ *  @param motion output.
+ *
+ *  @return `0` on success, `-1` for invalid arguments.
+ */
+int estimateGlobalMotion(const uint8_t* previous, int previousStride, const uint8_t* current, int currentStride,
+                         int width, int height, int searchRange, VideoGlobalMotion* motion);
+
+/**
+ *  Analysis of one decoded frame.
+ */
+@interface DJIVideoFrameAnalysis : NSObject
+@property (nonatomic, readonly) uint32_t frameUUID;
+@property (nonatomic, readonly) int width;
+@property (nonatomic, readonly) int height;
+@property (nonatomic, readonly) VideoFrameAnalysisResult result;
+@property (nonatomic, readonly) VideoFrameRegionScore totalScore;
+//width x height overlays, nil unless the analyzer generates masks
+@property (nonatomic, readonly) NSData* edgeMask;
+@property (nonatomic, readonly) NSData* clipMask;
+
+-(VideoFrameRegionScore) scoreOfRegionAtColumn:(int)column row:(int)row;
+@end
+
+typedef void (^VideoFrameAnalysisHandler)(DJIVideoFrameAnalysis* analysis);
+
+/**
+ *  Frame processor that runs the analysis on a pyramid level of every decoded frame, independent of the GL view.
+ *  Register it with `registFrameProcessor:`.
+ */
+@interface DJIVideoFrameAnalyzer : NSObject <VideoFrameProcessor>
+@property (nonatomic, assign) BOOL enabled;
+
+//pyramid level to analyze, default 1 (a quarter of the decoded size)
+@property (nonatomic, assign) int pyramidLevel;
+
+//region grid, default 4 x 3
+@property (nonatomic, assign) int columns;
+@property (nonatomic, assign) int rows;
+
+//thresholds in the units of MovieGLView, default 3.0 and 0.9
+@property (nonatomic, assign) float focusWarningThreshold;
+@property (nonatomic, assign) float overExposedMark;
+
+//fill edgeMask and clipMask of the analysis
+@property (nonatomic, assign) BOOL generateMasks;
+
+//called on the decode thread after each analyzed frame
+@property (nonatomic, copy) VideoFrameAnalysisHandler analysisHandler;
+
+@property (atomic, readonly) DJIVideoFrameAnalysis* latestAnalysis;
+@end
@@ -0,0 +1,618 @@
+//
+//  DJIVideoFrameAnalysis.m
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import "DJIVideoFrameAnalysis.h"
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define FRAME_ANALYSIS_USE_NEON (1)
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define FRAME_ANALYSIS_USE_SSE2 (1)
+#endif
+
+//pixels per vector pass before the 32 bit energy lanes are flushed, keeps them far from overflow
+#define FRAME_ANALYSIS_FLUSH_PIXELS (256)
+
+typedef struct{
+    uint64_t energy;
+    uint32_t edges;
+    uint32_t clipped;
+    uint32_t pixels;
+} RegionAccumulator;
+
+static inline int sobelMagnitude2(const uint8_t* a, const uint8_t* b, const uint8_t* c, int x){
+    int gx = (a[x+1] + 2*b[x+1] + c[x+1]) - (a[x-1] + 2*b[x-1] + c[x-1]);
+    int gy = (c[x-1] + 2*c[x] + c[x+1]) - (a[x-1] + 2*a[x] + a[x+1]);
+    return gx*gx + gy*gy;
+}
+
+/**
+ *  Sobel over [x0, x1) of row b, a and c are the rows above and below. x0 >= 1 and x1 <= width-1.
+ */
+static void sobelSegment(const uint8_t* a, const uint8_t* b, const uint8_t* c, int x0, int x1, int threshold2,
+                         uint8_t* mask, RegionAccumulator* acc, BOOL useSIMD){
+    int x = x0;
+
+#if FRAME_ANALYSIS_USE_NEON
+    if (useSIMD) {
+        const int32x4_t thr = vdupq_n_s32(threshold2);
+        while (x+8 <= x1) {
+            uint32x4_t energy = vdupq_n_u32(0);
+            uint32x4_t edges = vdupq_n_u32(0);
+            int end = x + FRAME_ANALYSIS_FLUSH_PIXELS;
+
+            for (; x+8 <= x1 && x < end; x += 8) {
+                int16x8_t a0 = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(a + x - 1)));
+                int16x8_t a1 = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(a + x)));
+                int16x8_t a2 = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(a + x + 1)));
+                int16x8_t b0 = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(b + x - 1)));
+                int16x8_t b2 = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(b + x + 1)));
+                int16x8_t c0 = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(c + x - 1)));
+                int16x8_t c1 = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(c + x)));
+                int16x8_t c2 = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(c + x + 1)));
+
+                int16x8_t gx = vsubq_s16(vaddq_s16(vaddq_s16(a2, c2), vshlq_n_s16(b2, 1)),
+                                         vaddq_s16(vaddq_s16(a0, c0), vshlq_n_s16(b0, 1)));
+                int16x8_t gy = vsubq_s16(vaddq_s16(vaddq_s16(c0, c2), vshlq_n_s16(c1, 1)),
+                                         vaddq_s16(vaddq_s16(a0, a2), vshlq_n_s16(a1, 1)));
+
+                int32x4_t lo = vmlal_s16(vmull_s16(vget_low_s16(gx), vget_low_s16(gx)), vget_low_s16(gy), vget_low_s16(gy));
+                int32x4_t hi = vmlal_s16(vmull_s16(vget_high_s16(gx), vget_high_s16(gx)), vget_high_s16(gy), vget_high_s16(gy));
+
+                uint32x4_t edgeLo = vcgtq_s32(lo, thr);
+                uint32x4_t edgeHi = vcgtq_s32(hi, thr);
+
+                energy = vaddq_u32(energy, vaddq_u32(vreinterpretq_u32_s32(lo), vreinterpretq_u32_s32(hi)));
+                edges = vsubq_u32(vsubq_u32(edges, edgeLo), edgeHi);
+
+                if (mask) {
+                    uint16x8_t edge16 = vcombine_u16(vmovn_u32(edgeLo), vmovn_u32(edgeHi));
+                    vst1_u8(mask + x, vmovn_u16(edge16));
+                }
+            }
+
+            uint64x2_t energy64 = vpaddlq_u32(energy);
+            uint64x2_t edges64 = vpaddlq_u32(edges);
+            acc->energy += vgetq_lane_u64(energy64, 0) + vgetq_lane_u64(energy64, 1);
+            acc->edges += (uint32_t)(vgetq_lane_u64(edges64, 0) + vgetq_lane_u64(edges64, 1));
+        }
+    }
+#elif FRAME_ANALYSIS_USE_SSE2
+    if (useSIMD) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i thr = _mm_set1_epi32(threshold2);
+        while (x+8 <= x1) {
+            __m128i energy = _mm_setzero_si128();
+            __m128i edges = _mm_setzero_si128();
+            int end = x + FRAME_ANALYSIS_FLUSH_PIXELS;
+
+            for (; x+8 <= x1 && x < end; x += 8) {
+                __m128i a0 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(a + x - 1)), zero);
+                __m128i a1 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(a + x)), zero);
+                __m128i a2 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(a + x + 1)), zero);
+                __m128i b0 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(b + x - 1)), zero);
+                __m128i b2 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(b + x + 1)), zero);
+                __m128i c0 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(c + x - 1)), zero);
+                __m128i c1 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(c + x)), zero);
+                __m128i c2 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(c + x + 1)), zero);
+
+                __m128i gx = _mm_sub_epi16(_mm_add_epi16(_mm_add_epi16(a2, c2), _mm_slli_epi16(b2, 1)),
+                                           _mm_add_epi16(_mm_add_epi16(a0, c0), _mm_slli_epi16(b0, 1)));
+                __m128i gy = _mm_sub_epi16(_mm_add_epi16(_mm_add_epi16(c0, c2), _mm_slli_epi16(c1, 1)),
+                                           _mm_add_epi16(_mm_add_epi16(a0, a2), _mm_slli_epi16(a1, 1)));
+
+                //gx*gx + gy*gy per pixel from the interleaved pairs
+                __m128i pairLo = _mm_unpacklo_epi16(gx, gy);
+                __m128i pairHi = _mm_unpackhi_epi16(gx, gy);
+                __m128i lo = _mm_madd_epi16(pairLo, pairLo);
+                __m128i hi = _mm_madd_epi16(pairHi, pairHi);
+
+                __m128i edgeLo = _mm_cmpgt_epi32(lo, thr);
+                __m128i edgeHi = _mm_cmpgt_epi32(hi, thr);
+
+                energy = _mm_add_epi32(energy, _mm_add_epi32(lo, hi));
+                edges = _mm_sub_epi32(_mm_sub_epi32(edges, edgeLo), edgeHi);
+
+                if (mask) {
+                    __m128i edge16 = _mm_packs_epi32(edgeLo, edgeHi);
+                    _mm_storel_epi64((__m128i*)(mask + x), _mm_packs_epi16(edge16, edge16));
+                }
+            }
+
+            uint32_t energyLanes[4], edgeLanes[4];
+            _mm_storeu_si128((__m128i*)energyLanes, energy);
+            _mm_storeu_si128((__m128i*)edgeLanes, edges);
+            acc->energy += (uint64_t)energyLanes[0] + energyLanes[1] + energyLanes[2] + energyLanes[3];
+            acc->edges += edgeLanes[0] + edgeLanes[1] + edgeLanes[2] + edgeLanes[3];
+        }
+    }
+#endif
+
+    for (; x<x1; x++) {
+        int magnitude2 = sobelMagnitude2(a, b, c, x);
+        BOOL edge = magnitude2 > threshold2;
+
+        acc->energy += magnitude2;
+        acc->edges += edge;
+        if (mask) {
+            mask[x] = edge? 255 : 0;
+        }
+    }
+}
+
+/**
+ *  Count pixels of [x0, x1) at or above the threshold.
+ */
+static void clipSegment(const uint8_t* row, int x0, int x1, int threshold, uint8_t* mask, RegionAccumulator* acc, BOOL useSIMD){
+    int x = x0;
+
+    if (threshold < 0) {
+        threshold = 0;
+    }
+
+    //a threshold above 255 clips nothing, the vector compare can not express it
+    if (threshold > 255) {
+        if (mask) {
+            memset(mask + x0, 0, x1 - x0);
+        }
+        return;
+    }
+
+#if FRAME_ANALYSIS_USE_NEON
+    if (useSIMD) {
+        const uint8x16_t thr = vdupq_n_u8((uint8_t)threshold);
+        uint16x8_t count = vdupq_n_u16(0);
+        for (; x+16 <= x1; x += 16) {
+            uint8x16_t clipped = vcgeq_u8(vld1q_u8(row + x), thr);
+            count = vpadalq_u8(count, vshrq_n_u8(clipped, 7));
+            if (mask) {
+                vst1q_u8(mask + x, clipped);
+            }
+        }
+
+        uint64x2_t count64 = vpaddlq_u32(vpaddlq_u16(count));
+        acc->clipped += (uint32_t)(vgetq_lane_u64(count64, 0) + vgetq_lane_u64(count64, 1));
+    }
+#elif FRAME_ANALYSIS_USE_SSE2
+    if (useSIMD) {
+        const __m128i thr = _mm_set1_epi8((char)threshold);
+        const __m128i one = _mm_set1_epi8(1);
+        __m128i count = _mm_setzero_si128();
+        for (; x+16 <= x1; x += 16) {
+            __m128i value = _mm_loadu_si128((const __m128i*)(row + x));
+            __m128i clipped = _mm_cmpeq_epi8(_mm_max_epu8(value, thr), value);
+            count = _mm_add_epi64(count, _mm_sad_epu8(_mm_and_si128(clipped, one), _mm_setzero_si128()));
+            if (mask) {
+                _mm_storeu_si128((__m128i*)(mask + x), clipped);
+            }
+        }
+
+        uint64_t lanes[2];
+        _mm_storeu_si128((__m128i*)lanes, count);
+        acc->clipped += (uint32_t)(lanes[0] + lanes[1]);
+    }
+#endif
+
+    for (; x<x1; x++) {
+        BOOL clipped = row[x] >= threshold;
+        acc->clipped += clipped;
+        if (mask) {
+            mask[x] = clipped? 255 : 0;
+        }
+    }
+}
+
+static VideoFrameRegionScore regionScore(const RegionAccumulator* acc){
+    VideoFrameRegionScore score = {0};
+    if (acc->pixels) {
+        score.edgeEnergy = (float)((double)acc->energy/acc->pixels);
+        score.edgeFraction = (float)acc->edges/acc->pixels;
+        score.clippedFraction = (float)acc->clipped/acc->pixels;
+    }
+    return score;
+}
+
+static int analyzeLumaPlaneInternal(const uint8_t* luma, int stride, int width, int height,
+                                    const VideoFrameAnalysisOptions* options, VideoFrameAnalysisResult* result, BOOL useSIMD){
+    if (!luma || !options || !result || width < 3 || height < 3 || stride < width) {
+        return -1;
+    }
+
+    int columns = options->columns > 0? options->columns : 1;
+    int rows = options->rows > 0? options->rows : 1;
+    if (columns*rows > VIDEO_ANALYSIS_MAX_REGION_COUNT || columns > width || rows > height) {
+        return -1;
+    }
+
+    RegionAccumulator acc[VIDEO_ANALYSIS_MAX_REGION_COUNT];
+    memset(acc, 0, sizeof(acc));
+
+    int threshold2 = options->edgeThreshold*options->edgeThreshold;
+
+    for (int y=0; y<height; y++) {
+        const uint8_t* b = luma + y*stride;
+        const uint8_t* a = b - stride;
+        const uint8_t* c = b + stride;
+        uint8_t* edgeRow = options->edgeMask? options->edgeMask + y*width : NULL;
+        uint8_t* clipRow = options->clipMask? options->clipMask + y*width : NULL;
+        BOOL border = (y == 0 || y == height-1);
+        RegionAccumulator* rowAcc = acc + (y*rows/height)*columns;
+
+        if (edgeRow) {
+            edgeRow[0] = 0;
+            edgeRow[width-1] = 0;
+            if (border) {
+                memset(edgeRow, 0, width);
+            }
+        }
+
+        for (int column=0; column<columns; column++) {
+            int x0 = column*width/columns;
+            int x1 = (column+1)*width/columns;
+            RegionAccumulator* region = rowAcc + column;
+
+            region->pixels += x1 - x0;
+            clipSegment(b, x0, x1, options->clipThreshold, clipRow, region, useSIMD);
+
+            if (!border) {
+                int sx0 = x0 > 1? x0 : 1;
+                int sx1 = x1 < width-1? x1 : width-1;
+                if (sx0 < sx1) {
+                    sobelSegment(a, b, c, sx0, sx1, threshold2, edgeRow, region, useSIMD);
+                }
+            }
+        }
+    }
+
+    RegionAccumulator total = {0};
+    memset(result, 0, sizeof(VideoFrameAnalysisResult));
+    result->columns = columns;
+    result->rows = rows;
+    for (int i=0; i<columns*rows; i++) {
+        result->regions[i] = regionScore(&acc[i]);
+        total.energy += acc[i].energy;
+        total.edges += acc[i].edges;
+        total.clipped += acc[i].clipped;
+        total.pixels += acc[i].pixels;
+    }
+    result->total = regionScore(&total);
+
+    return 0;
+}
+
+int analyzeLumaPlane(const uint8_t* luma, int stride, int width, int height, const VideoFrameAnalysisOptions* options, VideoFrameAnalysisResult* result){
+    return analyzeLumaPlaneInternal(luma, stride, width, height, options, result, YES);
+}
+
+int analyzeLumaPlaneReference(const uint8_t* luma, int stride, int width, int height, const VideoFrameAnalysisOptions* options, VideoFrameAnalysisResult* result){
+    return analyzeLumaPlaneInternal(luma, stride, width, height, options, result, NO);
+}
+
+int edgeThresholdForFocusWarning(float focusWarningThreshold){
+    //the shader compares the length of the rgb sobel vector in [0, 1] units against sqrt(threshold),
+    //for a gray pixel that length is sqrt(3) times the luma gradient
+    if (focusWarningThreshold <= 0) {
+        return 0;
+    }
+    return (int)lroundf(255.0f*sqrtf(focusWarningThreshold/3.0f));
+}
+
+int clipThresholdForOverExposedMark(float overExposedMark){
+    //the shader marks luma strictly above the mark, a mark of 0 disables it
+    if (overExposedMark <= 0) {
+        return 256;
+    }
+    int threshold = (int)floorf(overExposedMark*255.0f) + 1;
+    return threshold < 256? threshold : 256;
+}
+
+#pragma mark - sharpness and motion
+
+double lumaLaplacianVariance(const uint8_t* luma, int stride, int width, int height){
+    if (!luma || width < 3 || height < 3 || stride < width) {
+        return -1;
+    }
+
+    int64_t sum = 0;
+    uint64_t sum2 = 0;
+
+    for (int y=1; y<height-1; y++) {
+        const uint8_t* b = luma + y*stride;
+        const uint8_t* a = b - stride;
+        const uint8_t* c = b + stride;
+        int x = 1;
+
+#if FRAME_ANALYSIS_USE_NEON
+        while (x+8 <= width-1) {
+            int32x4_t rowSum = vdupq_n_s32(0);
+            uint32x4_t rowSum2 = vdupq_n_u32(0);
+            int end = x + FRAME_ANALYSIS_FLUSH_PIXELS;
+
+            for (; x+8 <= width-1 && x < end; x += 8) {
+                int16x8_t center = vreinterpretq_s16_u16(vshll_n_u8(vld1_u8(b + x), 2));
+                uint16x8_t around = vaddl_u8(vld1_u8(b + x - 1), vld1_u8(b + x + 1));
+                around = vaddq_u16(around, vaddl_u8(vld1_u8(a + x), vld1_u8(c + x)));
+                int16x8_t laplacian = vsubq_s16(center, vreinterpretq_s16_u16(around));
+
+                rowSum = vpadalq_s16(rowSum, laplacian);
+                int32x4_t lo = vmull_s16(vget_low_s16(laplacian), vget_low_s16(laplacian));
+                int32x4_t hi = vmull_s16(vget_high_s16(laplacian), vget_high_s16(laplacian));
+                rowSum2 = vaddq_u32(rowSum2, vaddq_u32(vreinterpretq_u32_s32(lo), vreinterpretq_u32_s32(hi)));
+            }
+
+            int64x2_t sum64 = vpaddlq_s32(rowSum);
+            uint64x2_t sum264 = vpaddlq_u32(rowSum2);
+            sum += vgetq_lane_s64(sum64, 0) + vgetq_lane_s64(sum64, 1);
+            sum2 += vgetq_lane_u64(sum264, 0) + vgetq_lane_u64(sum264, 1);
+        }
+#elif FRAME_ANALYSIS_USE_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i ones = _mm_set1_epi16(1);
+        while (x+8 <= width-1) {
+            __m128i rowSum = _mm_setzero_si128();
+            __m128i rowSum2 = _mm_setzero_si128();
+            int end = x + FRAME_ANALYSIS_FLUSH_PIXELS;
+
+            for (; x+8 <= width-1 && x < end; x += 8) {
+                __m128i center = _mm_slli_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(b + x)), zero), 2);
+                __m128i around = _mm_add_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(b + x - 1)), zero),
+                                               _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(b + x + 1)), zero));
+                around = _mm_add_epi16(around, _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(a + x)), zero));
+                around = _mm_add_epi16(around, _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(c + x)), zero));
+                __m128i laplacian = _mm_sub_epi16(center, around);
+
+                rowSum = _mm_add_epi32(rowSum, _mm_madd_epi16(laplacian, ones));
+                rowSum2 = _mm_add_epi32(rowSum2, _mm_madd_epi16(laplacian, laplacian));
+            }
+
+            int32_t sumLanes[4];
+            uint32_t sum2Lanes[4];
+            _mm_storeu_si128((__m128i*)sumLanes, rowSum);
+            _mm_storeu_si128((__m128i*)sum2Lanes, rowSum2);
+            sum += (int64_t)sumLanes[0] + sumLanes[1] + sumLanes[2] + sumLanes[3];
+            sum2 += (uint64_t)sum2Lanes[0] + sum2Lanes[1] + sum2Lanes[2] + sum2Lanes[3];
+        }
+#endif
+
+        for (; x<width-1; x++) {
+            int laplacian = 4*b[x] - b[x-1] - b[x+1] - a[x] - c[x];
+            sum += laplacian;
+            sum2 += laplacian*laplacian;
+        }
+    }
+
+    double count = (double)(width-2)*(height-2);
+    double mean = sum/count;
+    return sum2/count - mean*mean;
+}
+
+static uint64_t sumAbsoluteDifference(const uint8_t* lumaA, int strideA, const uint8_t* lumaB, int strideB, int width, int height){
+    uint64_t sum = 0;
+
+    for (int y=0; y<height; y++) {
+        const uint8_t* a = lumaA + y*strideA;
+        const uint8_t* b = lumaB + y*strideB;
+        int x = 0;
+
+#if FRAME_ANALYSIS_USE_NEON
+        uint32x4_t rowSum = vdupq_n_u32(0);
+        for (; x+16 <= width; x += 16) {
+            rowSum = vpadalq_u16(rowSum, vpaddlq_u8(vabdq_u8(vld1q_u8(a + x), vld1q_u8(b + x))));
+        }
+        uint64x2_t sum64 = vpaddlq_u32(rowSum);
+        sum += vgetq_lane_u64(sum64, 0) + vgetq_lane_u64(sum64, 1);
+#elif FRAME_ANALYSIS_USE_SSE2
+        __m128i rowSum = _mm_setzero_si128();
+        for (; x+16 <= width; x += 16) {
+            rowSum = _mm_add_epi64(rowSum, _mm_sad_epu8(_mm_loadu_si128((const __m128i*)(a + x)),
+                                                        _mm_loadu_si128((const __m128i*)(b + x))));
+        }
+        uint64_t lanes[2];
+        _mm_storeu_si128((__m128i*)lanes, rowSum);
+        sum += lanes[0] + lanes[1];
+#endif
+
+        for (; x<width; x++) {
+            sum += a[x] > b[x]? a[x] - b[x] : b[x] - a[x];
+        }
+    }
+
+    return sum;
+}
+
+double lumaMeanAbsoluteDifference(const uint8_t* lumaA, int strideA, const uint8_t* lumaB, int strideB, int width, int height){
+    if (!lumaA || !lumaB || width <= 0 || height <= 0 || strideA < width || strideB < width) {
+        return -1;
+    }
+
+    return (double)sumAbsoluteDifference(lumaA, strideA, lumaB, strideB, width, height)/((double)width*height);
+}
+
+//offset of the minimum of the V through three costs around the best one, in [-0.5, 0.5]. Absolute differences grow
+//about linearly with the shift, so a V fits them better than a parabola
+static float subpixelOffset(uint64_t before, uint64_t best, uint64_t after){
+    double slope = (double)(before > after? before : after) - (double)best;
+    if (slope <= 0) {
+        return 0;
+    }
+    return (float)(((double)before - (double)after)/(2.0*slope));
+}
+
+int estimateGlobalMotion(const uint8_t* previous, int previousStride, const uint8_t* current, int currentStride,
+                         int width, int height, int searchRange, VideoGlobalMotion* motion){
+    if (!previous || !current || !motion || searchRange <= 0 || searchRange > VIDEO_GLOBAL_MOTION_MAX_SEARCH_RANGE
+        || width <= 4*searchRange || height <= 4*searchRange || previousStride < width || currentStride < width) {
+        return -1;
+    }
+
+    int side = 2*searchRange + 1;
+    uint64_t costs[(2*VIDEO_GLOBAL_MOTION_MAX_SEARCH_RANGE + 1)*(2*VIDEO_GLOBAL_MOTION_MAX_SEARCH_RANGE + 1)];
+
+    //the window of the current frame that stays inside the previous frame for every shift
+    int windowWidth = width - 2*searchRange;
+    int windowHeight = height - 2*searchRange;
+    const uint8_t* window = current + searchRange*currentStride + searchRange;
+
+    //no motion is tried first and wins ties, a flat picture reads as still
+    int bestX = 0, bestY = 0;
+    uint64_t bestCost = sumAbsoluteDifference(window, currentStride, previous + searchRange*previousStride + searchRange,
+                                              previousStride, windowWidth, windowHeight);
+    costs[searchRange*side + searchRange] = bestCost;
+
+    for (int dy=-searchRange; dy<=searchRange; dy++) {
+        for (int dx=-searchRange; dx<=searchRange; dx++) {
+            if (dx == 0 && dy == 0) {
+                continue;
+            }
+
+            //current(x, y) is matched with previous(x - dx, y - dy)
+            const uint8_t* reference = previous + (searchRange - dy)*previousStride + (searchRange - dx);
+            uint64_t cost = sumAbsoluteDifference(window, currentStride, reference, previousStride, windowWidth, windowHeight);
+            costs[(dy + searchRange)*side + dx + searchRange] = cost;
+
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestX = dx;
+                bestY = dy;
+            }
+        }
+    }
+
+    memset(motion, 0, sizeof(VideoGlobalMotion));
+    motion->dx = bestX;
+    motion->dy = bestY;
+    motion->cost = (float)((double)bestCost/((double)windowWidth*windowHeight));
+
+    int center = (bestY + searchRange)*side + bestX + searchRange;
+    if (bestX == -searchRange || bestX == searchRange) {
+        motion->atSearchLimit = YES;
+    }
+    else{
+        motion->dx += subpixelOffset(costs[center - 1], bestCost, costs[center + 1]);
+    }
+
+    if (bestY == -searchRange || bestY == searchRange) {
+        motion->atSearchLimit = YES;
+    }
+    else{
+        motion->dy += subpixelOffset(costs[center - side], bestCost, costs[center + side]);
+    }
+
+    return 0;
+}
+
+#pragma mark - analysis
+
+@interface DJIVideoFrameAnalysis ()
+@property (nonatomic, assign) uint32_t frameUUID;
+@property (nonatomic, assign) int width;
+@property (nonatomic, assign) int height;
+@property (nonatomic, assign) VideoFrameAnalysisResult result;
+@property (nonatomic, strong) NSData* edgeMask;
+@property (nonatomic, strong) NSData* clipMask;
+@end
+
+@implementation DJIVideoFrameAnalysis
+
+-(VideoFrameRegionScore) totalScore{
+    return _result.total;
+}
+
+-(VideoFrameRegionScore) scoreOfRegionAtColumn:(int)column row:(int)row{
+    if (column < 0 || column >= _result.columns || row < 0 || row >= _result.rows) {
+        VideoFrameRegionScore empty = {0};
+        return empty;
+    }
+    return _result.regions[row*_result.columns + column];
+}
+
+@end
+
+#pragma mark - analyzer
+
+@interface DJIVideoFrameAnalyzer ()
+@property (atomic, strong) DJIVideoFrameAnalysis* latestAnalysis;
+@end
+
+@implementation DJIVideoFrameAnalyzer
+
+-(id) init{
+    self = [super init];
+    if (self) {
+        _enabled = YES;
+        _pyramidLevel = 1;
+        _columns = 4;
+        _rows = 3;
+        _focusWarningThreshold = 3.0;
+        _overExposedMark = 0.9;
+    }
+    return self;
+}
+
+-(BOOL) videoProcessorEnabled{
+    return self.enabled;
+}
+
+-(int) videoProcessorPyramidLevel{
+    return self.pyramidLevel;
+}
+
+-(void) videoProcessFrame:(VideoFrameYUV *)frame{
+    //pyramid level -1, analyze the full size luma
+    if (frame->frameType != VPFrameTypeYUV420Planer && frame->frameType != VPFrameTypeYUV420SemiPlaner) {
+        return;
+    }
+
+    int stride = frame->lumaSlice? frame->lumaSlice : frame->width;
+    [self analyzeLuma:frame->luma stride:stride width:frame->width height:frame->height frameUUID:frame->frame_uuid];
+}
+
+-(void) videoProcessPyramidLevel:(VideoFramePyramidLevel *)level frame:(VideoFrameYUV *)frame{
+    [self analyzeLuma:level->luma stride:level->width width:level->width height:level->height frameUUID:frame->frame_uuid];
+}
+
+-(void) videoProcessFailedFrame{
+}
+
+-(void) analyzeLuma:(const uint8_t*)luma stride:(int)stride width:(int)width height:(int)height frameUUID:(uint32_t)uuid{
+    VideoFrameAnalysisOptions options = {0};
+    options.columns = self.columns;
+    options.rows = self.rows;
+    options.edgeThreshold = edgeThresholdForFocusWarning(self.focusWarningThreshold);
+    options.clipThreshold = clipThresholdForOverExposedMark(self.overExposedMark);
+
+    NSMutableData* edgeMask = nil;
+    NSMutableData* clipMask = nil;
+    if (self.generateMasks) {
+        edgeMask = [NSMutableData dataWithLength:width*height];
+        clipMask = [NSMutableData dataWithLength:width*height];
+        options.edgeMask = (uint8_t*)edgeMask.mutableBytes;
+        options.clipMask = (uint8_t*)clipMask.mutableBytes;
+    }
+
+    VideoFrameAnalysisResult result;
+    if (0 != analyzeLumaPlane(luma, stride, width, height, &options, &result)) {
+        return;
+    }
+
+    DJIVideoFrameAnalysis* analysis = [[DJIVideoFrameAnalysis alloc] init];
+    analysis.frameUUID = uuid;
+    analysis.width = width;
+    analysis.height = height;
+    analysis.result = result;
+    analysis.edgeMask = edgeMask;
+    analysis.clipMask = clipMask;
+
+    self.latestAnalysis = analysis;
+
+    VideoFrameAnalysisHandler handler = self.analysisHandler;
+    if (handler) {
+        handler(analysis);
+    }
+}
+
+@end
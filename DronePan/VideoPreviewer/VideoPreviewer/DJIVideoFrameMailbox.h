@@ -0,0 +1,72 @@
+//
+//  DJIVideoFrameMailbox.h
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <pthread.h>
+#import "DJIStreamCommon.h"
+#import "DJIVideoStatistics.h"
+
+//the frame being written, the newest finished frame and the frame being presented
+#define VIDEO_FRAME_MAILBOX_SLOT_COUNT (3)
+
+typedef struct{
+    VideoFrameYUV frame;
+    //packed planes of the frame
+    uint8_t* buffer;
+    size_t bufferSize;
+} VideoFrameMailboxSlot;
+
+typedef void (*VideoFrameMailboxPixelBufferCallback)(void* pixelBuffer);
+
+/**
+ *  Hands decoded frames from the decoder to a presenter running at its own cadence. The mailbox holds only the newest
+ *  frame, a frame the presenter has not taken when the next one is published is dropped. Neither side waits for the
+ *  other: the decoder copies into a slot of its own and the presenter keeps its frame until it takes the next one.
+ */
+typedef struct{
+    VideoFrameMailboxSlot slots[VIDEO_FRAME_MAILBOX_SLOT_COUNT];
+    int writeSlot;
+    int readySlot;
+    int readSlot;
+    BOOL readyFresh;
+    pthread_mutex_t mutex;
+    
+    //a fast upload pixel buffer is kept instead of copying the planes when both are set
+    VideoFrameMailboxPixelBufferCallback retainPixelBuffer;
+    VideoFrameMailboxPixelBufferCallback releasePixelBuffer;
+    
+    VideoFrameMailboxStatistics statistics;
+} VideoFrameMailbox;
+
+/**
+ *  @param mailbox the mailbox.
+ *  @param retainPixelBuffer retains the `cv_pixelbuffer_fastupload` of a published frame, NULL to copy the planes.
+ *  @param releasePixelBuffer releases a pixel buffer retained before.
+ */
+void videoMailboxInit(VideoFrameMailbox* mailbox, VideoFrameMailboxPixelBufferCallback retainPixelBuffer,
+                      VideoFrameMailboxPixelBufferCallback releasePixelBuffer);
+void videoMailboxRelease(VideoFrameMailbox* mailbox);
+
+/**
+ *  Copy the frame into the mailbox, replacing a frame the presenter has not taken. Only one thread publishes.
+ *
+ *  @return `0` on success, `-1` when the format is not supported or the copy could not be allocated.
+ */
+int videoMailboxPublish(VideoFrameMailbox* mailbox, const VideoFrameYUV* frame);
+
+/**
+ *  Take the newest frame. Only one thread takes frames.
+ *
+ *  @return the frame, valid until the next call, or NULL when no frame was published since the last call.
+ */
+VideoFrameYUV* videoMailboxTake(VideoFrameMailbox* mailbox);
+
+/**
+ *  Drop a frame the presenter has not taken yet.
+ */
+void videoMailboxClear(VideoFrameMailbox* mailbox);
+
+VideoFrameMailboxStatistics videoMailboxStatistics(VideoFrameMailbox* mailbox);
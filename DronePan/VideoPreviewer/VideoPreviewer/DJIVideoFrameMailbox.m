@@ -0,0 +1,190 @@
+//
+//  DJIVideoFrameMailbox.m
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import "DJIVideoFrameMailbox.h"
+
+void videoMailboxInit(VideoFrameMailbox* mailbox, VideoFrameMailboxPixelBufferCallback retainPixelBuffer,
+                      VideoFrameMailboxPixelBufferCallback releasePixelBuffer){
+    memset(mailbox, 0, sizeof(VideoFrameMailbox));
+    mailbox->writeSlot = 0;
+    mailbox->readySlot = 1;
+    mailbox->readSlot = 2;
+    mailbox->retainPixelBuffer = retainPixelBuffer;
+    mailbox->releasePixelBuffer = releasePixelBuffer;
+    pthread_mutex_init(&mailbox->mutex, NULL);
+}
+
+static void releaseSlotPixelBuffer(VideoFrameMailbox* mailbox, VideoFrameMailboxSlot* slot){
+    if (slot->frame.cv_pixelbuffer_fastupload && mailbox->releasePixelBuffer) {
+        mailbox->releasePixelBuffer(slot->frame.cv_pixelbuffer_fastupload);
+    }
+    slot->frame.cv_pixelbuffer_fastupload = NULL;
+}
+
+void videoMailboxRelease(VideoFrameMailbox* mailbox){
+    for (int i = 0; i < VIDEO_FRAME_MAILBOX_SLOT_COUNT; i++) {
+        releaseSlotPixelBuffer(mailbox, mailbox->slots + i);
+        free(mailbox->slots[i].buffer);
+        mailbox->slots[i].buffer = NULL;
+        mailbox->slots[i].bufferSize = 0;
+    }
+    pthread_mutex_destroy(&mailbox->mutex);
+}
+
+static void copyPlane(uint8_t* dst, int dstStride, const uint8_t* src, int srcStride, int rowBytes, int rows){
+    for (int row = 0; row < rows; row++) {
+        memcpy(dst + (size_t)row*dstStride, src + (size_t)row*srcStride, rowBytes);
+    }
+}
+
+static int copyIntoSlot(VideoFrameMailbox* mailbox, VideoFrameMailboxSlot* slot, const VideoFrameYUV* frame){
+    int width = frame->width;
+    int height = frame->height;
+    if (width <= 0 || height <= 0 || !frame->luma) {
+        return -1;
+    }
+    
+    //bytes per row of each packed plane, 0 for a plane the format does not have
+    int lumaBytes = 0, chromaBBytes = 0, chromaRBytes = 0;
+    int chromaRows = height/2;
+    if (frame->frameType == VPFrameTypeYUV420Planer) {
+        lumaBytes = width;
+        chromaBBytes = width/2;
+        chromaRBytes = width/2;
+    }
+    else if (frame->frameType == VPFrameTypeYUV420SemiPlaner) {
+        lumaBytes = width;
+        chromaBBytes = width;
+    }
+    else if (frame->frameType == VPFrameTypeRGBA) {
+        lumaBytes = width*4;
+        chromaRows = 0;
+    }
+    else{
+        return -1;
+    }
+    
+    if ((chromaBBytes && !frame->chromaB) || (chromaRBytes && !frame->chromaR)) {
+        return -1;
+    }
+    
+    releaseSlotPixelBuffer(mailbox, slot);
+    
+    VideoFrameYUV* copy = &slot->frame;
+    *copy = *frame;
+    memset(&copy->mutex, 0, sizeof(copy->mutex));
+    copy->cv_pixelbuffer_fastupload = NULL;
+    
+    //the presenter uploads a retained pixel buffer directly, its planes are not needed
+    if (frame->cv_pixelbuffer_fastupload && mailbox->retainPixelBuffer && mailbox->releasePixelBuffer) {
+        mailbox->retainPixelBuffer(frame->cv_pixelbuffer_fastupload);
+        copy->cv_pixelbuffer_fastupload = frame->cv_pixelbuffer_fastupload;
+        copy->luma = copy->chromaB = copy->chromaR = NULL;
+        copy->lumaSlice = copy->chromaBSlice = copy->chromaRSlice = 0;
+        return 0;
+    }
+    
+    size_t lumaSize = (size_t)lumaBytes*height;
+    size_t chromaBSize = (size_t)chromaBBytes*chromaRows;
+    size_t chromaRSize = (size_t)chromaRBytes*chromaRows;
+    size_t size = lumaSize + chromaBSize + chromaRSize;
+    
+    if (slot->bufferSize < size) {
+        uint8_t* buffer = (uint8_t*)realloc(slot->buffer, size);
+        if (!buffer) {
+            return -1;
+        }
+        slot->buffer = buffer;
+        slot->bufferSize = size;
+    }
+    
+    //a slice of 0 means a packed plane
+    copy->luma = slot->buffer;
+    copyPlane(copy->luma, lumaBytes, frame->luma, frame->lumaSlice ? frame->lumaSlice : lumaBytes, lumaBytes, height);
+    copy->lumaSlice = lumaBytes;
+    
+    copy->chromaB = NULL;
+    copy->chromaBSlice = 0;
+    if (chromaBSize) {
+        copy->chromaB = slot->buffer + lumaSize;
+        copyPlane(copy->chromaB, chromaBBytes, frame->chromaB, frame->chromaBSlice ? frame->chromaBSlice : chromaBBytes, chromaBBytes, chromaRows);
+        copy->chromaBSlice = chromaBBytes;
+    }
+    
+    copy->chromaR = NULL;
+    copy->chromaRSlice = 0;
+    if (chromaRSize) {
+        copy->chromaR = slot->buffer + lumaSize + chromaBSize;
+        copyPlane(copy->chromaR, chromaRBytes, frame->chromaR, frame->chromaRSlice ? frame->chromaRSlice : chromaRBytes, chromaRBytes, chromaRows);
+        copy->chromaRSlice = chromaRBytes;
+    }
+    return 0;
+}
+
+int videoMailboxPublish(VideoFrameMailbox* mailbox, const VideoFrameYUV* frame){
+    if (!mailbox || !frame) {
+        return -1;
+    }
+    
+    //the write slot belongs to the publisher, the copy is made without the lock
+    if (0 != copyIntoSlot(mailbox, mailbox->slots + mailbox->writeSlot, frame)) {
+        return -1;
+    }
+    
+    pthread_mutex_lock(&mailbox->mutex);
+    int ready = mailbox->readySlot;
+    mailbox->readySlot = mailbox->writeSlot;
+    mailbox->writeSlot = ready;
+    if (mailbox->readyFresh) {
+        mailbox->statistics.droppedCount++;
+    }
+    mailbox->readyFresh = YES;
+    mailbox->statistics.publishedCount++;
+    pthread_mutex_unlock(&mailbox->mutex);
+    return 0;
+}
+
+VideoFrameYUV* videoMailboxTake(VideoFrameMailbox* mailbox){
+    if (!mailbox) {
+        return NULL;
+    }
+    
+    pthread_mutex_lock(&mailbox->mutex);
+    if (!mailbox->readyFresh) {
+        mailbox->statistics.idleTickCount++;
+        pthread_mutex_unlock(&mailbox->mutex);
+        return NULL;
+    }
+    
+    int read = mailbox->readSlot;
+    mailbox->readSlot = mailbox->readySlot;
+    mailbox->readySlot = read;
+    mailbox->readyFresh = NO;
+    mailbox->statistics.presentedCount++;
+    VideoFrameYUV* frame = &mailbox->slots[mailbox->readSlot].frame;
+    pthread_mutex_unlock(&mailbox->mutex);
+    return frame;
+}
+
+void videoMailboxClear(VideoFrameMailbox* mailbox){
+    if (!mailbox) {
+        return;
+    }
+    
+    pthread_mutex_lock(&mailbox->mutex);
+    if (mailbox->readyFresh) {
+        mailbox->readyFresh = NO;
+        mailbox->statistics.droppedCount++;
+    }
+    pthread_mutex_unlock(&mailbox->mutex);
+}
+
+VideoFrameMailboxStatistics videoMailboxStatistics(VideoFrameMailbox* mailbox){
+    pthread_mutex_lock(&mailbox->mutex);
+    VideoFrameMailboxStatistics statistics = mailbox->statistics;
+    pthread_mutex_unlock(&mailbox->mutex);
+    return statistics;
+}
@@ -0,0 +1,48 @@
+//
+//  DJIVideoFrameRaw.h
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#ifndef DJI_VIDEO_FRAME_RAW_H
+#define DJI_VIDEO_FRAME_RAW_H
+
+#include <stdint.h>
+
+//raw frame layout shared with the plain C modules, it is also the record format of DJIVideoStreamRecorder
+
+typedef struct{
+    uint16_t width;
+    uint16_t height;
+    
+    uint16_t fps;
+    uint16_t reserved;
+    
+    uint16_t frame_index;
+    uint16_t max_frame_index_plus_one;
+    
+    union{
+        struct{
+            int has_sps :1;
+            int has_pps :1;
+            int has_idr :1;
+        } frame_flag;
+        uint32_t value;
+    };
+    
+} VideoFrameH264BasicInfo;
+
+#pragma pack (1)
+typedef struct{
+    uint32_t type_tag:8;//TYPE_TAG_VideoFrameH264Raw
+    uint32_t frame_size:24;
+    uint32_t frame_uuid;
+    uint64_t time_tag; //videoClockTimeTag when the frame was parsed
+    uint64_t pts; //reconstructed presentation time on the same clock, 0 when unknown
+    VideoFrameH264BasicInfo frame_info;
+    
+    uint8_t frame_data[0]; //followd by frame data;
+}VideoFrameH264Raw;
+#pragma pack()
+
+#endif
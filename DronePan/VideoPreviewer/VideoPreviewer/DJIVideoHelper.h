@@ -13,6 +13,7 @@ typedef struct _DummyIframeInfo{
     int frame_height;
     int fps;
     int encoder_type; //H264EncoderType
+    uint32_t param_set_hash; //parameterSetsHash of the decoder's SPS/PPS, 0 when unknown
 }PrebuildIframeInfo;
 
 typedef char* (*loadPrebuildIframePathPtr)(uint8_t* buffer, int in_buffer_size, PrebuildIframeInfo info);
@@ -150,6 +151,26 @@ int findNextNALStartCodeEndPos(uint8_t* buffer, int size);
  */
 int findNextNALStartCodePos(uint8_t* buffer, int size);
 
+/**
+ *  Hash the SPS and PPS carried in a frame.
+ *
+ *  @param buffer Frame data.
+ *  @param size Frame size.
+ *
+ *  @return `0` if the frame has no parameter set, otherwise the hash of all SPS and PPS nal units.
+ */
+uint32_t parameterSetsHash(uint8_t* buffer, int size);
+
+/**
+ *  Type of the first slice nal unit in a frame. Only the nal units in front of the slice are walked.
+ *
+ *  @param buffer Frame data.
+ *  @param size Frame size.
+ *
+ *  @return `IDR_TAG` for an IDR frame, `0` if the frame has no slice.
+ */
+int firstSliceNALType(uint8_t* buffer, int size);
+
 /**
  *  Attempts to load pre-constructed i frame from disk
  *  
@@ -159,4 +180,12 @@ int findNextNALStartCodePos(uint8_t* buffer, int size);
  *
  *  @return If less than `0` mean the buffer have no enough size, '0' No correspond i frame, more than `0` the size of get.
  */
-int loadPrebuildIframe(uint8_t* buffer, int in_buffer_size, PrebuildIframeInfo info);
\ No newline at end of file
+int loadPrebuildIframe(uint8_t* buffer, int in_buffer_size, PrebuildIframeInfo info);
+
+/**
+ *  Register a loader tried by `loadPrebuildIframe` before `g_loadPrebuildIframeOverrideFunc`. The loader registered
+ *  last is tried first, a loader returning `0` passes on to the next one.
+ *
+ *  @param loader the loader, same return value as `loadPrebuildIframe`.
+ */
+void registerPrebuildIframeLoader(loadPrebuildIframeOverridePtr loader);
\ No newline at end of file
@@ -12,6 +12,10 @@
 loadPrebuildIframeOverridePtr g_loadPrebuildIframeOverrideFunc = nil;
 loadPrebuildIframePathPtr g_loadPrebuildIframePathFunc = nil;
 
+#define PREBUILD_IFRAME_LOADER_MAX (4)
+static loadPrebuildIframeOverridePtr g_prebuildIframeLoaders[PREBUILD_IFRAME_LOADER_MAX] = {0};
+static int g_prebuildIframeLoaderCount = 0;
+
 BOOL g_is_smooth = NO;
 
 //retern the pos after 00 00 01 or 00 00 00 01
@@ -70,6 +74,64 @@ int findNextNALStartCodePos(uint8_t* buffer, int size){
     return -1;
 }
 
+uint32_t parameterSetsHash(uint8_t* buffer, int size){
+    uint32_t hash = 2166136261u; //FNV-1a
+    BOOL found = NO;
+    
+    int remain_size = size;
+    uint8_t* iter = buffer;
+    while (remain_size > 0) {
+        int start_code_offset = findNextNALStartCodeEndPos(iter, remain_size);
+        if (start_code_offset <= 0) {
+            break;
+        }
+        
+        int nal_size = findNextNALStartCodePos(iter + start_code_offset, remain_size - start_code_offset);
+        if (nal_size < 0) {
+            nal_size = remain_size - start_code_offset;
+        }
+        
+        uint8_t nal_unit_type = iter[start_code_offset]&0x1f;
+        if (nal_unit_type == SPS_TAG || nal_unit_type == PPS_TAG) {
+            for (int i=0; i<nal_size; i++) {
+                hash ^= iter[start_code_offset + i];
+                hash *= 16777619u;
+            }
+            found = YES;
+        }
+        
+        remain_size -= start_code_offset + nal_size;
+        iter += start_code_offset + nal_size;
+    }
+    
+    return found?hash:0;
+}
+
+int firstSliceNALType(uint8_t* buffer, int size){
+    int remain_size = size;
+    uint8_t* iter = buffer;
+    while (remain_size > 0) {
+        int start_code_offset = findNextNALStartCodeEndPos(iter, remain_size);
+        if (start_code_offset <= 0 || start_code_offset >= remain_size) {
+            break;
+        }
+        
+        uint8_t nal_unit_type = iter[start_code_offset]&0x1f;
+        if (nal_unit_type >= 1 && nal_unit_type <= IDR_TAG) {
+            return nal_unit_type;
+        }
+        
+        int nal_size = findNextNALStartCodePos(iter + start_code_offset, remain_size - start_code_offset);
+        if (nal_size < 0) {
+            break;
+        }
+        
+        remain_size -= start_code_offset + nal_size;
+        iter += start_code_offset + nal_size;
+    }
+    
+    return 0;
+}
 
 int32_t convertOSD(uint8_t* osdBuf, int osdLen, uint8_t* convBuf, int* convLen) {
 	if (osdLen > 250)
@@ -695,7 +757,22 @@ int getVideFrameRate(uint8_t* buffer, int bufferSize, bool* hasSpsPps)
     return getVideFrameRateWH(buffer, bufferSize, hasSpsPps, &w, &h);
 }
 
+//loaders are registered once at start up, before any decoder runs
+void registerPrebuildIframeLoader(loadPrebuildIframeOverridePtr loader){
+    if (loader == NULL || g_prebuildIframeLoaderCount >= PREBUILD_IFRAME_LOADER_MAX) {
+        return;
+    }
+    g_prebuildIframeLoaders[g_prebuildIframeLoaderCount++] = loader;
+}
+
 int loadPrebuildIframe(uint8_t* buffer, int in_buffer_size, PrebuildIframeInfo info){
+    for (int i=g_prebuildIframeLoaderCount-1; i>=0; i--) {
+        int ret = g_prebuildIframeLoaders[i](buffer, in_buffer_size, info);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+    
     if(g_loadPrebuildIframeOverrideFunc){
         return g_loadPrebuildIframeOverrideFunc(buffer, in_buffer_size, info);
     }
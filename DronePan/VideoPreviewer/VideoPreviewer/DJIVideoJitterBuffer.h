@@ -0,0 +1,79 @@
+//
+//  DJIVideoJitterBuffer.h
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "DJIVideoStatistics.h"
+
+//arrival delays the playout delay is chosen from
+#define VIDEO_PLAYOUT_WINDOW (64)
+//a frame this late on its reconstructed time restarts the timeline, the link stalled or the encoder restarted
+#define VIDEO_TIMESTAMP_RESYNC_DELAY (500*1000)
+
+/**
+ *  Rebuilds presentation times of the frames of a live stream, which carries none, from their arrival times, the
+ *  frame rate and frame_num. The timeline follows the frame cadence, the earliest arrival relative to it marks the
+ *  frame that was not delayed by the link.
+ */
+typedef struct{
+    BOOL started;
+    double lastPts;
+    int lastFrameIndex;
+
+    //smallest arrival delay in the current window, a positive minimum means the cadence runs slow
+    int64_t windowMinDelay;
+    int windowCount;
+
+    uint64_t resyncCount;
+} VideoTimestampReconstructor;
+
+/**
+ *  Holds each frame until its presentation time plus a playout delay, so frames leave at the cadence they were
+ *  encoded at instead of the cadence the link delivered them at. The delay follows the recent arrival delays: up at
+ *  once when the link gets worse, down slowly when it gets better.
+ */
+typedef struct{
+    //no delay, frames leave as soon as they arrive
+    BOOL lowestLatency;
+    //microseconds
+    uint32_t maxDelay;
+
+    uint32_t delays[VIDEO_PLAYOUT_WINDOW];
+    int delayCount;
+    int delayHead;
+
+    double playoutDelay;
+    VideoPlayoutStatistics statistics;
+} VideoPlayoutBuffer;
+
+void videoTimestampReset(VideoTimestampReconstructor* reconstructor);
+
+/**
+ *  @param reconstructor the reconstructor, zero it or reset it before the first frame.
+ *  @param arrival videoClockTimeTag when the frame arrived.
+ *  @param frameIndex frame_num of the frame, -1 when unknown.
+ *  @param maxFrameIndexPlusOne range of frame_num, 0 when unknown.
+ *  @param fps frames per second, 0 when unknown.
+ *
+ *  @return presentation time on the videoClockTimeTag clock, never after the arrival.
+ */
+uint64_t videoTimestampReconstruct(VideoTimestampReconstructor* reconstructor, uint64_t arrival, int frameIndex, int maxFrameIndexPlusOne, int fps);
+
+/**
+ *  @param buffer the buffer.
+ *  @param maxDelay largest playout delay in microseconds.
+ */
+void videoPlayoutInit(VideoPlayoutBuffer* buffer, uint32_t maxDelay);
+void videoPlayoutReset(VideoPlayoutBuffer* buffer);
+
+/**
+ *  @param buffer the buffer.
+ *  @param pts presentation time of the frame.
+ *  @param arrival arrival time of the frame.
+ *  @param now current videoClockTimeTag.
+ *
+ *  @return when the frame should be decoded, `now` or later.
+ */
+uint64_t videoPlayoutTime(VideoPlayoutBuffer* buffer, uint64_t pts, uint64_t arrival, uint64_t now);
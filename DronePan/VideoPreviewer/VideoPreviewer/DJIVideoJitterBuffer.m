@@ -0,0 +1,131 @@
+//
+//  DJIVideoJitterBuffer.m
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import "DJIVideoJitterBuffer.h"
+
+//share of the distance to the target the playout delay moves down per frame
+#define PLAYOUT_DELAY_DECAY (1.0/32)
+//head room over the recent delays
+#define PLAYOUT_DELAY_MARGIN (1000)
+//weight of the newest frame in the jitter
+#define PLAYOUT_JITTER_WEIGHT (1.0/16)
+
+void videoTimestampReset(VideoTimestampReconstructor* reconstructor){
+    uint64_t resyncCount = reconstructor->resyncCount;
+    memset(reconstructor, 0, sizeof(VideoTimestampReconstructor));
+    reconstructor->resyncCount = resyncCount;
+}
+
+uint64_t videoTimestampReconstruct(VideoTimestampReconstructor* reconstructor, uint64_t arrival, int frameIndex, int maxFrameIndexPlusOne, int fps){
+    if (fps <= 0) {
+        fps = 30;
+    }
+
+    if (!reconstructor->started) {
+        reconstructor->started = YES;
+        reconstructor->lastPts = arrival;
+        reconstructor->lastFrameIndex = frameIndex;
+        reconstructor->windowMinDelay = INT64_MAX;
+        reconstructor->windowCount = 0;
+        return arrival;
+    }
+
+    //frames skipped by the encoder or lost on the link still take their place in the cadence
+    int step = 1;
+    if (maxFrameIndexPlusOne > 0 && frameIndex >= 0 && reconstructor->lastFrameIndex >= 0) {
+        int distance = (frameIndex - reconstructor->lastFrameIndex + maxFrameIndexPlusOne)%maxFrameIndexPlusOne;
+        if (distance >= 1 && distance <= maxFrameIndexPlusOne/2) {
+            step = distance;
+        }
+    }
+
+    double pts = reconstructor->lastPts + step*1000000.0/fps;
+    double delay = (double)arrival - pts;
+
+    if (delay < 0) {
+        //earlier than the timeline allows, the frames before were all delayed
+        pts = arrival;
+        delay = 0;
+    }
+    else if (delay > VIDEO_TIMESTAMP_RESYNC_DELAY) {
+        pts = arrival;
+        delay = 0;
+        reconstructor->resyncCount++;
+        reconstructor->windowMinDelay = INT64_MAX;
+        reconstructor->windowCount = 0;
+    }
+
+    //every frame of two seconds late means the encoder runs a little faster than its frame rate
+    reconstructor->windowMinDelay = MIN(reconstructor->windowMinDelay, (int64_t)delay);
+    if (++reconstructor->windowCount >= fps*2) {
+        if (reconstructor->windowMinDelay > 0) {
+            pts += reconstructor->windowMinDelay;
+        }
+        reconstructor->windowMinDelay = INT64_MAX;
+        reconstructor->windowCount = 0;
+    }
+
+    reconstructor->lastPts = pts;
+    reconstructor->lastFrameIndex = frameIndex;
+    return (uint64_t)pts;
+}
+
+void videoPlayoutInit(VideoPlayoutBuffer* buffer, uint32_t maxDelay){
+    memset(buffer, 0, sizeof(VideoPlayoutBuffer));
+    buffer->maxDelay = maxDelay;
+}
+
+void videoPlayoutReset(VideoPlayoutBuffer* buffer){
+    buffer->delayCount = 0;
+    buffer->delayHead = 0;
+    buffer->playoutDelay = 0;
+}
+
+static int compareDelays(const void* a, const void* b){
+    uint32_t left = *(const uint32_t*)a;
+    uint32_t right = *(const uint32_t*)b;
+    return left < right ? -1 : (left > right ? 1 : 0);
+}
+
+uint64_t videoPlayoutTime(VideoPlayoutBuffer* buffer, uint64_t pts, uint64_t arrival, uint64_t now){
+    uint32_t delay = arrival > pts ? (uint32_t)MIN(arrival - pts, UINT32_MAX) : 0;
+
+    buffer->delays[buffer->delayHead] = delay;
+    buffer->delayHead = (buffer->delayHead + 1)%VIDEO_PLAYOUT_WINDOW;
+    buffer->delayCount = MIN(buffer->delayCount + 1, VIDEO_PLAYOUT_WINDOW);
+
+    VideoPlayoutStatistics* statistics = &buffer->statistics;
+    statistics->frameCount++;
+    statistics->jitter += (delay/1000.0 - statistics->jitter)*PLAYOUT_JITTER_WEIGHT;
+
+    double target = 0;
+    if (!buffer->lowestLatency) {
+        //the 95th percentile, a single stall should not hold every frame after it
+        uint32_t sorted[VIDEO_PLAYOUT_WINDOW];
+        memcpy(sorted, buffer->delays, sizeof(uint32_t)*buffer->delayCount);
+        qsort(sorted, buffer->delayCount, sizeof(uint32_t), compareDelays);
+
+        int index = MIN(buffer->delayCount - 1, (buffer->delayCount*95)/100);
+        target = MIN((double)sorted[index] + PLAYOUT_DELAY_MARGIN, (double)buffer->maxDelay);
+    }
+
+    if (target >= buffer->playoutDelay) {
+        buffer->playoutDelay = target;
+    }else{
+        buffer->playoutDelay += (target - buffer->playoutDelay)*PLAYOUT_DELAY_DECAY;
+    }
+    statistics->targetDelay = target/1000.0;
+    statistics->playoutDelay = buffer->playoutDelay/1000.0;
+
+    uint64_t due = pts + (uint64_t)buffer->playoutDelay;
+    if (due < now) {
+        if (!buffer->lowestLatency) {
+            statistics->lateFrameCount++;
+        }
+        return now;
+    }
+    return MIN(due, now + buffer->maxDelay);
+}
@@ -0,0 +1,67 @@
+//
+//  DJIVideoKeyframeStore.h
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "DJIStreamCommon.h"
+#import "DJIVideoHelper.h"
+
+/**
+ *  Small on-disk cache of the last valid SPS/PPS and IDR seen for a product, encoder type, resolution, frame rate
+ *  and parameter sets.
+ *  Frames are written asynchronously during the flight and pre-loaded when the product is known, so the decoders
+ *  can start with the first P frame after a reconnect. Thread safe.
+ */
+@interface DJIVideoKeyframeStore : NSObject
+
++(DJIVideoKeyframeStore*) instance;
+
+/**
+ *  Select the product and encoder type and load their keyframes from disk in the background. Only the
+ *  most recently written files are kept, the older ones are deleted.
+ *
+ *  @param model model name of the product
+ *  @param encoderType H264EncoderType of the stream
+ */
+-(void) preloadForProductModel:(NSString*)model encoderType:(H264EncoderType)encoderType;
+
+/**
+ *  Persist a parsed frame if it carries parameter sets and an IDR. Each parameter sets of a resolution and frame
+ *  rate are written once per session.
+ *
+ *  @param frame the parsed frame
+ */
+-(void) storeFrame:(VideoFrameH264Raw*)frame;
+
+/**
+ *  The most recently stored keyframe of the selected product and encoder type in Annex B format, whatever parameter
+ *  sets it was encoded with.
+ *
+ *  @return nil when nothing is stored.
+ */
+-(NSData*) latestKeyframe;
+
+/**
+ *  The stored keyframe encoded with the given parameter sets, the most recent one first.
+ *
+ *  @param hash `parameterSetsHash` of the live parameter sets.
+ *
+ *  @return nil when no keyframe was stored with them.
+ */
+-(NSData*) keyframeForParamSetHash:(uint32_t)hash;
+
+/**
+ *  Copy the stored IDR for `info` as length prefixed nal units, used by the hardware decoder. Nothing is copied
+ *  when `info` has no parameter sets hash.
+ *
+ *  @param buffer Out the i frame data.
+ *  @param in_buffer_size In buffer size.
+ *  @param info In the i frame info.
+ *
+ *  @return same as `loadPrebuildIframe`.
+ */
+-(int) loadIframe:(uint8_t*)buffer size:(int)in_buffer_size info:(PrebuildIframeInfo)info;
+
+@end
@@ -0,0 +1,274 @@
+//
+//  DJIVideoKeyframeStore.m
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import "DJIVideoKeyframeStore.h"
+
+#define KEYFRAME_STORE_DIRECTORY @"VideoPreviewerKeyframes"
+#define KEYFRAME_STORE_EXTENSION @"h264"
+//keyframes kept on disk for one product and encoder type
+#define KEYFRAME_STORE_MAX_FILE_COUNT (8)
+
+static int loadStoredIframe(uint8_t* buffer, int in_buffer_size, PrebuildIframeInfo info){
+    return [[DJIVideoKeyframeStore instance] loadIframe:buffer size:in_buffer_size info:info];
+}
+
+@interface DJIVideoKeyframeStore (){
+    dispatch_queue_t _ioQueue;
+}
+@property (copy, nonatomic) NSString* productModel;
+@property (assign, nonatomic) H264EncoderType encoderType;
+//file name -> annex b keyframe, for the selected product and encoder
+@property (strong, nonatomic) NSMutableDictionary* keyframes;
+//file names written in this session
+@property (strong, nonatomic) NSMutableSet* writtenNames;
+@property (copy, nonatomic) NSString* latestName;
+@end
+
+@implementation DJIVideoKeyframeStore
+
++(DJIVideoKeyframeStore*) instance
+{
+    static DJIVideoKeyframeStore* store = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        store = [[DJIVideoKeyframeStore alloc] init];
+        registerPrebuildIframeLoader(loadStoredIframe);
+    });
+    return store;
+}
+
+-(id) init{
+    self = [super init];
+    _ioQueue = dispatch_queue_create("video_keyframe_store_queue", DISPATCH_QUEUE_SERIAL);
+    _keyframes = [[NSMutableDictionary alloc] init];
+    _writtenNames = [[NSMutableSet alloc] init];
+    _encoderType = H264EncoderType_unknown;
+    return self;
+}
+
+-(NSString*) directory{
+    NSArray *paths = NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES);
+    return [(NSString*)[paths objectAtIndex:0] stringByAppendingPathComponent:KEYFRAME_STORE_DIRECTORY];
+}
+
+-(NSString*) prefixForModel:(NSString*)model encoderType:(H264EncoderType)encoderType{
+    NSCharacterSet* invalid = [[NSCharacterSet alphanumericCharacterSet] invertedSet];
+    NSString* safeModel = [[model componentsSeparatedByCharactersInSet:invalid] componentsJoinedByString:@""];
+    return [NSString stringWithFormat:@"%@_%d_", safeModel, (int)encoderType];
+}
+
+//an idr only decodes with the parameter sets it was encoded with, so they are part of the name
+-(NSString*) nameForWidth:(int)width height:(int)height fps:(int)fps paramSetHash:(uint32_t)hash{
+    return [NSString stringWithFormat:@"%@%dx%d_p%d_%08x.%@", [self prefixForModel:_productModel encoderType:_encoderType],
+            width, height, fps, hash, KEYFRAME_STORE_EXTENSION];
+}
+
+//0 for a name without a parameter sets hash
+-(uint32_t) paramSetHashOfName:(NSString*)name{
+    NSString* field = [[[name stringByDeletingPathExtension] componentsSeparatedByString:@"_"] lastObject];
+    if (field.length != 8) {
+        return 0;
+    }
+    
+    unsigned int hash = 0;
+    if (![[NSScanner scannerWithString:field] scanHexInt:&hash]) {
+        return 0;
+    }
+    return hash;
+}
+
+-(void) preloadForProductModel:(NSString*)model encoderType:(H264EncoderType)encoderType{
+    if (model == nil) {
+        return;
+    }
+    
+    @synchronized (self) {
+        if ([_productModel isEqualToString:model] && _encoderType == encoderType) {
+            return;
+        }
+        self.productModel = model;
+        self.encoderType = encoderType;
+        [_keyframes removeAllObjects];
+        [_writtenNames removeAllObjects];
+        self.latestName = nil;
+    }
+    
+    NSString* prefix = [self prefixForModel:model encoderType:encoderType];
+    dispatch_async(_ioQueue, ^{
+        NSString* directory = [self directory];
+        NSFileManager* fileManager = [NSFileManager defaultManager];
+        NSMutableDictionary* loaded = [[NSMutableDictionary alloc] init];
+        NSMutableArray* names = [[NSMutableArray alloc] init];
+        NSMutableDictionary* dates = [[NSMutableDictionary alloc] init];
+        
+        for (NSString* name in [fileManager contentsOfDirectoryAtPath:directory error:nil]) {
+            if (![name hasPrefix:prefix]) {
+                continue;
+            }
+            
+            NSString* path = [directory stringByAppendingPathComponent:name];
+            //a name without a parameter sets hash is never loaded
+            if ([self paramSetHashOfName:name] == 0) {
+                [fileManager removeItemAtPath:path error:nil];
+                continue;
+            }
+            
+            [names addObject:name];
+            dates[name] = [[fileManager attributesOfItemAtPath:path error:nil] fileModificationDate] ?: [NSDate distantPast];
+        }
+        
+        //most recent first, the others are deleted
+        [names sortUsingComparator:^NSComparisonResult(NSString* a, NSString* b) {
+            return [dates[b] compare:dates[a]];
+        }];
+        
+        for (NSUInteger i = 0; i < names.count; i++) {
+            NSString* path = [directory stringByAppendingPathComponent:names[i]];
+            if (i >= KEYFRAME_STORE_MAX_FILE_COUNT) {
+                [fileManager removeItemAtPath:path error:nil];
+                continue;
+            }
+            
+            NSData* data = [NSData dataWithContentsOfFile:path];
+            if (data.length) {
+                loaded[names[i]] = data;
+            }
+        }
+        NSString* latestName = names.count && loaded[names[0]] ? names[0] : nil;
+        
+        @synchronized (self) {
+            if (![_productModel isEqualToString:model] || _encoderType != encoderType) {
+                return; // selection changed while loading
+            }
+            
+            for (NSString* name in loaded) {
+                if (_keyframes[name] == nil) {
+                    _keyframes[name] = loaded[name];
+                }
+            }
+            if (_latestName == nil) {
+                self.latestName = latestName;
+            }
+        }
+        NSLog(@"keyframe store loaded %d keyframes for %@", (int)loaded.count, model);
+    });
+}
+
+-(void) storeFrame:(VideoFrameH264Raw*)frame{
+    if (frame == NULL
+        || !frame->frame_info.frame_flag.has_sps
+        || !frame->frame_info.frame_flag.has_idr
+        || frame->frame_info.width == 0
+        || frame->frame_info.height == 0) {
+        return;
+    }
+    
+    uint32_t hash = parameterSetsHash(frame->frame_data, frame->frame_size);
+    if (hash == 0) {
+        return;
+    }
+    NSString* name = nil;
+    NSData* data = nil;
+    
+    @synchronized (self) {
+        if (_productModel == nil || _encoderType == H264EncoderType_unknown) {
+            return;
+        }
+        
+        name = [self nameForWidth:frame->frame_info.width height:frame->frame_info.height
+                              fps:frame->frame_info.fps paramSetHash:hash];
+        if ([_writtenNames containsObject:name]) {
+            return;
+        }
+        [_writtenNames addObject:name];
+        
+        data = [NSData dataWithBytes:frame->frame_data length:frame->frame_size];
+        _keyframes[name] = data;
+        self.latestName = name;
+    }
+    
+    dispatch_async(_ioQueue, ^{
+        NSString* directory = [self directory];
+        [[NSFileManager defaultManager] createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:nil error:nil];
+        if (![data writeToFile:[directory stringByAppendingPathComponent:name] atomically:YES]) {
+            NSLog(@"keyframe store write failed: %@", name);
+        }
+    });
+}
+
+-(NSData*) latestKeyframe{
+    @synchronized (self) {
+        if (_latestName == nil) {
+            return nil;
+        }
+        return _keyframes[_latestName];
+    }
+}
+
+-(NSData*) keyframeForParamSetHash:(uint32_t)hash{
+    @synchronized (self) {
+        if (_latestName && [self paramSetHashOfName:_latestName] == hash) {
+            return _keyframes[_latestName];
+        }
+        
+        for (NSString* name in _keyframes) {
+            if ([self paramSetHashOfName:name] == hash) {
+                return _keyframes[name];
+            }
+        }
+        return nil;
+    }
+}
+
+-(int) loadIframe:(uint8_t*)buffer size:(int)in_buffer_size info:(PrebuildIframeInfo)info{
+    NSData* keyframe = nil;
+    @synchronized (self) {
+        if (_productModel == nil || info.encoder_type != (int)_encoderType || info.param_set_hash == 0) {
+            return 0;
+        }
+        keyframe = _keyframes[[self nameForWidth:info.frame_width height:info.frame_height
+                                             fps:info.fps paramSetHash:info.param_set_hash]];
+    }
+    
+    if (keyframe == nil) {
+        return 0;
+    }
+    
+    //the session already has the parameter sets, only the idr slices are pushed with a 4 bytes length
+    int out_size = 0;
+    int remain_size = (int)keyframe.length;
+    uint8_t* iter = (uint8_t*)keyframe.bytes;
+    while (remain_size > 0) {
+        int start_code_offset = findNextNALStartCodeEndPos(iter, remain_size);
+        if (start_code_offset <= 0) {
+            break;
+        }
+        
+        int nal_size = findNextNALStartCodePos(iter + start_code_offset, remain_size - start_code_offset);
+        if (nal_size < 0) {
+            nal_size = remain_size - start_code_offset;
+        }
+        
+        if ((iter[start_code_offset]&0x1f) == IDR_TAG) {
+            if (out_size + 4 + nal_size > in_buffer_size) {
+                return -(out_size + 4 + nal_size);
+            }
+            buffer[out_size] = (uint8_t)(nal_size >> 24);
+            buffer[out_size+1] = (uint8_t)(nal_size >> 16);
+            buffer[out_size+2] = (uint8_t)(nal_size >> 8);
+            buffer[out_size+3] = (uint8_t)(nal_size);
+            memcpy(buffer + out_size + 4, iter + start_code_offset, nal_size);
+            out_size += 4 + nal_size;
+        }
+        
+        remain_size -= start_code_offset + nal_size;
+        iter += start_code_offset + nal_size;
+    }
+    
+    return out_size;
+}
+
+@end
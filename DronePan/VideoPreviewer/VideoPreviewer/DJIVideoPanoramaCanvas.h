@@ -0,0 +1,87 @@
+//
+//  DJIVideoPanoramaCanvas.h
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "DJIStreamCommon.h"
+
+//fractional bits of the source position in a remap entry
+#define VIDEO_PANORAMA_REMAP_FRACTION_BITS (5)
+
+typedef struct{
+    int16_t column; //canvas column relative to the column of the shot yaw
+    uint16_t row; //canvas row
+    uint16_t sourceX; //source position in 1/32 pixels
+    uint16_t sourceY;
+    uint8_t weight; //feathering weight, low near the border of the source
+} VideoPanoramaRemapEntry;
+
+/**
+ *  Lookup table from the canvas pixels a shot covers to the source pixels, for one gimbal pitch. The yaw of a shot
+ *  only moves its footprint along the canvas, so one table serves every shot of a row.
+ */
+typedef struct{
+    int canvasWidth, canvasHeight;
+    int sourceWidth, sourceHeight;
+    int count;
+    VideoPanoramaRemapEntry* entries;
+} VideoPanoramaRemap;
+
+/**
+ *  Equirectangular YUV420 canvas, yaw 0 is the center column and the horizon the middle row.
+ */
+typedef struct{
+    int width, height;
+    uint8_t* luma; //width x height
+    uint8_t* chromaB; //width/2 x height/2
+    uint8_t* chromaR;
+    uint16_t* lumaWeight; //weight blended into each pixel so far
+    uint16_t* chromaWeight;
+} VideoPanoramaCanvas;
+
+/**
+ *  Build the remap table of a pinhole camera at a pitch.
+ *
+ *  @param canvasWidth width of the canvas, twice its height for the full sphere.
+ *  @param canvasHeight height of the canvas.
+ *  @param sourceWidth width of the frames that will be blended, usually a pyramid level.
+ *  @param sourceHeight height of the frames.
+ *  @param horizontalFov horizontal field of view of the frames in degrees.
+ *  @param pitch gimbal pitch in degrees, -90 looks straight down.
+ *  @param remap output, release it with `freePanoramaRemap`.
+ *
+ *  @return `0` on success, `-1` for invalid arguments or when out of memory.
+ */
+int buildPanoramaRemap(int canvasWidth, int canvasHeight, int sourceWidth, int sourceHeight, float horizontalFov, float pitch, VideoPanoramaRemap* remap);
+
+void freePanoramaRemap(VideoPanoramaRemap* remap);
+
+/**
+ *  Allocate a black canvas.
+ *
+ *  @param width canvas width, even.
+ *  @param height canvas height, even.
+ *  @param canvas output, release it with `freePanoramaCanvas`.
+ *
+ *  @return `0` on success, `-1` for invalid arguments or when out of memory.
+ */
+int createPanoramaCanvas(int width, int height, VideoPanoramaCanvas* canvas);
+
+void clearPanoramaCanvas(VideoPanoramaCanvas* canvas);
+
+void freePanoramaCanvas(VideoPanoramaCanvas* canvas);
+
+/**
+ *  Blend a frame into the canvas through a remap table with bilinear sampling. Each pixel becomes the weighted
+ *  average of all the shots covering it, so seams are feathered and a shot taken again refines the picture.
+ *
+ *  @param canvas the canvas.
+ *  @param remap table for the pitch of the shot, built for the canvas and frame size.
+ *  @param frame YUV420 planar frame of the remap source size, usually a pyramid level.
+ *  @param yaw yaw of the shot in degrees relative to the canvas center.
+ *
+ *  @return `0` on success, `-1` when the sizes do not match.
+ */
+int blendPanoramaShot(VideoPanoramaCanvas* canvas, const VideoPanoramaRemap* remap, const VideoFramePyramidLevel* frame, float yaw);
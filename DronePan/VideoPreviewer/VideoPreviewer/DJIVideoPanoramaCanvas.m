@@ -0,0 +1,243 @@
+//
+//  DJIVideoPanoramaCanvas.m
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import "DJIVideoPanoramaCanvas.h"
+#include <math.h>
+
+#define REMAP_ONE (1 << VIDEO_PANORAMA_REMAP_FRACTION_BITS)
+
+//share of the shorter source side over which the feathering weight rises to full
+#define REMAP_FEATHER (0.2f)
+
+//canvas pixels covered by a pitch, the first pass counts them and the second fills the entries
+static int remapPass(int canvasWidth, int canvasHeight, int sourceWidth, int sourceHeight, float horizontalFov, float pitch,
+                     const float* lonSin, const float* lonCos, VideoPanoramaRemapEntry* entries){
+    float pitchRad = pitch*(float)M_PI/180.0f;
+    float pitchSin = sinf(pitchRad);
+    float pitchCos = cosf(pitchRad);
+    float focal = (sourceWidth*0.5f)/tanf(horizontalFov*(float)M_PI/360.0f);
+    float feather = REMAP_FEATHER*MIN(sourceWidth, sourceHeight);
+    float maxX = (float)(sourceWidth - 1) - 1.0f/REMAP_ONE;
+    float maxY = (float)(sourceHeight - 1) - 1.0f/REMAP_ONE;
+    int count = 0;
+
+    for (int row = 0; row < canvasHeight; row++) {
+        float lat = (90.0f - (row + 0.5f)*180.0f/canvasHeight)*(float)M_PI/180.0f;
+        float latSin = sinf(lat);
+        float latCos = cosf(lat);
+
+        for (int column = 0; column < canvasWidth; column++) {
+            //direction with x right, y up and z at yaw 0, then into the pitched camera
+            float x = latCos*lonSin[column];
+            float y = latSin;
+            float z = latCos*lonCos[column];
+
+            float cameraY = y*pitchCos - z*pitchSin;
+            float cameraZ = y*pitchSin + z*pitchCos;
+            if (cameraZ <= 1e-3f) {
+                continue;
+            }
+
+            float sourceX = sourceWidth*0.5f + focal*x/cameraZ - 0.5f;
+            float sourceY = sourceHeight*0.5f - focal*cameraY/cameraZ - 0.5f;
+            if (sourceX < 0 || sourceY < 0 || sourceX > maxX || sourceY > maxY) {
+                continue;
+            }
+
+            if (entries) {
+                float edge = MIN(MIN(sourceX, maxX - sourceX), MIN(sourceY, maxY - sourceY));
+                float weight = 1.0f + 254.0f*MIN(1.0f, edge/feather);
+
+                VideoPanoramaRemapEntry* entry = entries + count;
+                entry->column = (int16_t)(column - canvasWidth/2);
+                entry->row = (uint16_t)row;
+                entry->sourceX = (uint16_t)(sourceX*REMAP_ONE + 0.5f);
+                entry->sourceY = (uint16_t)(sourceY*REMAP_ONE + 0.5f);
+                entry->weight = (uint8_t)weight;
+            }
+            count++;
+        }
+    }
+
+    return count;
+}
+
+int buildPanoramaRemap(int canvasWidth, int canvasHeight, int sourceWidth, int sourceHeight, float horizontalFov, float pitch, VideoPanoramaRemap* remap){
+    if (!remap || canvasWidth < 2 || canvasHeight < 2 || canvasWidth > INT16_MAX || canvasHeight > UINT16_MAX
+        || sourceWidth < 4 || sourceHeight < 4 || sourceWidth*REMAP_ONE > UINT16_MAX || sourceHeight*REMAP_ONE > UINT16_MAX
+        || horizontalFov <= 0 || horizontalFov >= 180) {
+        return -1;
+    }
+
+    memset(remap, 0, sizeof(VideoPanoramaRemap));
+
+    float* lonSin = (float*)malloc(sizeof(float)*canvasWidth*2);
+    if (!lonSin) {
+        return -1;
+    }
+    float* lonCos = lonSin + canvasWidth;
+
+    //the longitude is relative to the shot, the center column looks along its yaw
+    for (int column = 0; column < canvasWidth; column++) {
+        float lon = ((column + 0.5f)*360.0f/canvasWidth - 180.0f)*(float)M_PI/180.0f;
+        lonSin[column] = sinf(lon);
+        lonCos[column] = cosf(lon);
+    }
+
+    int count = remapPass(canvasWidth, canvasHeight, sourceWidth, sourceHeight, horizontalFov, pitch, lonSin, lonCos, NULL);
+
+    VideoPanoramaRemapEntry* entries = (VideoPanoramaRemapEntry*)malloc(sizeof(VideoPanoramaRemapEntry)*MAX(count, 1));
+    if (!entries) {
+        free(lonSin);
+        return -1;
+    }
+
+    remapPass(canvasWidth, canvasHeight, sourceWidth, sourceHeight, horizontalFov, pitch, lonSin, lonCos, entries);
+    free(lonSin);
+
+    remap->canvasWidth = canvasWidth;
+    remap->canvasHeight = canvasHeight;
+    remap->sourceWidth = sourceWidth;
+    remap->sourceHeight = sourceHeight;
+    remap->count = count;
+    remap->entries = entries;
+    return 0;
+}
+
+void freePanoramaRemap(VideoPanoramaRemap* remap){
+    if (!remap) {
+        return;
+    }
+
+    free(remap->entries);
+    memset(remap, 0, sizeof(VideoPanoramaRemap));
+}
+
+int createPanoramaCanvas(int width, int height, VideoPanoramaCanvas* canvas){
+    if (!canvas || width < 2 || height < 2 || (width & 1) || (height & 1)) {
+        return -1;
+    }
+
+    memset(canvas, 0, sizeof(VideoPanoramaCanvas));
+
+    size_t lumaSize = (size_t)width*height;
+    size_t chromaSize = lumaSize/4;
+
+    canvas->luma = (uint8_t*)malloc(lumaSize + chromaSize*2);
+    canvas->lumaWeight = (uint16_t*)malloc(sizeof(uint16_t)*(lumaSize + chromaSize));
+    if (!canvas->luma || !canvas->lumaWeight) {
+        freePanoramaCanvas(canvas);
+        return -1;
+    }
+
+    canvas->chromaB = canvas->luma + lumaSize;
+    canvas->chromaR = canvas->chromaB + chromaSize;
+    canvas->chromaWeight = canvas->lumaWeight + lumaSize;
+    canvas->width = width;
+    canvas->height = height;
+
+    clearPanoramaCanvas(canvas);
+    return 0;
+}
+
+void clearPanoramaCanvas(VideoPanoramaCanvas* canvas){
+    if (!canvas || !canvas->luma) {
+        return;
+    }
+
+    size_t lumaSize = (size_t)canvas->width*canvas->height;
+    size_t chromaSize = lumaSize/4;
+
+    memset(canvas->luma, 16, lumaSize);
+    memset(canvas->chromaB, 128, chromaSize*2);
+    memset(canvas->lumaWeight, 0, sizeof(uint16_t)*(lumaSize + chromaSize));
+}
+
+void freePanoramaCanvas(VideoPanoramaCanvas* canvas){
+    if (!canvas) {
+        return;
+    }
+
+    //the chroma planes and weights share the allocations of the luma plane and weight
+    free(canvas->luma);
+    free(canvas->lumaWeight);
+    memset(canvas, 0, sizeof(VideoPanoramaCanvas));
+}
+
+static inline int sampleBilinear(const uint8_t* plane, int stride, int x, int y){
+    int fx = x & (REMAP_ONE - 1);
+    int fy = y & (REMAP_ONE - 1);
+    const uint8_t* p = plane + (y >> VIDEO_PANORAMA_REMAP_FRACTION_BITS)*stride + (x >> VIDEO_PANORAMA_REMAP_FRACTION_BITS);
+
+    int top = p[0]*(REMAP_ONE - fx) + p[1]*fx;
+    int bottom = p[stride]*(REMAP_ONE - fx) + p[stride + 1]*fx;
+
+    return (top*(REMAP_ONE - fy) + bottom*fy + (1 << (2*VIDEO_PANORAMA_REMAP_FRACTION_BITS - 1))) >> (2*VIDEO_PANORAMA_REMAP_FRACTION_BITS);
+}
+
+static inline void blendPixel(uint8_t* pixel, uint16_t* accumulated, int value, int weight){
+    int total = *accumulated + weight;
+    *pixel = (uint8_t)(*pixel + ((value - *pixel)*weight + (value >= *pixel ? total/2 : -total/2))/total);
+    *accumulated = (uint16_t)MIN(total, UINT16_MAX);
+}
+
+int blendPanoramaShot(VideoPanoramaCanvas* canvas, const VideoPanoramaRemap* remap, const VideoFramePyramidLevel* frame, float yaw){
+    if (!canvas || !canvas->luma || !remap || !frame || !frame->luma || !frame->chromaB || !frame->chromaR
+        || remap->canvasWidth != canvas->width || remap->canvasHeight != canvas->height
+        || remap->sourceWidth != frame->width || remap->sourceHeight != frame->height) {
+        return -1;
+    }
+
+    int width = canvas->width;
+    int chromaWidth = width/2;
+    int sourceChromaWidth = frame->width/2;
+
+    //the chroma planes are half size, their remap positions are halved and kept off the last row and column
+    int chromaMaxX = (frame->width/2 - 1)*REMAP_ONE - 1;
+    int chromaMaxY = (frame->height/2 - 1)*REMAP_ONE - 1;
+
+    int shift = (int)lroundf(yaw*width/360.0f) + width/2;
+    shift %= width;
+    if (shift < 0) {
+        shift += width;
+    }
+
+    for (int i = 0; i < remap->count; i++) {
+        const VideoPanoramaRemapEntry* entry = remap->entries + i;
+
+        int column = entry->column + shift;
+        if (column < 0) {
+            column += width;
+        }
+        else if (column >= width) {
+            column -= width;
+        }
+
+        int index = entry->row*width + column;
+        blendPixel(canvas->luma + index, canvas->lumaWeight + index,
+                   sampleBilinear(frame->luma, frame->width, entry->sourceX, entry->sourceY), entry->weight);
+
+        //one luma pixel of each 2x2 block carries the chroma
+        if ((column & 1) || (entry->row & 1)) {
+            continue;
+        }
+
+        int chromaX = MIN((entry->sourceX - REMAP_ONE/2)/2, chromaMaxX);
+        int chromaY = MIN((entry->sourceY - REMAP_ONE/2)/2, chromaMaxY);
+        chromaX = MAX(chromaX, 0);
+        chromaY = MAX(chromaY, 0);
+
+        int chromaIndex = (entry->row/2)*chromaWidth + column/2;
+        int chromaB = sampleBilinear(frame->chromaB, sourceChromaWidth, chromaX, chromaY);
+        int chromaR = sampleBilinear(frame->chromaR, sourceChromaWidth, chromaX, chromaY);
+
+        uint16_t accumulated = canvas->chromaWeight[chromaIndex];
+        blendPixel(canvas->chromaB + chromaIndex, &accumulated, chromaB, entry->weight);
+        blendPixel(canvas->chromaR + chromaIndex, canvas->chromaWeight + chromaIndex, chromaR, entry->weight);
+    }
+
+    return 0;
+}
@@ -0,0 +1,42 @@
+//
+//  DJIVideoPhaseCorrelation.h
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "DJIStreamCommon.h"
+
+#define VIDEO_PHASE_CORRELATION_MIN_SIZE (16)
+#define VIDEO_PHASE_CORRELATION_MAX_SIZE (256)
+
+typedef struct{
+    float dx; //the picture moved right by dx pixels from the first to the second plane, to sub pixel precision
+    float dy; //the picture moved down by dy pixels
+    float peak; //height of the normalized correlation peak, near 1 for a clean match and near 0 without one
+    float overlap; //fraction of the area the two planes share at the shift
+} VideoPhaseCorrelation;
+
+/**
+ *  Translation between two luma planes by phase correlation. Both planes are resampled to size x size, tapered at
+ *  the border and correlated with a 2D FFT whose butterflies use NEON or SSE2 when available. The peak is refined
+ *  to sub pixel precision with a parabola.
+ *
+ *  Phase correlation only sees the shift modulo the size. When the wrapped shift has an alternative that leaves at
+ *  least a sixteenth of the size shared in each direction, the one whose overlap matches better is taken, so shifts
+ *  of more than half the plane, the normal case between neighbouring panorama shots, are measured correctly.
+ *
+ *  @param first luma plane of the first picture, usually a level of the frame pyramid.
+ *  @param firstStride bytes per row of the first plane.
+ *  @param second luma plane of the second picture, the same size.
+ *  @param secondStride bytes per row of the second plane.
+ *  @param width width of the planes.
+ *  @param height height of the planes.
+ *  @param size transform size, a power of two from VIDEO_PHASE_CORRELATION_MIN_SIZE to
+ *  VIDEO_PHASE_CORRELATION_MAX_SIZE.
+ *  @param correlation output, the shift is in pixels of the planes.
+ *
+ *  @return `0` on success, `-1` for invalid arguments or when out of memory.
+ */
+int phaseCorrelateLuma(const uint8_t* first, int firstStride, const uint8_t* second, int secondStride,
+                       int width, int height, int size, VideoPhaseCorrelation* correlation);
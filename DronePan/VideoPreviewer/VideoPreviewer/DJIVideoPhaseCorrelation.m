@@ -0,0 +1,345 @@
+//
+//  DJIVideoPhaseCorrelation.m
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import "DJIVideoPhaseCorrelation.h"
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PHASE_USE_NEON (1)
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define PHASE_USE_SSE2 (1)
+#endif
+
+//an alternative to the wrapped shift has to match this much better to be taken
+#define ALTERNATIVE_SHIFT_COST_RATIO (0.8f)
+
+static void resamplePlane(const uint8_t* luma, int stride, int width, int height, int size, uint8_t* output){
+    for (int v=0; v<size; v++) {
+        int y0 = v*height/size;
+        int y1 = MAX((v+1)*height/size, y0+1);
+
+        for (int u=0; u<size; u++) {
+            int x0 = u*width/size;
+            int x1 = MAX((u+1)*width/size, x0+1);
+
+            uint32_t sum = 0;
+            for (int y=y0; y<y1; y++) {
+                const uint8_t* row = luma + y*stride;
+                for (int x=x0; x<x1; x++) {
+                    sum += row[x];
+                }
+            }
+
+            uint32_t count = (y1-y0)*(x1-x0);
+            output[v*size + u] = (uint8_t)((sum + count/2)/count);
+        }
+    }
+}
+
+//raised cosine over the outer eighth on each side, so the plane edges do not correlate
+static void taperWindow(int size, float* window){
+    int taper = size/8;
+    for (int i=0; i<size; i++) {
+        window[i] = 1.0f;
+    }
+    for (int i=0; i<taper; i++) {
+        float w = 0.5f - 0.5f*cosf((float)M_PI*(i + 0.5f)/taper);
+        window[i] = w;
+        window[size-1-i] = w;
+    }
+}
+
+static void swapRows(float* a, float* b, int n){
+    for (int i=0; i<n; i++) {
+        float t = a[i];
+        a[i] = b[i];
+        b[i] = t;
+    }
+}
+
+//a = a + w*b, b = a - w*b for every column of the two rows
+static inline void butterflyRows(float* ar, float* ai, float* br, float* bi, float wr, float wi, int n){
+    int c = 0;
+#if PHASE_USE_NEON
+    float32x4_t vwr = vdupq_n_f32(wr);
+    float32x4_t vwi = vdupq_n_f32(wi);
+    for (; c+4 <= n; c += 4) {
+        float32x4_t xr = vld1q_f32(br + c);
+        float32x4_t xi = vld1q_f32(bi + c);
+        float32x4_t tr = vmlsq_f32(vmulq_f32(vwr, xr), vwi, xi);
+        float32x4_t ti = vmlaq_f32(vmulq_f32(vwr, xi), vwi, xr);
+        float32x4_t ur = vld1q_f32(ar + c);
+        float32x4_t ui = vld1q_f32(ai + c);
+        vst1q_f32(br + c, vsubq_f32(ur, tr));
+        vst1q_f32(bi + c, vsubq_f32(ui, ti));
+        vst1q_f32(ar + c, vaddq_f32(ur, tr));
+        vst1q_f32(ai + c, vaddq_f32(ui, ti));
+    }
+#elif PHASE_USE_SSE2
+    __m128 vwr = _mm_set1_ps(wr);
+    __m128 vwi = _mm_set1_ps(wi);
+    for (; c+4 <= n; c += 4) {
+        __m128 xr = _mm_loadu_ps(br + c);
+        __m128 xi = _mm_loadu_ps(bi + c);
+        __m128 tr = _mm_sub_ps(_mm_mul_ps(vwr, xr), _mm_mul_ps(vwi, xi));
+        __m128 ti = _mm_add_ps(_mm_mul_ps(vwr, xi), _mm_mul_ps(vwi, xr));
+        __m128 ur = _mm_loadu_ps(ar + c);
+        __m128 ui = _mm_loadu_ps(ai + c);
+        _mm_storeu_ps(br + c, _mm_sub_ps(ur, tr));
+        _mm_storeu_ps(bi + c, _mm_sub_ps(ui, ti));
+        _mm_storeu_ps(ar + c, _mm_add_ps(ur, tr));
+        _mm_storeu_ps(ai + c, _mm_add_ps(ui, ti));
+    }
+#endif
+    for (; c<n; c++) {
+        float tr = wr*br[c] - wi*bi[c];
+        float ti = wr*bi[c] + wi*br[c];
+        br[c] = ar[c] - tr;
+        bi[c] = ai[c] - ti;
+        ar[c] += tr;
+        ai[c] += ti;
+    }
+}
+
+/**
+ *  Radix 2 FFT down every column of an n x n matrix at once. All columns share the twiddle of a butterfly, so the
+ *  butterflies run along the rows and vectorize.
+ */
+static void fftColumns(float* re, float* im, int n, const float* cosTable, const float* sinTable, BOOL inverse){
+    //bit reversed order of the rows
+    for (int i=1, j=0; i<n; i++) {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+
+        if (i < j) {
+            swapRows(re + i*n, re + j*n, n);
+            swapRows(im + i*n, im + j*n, n);
+        }
+    }
+
+    for (int length=2; length<=n; length <<= 1) {
+        int half = length >> 1;
+        int step = n/length;
+        for (int start=0; start<n; start+=length) {
+            for (int k=0; k<half; k++) {
+                float wr = cosTable[k*step];
+                float wi = inverse? sinTable[k*step] : -sinTable[k*step];
+                int a = (start + k)*n;
+                int b = (start + k + half)*n;
+                butterflyRows(re + a, im + a, re + b, im + b, wr, wi, n);
+            }
+        }
+    }
+}
+
+static void transpose(float* m, int n){
+    for (int r=0; r<n; r++) {
+        for (int c=r+1; c<n; c++) {
+            float t = m[r*n + c];
+            m[r*n + c] = m[c*n + r];
+            m[c*n + r] = t;
+        }
+    }
+}
+
+/**
+ *  2D FFT as two column passes with a transpose between them. The result is transposed: the forward transform leaves
+ *  the spectrum transposed and the inverse of a transposed spectrum is back in the layout of the input.
+ */
+static void fft2D(float* re, float* im, int n, const float* cosTable, const float* sinTable, BOOL inverse){
+    fftColumns(re, im, n, cosTable, sinTable, inverse);
+    transpose(re, n);
+    transpose(im, n);
+    fftColumns(re, im, n, cosTable, sinTable, inverse);
+}
+
+//mean absolute difference of the shared area when the second plane is the first moved by (dx, dy)
+static float shiftCost(const uint8_t* first, const uint8_t* second, int size, int dx, int dy){
+    int x0 = MAX(dx, 0), x1 = MIN(size + dx, size);
+    int y0 = MAX(dy, 0), y1 = MIN(size + dy, size);
+
+    uint32_t sum = 0;
+    for (int y=y0; y<y1; y++) {
+        const uint8_t* a = first + (y - dy)*size - dx;
+        const uint8_t* b = second + y*size;
+        for (int x=x0; x<x1; x++) {
+            sum += abs((int)b[x] - (int)a[x]);
+        }
+    }
+
+    return (float)sum/((y1-y0)*(x1-x0));
+}
+
+static int wrapShift(int shift, int size){
+    return shift >= size/2? shift - size : shift;
+}
+
+//parabola through the peak and its neighbours, at most half a sample either way
+static float peakOffset(float before, float peak, float after){
+    float denominator = before - 2*peak + after;
+    if (denominator >= 0) {
+        return 0;
+    }
+
+    float offset = 0.5f*(before - after)/denominator;
+    return MAX(-0.5f, MIN(0.5f, offset));
+}
+
+int phaseCorrelateLuma(const uint8_t* first, int firstStride, const uint8_t* second, int secondStride,
+                       int width, int height, int size, VideoPhaseCorrelation* correlation){
+    if (!first || !second || !correlation || width <= 0 || height <= 0 || firstStride < width || secondStride < width
+        || size < VIDEO_PHASE_CORRELATION_MIN_SIZE || size > VIDEO_PHASE_CORRELATION_MAX_SIZE || (size & (size-1))) {
+        return -1;
+    }
+
+    memset(correlation, 0, sizeof(VideoPhaseCorrelation));
+
+    int count = size*size;
+    int mask = size - 1;
+    float* buffer = (float*)malloc(sizeof(float)*(2*count + 2*size));
+    uint8_t* planes = (uint8_t*)malloc(2*count);
+    if (!buffer || !planes) {
+        free(buffer);
+        free(planes);
+        return -1;
+    }
+
+    float* re = buffer;
+    float* im = re + count;
+    float* window = im + count;
+    float* cosTable = window + size;
+    float* sinTable = cosTable + size/2;
+    uint8_t* firstPlane = planes;
+    uint8_t* secondPlane = planes + count;
+
+    resamplePlane(first, firstStride, width, height, size, firstPlane);
+    resamplePlane(second, secondStride, width, height, size, secondPlane);
+    taperWindow(size, window);
+
+    uint32_t firstSum = 0, secondSum = 0;
+    for (int i=0; i<count; i++) {
+        firstSum += firstPlane[i];
+        secondSum += secondPlane[i];
+    }
+    float firstMean = (float)firstSum/count;
+    float secondMean = (float)secondSum/count;
+
+    //both real planes go through one complex transform, the first as the real and the second as the imaginary part
+    for (int v=0; v<size; v++) {
+        for (int u=0; u<size; u++) {
+            float w = window[v]*window[u];
+            re[v*size + u] = (firstPlane[v*size + u] - firstMean)*w;
+            im[v*size + u] = (secondPlane[v*size + u] - secondMean)*w;
+        }
+    }
+
+    for (int k=0; k<size/2; k++) {
+        cosTable[k] = cosf(2*(float)M_PI*k/size);
+        sinTable[k] = sinf(2*(float)M_PI*k/size);
+    }
+
+    fft2D(re, im, size, cosTable, sinTable, NO);
+
+    //split the two spectra and form the normalized cross power spectrum, k and -k are handled together because the
+    //split reads both and the result at -k is the conjugate of the one at k
+    for (int p=0; p<size; p++) {
+        for (int q=0; q<size; q++) {
+            int k = p*size + q;
+            int negative = ((size - p) & mask)*size + ((size - q) & mask);
+            if (negative < k) {
+                continue;
+            }
+
+            float ar = re[k] + re[negative];
+            float ai = im[k] - im[negative];
+            float br = im[k] + im[negative];
+            float bi = re[negative] - re[k];
+
+            float cr = br*ar + bi*ai;
+            float ci = bi*ar - br*ai;
+            float magnitude = sqrtf(cr*cr + ci*ci);
+
+            if (magnitude > 1e-6f) {
+                cr /= magnitude;
+                ci /= magnitude;
+            }
+            else {
+                cr = ci = 0;
+            }
+
+            re[k] = cr;
+            im[k] = ci;
+            re[negative] = cr;
+            im[negative] = -ci;
+        }
+    }
+
+    fft2D(re, im, size, cosTable, sinTable, YES);
+
+    int peakIndex = 0;
+    for (int i=1; i<count; i++) {
+        if (re[i] > re[peakIndex]) {
+            peakIndex = i;
+        }
+    }
+
+    int px = peakIndex & mask;
+    int py = peakIndex/size;
+    float offsetX = peakOffset(re[py*size + ((px - 1) & mask)], re[peakIndex], re[py*size + ((px + 1) & mask)]);
+    float offsetY = peakOffset(re[((py - 1) & mask)*size + px], re[peakIndex], re[((py + 1) & mask)*size + px]);
+
+    //the inverse is not scaled, a perfect match peaks at count
+    correlation->peak = MAX(0.0f, re[peakIndex]/count);
+
+    //the wrapped shift first, then the alternatives one size away that still share enough to compare
+    int candidatesX[2] = {wrapShift(px, size), 0};
+    int candidatesY[2] = {wrapShift(py, size), 0};
+    int countX = 1, countY = 1;
+
+    //the alternative shares as many samples as the wrapped shift moves
+    int minimumShared = size/16;
+    if (abs(candidatesX[0]) >= minimumShared) {
+        candidatesX[1] = candidatesX[0] > 0? candidatesX[0] - size : candidatesX[0] + size;
+        countX++;
+    }
+    if (abs(candidatesY[0]) >= minimumShared) {
+        candidatesY[1] = candidatesY[0] > 0? candidatesY[0] - size : candidatesY[0] + size;
+        countY++;
+    }
+
+    int shiftX = candidatesX[0], shiftY = candidatesY[0];
+    if (countX > 1 || countY > 1) {
+        float bestCost = shiftCost(firstPlane, secondPlane, size, shiftX, shiftY);
+        for (int i=0; i<countX; i++) {
+            for (int j=0; j<countY; j++) {
+                if (i == 0 && j == 0) {
+                    continue;
+                }
+
+                float cost = shiftCost(firstPlane, secondPlane, size, candidatesX[i], candidatesY[j]);
+                if (cost < bestCost*ALTERNATIVE_SHIFT_COST_RATIO) {
+                    bestCost = cost;
+                    shiftX = candidatesX[i];
+                    shiftY = candidatesY[j];
+                }
+            }
+        }
+    }
+
+    float sx = shiftX + offsetX;
+    float sy = shiftY + offsetY;
+    correlation->dx = sx*width/size;
+    correlation->dy = sy*height/size;
+    correlation->overlap = MAX(0.0f, 1.0f - fabsf(sx)/size)*MAX(0.0f, 1.0f - fabsf(sy)/size);
+
+    free(buffer);
+    free(planes);
+    return 0;
+}
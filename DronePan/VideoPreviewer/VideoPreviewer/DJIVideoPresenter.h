@@ -0,0 +1,66 @@
+//
+//  DJIVideoPresenter.h
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "DJIStreamCommon.h"
+#import "DJIVideoFrameMailbox.h"
+
+@protocol DJIVideoPresentTarget <NSObject>
+
+/**
+ *  Show the frame, called on the presenter's thread.
+ *
+ *  @param frame the newest frame, valid until the call returns.
+ */
+-(void) presentFrame:(VideoFrameYUV*)frame;
+
+@end
+
+/**
+ *  Shows decoded frames at the cadence of the display instead of the decoder. The decoder publishes each frame and
+ *  returns at once, on every refresh of the display the newest frame not shown yet is presented. A frame replaced
+ *  before the next refresh is dropped, a slow present never delays the decoder.
+ */
+@interface DJIVideoPresenter : NSObject
+
+/**
+ *  @param target receives the frames, not retained.
+ */
+-(id) initWithTarget:(id<DJIVideoPresentTarget>)target;
+
+@property (nonatomic, weak, readonly) id<DJIVideoPresentTarget> target;
+
+/**
+ *  Copy the frame into the mailbox. Only the decode thread publishes.
+ *
+ *  @return NO when the frame format is not supported.
+ */
+-(BOOL) publishFrame:(VideoFrameYUV*)frame;
+
+/**
+ *  One refresh of the display: present the newest frame if one was published since the last refresh. The display
+ *  link calls this on its thread, without a display link it may be called on any one thread.
+ *
+ *  @return YES when a frame was presented.
+ */
+-(BOOL) presentNewestFrame;
+
+/**
+ *  Drop a frame published but not presented yet.
+ */
+-(void) clear;
+
+/**
+ *  Present on a display link on a thread of its own.
+ */
+-(void) start;
+-(void) stop;
+
+@property (atomic, readonly) BOOL running;
+
+@property (nonatomic, readonly) VideoFrameMailboxStatistics statistics;
+
+@end
@@ -0,0 +1,112 @@
+//
+//  DJIVideoPresenter.m
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import "DJIVideoPresenter.h"
+#import <QuartzCore/QuartzCore.h>
+#import <CoreVideo/CoreVideo.h>
+
+static void retainPixelBuffer(void* pixelBuffer){
+    CVPixelBufferRetain((CVPixelBufferRef)pixelBuffer);
+}
+
+static void releasePixelBuffer(void* pixelBuffer){
+    CVPixelBufferRelease((CVPixelBufferRef)pixelBuffer);
+}
+
+@interface DJIVideoPresenter (){
+    VideoFrameMailbox _mailbox;
+}
+@property (atomic, assign) BOOL running;
+@property (nonatomic, strong) NSThread* thread;
+@end
+
+@implementation DJIVideoPresenter
+
+-(id) initWithTarget:(id<DJIVideoPresentTarget>)target{
+    self = [super init];
+    if (self) {
+        _target = target;
+        videoMailboxInit(&_mailbox, retainPixelBuffer, releasePixelBuffer);
+    }
+    return self;
+}
+
+-(void) dealloc{
+    [self stop];
+    videoMailboxRelease(&_mailbox);
+}
+
+-(BOOL) publishFrame:(VideoFrameYUV*)frame{
+    return 0 == videoMailboxPublish(&_mailbox, frame);
+}
+
+-(BOOL) presentNewestFrame{
+    VideoFrameYUV* frame = videoMailboxTake(&_mailbox);
+    if (!frame) {
+        return NO;
+    }
+    
+    [self.target presentFrame:frame];
+    return YES;
+}
+
+-(void) clear{
+    videoMailboxClear(&_mailbox);
+}
+
+-(VideoFrameMailboxStatistics) statistics{
+    return videoMailboxStatistics(&_mailbox);
+}
+
+-(void) start{
+    @synchronized (self) {
+        if (self.running) {
+            return;
+        }
+        
+        self.running = YES;
+        self.thread = [[NSThread alloc] initWithTarget:self selector:@selector(presentRunloop) object:nil];
+        self.thread.qualityOfService = NSQualityOfServiceUserInteractive;
+        self.thread.name = @"video_presenter";
+        [self.thread start];
+    }
+}
+
+-(void) stop{
+    @synchronized (self) {
+        if (!self.running) {
+            return;
+        }
+        
+        self.running = NO;
+        [self.thread cancel];
+        [self performSelector:@selector(wakeUp) onThread:self.thread withObject:nil waitUntilDone:NO];
+        self.thread = nil;
+    }
+}
+
+-(void) presentRunloop{
+    CADisplayLink* displayLink = [CADisplayLink displayLinkWithTarget:self selector:@selector(displayLinkFired:)];
+    [displayLink addToRunLoop:[NSRunLoop currentRunLoop] forMode:NSRunLoopCommonModes];
+    
+    while (![NSThread currentThread].isCancelled) {
+        @autoreleasepool {
+            [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate distantFuture]];
+        }
+    }
+    
+    //the display link retains the presenter
+    [displayLink invalidate];
+}
+
+-(void) wakeUp{
+}
+
+-(void) displayLinkFired:(CADisplayLink*)displayLink{
+    [self presentNewestFrame];
+}
+
+@end
@@ -0,0 +1,76 @@
+//
+//  DJIVideoProcessorCost.h
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+//bucket 0 holds the calls under this many microseconds, each bucket after it is twice as wide
+#define VIDEO_PROCESSOR_COST_FIRST_BUCKET_US (50)
+//the last bucket holds every call above the bucket before it
+#define VIDEO_PROCESSOR_COST_BUCKET_COUNT (16)
+//calls before a processor can be flagged, the first frames after a start are slow for every processor
+#define VIDEO_PROCESSOR_COST_MIN_CALLS (30)
+
+/**
+ *  Time a registered processor spends per call, kept by the previewer for every stream and frame processor so a
+ *  processor that eats the frame budget can be found. Durations are in milliseconds.
+ */
+@interface DJIVideoProcessorCost : NSObject
+
+-(id) initWithName:(NSString*)name;
+
+//class of the processor
+@property (nonatomic, readonly) NSString* name;
+
+@property (atomic, readonly) NSUInteger callCount;
+@property (atomic, readonly) double averageDuration;
+@property (atomic, readonly) double maxDuration;
+//moving average over roughly the last 16 calls
+@property (atomic, readonly) double recentDuration;
+
+/**
+ *  Microseconds a call may take on average before the processor is flagged slow, 0 to never flag it. The previewer
+ *  sets it to a share of the frame interval.
+ */
+@property (atomic, assign) uint64_t budget;
+
+/**
+ *  The recent duration is over the budget. The flag clears once the recent duration falls under half the budget.
+ */
+@property (atomic, readonly) BOOL slow;
+
+/**
+ *  The previewer moved the processor off the decode thread, see `demoteSlowFrameProcessors` of VideoPreviewer.
+ */
+@property (atomic, assign) BOOL demoted;
+
+/**
+ *  Calls per bucket, VIDEO_PROCESSOR_COST_BUCKET_COUNT NSNumbers.
+ */
+-(NSArray*) histogram;
+
+/**
+ *  @param percentile 0 to 100.
+ *
+ *  @return upper bound of the bucket holding the percentile, the max duration for the last bucket.
+ */
+-(double) durationAtPercentile:(double)percentile;
+
+/**
+ *  @return upper bound of the bucket in milliseconds.
+ */
++(double) upperBoundOfBucket:(NSUInteger)bucket;
+
+/**
+ *  Record one call, the previewer calls it after every call into the processor.
+ *
+ *  @param duration microseconds.
+ *
+ *  @return YES when this call flagged the processor slow.
+ */
+-(BOOL) recordDuration:(uint64_t)duration;
+
+-(void) reset;
+@end
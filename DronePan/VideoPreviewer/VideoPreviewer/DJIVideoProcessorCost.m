@@ -0,0 +1,144 @@
+//
+//  DJIVideoProcessorCost.m
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import "DJIVideoProcessorCost.h"
+#import <pthread.h>
+
+//weight of the newest call in the recent duration
+#define VIDEO_PROCESSOR_COST_RECENT_WEIGHT (1.0/16)
+
+@interface DJIVideoProcessorCost (){
+    pthread_mutex_t _mutex;
+    uint64_t _buckets[VIDEO_PROCESSOR_COST_BUCKET_COUNT];
+    uint64_t _totalDuration;
+    uint64_t _maxDuration;
+    double _recentDuration;
+}
+@property (atomic, assign) NSUInteger callCount;
+@property (atomic, assign) BOOL slow;
+@end
+
+@implementation DJIVideoProcessorCost
+
+-(id) initWithName:(NSString*)name{
+    self = [super init];
+    if (self) {
+        _name = [name copy];
+        pthread_mutex_init(&_mutex, nil);
+    }
+    return self;
+}
+
+-(void) dealloc{
+    pthread_mutex_destroy(&_mutex);
+}
+
++(double) upperBoundOfBucket:(NSUInteger)bucket{
+    return VIDEO_PROCESSOR_COST_FIRST_BUCKET_US*(double)(1ULL << MIN(bucket, 62))/1000.0;
+}
+
+-(BOOL) recordDuration:(uint64_t)duration{
+    NSUInteger bucket = 0;
+    while (bucket < VIDEO_PROCESSOR_COST_BUCKET_COUNT - 1
+           && duration >= (uint64_t)VIDEO_PROCESSOR_COST_FIRST_BUCKET_US << bucket) {
+        bucket++;
+    }
+
+    uint64_t budget = self.budget;
+    BOOL flagged = NO;
+
+    pthread_mutex_lock(&_mutex);
+    _buckets[bucket]++;
+    _totalDuration += duration;
+    _maxDuration = MAX(_maxDuration, duration);
+    _recentDuration = _callCount ? _recentDuration + (duration - _recentDuration)*VIDEO_PROCESSOR_COST_RECENT_WEIGHT : duration;
+    _callCount++;
+
+    if (budget && _callCount >= VIDEO_PROCESSOR_COST_MIN_CALLS) {
+        if (!_slow && _recentDuration > budget) {
+            _slow = YES;
+            flagged = YES;
+        }
+        else if (_slow && _recentDuration < budget/2) {
+            _slow = NO;
+        }
+    }
+    pthread_mutex_unlock(&_mutex);
+
+    if (flagged) {
+        NSLog(@"processor %@ is slow, %.2fms per frame against a budget of %.2fms", _name, _recentDuration/1000.0, budget/1000.0);
+    }
+    return flagged;
+}
+
+-(double) averageDuration{
+    pthread_mutex_lock(&_mutex);
+    double average = _callCount ? _totalDuration/1000.0/_callCount : 0;
+    pthread_mutex_unlock(&_mutex);
+    return average;
+}
+
+-(double) maxDuration{
+    pthread_mutex_lock(&_mutex);
+    double max = _maxDuration/1000.0;
+    pthread_mutex_unlock(&_mutex);
+    return max;
+}
+
+-(double) recentDuration{
+    pthread_mutex_lock(&_mutex);
+    double recent = _recentDuration/1000.0;
+    pthread_mutex_unlock(&_mutex);
+    return recent;
+}
+
+-(NSArray*) histogram{
+    NSMutableArray* histogram = [NSMutableArray arrayWithCapacity:VIDEO_PROCESSOR_COST_BUCKET_COUNT];
+
+    pthread_mutex_lock(&_mutex);
+    for (int i = 0; i < VIDEO_PROCESSOR_COST_BUCKET_COUNT; i++) {
+        [histogram addObject:@(_buckets[i])];
+    }
+    pthread_mutex_unlock(&_mutex);
+
+    return histogram;
+}
+
+-(double) durationAtPercentile:(double)percentile{
+    double duration = 0;
+
+    pthread_mutex_lock(&_mutex);
+    if (_callCount) {
+        //the call at the percentile, counted from 1
+        uint64_t rank = MAX(1, (uint64_t)ceil(MIN(MAX(percentile, 0), 100)*_callCount/100.0));
+        uint64_t seen = 0;
+
+        for (NSUInteger i = 0; i < VIDEO_PROCESSOR_COST_BUCKET_COUNT; i++) {
+            seen += _buckets[i];
+            if (seen >= rank) {
+                duration = i == VIDEO_PROCESSOR_COST_BUCKET_COUNT - 1 ?
+                    _maxDuration/1000.0 : [DJIVideoProcessorCost upperBoundOfBucket:i];
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&_mutex);
+
+    return duration;
+}
+
+-(void) reset{
+    pthread_mutex_lock(&_mutex);
+    memset(_buckets, 0, sizeof(_buckets));
+    _totalDuration = 0;
+    _maxDuration = 0;
+    _recentDuration = 0;
+    _callCount = 0;
+    _slow = NO;
+    pthread_mutex_unlock(&_mutex);
+}
+
+@end
@@ -0,0 +1,83 @@
+//
+//  DJIVideoProcessorSnapshot.h
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "DJIStreamCommon.h"
+
+@class DJIVideoStreamWorker;
+@class DJIVideoProcessorCost;
+
+/**
+ *  A registered stream processor with what it answered at registration.
+ */
+@interface DJIVideoStreamProcessorEntry : NSObject
+@property (nonatomic, readonly) id<VideoStreamProcessor> processor;
+@property (nonatomic, readonly) DJIVideoStreamProcessorType type;
+//order of a modify processor
+@property (nonatomic, readonly) int order;
+//nil for the processors run on the decode thread
+@property (nonatomic, readonly) DJIVideoStreamWorker* worker;
+@property (nonatomic, readonly) DJIVideoProcessorCost* cost;
+
+@property (nonatomic, readonly) BOOL handlesInfoChanged;
+@property (nonatomic, readonly) BOOL handlesPause;
+@property (nonatomic, readonly) BOOL handlesReset;
+@property (nonatomic, readonly) BOOL handlesFlush;
+
+-(id) initWithProcessor:(id<VideoStreamProcessor>)processor;
+@end
+
+/**
+ *  A registered frame processor with what it answered at registration.
+ */
+@interface DJIVideoFrameProcessorEntry : NSObject
+@property (nonatomic, readonly) id<VideoFrameProcessor> processor;
+//the processor takes pyramid levels instead of the full size frame
+@property (nonatomic, readonly) BOOL handlesPyramidLevel;
+@property (nonatomic, readonly) DJIVideoProcessorCost* cost;
+
+-(id) initWithProcessor:(id<VideoFrameProcessor>)processor;
+
+/**
+ *  Move the processor to a serial queue of its own. A demoted processor gets copies of the frames, one at a time,
+ *  and misses the frames that arrive while it is busy.
+ */
+-(void) demote;
+@property (nonatomic, readonly) BOOL isDemoted;
+
+/**
+ *  Queue a copy of the frame, or of the pyramid level, for a demoted processor. The copy of the frame passed with a
+ *  level carries no planes.
+ *
+ *  @param frame the decoded frame.
+ *  @param level the pyramid level, NULL for a processor of full size frames.
+ *
+ *  @return NO when the processor is still busy with the last frame.
+ */
+-(BOOL) submitFrame:(VideoFrameYUV*)frame level:(VideoFramePyramidLevel*)level;
+-(void) submitFailedFrame;
+@end
+
+/**
+ *  Immutable view of the registered processors. The previewer swaps in a new snapshot when a processor is
+ *  registered or removed, so the decode thread reads the lists without a lock or a copy.
+ */
+@interface DJIVideoProcessorSnapshot : NSObject
+
+//stream processors in the order they were registered
+@property (nonatomic, readonly) NSArray* streamEntries;
+//modify processors sorted by their order
+@property (nonatomic, readonly) NSArray* modifyEntries;
+@property (nonatomic, readonly) NSArray* decoderEntries;
+//passthrough and consume processors in the order they were registered
+@property (nonatomic, readonly) NSArray* workerEntries;
+
+@property (nonatomic, readonly) NSArray* frameEntries;
+
+-(instancetype) snapshotByAddingStreamProcessor:(id<VideoStreamProcessor>)processor;
+-(instancetype) snapshotByAddingFrameProcessor:(id<VideoFrameProcessor>)processor;
+-(instancetype) snapshotByRemovingProcessor:(id)processor;
+@end
@@ -0,0 +1,264 @@
+//
+//  DJIVideoProcessorSnapshot.m
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import "DJIVideoProcessorSnapshot.h"
+#import "DJIVideoStreamWorker.h"
+#import "DJIVideoProcessorCost.h"
+#import "DJIVideoClock.h"
+#import <CoreVideo/CoreVideo.h>
+
+//copy of the frame in one allocation, the planes follow the struct. a fast upload pixel buffer is retained
+static VideoFrameYUV* copyVideoFrame(const VideoFrameYUV* frame, BOOL withPlanes){
+    //a slice of 0 means a packed plane, the interleaved chroma of a semi planar frame is as wide as the luma
+    int chromaWidth = frame->frameType == VPFrameTypeYUV420SemiPlaner ? frame->width : frame->width/2;
+    int lumaSlice = frame->lumaSlice ? frame->lumaSlice : frame->width;
+    int chromaBSlice = frame->chromaBSlice ? frame->chromaBSlice : chromaWidth;
+    int chromaRSlice = frame->chromaRSlice ? frame->chromaRSlice : chromaWidth;
+
+    size_t chromaHeight = (frame->height + 1)/2;
+    size_t lumaSize = withPlanes && frame->luma ? (size_t)lumaSlice*frame->height : 0;
+    size_t chromaBSize = withPlanes && frame->chromaB ? (size_t)chromaBSlice*chromaHeight : 0;
+    size_t chromaRSize = withPlanes && frame->chromaR ? (size_t)chromaRSlice*chromaHeight : 0;
+
+    VideoFrameYUV* copy = (VideoFrameYUV*)malloc(sizeof(VideoFrameYUV) + lumaSize + chromaBSize + chromaRSize);
+    if (!copy) {
+        return NULL;
+    }
+
+    *copy = *frame;
+    memset(&copy->mutex, 0, sizeof(copy->mutex));
+    copy->lumaSlice = lumaSlice;
+    copy->chromaBSlice = chromaBSlice;
+    copy->chromaRSlice = chromaRSlice;
+    copy->cv_pixelbuffer_fastupload = withPlanes && frame->cv_pixelbuffer_fastupload ?
+        (void*)CVPixelBufferRetain((CVPixelBufferRef)frame->cv_pixelbuffer_fastupload) : NULL;
+
+    uint8_t* planes = (uint8_t*)(copy + 1);
+    copy->luma = lumaSize ? memcpy(planes, frame->luma, lumaSize) : NULL;
+    copy->chromaB = chromaBSize ? memcpy(planes + lumaSize, frame->chromaB, chromaBSize) : NULL;
+    copy->chromaR = chromaRSize ? memcpy(planes + lumaSize + chromaBSize, frame->chromaR, chromaRSize) : NULL;
+    return copy;
+}
+
+static void freeVideoFrame(VideoFrameYUV* frame){
+    if (frame && frame->cv_pixelbuffer_fastupload) {
+        CVPixelBufferRelease((CVPixelBufferRef)frame->cv_pixelbuffer_fastupload);
+    }
+    free(frame);
+}
+
+static VideoFramePyramidLevel* copyPyramidLevel(const VideoFramePyramidLevel* level){
+    size_t lumaSize = (size_t)level->width*level->height;
+    size_t chromaSize = (size_t)(level->width/2)*(level->height/2);
+
+    VideoFramePyramidLevel* copy = (VideoFramePyramidLevel*)malloc(sizeof(VideoFramePyramidLevel) + lumaSize + chromaSize*2);
+    if (!copy) {
+        return NULL;
+    }
+
+    *copy = *level;
+    copy->luma = (uint8_t*)(copy + 1);
+    copy->chromaB = copy->luma + lumaSize;
+    copy->chromaR = copy->chromaB + chromaSize;
+    memcpy(copy->luma, level->luma, lumaSize);
+    memcpy(copy->chromaB, level->chromaB, chromaSize);
+    memcpy(copy->chromaR, level->chromaR, chromaSize);
+    return copy;
+}
+
+@implementation DJIVideoStreamProcessorEntry
+
+-(id) initWithProcessor:(id<VideoStreamProcessor>)processor{
+    self = [super init];
+    if (self) {
+        _processor = processor;
+        _type = [processor streamProcessorType];
+        _order = [processor respondsToSelector:@selector(streamProcessorOrder)] ? [processor streamProcessorOrder] : 0;
+
+        _cost = [[DJIVideoProcessorCost alloc] initWithName:NSStringFromClass([processor class])];
+
+        if (_type == DJIVideoStreamProcessorType_Passthrough || _type == DJIVideoStreamProcessorType_Consume) {
+            _worker = [[DJIVideoStreamWorker alloc] initWithProcessor:processor];
+            _worker.cost = _cost;
+        }
+
+        _handlesInfoChanged = [processor respondsToSelector:@selector(streamProcessorInfoChanged:)];
+        _handlesPause = [processor respondsToSelector:@selector(streamProcessorPause)];
+        _handlesReset = [processor respondsToSelector:@selector(streamProcessorReset)];
+        _handlesFlush = [processor respondsToSelector:@selector(streamProcessorFlush)];
+    }
+    return self;
+}
+
+@end
+
+@interface DJIVideoFrameProcessorEntry (){
+    //retained lane queue, stored once by demote and loaded without a lock for each frame
+    void* _laneQueue;
+}
+//one frame at a time on the lane
+@property (nonatomic, strong) dispatch_semaphore_t laneSlot;
+@end
+
+@implementation DJIVideoFrameProcessorEntry
+
+-(id) initWithProcessor:(id<VideoFrameProcessor>)processor{
+    self = [super init];
+    if (self) {
+        _processor = processor;
+        _handlesPyramidLevel = [processor respondsToSelector:@selector(videoProcessorPyramidLevel)]
+            && [processor respondsToSelector:@selector(videoProcessPyramidLevel:frame:)];
+        _cost = [[DJIVideoProcessorCost alloc] initWithName:NSStringFromClass([processor class])];
+    }
+    return self;
+}
+
+-(void) dealloc{
+    if (_laneQueue) {
+        CFBridgingRelease(_laneQueue);
+    }
+}
+
+-(dispatch_queue_t) laneQueue{
+    return (__bridge dispatch_queue_t)__atomic_load_n(&_laneQueue, __ATOMIC_ACQUIRE);
+}
+
+-(void) demote{
+    @synchronized(self) {
+        if (self.laneQueue) {
+            return;
+        }
+
+        NSString* label = [NSString stringWithFormat:@"video_frame_lane_%@", _cost.name];
+        _laneSlot = dispatch_semaphore_create(1);
+        //the release store publishes the slot along with the queue
+        dispatch_queue_t laneQueue = dispatch_queue_create(label.UTF8String, DISPATCH_QUEUE_SERIAL);
+        __atomic_store_n(&_laneQueue, (__bridge_retained void*)laneQueue, __ATOMIC_RELEASE);
+        _cost.demoted = YES;
+        NSLog(@"processor %@ moved off the decode thread", _cost.name);
+    }
+}
+
+-(BOOL) isDemoted{
+    return self.laneQueue != nil;
+}
+
+-(BOOL) submitFrame:(VideoFrameYUV*)frame level:(VideoFramePyramidLevel*)level{
+    dispatch_queue_t laneQueue = self.laneQueue;
+    if (!laneQueue || 0 != dispatch_semaphore_wait(_laneSlot, DISPATCH_TIME_NOW)) {
+        return NO;
+    }
+
+    VideoFrameYUV* frameCopy = copyVideoFrame(frame, level == NULL);
+    VideoFramePyramidLevel* levelCopy = level ? copyPyramidLevel(level) : NULL;
+    if (!frameCopy || (level && !levelCopy)) {
+        freeVideoFrame(frameCopy);
+        free(levelCopy);
+        dispatch_semaphore_signal(_laneSlot);
+        return NO;
+    }
+
+    dispatch_async(laneQueue, ^{
+        uint64_t start = videoClockTimeTag();
+        if (levelCopy) {
+            [_processor videoProcessPyramidLevel:levelCopy frame:frameCopy];
+        }else{
+            [_processor videoProcessFrame:frameCopy];
+        }
+        [_cost recordDuration:videoClockTimeTag() - start];
+
+        freeVideoFrame(frameCopy);
+        free(levelCopy);
+        dispatch_semaphore_signal(_laneSlot);
+    });
+    return YES;
+}
+
+-(void) submitFailedFrame{
+    dispatch_async(self.laneQueue, ^{
+        [_processor videoProcessFailedFrame];
+    });
+}
+
+@end
+
+@implementation DJIVideoProcessorSnapshot
+
+-(id) init{
+    return [self initWithStreamEntries:@[] frameEntries:@[]];
+}
+
+-(id) initWithStreamEntries:(NSArray*)streamEntries frameEntries:(NSArray*)frameEntries{
+    self = [super init];
+    if (self) {
+        _streamEntries = [streamEntries copy];
+        _frameEntries = [frameEntries copy];
+
+        NSMutableArray* modifyEntries = [NSMutableArray array];
+        NSMutableArray* decoderEntries = [NSMutableArray array];
+        NSMutableArray* workerEntries = [NSMutableArray array];
+        for (DJIVideoStreamProcessorEntry* entry in _streamEntries) {
+            if (entry.worker) {
+                [workerEntries addObject:entry];
+            }
+            else if (entry.type == DJIVideoStreamProcessorType_Decoder) {
+                [decoderEntries addObject:entry];
+            }
+            else if (entry.type == DJIVideoStreamProcessorType_Modify) {
+                [modifyEntries addObject:entry];
+            }
+        }
+
+        //processors of the same order keep the order they were registered in
+        [modifyEntries sortWithOptions:NSSortStable usingComparator:^NSComparisonResult(DJIVideoStreamProcessorEntry* a, DJIVideoStreamProcessorEntry* b) {
+            return a.order < b.order ? NSOrderedAscending : (a.order > b.order ? NSOrderedDescending : NSOrderedSame);
+        }];
+
+        _modifyEntries = [modifyEntries copy];
+        _decoderEntries = [decoderEntries copy];
+        _workerEntries = [workerEntries copy];
+    }
+    return self;
+}
+
+-(instancetype) snapshotByAddingStreamProcessor:(id<VideoStreamProcessor>)processor{
+    if (![processor conformsToProtocol:@protocol(VideoStreamProcessor)]) {
+        return self;
+    }
+
+    DJIVideoStreamProcessorEntry* entry = [[DJIVideoStreamProcessorEntry alloc] initWithProcessor:processor];
+    return [[DJIVideoProcessorSnapshot alloc] initWithStreamEntries:[_streamEntries arrayByAddingObject:entry] frameEntries:_frameEntries];
+}
+
+-(instancetype) snapshotByAddingFrameProcessor:(id<VideoFrameProcessor>)processor{
+    if (![processor conformsToProtocol:@protocol(VideoFrameProcessor)]) {
+        return self;
+    }
+
+    DJIVideoFrameProcessorEntry* entry = [[DJIVideoFrameProcessorEntry alloc] initWithProcessor:processor];
+    return [[DJIVideoProcessorSnapshot alloc] initWithStreamEntries:_streamEntries frameEntries:[_frameEntries arrayByAddingObject:entry]];
+}
+
+-(instancetype) snapshotByRemovingProcessor:(id)processor{
+    //every registration of the processor is removed
+    NSMutableArray* streamEntries = [NSMutableArray array];
+    for (DJIVideoStreamProcessorEntry* entry in _streamEntries) {
+        if (entry.processor != processor) {
+            [streamEntries addObject:entry];
+        }
+    }
+
+    NSMutableArray* frameEntries = [NSMutableArray array];
+    for (DJIVideoFrameProcessorEntry* entry in _frameEntries) {
+        if (entry.processor != processor) {
+            [frameEntries addObject:entry];
+        }
+    }
+
+    return [[DJIVideoProcessorSnapshot alloc] initWithStreamEntries:streamEntries frameEntries:frameEntries];
+}
+
+@end
@@ -0,0 +1,63 @@
+//
+//  DJIVideoPyramid.h
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "DJIStreamCommon.h"
+
+#define VIDEO_PYRAMID_MAX_LEVEL_COUNT (3)
+
+/**
+ *  Down scaled copies of a decoded frame, built once per frame and shared by the frame processors.
+ */
+typedef struct{
+    int levelCount;
+    VideoFramePyramidLevel levels[VIDEO_PYRAMID_MAX_LEVEL_COUNT];
+    
+    //all planes of all levels live in one buffer
+    uint8_t* buffer;
+    size_t bufferSize;
+} VideoFramePyramid;
+
+/**
+ *  Build the first `levelCount` levels of the pyramid with a 2x2 box filter. The buffer is reused between frames.
+ *
+ *  @param pyramid the pyramid to fill, zero it before the first use.
+ *  @param frame decoded frame in YUV420 planar or semi planar format.
+ *  @param levelCount number of levels needed.
+ *
+ *  @return number of levels built, `0` when the frame format is not supported.
+ */
+int videoPyramidBuild(VideoFramePyramid* pyramid, const VideoFrameYUV* frame, int levelCount);
+
+/**
+ *  Release the buffer of the pyramid.
+ */
+void videoPyramidRelease(VideoFramePyramid* pyramid);
+
+/**
+ *  Halve a plane with a rounded 2x2 average.
+ *
+ *  @param src source plane.
+ *  @param srcStride bytes per row of the source.
+ *  @param dst destination plane.
+ *  @param dstStride bytes per row of the destination.
+ *  @param dstWidth destination width, at most half of the source width.
+ *  @param dstHeight destination height, at most half of the source height.
+ */
+void downscalePlane2x(const uint8_t* src, int srcStride, uint8_t* dst, int dstStride, int dstWidth, int dstHeight);
+
+/**
+ *  Halve an interleaved CbCr plane into two planar chroma planes.
+ *
+ *  @param src source plane, Cb and Cr interleaved.
+ *  @param srcStride bytes per row of the source.
+ *  @param dstB destination Cb plane.
+ *  @param dstR destination Cr plane.
+ *  @param dstStride bytes per row of the destinations.
+ *  @param dstWidth destination width in samples.
+ *  @param dstHeight destination height.
+ */
+void downscaleInterleavedPlane2x(const uint8_t* src, int srcStride, uint8_t* dstB, uint8_t* dstR, int dstStride, int dstWidth, int dstHeight);
@@ -0,0 +1,191 @@
+//
+//  DJIVideoPyramid.m
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import "DJIVideoPyramid.h"
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PYRAMID_USE_NEON (1)
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define PYRAMID_USE_SSE2 (1)
+#endif
+
+void downscalePlane2x(const uint8_t* src, int srcStride, uint8_t* dst, int dstStride, int dstWidth, int dstHeight){
+    for (int y=0; y<dstHeight; y++) {
+        const uint8_t* row0 = src + 2*y*srcStride;
+        const uint8_t* row1 = row0 + srcStride;
+        uint8_t* out = dst + y*dstStride;
+        int x = 0;
+        
+#if PYRAMID_USE_NEON
+        for (; x+16 <= dstWidth; x += 16) {
+            uint16x8_t lo = vpaddlq_u8(vld1q_u8(row0 + 2*x));
+            uint16x8_t hi = vpaddlq_u8(vld1q_u8(row0 + 2*x + 16));
+            lo = vpadalq_u8(lo, vld1q_u8(row1 + 2*x));
+            hi = vpadalq_u8(hi, vld1q_u8(row1 + 2*x + 16));
+            vst1q_u8(out + x, vcombine_u8(vrshrn_n_u16(lo, 2), vrshrn_n_u16(hi, 2)));
+        }
+#elif PYRAMID_USE_SSE2
+        const __m128i even_mask = _mm_set1_epi16(0x00ff);
+        const __m128i rounding = _mm_set1_epi16(2);
+        for (; x+8 <= dstWidth; x += 8) {
+            __m128i r0 = _mm_loadu_si128((const __m128i*)(row0 + 2*x));
+            __m128i r1 = _mm_loadu_si128((const __m128i*)(row1 + 2*x));
+            __m128i sum = _mm_add_epi16(_mm_and_si128(r0, even_mask), _mm_srli_epi16(r0, 8));
+            sum = _mm_add_epi16(sum, _mm_and_si128(r1, even_mask));
+            sum = _mm_add_epi16(sum, _mm_srli_epi16(r1, 8));
+            sum = _mm_srli_epi16(_mm_add_epi16(sum, rounding), 2);
+            _mm_storel_epi64((__m128i*)(out + x), _mm_packus_epi16(sum, sum));
+        }
+#endif
+        
+        for (; x<dstWidth; x++) {
+            out[x] = (row0[2*x] + row0[2*x+1] + row1[2*x] + row1[2*x+1] + 2) >> 2;
+        }
+    }
+}
+
+void downscaleInterleavedPlane2x(const uint8_t* src, int srcStride, uint8_t* dstB, uint8_t* dstR, int dstStride, int dstWidth, int dstHeight){
+    for (int y=0; y<dstHeight; y++) {
+        const uint8_t* row0 = src + 2*y*srcStride;
+        const uint8_t* row1 = row0 + srcStride;
+        uint8_t* outB = dstB + y*dstStride;
+        uint8_t* outR = dstR + y*dstStride;
+        int x = 0;
+        
+#if PYRAMID_USE_NEON
+        for (; x+16 <= dstWidth; x += 16) {
+            //val[0] val[2] are the two cb samples of an output pixel, val[1] val[3] the cr samples
+            uint8x16x4_t a = vld4q_u8(row0 + 4*x);
+            uint8x16x4_t b = vld4q_u8(row1 + 4*x);
+            
+            uint16x8_t bl = vaddq_u16(vaddl_u8(vget_low_u8(a.val[0]), vget_low_u8(a.val[2])),
+                                      vaddl_u8(vget_low_u8(b.val[0]), vget_low_u8(b.val[2])));
+            uint16x8_t bh = vaddq_u16(vaddl_u8(vget_high_u8(a.val[0]), vget_high_u8(a.val[2])),
+                                      vaddl_u8(vget_high_u8(b.val[0]), vget_high_u8(b.val[2])));
+            uint16x8_t rl = vaddq_u16(vaddl_u8(vget_low_u8(a.val[1]), vget_low_u8(a.val[3])),
+                                      vaddl_u8(vget_low_u8(b.val[1]), vget_low_u8(b.val[3])));
+            uint16x8_t rh = vaddq_u16(vaddl_u8(vget_high_u8(a.val[1]), vget_high_u8(a.val[3])),
+                                      vaddl_u8(vget_high_u8(b.val[1]), vget_high_u8(b.val[3])));
+            
+            vst1q_u8(outB + x, vcombine_u8(vrshrn_n_u16(bl, 2), vrshrn_n_u16(bh, 2)));
+            vst1q_u8(outR + x, vcombine_u8(vrshrn_n_u16(rl, 2), vrshrn_n_u16(rh, 2)));
+        }
+#endif
+        
+        for (; x<dstWidth; x++) {
+            outB[x] = (row0[4*x] + row0[4*x+2] + row1[4*x] + row1[4*x+2] + 2) >> 2;
+            outR[x] = (row0[4*x+1] + row0[4*x+3] + row1[4*x+1] + row1[4*x+3] + 2) >> 2;
+        }
+    }
+}
+
+int videoPyramidBuild(VideoFramePyramid* pyramid, const VideoFrameYUV* frame, int levelCount){
+    if (!pyramid || !frame || !frame->luma || !frame->chromaB) {
+        return 0;
+    }
+    
+    if (frame->frameType != VPFrameTypeYUV420Planer && frame->frameType != VPFrameTypeYUV420SemiPlaner) {
+        return 0;
+    }
+    
+    if (frame->frameType == VPFrameTypeYUV420Planer && !frame->chromaR) {
+        return 0;
+    }
+    
+    if (levelCount > VIDEO_PYRAMID_MAX_LEVEL_COUNT) {
+        levelCount = VIDEO_PYRAMID_MAX_LEVEL_COUNT;
+    }
+    
+    //layout of the levels, stop at levels too small to be useful
+    size_t needed = 0;
+    int count = 0;
+    int width = frame->width;
+    int height = frame->height;
+    for (int i=0; i<levelCount; i++) {
+        width /= 2;
+        height /= 2;
+        if (width < 4 || height < 4) {
+            break;
+        }
+        
+        needed += width*height + 2*(width/2)*(height/2);
+        count++;
+    }
+    
+    if (count == 0) {
+        return 0;
+    }
+    
+    if (pyramid->bufferSize < needed) {
+        free(pyramid->buffer);
+        pyramid->buffer = (uint8_t*)malloc(needed);
+        pyramid->bufferSize = pyramid->buffer? needed : 0;
+        if (!pyramid->buffer) {
+            pyramid->levelCount = 0;
+            return 0;
+        }
+    }
+    
+    uint8_t* iter = pyramid->buffer;
+    width = frame->width;
+    height = frame->height;
+    for (int i=0; i<count; i++) {
+        VideoFramePyramidLevel* level = &pyramid->levels[i];
+        level->level = i;
+        level->width = width/2;
+        level->height = height/2;
+        level->luma = iter;
+        iter += level->width*level->height;
+        level->chromaB = iter;
+        iter += (level->width/2)*(level->height/2);
+        level->chromaR = iter;
+        iter += (level->width/2)*(level->height/2);
+        
+        width = level->width;
+        height = level->height;
+    }
+    
+    //level 0 from the decoded frame, packed planes have no slice set
+    VideoFramePyramidLevel* first = &pyramid->levels[0];
+    int lumaStride = frame->lumaSlice? frame->lumaSlice : frame->width;
+    downscalePlane2x(frame->luma, lumaStride, first->luma, first->width, first->width, first->height);
+    
+    if (frame->frameType == VPFrameTypeYUV420SemiPlaner) {
+        int chromaStride = frame->chromaBSlice? frame->chromaBSlice : frame->width;
+        downscaleInterleavedPlane2x(frame->chromaB, chromaStride, first->chromaB, first->chromaR,
+                                    first->width/2, first->width/2, first->height/2);
+    }
+    else{
+        int chromaBStride = frame->chromaBSlice? frame->chromaBSlice : frame->width/2;
+        int chromaRStride = frame->chromaRSlice? frame->chromaRSlice : frame->width/2;
+        downscalePlane2x(frame->chromaB, chromaBStride, first->chromaB, first->width/2, first->width/2, first->height/2);
+        downscalePlane2x(frame->chromaR, chromaRStride, first->chromaR, first->width/2, first->width/2, first->height/2);
+    }
+    
+    for (int i=1; i<count; i++) {
+        VideoFramePyramidLevel* src = &pyramid->levels[i-1];
+        VideoFramePyramidLevel* dst = &pyramid->levels[i];
+        downscalePlane2x(src->luma, src->width, dst->luma, dst->width, dst->width, dst->height);
+        downscalePlane2x(src->chromaB, src->width/2, dst->chromaB, dst->width/2, dst->width/2, dst->height/2);
+        downscalePlane2x(src->chromaR, src->width/2, dst->chromaR, dst->width/2, dst->width/2, dst->height/2);
+    }
+    
+    pyramid->levelCount = count;
+    return count;
+}
+
+void videoPyramidRelease(VideoFramePyramid* pyramid){
+    if (!pyramid) {
+        return;
+    }
+    
+    free(pyramid->buffer);
+    pyramid->buffer = NULL;
+    pyramid->bufferSize = 0;
+    pyramid->levelCount = 0;
+}
@@ -0,0 +1,77 @@
+//
+//  DJIVideoResumeTracker.h
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "DJIStreamCommon.h"
+#import "DJIVideoStatistics.h"
+
+//a resume that sees no clean frame in this long shows the video anyway
+#define VIDEO_RESUME_DEFAULT_TIMEOUT (2000*1000)
+
+typedef NS_ENUM(NSUInteger, VideoResumeResult){
+    VideoResumeResultPending,
+    //a frame decoded from a complete reference chain
+    VideoResumeResultClean,
+    VideoResumeResultTimedOut,
+};
+
+/**
+ *  Decides when the picture is safe to show again after a resume. A frame is clean when it is a keyframe, or when
+ *  every frame since the last keyframe was decoded in frame_num order, so all of its references are in the decoder.
+ */
+typedef struct{
+    //every frame since the last keyframe was decoded without a gap
+    BOOL chainIntact;
+    int lastFrameIndex;
+    
+    BOOL resuming;
+    uint64_t resumeStart;
+    uint32_t hiddenFrameCount;
+    //microseconds
+    uint64_t timeout;
+    
+    VideoResumeStatistics statistics;
+} VideoResumeTracker;
+
+void videoResumeInit(VideoResumeTracker* tracker, uint64_t timeout);
+
+/**
+ *  Start hiding the frames until a clean one is decoded. The chain seen before the resume is not trusted.
+ */
+void videoResumeBegin(VideoResumeTracker* tracker, uint64_t now);
+
+/**
+ *  Stop hiding without counting a resume, when the decoder restarts.
+ */
+void videoResumeCancel(VideoResumeTracker* tracker);
+
+/**
+ *  A frame came out of the decoder.
+ *
+ *  @param tracker the tracker.
+ *  @param info frame info of the frame.
+ *  @param keyframe the frame can be decoded without the frames before it.
+ *  @param decoded every decoder took the frame, NO when it was skipped or failed.
+ *  @param now current videoClockTimeTag.
+ *
+ *  @return VideoResumeResultClean or VideoResumeResultTimedOut when the resume ends with this frame.
+ */
+VideoResumeResult videoResumeFrameDecoded(VideoResumeTracker* tracker, const VideoFrameH264BasicInfo* info, BOOL keyframe, BOOL decoded, uint64_t now);
+
+/**
+ *  The references of the next frame were decoded out of band, from a replayed gop.
+ */
+void videoResumeChainRebuilt(VideoResumeTracker* tracker);
+
+/**
+ *  A frame failed after it was counted, or the decoder lost its references.
+ */
+void videoResumeChainBroken(VideoResumeTracker* tracker);
+
+/**
+ *  @return VideoResumeResultTimedOut when the resume ran out of time without a frame.
+ */
+VideoResumeResult videoResumeCheckTimeout(VideoResumeTracker* tracker, uint64_t now);
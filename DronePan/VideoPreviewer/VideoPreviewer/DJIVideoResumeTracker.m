@@ -0,0 +1,86 @@
+//
+//  DJIVideoResumeTracker.m
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import "DJIVideoResumeTracker.h"
+
+void videoResumeInit(VideoResumeTracker* tracker, uint64_t timeout){
+    memset(tracker, 0, sizeof(VideoResumeTracker));
+    tracker->lastFrameIndex = -1;
+    tracker->timeout = timeout;
+}
+
+void videoResumeBegin(VideoResumeTracker* tracker, uint64_t now){
+    tracker->resuming = YES;
+    tracker->resumeStart = now;
+    tracker->hiddenFrameCount = 0;
+    //references decoded before the pause may be gone, only a keyframe or a replayed gop proves the chain again
+    tracker->chainIntact = NO;
+    tracker->lastFrameIndex = -1;
+}
+
+void videoResumeCancel(VideoResumeTracker* tracker){
+    tracker->resuming = NO;
+    tracker->chainIntact = NO;
+    tracker->lastFrameIndex = -1;
+}
+
+static VideoResumeResult finishResume(VideoResumeTracker* tracker, VideoResumeResult result, uint64_t now){
+    double latency = (now - tracker->resumeStart)/1000.0;
+    
+    tracker->resuming = NO;
+    tracker->statistics.resumeCount++;
+    if (result == VideoResumeResultTimedOut) {
+        tracker->statistics.timeoutCount++;
+    }
+    tracker->statistics.lastLatency = latency;
+    tracker->statistics.maxLatency = MAX(tracker->statistics.maxLatency, latency);
+    tracker->statistics.lastHiddenFrameCount = tracker->hiddenFrameCount;
+    return result;
+}
+
+VideoResumeResult videoResumeFrameDecoded(VideoResumeTracker* tracker, const VideoFrameH264BasicInfo* info, BOOL keyframe, BOOL decoded, uint64_t now){
+    if (!decoded) {
+        videoResumeChainBroken(tracker);
+    }
+    else if (keyframe) {
+        tracker->chainIntact = YES;
+    }
+    else if (tracker->chainIntact && info->max_frame_index_plus_one && tracker->lastFrameIndex >= 0) {
+        //frame_num grows by one after each reference frame, a larger step means a reference never arrived
+        int step = (info->frame_index - tracker->lastFrameIndex + info->max_frame_index_plus_one)%info->max_frame_index_plus_one;
+        if (step > 1) {
+            tracker->chainIntact = NO;
+        }
+    }
+    tracker->lastFrameIndex = decoded ? info->frame_index : -1;
+    
+    if (!tracker->resuming) {
+        return VideoResumeResultPending;
+    }
+    tracker->hiddenFrameCount++;
+    
+    if (decoded && tracker->chainIntact) {
+        return finishResume(tracker, VideoResumeResultClean, now);
+    }
+    return videoResumeCheckTimeout(tracker, now);
+}
+
+void videoResumeChainRebuilt(VideoResumeTracker* tracker){
+    tracker->chainIntact = YES;
+    tracker->lastFrameIndex = -1;
+}
+
+void videoResumeChainBroken(VideoResumeTracker* tracker){
+    tracker->chainIntact = NO;
+    tracker->lastFrameIndex = -1;
+}
+
+VideoResumeResult videoResumeCheckTimeout(VideoResumeTracker* tracker, uint64_t now){
+    if (!tracker->resuming || now - tracker->resumeStart < tracker->timeout) {
+        return VideoResumeResultPending;
+    }
+    return finishResume(tracker, VideoResumeResultTimedOut, now);
+}
@@ -0,0 +1,60 @@
+//
+//  DJIVideoStatistics.h
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#ifndef DJI_VIDEO_STATISTICS_H
+#define DJI_VIDEO_STATISTICS_H
+
+#import <Foundation/Foundation.h>
+
+//statistics VideoPreviewer reports for the modules behind it, which stay private to the framework
+
+/**
+ *  Jitter and delay of the playout buffer, durations in milliseconds.
+ */
+typedef struct{
+    //mean arrival delay of the frames on their reconstructed times
+    double jitter;
+    //delay the frames are held for, moving toward the target
+    double playoutDelay;
+    //delay that covers nearly every recent arrival delay
+    double targetDelay;
+    uint64_t frameCount;
+    //frames that arrived after their playout time
+    uint64_t lateFrameCount;
+    //times the reconstructed timeline was restarted
+    uint64_t resyncCount;
+} VideoPlayoutStatistics;
+
+//safe resume
+typedef struct{
+    uint64_t resumeCount;
+    uint64_t timeoutCount;
+    //milliseconds from the resume to the first clean frame or the timeout
+    double lastLatency;
+    double maxLatency;
+    //frames decoded and hidden during the last resume
+    uint32_t lastHiddenFrameCount;
+} VideoResumeStatistics;
+
+//frame presentation
+typedef struct{
+    uint64_t publishedCount;
+    uint64_t presentedCount;
+    //frames replaced by a newer one before the presenter took them
+    uint64_t droppedCount;
+    //presenter ticks without a new frame
+    uint64_t idleTickCount;
+} VideoFrameMailboxStatistics;
+
+//low power stream tracking
+typedef struct{
+    uint64_t trackedBytes;
+    uint64_t keyframeCount;
+    //keyframes given up because the stream after them outgrew the buffer
+    uint64_t overflowCount;
+} VideoStreamTrackerStatistics;
+
+#endif
@@ -0,0 +1,406 @@
+//
+//  DJIVideoStreamRecord.c
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#include "DJIVideoStreamRecord.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const char segmentMagic[8] = {'D', 'J', 'I', 'V', 'R', 'E', 'C', '1'};
+static const char indexMagic[8] = {'D', 'J', 'I', 'V', 'I', 'D', 'X', '1'};
+
+#define ALIGN_UP(value, alignment) (((value) + (alignment) - 1)/(alignment)*(alignment))
+
+int videoRecordPath(char* path, size_t size, const char* directory, const char* prefix, uint32_t segmentNumber,
+                    const char* extension){
+    int length = snprintf(path, size, "%s/%s_%06u.%s", directory, prefix, segmentNumber, extension);
+    return (length < 0 || (size_t)length >= size) ? -1 : 0;
+}
+
+static int writeAll(int fd, const void* data, size_t size){
+    const uint8_t* bytes = (const uint8_t*)data;
+    while (size) {
+        ssize_t written = write(fd, bytes, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        bytes += written;
+        size -= written;
+    }
+    return 0;
+}
+
+static void closeSegmentFiles(VideoRecordWriter* writer){
+    if (writer->dataFd >= 0) {
+        close(writer->dataFd);
+        writer->dataFd = -1;
+    }
+    if (writer->indexFd >= 0) {
+        close(writer->indexFd);
+        writer->indexFd = -1;
+    }
+}
+
+//a write error loses the segment, the next record starts a new one
+static int failSegment(VideoRecordWriter* writer){
+    closeSegmentFiles(writer);
+    writer->statistics.errorCount++;
+    writer->bufferUsed = 0;
+    writer->pendingCount = 0;
+    writer->segmentNumber++;
+    return -1;
+}
+
+static int openSegment(VideoRecordWriter* writer){
+    char path[PATH_MAX];
+    if (0 != videoRecordPath(path, sizeof(path), writer->directory, writer->prefix, writer->segmentNumber,
+                             VIDEO_RECORD_SEGMENT_EXTENSION)) {
+        return -1;
+    }
+    writer->dataFd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    
+    if (0 != videoRecordPath(path, sizeof(path), writer->directory, writer->prefix, writer->segmentNumber,
+                             VIDEO_RECORD_INDEX_EXTENSION)) {
+        closeSegmentFiles(writer);
+        return -1;
+    }
+    writer->indexFd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    
+    if (writer->dataFd < 0 || writer->indexFd < 0) {
+        closeSegmentFiles(writer);
+        return -1;
+    }
+    
+    //the header takes the first page so the records start page aligned
+    VideoRecordSegmentHeader* header = (VideoRecordSegmentHeader*)writer->buffer;
+    memset(writer->buffer, 0, VIDEO_RECORD_PAGE_SIZE);
+    memcpy(header->magic, segmentMagic, sizeof(segmentMagic));
+    header->version = VIDEO_RECORD_VERSION;
+    header->pageSize = VIDEO_RECORD_PAGE_SIZE;
+    header->segmentNumber = writer->segmentNumber;
+    
+    VideoRecordIndexHeader indexHeader;
+    memset(&indexHeader, 0, sizeof(indexHeader));
+    memcpy(indexHeader.magic, indexMagic, sizeof(indexMagic));
+    indexHeader.version = VIDEO_RECORD_VERSION;
+    indexHeader.segmentNumber = writer->segmentNumber;
+    indexHeader.entrySize = sizeof(VideoRecordIndexEntry);
+    
+    if (0 != writeAll(writer->dataFd, writer->buffer, VIDEO_RECORD_PAGE_SIZE)
+        || 0 != writeAll(writer->indexFd, &indexHeader, sizeof(indexHeader))) {
+        closeSegmentFiles(writer);
+        return -1;
+    }
+    
+    writer->bufferOffset = VIDEO_RECORD_PAGE_SIZE;
+    writer->bufferUsed = 0;
+    writer->statistics.segmentCount++;
+    return 0;
+}
+
+//index the keyframes whose records are on disk now
+static int writePendingEntries(VideoRecordWriter* writer){
+    int ready = 0;
+    while (ready < writer->pendingCount) {
+        const VideoRecordIndexEntry* entry = &writer->pendingEntries[ready];
+        if (entry->offset + sizeof(VideoRecordHeader) + entry->size > writer->bufferOffset) {
+            break;
+        }
+        ready++;
+    }
+    
+    if (ready == 0) {
+        return 0;
+    }
+    
+    if (0 != writeAll(writer->indexFd, writer->pendingEntries, ready*sizeof(VideoRecordIndexEntry))) {
+        return -1;
+    }
+    
+    writer->pendingCount -= ready;
+    memmove(writer->pendingEntries, writer->pendingEntries + ready, writer->pendingCount*sizeof(VideoRecordIndexEntry));
+    return 0;
+}
+
+static int writeBuffer(VideoRecordWriter* writer, size_t size){
+    if (0 != writeAll(writer->dataFd, writer->buffer, size)) {
+        return failSegment(writer);
+    }
+    
+    writer->bufferOffset += size;
+    writer->bufferUsed = 0;
+    writer->statistics.bytesWritten += size;
+    writer->statistics.writeCount++;
+    
+    if (0 != writePendingEntries(writer)) {
+        return failSegment(writer);
+    }
+    return 0;
+}
+
+//copy into the buffer, NULL data appends zeros, full buffers are written on the way
+static int appendBytes(VideoRecordWriter* writer, const uint8_t* data, size_t size){
+    while (size) {
+        size_t count = writer->bufferSize - writer->bufferUsed;
+        if (count > size) {
+            count = size;
+        }
+        
+        if (data) {
+            memcpy(writer->buffer + writer->bufferUsed, data, count);
+            data += count;
+        }else{
+            memset(writer->buffer + writer->bufferUsed, 0, count);
+        }
+        writer->bufferUsed += count;
+        size -= count;
+        
+        if (writer->bufferUsed == writer->bufferSize && 0 != writeBuffer(writer, writer->bufferSize)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int videoRecordWriterOpen(VideoRecordWriter* writer, const char* directory, const char* prefix, size_t bufferSize,
+                          size_t maxSegmentBytes, uint64_t flushInterval){
+    memset(writer, 0, sizeof(VideoRecordWriter));
+    writer->dataFd = -1;
+    writer->indexFd = -1;
+    
+    if (strlen(directory) >= sizeof(writer->directory) || strlen(prefix) >= sizeof(writer->prefix)) {
+        return -1;
+    }
+    strcpy(writer->directory, directory);
+    strcpy(writer->prefix, prefix);
+    writer->maxSegmentBytes = maxSegmentBytes;
+    writer->flushInterval = flushInterval;
+    
+    writer->bufferSize = ALIGN_UP(bufferSize ? bufferSize : VIDEO_RECORD_PAGE_SIZE, VIDEO_RECORD_PAGE_SIZE);
+    if (0 != posix_memalign((void**)&writer->buffer, VIDEO_RECORD_PAGE_SIZE, writer->bufferSize)) {
+        writer->buffer = NULL;
+        return -1;
+    }
+    
+    if (0 != openSegment(writer)) {
+        videoRecordWriterClose(writer);
+        return -1;
+    }
+    return 0;
+}
+
+int videoRecordWriterAppend(VideoRecordWriter* writer, const void* payload, uint32_t size, int keyframe,
+                            uint64_t pts, uint64_t timeTag, uint32_t uuid){
+    if (!writer->buffer || !payload || !size) {
+        return -1;
+    }
+    
+    //a segment ends at a keyframe so each one decodes on its own
+    if (writer->dataFd >= 0 && keyframe && writer->bufferOffset + writer->bufferUsed >= writer->maxSegmentBytes) {
+        videoRecordWriterFlush(writer);
+        closeSegmentFiles(writer);
+        writer->segmentNumber++;
+    }
+    
+    if (writer->dataFd < 0 && 0 != openSegment(writer)) {
+        writer->statistics.errorCount++;
+        return -1;
+    }
+    
+    uint64_t offset = writer->bufferOffset + writer->bufferUsed;
+    VideoRecordHeader header = {size, keyframe ? VIDEO_RECORD_FLAG_KEYFRAME : 0};
+    size_t padding = ALIGN_UP(sizeof(header) + size, 8) - (sizeof(header) + size);
+    
+    if (keyframe) {
+        if (writer->pendingCount == writer->pendingCapacity) {
+            int capacity = writer->pendingCapacity ? writer->pendingCapacity*2 : 16;
+            VideoRecordIndexEntry* entries = (VideoRecordIndexEntry*)realloc(writer->pendingEntries,
+                                                                             capacity*sizeof(VideoRecordIndexEntry));
+            if (!entries) {
+                writer->statistics.errorCount++;
+                return -1;
+            }
+            writer->pendingEntries = entries;
+            writer->pendingCapacity = capacity;
+        }
+        
+        VideoRecordIndexEntry* entry = &writer->pendingEntries[writer->pendingCount++];
+        entry->offset = offset;
+        entry->pts = pts;
+        entry->timeTag = timeTag;
+        entry->uuid = uuid;
+        entry->size = size;
+        writer->statistics.keyframeCount++;
+    }
+    
+    if (0 != appendBytes(writer, (const uint8_t*)&header, sizeof(header))
+        || 0 != appendBytes(writer, (const uint8_t*)payload, size)
+        || 0 != appendBytes(writer, NULL, padding)) {
+        return -1;
+    }
+    writer->statistics.recordCount++;
+    
+    if (!writer->lastFlushTime) {
+        writer->lastFlushTime = timeTag;
+    }
+    else if (writer->flushInterval && timeTag - writer->lastFlushTime >= writer->flushInterval) {
+        writer->lastFlushTime = timeTag;
+        return videoRecordWriterFlush(writer);
+    }
+    return 0;
+}
+
+int videoRecordWriterFlush(VideoRecordWriter* writer){
+    if (writer->dataFd < 0) {
+        return 0;
+    }
+    
+    if (writer->bufferUsed == 0) {
+        return writePendingEntries(writer) == 0 ? 0 : failSegment(writer);
+    }
+    
+    //the zeros read as a padding record, the buffer is a whole number of pages so they fit
+    size_t size = ALIGN_UP(writer->bufferUsed, VIDEO_RECORD_PAGE_SIZE);
+    memset(writer->buffer + writer->bufferUsed, 0, size - writer->bufferUsed);
+    return writeBuffer(writer, size);
+}
+
+void videoRecordWriterClose(VideoRecordWriter* writer){
+    if (writer->buffer) {
+        videoRecordWriterFlush(writer);
+    }
+    closeSegmentFiles(writer);
+    
+    free(writer->buffer);
+    writer->buffer = NULL;
+    free(writer->pendingEntries);
+    writer->pendingEntries = NULL;
+    writer->pendingCount = 0;
+    writer->pendingCapacity = 0;
+}
+
+//map a whole file read only
+static const uint8_t* mapFile(const char* path, size_t* size){
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    
+    struct stat info;
+    void* data = MAP_FAILED;
+    if (0 == fstat(fd, &info) && info.st_size > 0) {
+        data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+    *size = (size_t)info.st_size;
+    return (const uint8_t*)data;
+}
+
+int videoRecordSegmentOpen(VideoRecordSegment* segment, const char* path){
+    memset(segment, 0, sizeof(VideoRecordSegment));
+    segment->data = mapFile(path, &segment->size);
+    if (!segment->data) {
+        return -1;
+    }
+    
+    const VideoRecordSegmentHeader* header = (const VideoRecordSegmentHeader*)segment->data;
+    if (segment->size < VIDEO_RECORD_PAGE_SIZE || memcmp(header->magic, segmentMagic, sizeof(segmentMagic))
+        || header->version != VIDEO_RECORD_VERSION || header->pageSize != VIDEO_RECORD_PAGE_SIZE) {
+        videoRecordSegmentClose(segment);
+        return -1;
+    }
+    segment->segmentNumber = header->segmentNumber;
+    return 0;
+}
+
+void videoRecordSegmentClose(VideoRecordSegment* segment){
+    if (segment->data) {
+        munmap((void*)segment->data, segment->size);
+    }
+    segment->data = NULL;
+    segment->size = 0;
+}
+
+const uint8_t* videoRecordSegmentRead(const VideoRecordSegment* segment, uint64_t* offset, uint32_t* size, uint32_t* flags){
+    uint64_t position = *offset < VIDEO_RECORD_PAGE_SIZE ? VIDEO_RECORD_PAGE_SIZE : *offset;
+    
+    while (position + sizeof(VideoRecordHeader) <= segment->size) {
+        const VideoRecordHeader* header = (const VideoRecordHeader*)(segment->data + position);
+        if (header->size == 0) {
+            position = (position/VIDEO_RECORD_PAGE_SIZE + 1)*VIDEO_RECORD_PAGE_SIZE;
+            continue;
+        }
+        
+        if (position + sizeof(VideoRecordHeader) + header->size > segment->size) {
+            //cut short, the recording stopped in the middle of a write
+            break;
+        }
+        
+        *size = header->size;
+        if (flags) {
+            *flags = header->flags;
+        }
+        *offset = position + ALIGN_UP(sizeof(VideoRecordHeader) + header->size, 8);
+        return segment->data + position + sizeof(VideoRecordHeader);
+    }
+    
+    *offset = segment->size;
+    return NULL;
+}
+
+int videoRecordIndexOpen(VideoRecordIndex* index, const char* path){
+    memset(index, 0, sizeof(VideoRecordIndex));
+    index->data = mapFile(path, &index->size);
+    if (!index->data) {
+        return -1;
+    }
+    
+    const VideoRecordIndexHeader* header = (const VideoRecordIndexHeader*)index->data;
+    if (index->size < sizeof(VideoRecordIndexHeader) || memcmp(header->magic, indexMagic, sizeof(indexMagic))
+        || header->version != VIDEO_RECORD_VERSION || header->entrySize != sizeof(VideoRecordIndexEntry)) {
+        videoRecordIndexClose(index);
+        return -1;
+    }
+    
+    index->segmentNumber = header->segmentNumber;
+    index->entries = (const VideoRecordIndexEntry*)(index->data + sizeof(VideoRecordIndexHeader));
+    index->count = (index->size - sizeof(VideoRecordIndexHeader))/sizeof(VideoRecordIndexEntry);
+    return 0;
+}
+
+void videoRecordIndexClose(VideoRecordIndex* index){
+    if (index->data) {
+        munmap((void*)index->data, index->size);
+    }
+    memset(index, 0, sizeof(VideoRecordIndex));
+}
+
+const VideoRecordIndexEntry* videoRecordIndexSeek(const VideoRecordIndex* index, uint64_t timeTag){
+    size_t low = 0;
+    size_t high = index->count;
+    while (low < high) {
+        size_t middle = (low + high)/2;
+        if (index->entries[middle].timeTag <= timeTag) {
+            low = middle + 1;
+        }else{
+            high = middle;
+        }
+    }
+    return low ? &index->entries[low - 1] : NULL;
+}
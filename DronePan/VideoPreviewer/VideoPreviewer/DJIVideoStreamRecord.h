@@ -0,0 +1,183 @@
+//
+//  DJIVideoStreamRecord.h
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#ifndef DJI_VIDEO_STREAM_RECORD_H
+#define DJI_VIDEO_STREAM_RECORD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <limits.h>
+
+/*
+ *  Segmented, append-only container of the raw stream. Plain C and POSIX only, so recordings are read by the same
+ *  code on a desktop.
+ *
+ *  A segment `<prefix>_<number>.vrec` is a page with a VideoRecordSegmentHeader followed by records. A record is a
+ *  VideoRecordHeader and its payload, padded to 8 bytes. A record header of size 0 pads to the next page, the writer
+ *  writes whole pages only. A new segment starts at a keyframe once the segment reaches its size limit.
+ *
+ *  The index `<prefix>_<number>.vidx` is a VideoRecordIndexHeader followed by a VideoRecordIndexEntry for every
+ *  keyframe of the segment. An entry is written once the record it points to is on disk.
+ */
+
+#define VIDEO_RECORD_PAGE_SIZE (4096)
+#define VIDEO_RECORD_VERSION (1)
+#define VIDEO_RECORD_SEGMENT_EXTENSION "vrec"
+#define VIDEO_RECORD_INDEX_EXTENSION "vidx"
+
+//record flags
+#define VIDEO_RECORD_FLAG_KEYFRAME (1)
+
+typedef struct{
+    char magic[8]; //"DJIVREC1"
+    uint32_t version;
+    uint32_t pageSize;
+    uint32_t segmentNumber;
+    uint32_t reserved;
+} VideoRecordSegmentHeader;
+
+typedef struct{
+    uint32_t size; //size of the payload, 0 for padding to the next page
+    uint32_t flags;
+} VideoRecordHeader;
+
+typedef struct{
+    char magic[8]; //"DJIVIDX1"
+    uint32_t version;
+    uint32_t segmentNumber;
+    uint32_t entrySize;
+    uint32_t reserved;
+} VideoRecordIndexHeader;
+
+typedef struct{
+    uint64_t offset; //offset of the record header in the segment
+    uint64_t pts;
+    uint64_t timeTag;
+    uint32_t uuid;
+    uint32_t size;
+} VideoRecordIndexEntry;
+
+typedef struct{
+    uint64_t recordCount;
+    uint64_t keyframeCount;
+    uint64_t bytesWritten;
+    uint64_t writeCount;
+    uint32_t segmentCount;
+    uint32_t errorCount;
+} VideoRecordStatistics;
+
+typedef struct{
+    char directory[PATH_MAX];
+    char prefix[64];
+    size_t maxSegmentBytes;
+    uint64_t flushInterval;
+    
+    int dataFd;
+    int indexFd;
+    uint32_t segmentNumber;
+    //offset in the segment of the first byte of the buffer, always a whole number of pages
+    uint64_t bufferOffset;
+    uint64_t lastFlushTime;
+    
+    //page aligned, written in whole buffers except on flush
+    uint8_t* buffer;
+    size_t bufferSize;
+    size_t bufferUsed;
+    
+    //keyframes whose records are not on disk yet
+    VideoRecordIndexEntry* pendingEntries;
+    int pendingCount;
+    int pendingCapacity;
+    
+    VideoRecordStatistics statistics;
+} VideoRecordWriter;
+
+/**
+ *  @param writer the writer.
+ *  @param directory existing directory of the segments.
+ *  @param prefix name of the recording, the segments are numbered after it.
+ *  @param bufferSize bytes gathered before a write, rounded up to whole pages.
+ *  @param maxSegmentBytes a segment ends at the first keyframe after this size.
+ *  @param flushInterval longest time in microseconds of the record times between two writes, 0 to write full
+ *  buffers only.
+ *
+ *  @return `0` on success.
+ */
+int videoRecordWriterOpen(VideoRecordWriter* writer, const char* directory, const char* prefix, size_t bufferSize,
+                          size_t maxSegmentBytes, uint64_t flushInterval);
+
+/**
+ *  Append a record. The buffer is written when it is full or the flush interval has passed.
+ *
+ *  @param keyframe the record starts a gop, it is indexed and may start a segment.
+ *  @param timeTag time of the record, also drives the flush interval.
+ *
+ *  @return `0` on success, `-1` on a write error, the writer keeps going with the next segment.
+ */
+int videoRecordWriterAppend(VideoRecordWriter* writer, const void* payload, uint32_t size, int keyframe,
+                            uint64_t pts, uint64_t timeTag, uint32_t uuid);
+
+/**
+ *  Pad the buffer to a page and write it with the pending index entries.
+ */
+int videoRecordWriterFlush(VideoRecordWriter* writer);
+
+/**
+ *  Flush and close the segment, the writer is released.
+ */
+void videoRecordWriterClose(VideoRecordWriter* writer);
+
+/**
+ *  Path of a segment or its index.
+ */
+int videoRecordPath(char* path, size_t size, const char* directory, const char* prefix, uint32_t segmentNumber,
+                    const char* extension);
+
+typedef struct{
+    const uint8_t* data;
+    size_t size;
+    uint32_t segmentNumber;
+} VideoRecordSegment;
+
+/**
+ *  Map a segment read only.
+ *
+ *  @return `0` on success, `-1` when the file is missing or not a segment.
+ */
+int videoRecordSegmentOpen(VideoRecordSegment* segment, const char* path);
+void videoRecordSegmentClose(VideoRecordSegment* segment);
+
+/**
+ *  The record at `offset`, padding is skipped. Start with offset 0 to read from the first record.
+ *
+ *  @param offset In the offset to read at, out the offset of the next record.
+ *  @param size Out size of the payload.
+ *  @param flags Out flags of the record, may be NULL.
+ *
+ *  @return the payload in the mapping, NULL at the end of the segment or on a truncated record.
+ */
+const uint8_t* videoRecordSegmentRead(const VideoRecordSegment* segment, uint64_t* offset, uint32_t* size, uint32_t* flags);
+
+typedef struct{
+    const VideoRecordIndexEntry* entries;
+    size_t count;
+    uint32_t segmentNumber;
+    
+    const uint8_t* data;
+    size_t size;
+} VideoRecordIndex;
+
+int videoRecordIndexOpen(VideoRecordIndex* index, const char* path);
+void videoRecordIndexClose(VideoRecordIndex* index);
+
+/**
+ *  The last keyframe at or before `timeTag`, where decoding starts to show that time.
+ *
+ *  @return the entry, NULL when the segment has no keyframe that early.
+ */
+const VideoRecordIndexEntry* videoRecordIndexSeek(const VideoRecordIndex* index, uint64_t timeTag);
+
+#endif
@@ -0,0 +1,63 @@
+//
+//  DJIVideoStreamRecorder.h
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "DJIStreamCommon.h"
+#import "DJIVideoStreamRecord.h"
+
+//bytes gathered before a write
+#define VIDEO_STREAM_RECORDER_BUFFER_SIZE (256*1024)
+//a segment ends at the first keyframe after this size
+#define VIDEO_STREAM_RECORDER_SEGMENT_SIZE (64*1024*1024)
+//longest stretch of the stream, in microseconds, held in memory before a write
+#define VIDEO_STREAM_RECORDER_FLUSH_INTERVAL (1000*1000)
+//frames that may wait for the disk, about 4 seconds of stream at 30 fps
+#define VIDEO_STREAM_RECORDER_QUEUE_DEPTH (120)
+
+/**
+ *  Consume processor recording the exact frames of the stream, each VideoFrameH264Raw with its header, to the
+ *  segmented container of DJIVideoStreamRecord.h. It runs on a stream worker, the decode thread never waits for the
+ *  disk. When the disk falls behind, the frames are dropped up to the next keyframe.
+ */
+@interface DJIVideoStreamRecorder : NSObject <VideoStreamProcessor>
+
+/**
+ *  @param directory directory of the recordings, created when missing.
+ */
+-(instancetype) initWithDirectory:(NSString*)directory;
+
+/**
+ *  `VideoStreamRecords` in the documents of the app.
+ */
++(NSString*) defaultDirectory;
+
+@property (nonatomic, readonly) NSString* directory;
+
+/**
+ *  Start a recording named after the current date, the segments are `<name>_<number>.vrec`.
+ *
+ *  @return `NO` when the first segment could not be created.
+ */
+-(BOOL) startRecording;
+
+/**
+ *  Write what is still buffered and close the recording.
+ */
+-(void) stopRecording;
+
+@property (atomic, readonly) BOOL recording;
+
+/**
+ *  Name of the current or last recording, nil before the first one.
+ */
+@property (atomic, readonly) NSString* recordingName;
+
+/**
+ *  Statistics of the current or last recording.
+ */
+@property (atomic, readonly) VideoRecordStatistics statistics;
+
+@end
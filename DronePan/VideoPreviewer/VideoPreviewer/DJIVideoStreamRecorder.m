@@ -0,0 +1,123 @@
+//
+//  DJIVideoStreamRecorder.m
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import "DJIVideoStreamRecorder.h"
+
+#define VIDEO_STREAM_RECORDER_DIRECTORY @"VideoStreamRecords"
+
+@interface DJIVideoStreamRecorder (){
+    //used under @synchronized (self), frames arrive on the worker queue
+    VideoRecordWriter _writer;
+}
+@property (atomic, assign) BOOL recording;
+@property (atomic, copy) NSString* recordingName;
+@property (atomic, assign) VideoRecordStatistics statistics;
+@end
+
+@implementation DJIVideoStreamRecorder
+
++(NSString*) defaultDirectory{
+    NSArray *paths = NSSearchPathForDirectoriesInDomains(NSDocumentDirectory, NSUserDomainMask, YES);
+    return [(NSString*)[paths objectAtIndex:0] stringByAppendingPathComponent:VIDEO_STREAM_RECORDER_DIRECTORY];
+}
+
+-(instancetype) initWithDirectory:(NSString*)directory{
+    self = [super init];
+    if (self) {
+        _directory = [directory copy];
+        memset(&_writer, 0, sizeof(_writer));
+    }
+    return self;
+}
+
+-(void) dealloc{
+    [self stopRecording];
+}
+
+-(BOOL) startRecording{
+    [[NSFileManager defaultManager] createDirectoryAtPath:_directory withIntermediateDirectories:YES attributes:nil error:nil];
+    
+    NSDateFormatter* formatter = [[NSDateFormatter alloc] init];
+    formatter.dateFormat = @"yyyyMMdd_HHmmss";
+    formatter.locale = [NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"];
+    NSString* name = [formatter stringFromDate:[NSDate date]];
+    
+    @synchronized (self) {
+        if (self.recording) {
+            videoRecordWriterClose(&_writer);
+            self.recording = NO;
+        }
+        
+        if (0 != videoRecordWriterOpen(&_writer, _directory.fileSystemRepresentation, name.UTF8String,
+                                       VIDEO_STREAM_RECORDER_BUFFER_SIZE, VIDEO_STREAM_RECORDER_SEGMENT_SIZE,
+                                       VIDEO_STREAM_RECORDER_FLUSH_INTERVAL)) {
+            NSLog(@"stream recorder can't create %@ in %@", name, _directory);
+            return NO;
+        }
+        
+        self.recordingName = name;
+        self.statistics = _writer.statistics;
+        self.recording = YES;
+    }
+    return YES;
+}
+
+-(void) stopRecording{
+    @synchronized (self) {
+        if (!self.recording) {
+            return;
+        }
+        
+        self.recording = NO;
+        videoRecordWriterClose(&_writer);
+        self.statistics = _writer.statistics;
+    }
+}
+
+#pragma mark - stream processor
+
+-(BOOL) streamProcessorEnabled{
+    return self.recording;
+}
+
+-(DJIVideoStreamProcessorType) streamProcessorType{
+    return DJIVideoStreamProcessorType_Consume;
+}
+
+-(NSUInteger) streamProcessorQueueDepth{
+    return VIDEO_STREAM_RECORDER_QUEUE_DEPTH;
+}
+
+-(BOOL) streamProcessorHandleFrameRaw:(VideoFrameH264Raw*)frame{
+    @synchronized (self) {
+        if (self.recording) {
+            BOOL keyframe = frame->frame_info.frame_flag.has_idr || frame->frame_info.frame_flag.has_sps;
+            videoRecordWriterAppend(&_writer, frame, (uint32_t)(sizeof(VideoFrameH264Raw) + frame->frame_size),
+                                    keyframe, frame->pts, frame->time_tag, frame->frame_uuid);
+            self.statistics = _writer.statistics;
+        }
+    }
+    
+    //the frame is copied into the write buffer
+    free(frame);
+    return YES;
+}
+
+-(void) streamProcessorPause{
+    //the stream may stop here for a while, write what it left behind
+    @synchronized (self) {
+        if (self.recording) {
+            videoRecordWriterFlush(&_writer);
+            self.statistics = _writer.statistics;
+        }
+    }
+}
+
+-(void) streamProcessorReset{
+    [self streamProcessorPause];
+}
+
+@end
@@ -0,0 +1,309 @@
+//
+//  DJIVideoStreamReplay.c
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#include "DJIVideoStreamReplay.h"
+#include "DJIVideoFrameRaw.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#define FNV_OFFSET_BASIS (2166136261u)
+#define FNV_PRIME (16777619u)
+
+//longest sleep between two checks of a cancel
+#define REPLAY_WAIT_SLICE (10*1000)
+
+static uint64_t wallTime(void){
+    struct timeval t;
+    gettimeofday(&t, NULL);
+    return (uint64_t)t.tv_sec*1000000 + t.tv_usec;
+}
+
+static uint32_t checksum(uint32_t hash, const uint8_t* data, size_t size){
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i])*FNV_PRIME;
+    }
+    return hash;
+}
+
+static int reserveChunk(VideoReplay* replay, size_t capacity){
+    if (capacity <= replay->chunkCapacity) {
+        return 0;
+    }
+    
+    uint8_t* chunk = (uint8_t*)realloc(replay->chunk, capacity);
+    if (!chunk) {
+        return -1;
+    }
+    replay->chunk = chunk;
+    replay->chunkCapacity = capacity;
+    return 0;
+}
+
+static void prepare(VideoReplay* replay, const VideoReplayOptions* options){
+    memset(replay, 0, sizeof(VideoReplay));
+    if (options) {
+        replay->options = *options;
+    }
+    if (replay->options.speed <= 0) {
+        replay->options.speed = 1;
+    }
+    if (replay->options.frameRate <= 0) {
+        replay->options.frameRate = VIDEO_REPLAY_DEFAULT_FRAME_RATE;
+    }
+    if (replay->options.chunkSize == 0) {
+        replay->options.chunkSize = VIDEO_RECORD_PAGE_SIZE;
+    }
+}
+
+int videoReplayOpenAnnexB(VideoReplay* replay, const char* path, const VideoReplayOptions* options){
+    prepare(replay, options);
+    
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    
+    struct stat info;
+    void* data = MAP_FAILED;
+    if (0 == fstat(fd, &info) && info.st_size > 0) {
+        data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    
+    if (data == MAP_FAILED) {
+        return -1;
+    }
+    replay->data = (const uint8_t*)data;
+    replay->size = (size_t)info.st_size;
+    return 0;
+}
+
+int videoReplayOpenRecording(VideoReplay* replay, const char* directory, const char* prefix, const VideoReplayOptions* options){
+    prepare(replay, options);
+    
+    if (strlen(directory) >= sizeof(replay->directory) || strlen(prefix) >= sizeof(replay->prefix)) {
+        return -1;
+    }
+    strcpy(replay->directory, directory);
+    strcpy(replay->prefix, prefix);
+    
+    char path[PATH_MAX];
+    return (0 == videoRecordPath(path, sizeof(path), directory, prefix, 0, VIDEO_RECORD_SEGMENT_EXTENSION)
+            && 0 == access(path, R_OK)) ? 0 : -1;
+}
+
+void videoReplayCancel(VideoReplay* replay){
+    replay->cancelled = 1;
+}
+
+void videoReplayClose(VideoReplay* replay){
+    if (replay->data) {
+        munmap((void*)replay->data, replay->size);
+    }
+    replay->data = NULL;
+    replay->size = 0;
+    
+    free(replay->chunk);
+    replay->chunk = NULL;
+    replay->chunkCapacity = 0;
+}
+
+//hand the gathered chunk to the sink once its time comes
+static int emitChunk(VideoReplay* replay, uint64_t mediaTime, VideoReplaySink sink, void* context){
+    if (replay->chunkUsed == 0) {
+        return 0;
+    }
+    
+    if (replay->options.pacing != VideoReplayPacingMaxSpeed) {
+        double speed = replay->options.pacing == VideoReplayPacingAccelerated ? replay->options.speed : 1;
+        uint64_t due = replay->startTime + (uint64_t)(mediaTime/speed);
+        
+        uint64_t now = wallTime();
+        while (now < due && !replay->cancelled) {
+            uint64_t wait = due - now;
+            usleep((useconds_t)(wait < REPLAY_WAIT_SLICE ? wait : REPLAY_WAIT_SLICE));
+            now = wallTime();
+        }
+        if (now > due && now - due > replay->statistics.maxLateness) {
+            replay->statistics.maxLateness = now - due;
+        }
+    }
+    
+    if (replay->cancelled) {
+        return 1;
+    }
+    
+    uint64_t size = replay->chunkUsed;
+    replay->statistics.checksum = checksum(replay->statistics.checksum, (const uint8_t*)&size, sizeof(size));
+    replay->statistics.checksum = checksum(replay->statistics.checksum, replay->chunk, replay->chunkUsed);
+    replay->statistics.chunkCount++;
+    replay->statistics.byteCount += replay->chunkUsed;
+    
+    sink(context, replay->chunk, replay->chunkUsed, mediaTime);
+    replay->chunkUsed = 0;
+    return 0;
+}
+
+static int handleUnit(VideoReplay* replay, const uint8_t* data, size_t size, uint64_t time, VideoReplaySink sink, void* context){
+    if (!replay->started) {
+        replay->started = 1;
+        replay->firstTime = time;
+    }
+    
+    //a capture time before the first one, a wrapped clock for example, is replayed at once
+    uint64_t mediaTime = time > replay->firstTime ? time - replay->firstTime : 0;
+    if (mediaTime > replay->statistics.mediaDuration) {
+        replay->statistics.mediaDuration = mediaTime;
+    }
+    replay->statistics.unitCount++;
+    
+    if (replay->options.chunking == VideoReplayChunkingOriginal) {
+        if (0 != reserveChunk(replay, size)) {
+            return -1;
+        }
+        memcpy(replay->chunk, data, size);
+        replay->chunkUsed = size;
+        return emitChunk(replay, mediaTime, sink, context);
+    }
+    
+    //a chunk leaves when it is full, at the time of the unit that filled it
+    while (size) {
+        size_t count = replay->options.chunkSize - replay->chunkUsed;
+        if (count > size) {
+            count = size;
+        }
+        memcpy(replay->chunk + replay->chunkUsed, data, count);
+        replay->chunkUsed += count;
+        data += count;
+        size -= count;
+        
+        if (replay->chunkUsed == replay->options.chunkSize) {
+            int result = emitChunk(replay, mediaTime, sink, context);
+            if (result != 0) {
+                return result;
+            }
+        }
+    }
+    return 0;
+}
+
+static size_t findStartCode(const uint8_t* data, size_t size, size_t from){
+    for (size_t i = from; i + 3 <= size; i++) {
+        if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1) {
+            return i;
+        }
+    }
+    return size;
+}
+
+//end of the access unit starting at `start`: the next delimiter, parameter set or SEI after a slice, or the next slice
+//with first_mb_in_slice 0, whose header starts with a set bit
+static size_t accessUnitEnd(const uint8_t* data, size_t size, size_t start){
+    int seenSlice = 0;
+    size_t i = start;
+    
+    while ((i = findStartCode(data, size, i)) + 3 < size) {
+        size_t begin = (i > start && data[i - 1] == 0) ? i - 1 : i;
+        int type = data[i + 3] & 0x1f;
+        int slice = type == 1 || type == 5;
+        
+        if (seenSlice && begin > start) {
+            if (type == 6 || type == 7 || type == 8 || type == 9) {
+                return begin;
+            }
+            if (slice && i + 4 < size && (data[i + 4] & 0x80)) {
+                return begin;
+            }
+        }
+        
+        seenSlice |= slice;
+        i += 3;
+    }
+    return size;
+}
+
+static int runAnnexB(VideoReplay* replay, VideoReplaySink sink, void* context){
+    size_t start = 0;
+    uint64_t index = 0;
+    
+    while (start < replay->size) {
+        size_t end = accessUnitEnd(replay->data, replay->size, start);
+        uint64_t time = (uint64_t)(index*1000000/replay->options.frameRate);
+        
+        int result = handleUnit(replay, replay->data + start, end - start, time, sink, context);
+        if (result != 0) {
+            return result;
+        }
+        start = end;
+        index++;
+    }
+    return 0;
+}
+
+static int runRecording(VideoReplay* replay, VideoReplaySink sink, void* context){
+    char path[PATH_MAX];
+    
+    for (uint32_t number = 0; ; number++) {
+        VideoRecordSegment segment;
+        if (0 != videoRecordPath(path, sizeof(path), replay->directory, replay->prefix, number, VIDEO_RECORD_SEGMENT_EXTENSION)
+            || 0 != videoRecordSegmentOpen(&segment, path)) {
+            //the first missing segment ends the recording
+            return number == 0 ? -1 : 0;
+        }
+        
+        uint64_t offset = 0;
+        uint32_t size = 0;
+        const uint8_t* payload = NULL;
+        int result = 0;
+        
+        while (result == 0 && (payload = videoRecordSegmentRead(&segment, &offset, &size, NULL))) {
+            const VideoFrameH264Raw* frame = (const VideoFrameH264Raw*)payload;
+            if (size < sizeof(VideoFrameH264Raw) || frame->frame_size > size - sizeof(VideoFrameH264Raw)) {
+                continue;
+            }
+            result = handleUnit(replay, payload + sizeof(VideoFrameH264Raw), frame->frame_size, frame->time_tag, sink, context);
+        }
+        
+        videoRecordSegmentClose(&segment);
+        if (result != 0) {
+            return result;
+        }
+    }
+}
+
+int videoReplayRun(VideoReplay* replay, VideoReplaySink sink, void* context){
+    if (!sink) {
+        return -1;
+    }
+    
+    memset(&replay->statistics, 0, sizeof(replay->statistics));
+    replay->statistics.checksum = FNV_OFFSET_BASIS;
+    replay->started = 0;
+    replay->chunkUsed = 0;
+    replay->cancelled = 0;
+    
+    if (replay->options.chunking == VideoReplayChunkingFixed && 0 != reserveChunk(replay, replay->options.chunkSize)) {
+        return -1;
+    }
+    
+    replay->startTime = wallTime();
+    int result = replay->data ? runAnnexB(replay, sink, context) : runRecording(replay, sink, context);
+    
+    //what is left of the last fixed chunk
+    if (result == 0) {
+        result = emitChunk(replay, replay->statistics.mediaDuration, sink, context);
+    }
+    
+    replay->statistics.wallDuration = wallTime() - replay->startTime;
+    return result;
+}
@@ -0,0 +1,118 @@
+//
+//  DJIVideoStreamReplay.h
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#ifndef DJI_VIDEO_STREAM_REPLAY_H
+#define DJI_VIDEO_STREAM_REPLAY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <limits.h>
+#include "DJIVideoStreamRecord.h"
+
+/*
+ *  Replays a capture into the stream input, an Annex B file or a recording of DJIVideoStreamRecorder. Plain C and
+ *  POSIX only like the recording container, so the same replay drives benchmarks on a desktop.
+ *
+ *  The chunks handed to the sink depend only on the capture and the chunking, never on the pacing or the machine,
+ *  so two replays of the same capture push the same bytes in the same pieces.
+ */
+
+//frame rate of an Annex B file, which carries no timing
+#define VIDEO_REPLAY_DEFAULT_FRAME_RATE (30.0)
+
+typedef enum{
+    VideoReplayPacingRealTime = 0, //the chunks arrive at their recorded times
+    VideoReplayPacingAccelerated, //`speed` times faster than recorded
+    VideoReplayPacingMaxSpeed, //as fast as the sink takes them
+} VideoReplayPacing;
+
+typedef enum{
+    VideoReplayChunkingOriginal = 0, //one chunk per recorded frame, or per access unit of an Annex B file
+    VideoReplayChunkingFixed, //the stream cut into chunks of `chunkSize`
+} VideoReplayChunking;
+
+typedef struct{
+    VideoReplayPacing pacing;
+    double speed;
+    VideoReplayChunking chunking;
+    size_t chunkSize;
+    //timing of an Annex B file, VIDEO_REPLAY_DEFAULT_FRAME_RATE when 0
+    double frameRate;
+} VideoReplayOptions;
+
+typedef struct{
+    //the same for every replay of a capture with the same chunking
+    uint64_t unitCount; //frames of a recording or access units of an Annex B file
+    uint64_t chunkCount;
+    uint64_t byteCount;
+    uint64_t mediaDuration; //microseconds from the first to the last unit
+    uint32_t checksum; //FNV-1a of the chunks and their sizes
+    
+    //wall clock, depends on the machine
+    uint64_t wallDuration;
+    uint64_t maxLateness; //longest delay of a chunk behind its time, in microseconds
+} VideoReplayStatistics;
+
+/**
+ *  Receives the chunks in order on the thread of `videoReplayRun`. The chunk may be modified, it is only valid during
+ *  the call.
+ *
+ *  @param mediaTime time of the chunk in the capture, in microseconds from the first unit.
+ */
+typedef void (*VideoReplaySink)(void* context, uint8_t* data, size_t size, uint64_t mediaTime);
+
+typedef struct{
+    VideoReplayOptions options;
+    
+    //Annex B file, mapped read only
+    const uint8_t* data;
+    size_t size;
+    
+    //recording
+    char directory[PATH_MAX];
+    char prefix[64];
+    
+    //copy handed to the sink
+    uint8_t* chunk;
+    size_t chunkCapacity;
+    size_t chunkUsed;
+    
+    //capture time of the first unit and wall time of the start
+    uint64_t firstTime;
+    int started;
+    uint64_t startTime;
+    volatile int cancelled;
+    VideoReplayStatistics statistics;
+} VideoReplay;
+
+/**
+ *  @return `0` on success, `-1` when the file can not be mapped.
+ */
+int videoReplayOpenAnnexB(VideoReplay* replay, const char* path, const VideoReplayOptions* options);
+
+/**
+ *  @param directory directory of the recording.
+ *  @param prefix name of the recording, its segments are read from number 0 on.
+ *
+ *  @return `0` on success, `-1` when the first segment is missing.
+ */
+int videoReplayOpenRecording(VideoReplay* replay, const char* directory, const char* prefix, const VideoReplayOptions* options);
+
+/**
+ *  Replay the whole capture into the sink, blocks until the end or a cancel. The statistics start over.
+ *
+ *  @return `0` at the end of the capture, `1` when cancelled, `-1` on an error.
+ */
+int videoReplayRun(VideoReplay* replay, VideoReplaySink sink, void* context);
+
+/**
+ *  Stop a replay running on another thread after its current chunk.
+ */
+void videoReplayCancel(VideoReplay* replay);
+
+void videoReplayClose(VideoReplay* replay);
+
+#endif
@@ -0,0 +1,64 @@
+//
+//  DJIVideoStreamReplayer.h
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "DJIVideoStreamReplay.h"
+
+//frames a previewer may hold before an accelerated replay waits, the previewer drops its queue beyond 30
+#define VIDEO_REPLAY_MAX_QUEUED_FRAMES (8)
+
+@class VideoPreviewer;
+
+/**
+ *  Replays a capture into a previewer as if the aircraft were sending it, for regression tests and benchmarks
+ *  without an aircraft. An accelerated or max speed replay waits for the decoder instead of letting the previewer
+ *  drop frames, so the same capture decodes the same frames on every run.
+ */
+@interface DJIVideoStreamReplayer : NSObject
+
+/**
+ *  @return nil when the file can not be read.
+ */
+-(instancetype) initWithAnnexBFile:(NSString*)path options:(VideoReplayOptions)options;
+
+/**
+ *  @param name name of a recording of DJIVideoStreamRecorder.
+ *  @param directory directory of the recording.
+ *
+ *  @return nil when the recording has no segment.
+ */
+-(instancetype) initWithRecording:(NSString*)name directory:(NSString*)directory options:(VideoReplayOptions)options;
+
+/**
+ *  Replay into a handler on the calling thread, blocks until the end.
+ *
+ *  @return `NO` when cancelled or on a read error.
+ */
+-(BOOL) replayWithHandler:(void(^)(uint8_t* data, int size))handler;
+
+/**
+ *  Replay into `-[VideoPreviewer push:length:]` on the calling thread, blocks until the end.
+ */
+-(BOOL) replayIntoPreviewer:(VideoPreviewer*)previewer;
+
+/**
+ *  Replay into the previewer on a queue of the replayer.
+ *
+ *  @param completion called on the queue of the replayer, `finished` is NO when cancelled.
+ */
+-(void) replayIntoPreviewer:(VideoPreviewer*)previewer completion:(void(^)(BOOL finished))completion;
+
+/**
+ *  Stop the replay after its current chunk.
+ */
+-(void) cancel;
+
+/**
+ *  Statistics of the current or last replay.
+ */
+@property (nonatomic, readonly) VideoReplayStatistics statistics;
+
+@end
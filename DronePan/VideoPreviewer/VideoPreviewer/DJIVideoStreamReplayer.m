@@ -0,0 +1,87 @@
+//
+//  DJIVideoStreamReplayer.m
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import "DJIVideoStreamReplayer.h"
+#import "VideoPreviewer.h"
+
+static void replayHandlerSink(void* context, uint8_t* data, size_t size, uint64_t mediaTime){
+    void(^handler)(uint8_t*, int) = (__bridge void(^)(uint8_t*, int))context;
+    handler(data, (int)size);
+}
+
+@interface DJIVideoStreamReplayer (){
+    VideoReplay _replay;
+    dispatch_queue_t _replayQueue;
+}
+@end
+
+@implementation DJIVideoStreamReplayer
+
+-(instancetype) initWithAnnexBFile:(NSString*)path options:(VideoReplayOptions)options{
+    self = [super init];
+    if (self) {
+        if (0 != videoReplayOpenAnnexB(&_replay, path.fileSystemRepresentation, &options)) {
+            return nil;
+        }
+        _replayQueue = dispatch_queue_create("video_stream_replay_queue", DISPATCH_QUEUE_SERIAL);
+    }
+    return self;
+}
+
+-(instancetype) initWithRecording:(NSString*)name directory:(NSString*)directory options:(VideoReplayOptions)options{
+    self = [super init];
+    if (self) {
+        if (0 != videoReplayOpenRecording(&_replay, directory.fileSystemRepresentation, name.UTF8String, &options)) {
+            return nil;
+        }
+        _replayQueue = dispatch_queue_create("video_stream_replay_queue", DISPATCH_QUEUE_SERIAL);
+    }
+    return self;
+}
+
+-(void) dealloc{
+    videoReplayClose(&_replay);
+}
+
+-(BOOL) replayWithHandler:(void(^)(uint8_t* data, int size))handler{
+    if (!handler) {
+        return NO;
+    }
+    
+    return 0 == videoReplayRun(&_replay, replayHandlerSink, (__bridge void*)handler);
+}
+
+-(BOOL) replayIntoPreviewer:(VideoPreviewer*)previewer{
+    BOOL paced = _replay.options.pacing == VideoReplayPacingRealTime;
+    VideoReplay* replay = &_replay;
+    
+    return [self replayWithHandler:^(uint8_t *data, int size) {
+        //ahead of time, the decoder sets the pace
+        while (!paced && previewer.dataQueue.count >= VIDEO_REPLAY_MAX_QUEUED_FRAMES && !replay->cancelled) {
+            usleep(1000);
+        }
+        [previewer push:data length:size];
+    }];
+}
+
+-(void) replayIntoPreviewer:(VideoPreviewer*)previewer completion:(void(^)(BOOL finished))completion{
+    dispatch_async(_replayQueue, ^{
+        BOOL finished = [self replayIntoPreviewer:previewer];
+        if (completion) {
+            completion(finished);
+        }
+    });
+}
+
+-(void) cancel{
+    videoReplayCancel(&_replay);
+}
+
+-(VideoReplayStatistics) statistics{
+    return _replay.statistics;
+}
+
+@end
@@ -0,0 +1,75 @@
+//
+//  DJIVideoStreamTracker.h
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "DJIVideoStatistics.h"
+
+//largest parameter set kept, with its start code
+#define VIDEO_STREAM_TRACKER_MAX_PARAMETER_SET (256)
+
+/**
+ *  Follows a raw H.264 stream without parsing or decoding it, only the NAL unit types are read. It keeps the
+ *  stream from the start of the latest keyframe, an access unit with SPS or IDR, and the latest parameter sets, so
+ *  decoding can restart from that keyframe instead of waiting for the next one.
+ */
+typedef struct{
+    uint8_t* buffer;
+    size_t size;
+    size_t capacity;
+    size_t maxBytes;
+    
+    //the buffer starts with the access unit of a keyframe
+    BOOL hasKeyframe;
+    //the keyframe brought its own SPS
+    BOOL keyframeHasSps;
+    
+    //bytes of the buffer searched for start codes
+    size_t scanned;
+    //start code of the NAL unit being read, -1 before the first one
+    long nalStart;
+    int nalType;
+    //first NAL unit of the access unit being read
+    size_t accessUnitStart;
+    BOOL accessUnitIsKeyframe;
+    BOOL accessUnitHasSps;
+    
+    uint8_t sps[VIDEO_STREAM_TRACKER_MAX_PARAMETER_SET];
+    int spsSize;
+    uint8_t pps[VIDEO_STREAM_TRACKER_MAX_PARAMETER_SET];
+    int ppsSize;
+    
+    VideoStreamTrackerStatistics statistics;
+} VideoStreamTracker;
+
+/**
+ *  @param tracker the tracker.
+ *  @param maxBytes largest stream kept after a keyframe, the keyframe is given up beyond it.
+ */
+void videoStreamTrackerInit(VideoStreamTracker* tracker, size_t maxBytes);
+void videoStreamTrackerRelease(VideoStreamTracker* tracker);
+
+/**
+ *  Follow the next bytes of the stream.
+ *
+ *  @return `0` on success, `-1` when the buffer could not grow, the keyframe is given up then.
+ */
+int videoStreamTrackerPush(VideoStreamTracker* tracker, const uint8_t* data, size_t size);
+
+/**
+ *  Take the stream from the latest keyframe to the last byte pushed, preceded by the latest parameter sets when the
+ *  keyframe did not bring its own. The tracker starts over and keeps only the parameter sets.
+ *
+ *  @param tracker the tracker.
+ *  @param size size of the returned stream.
+ *
+ *  @return the stream, released by the caller with free, or NULL when no keyframe was seen.
+ */
+uint8_t* videoStreamTrackerTake(VideoStreamTracker* tracker, size_t* size);
+
+/**
+ *  Forget the tracked stream, the parameter sets are kept.
+ */
+void videoStreamTrackerClear(VideoStreamTracker* tracker);
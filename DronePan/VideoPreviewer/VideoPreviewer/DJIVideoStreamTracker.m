@@ -0,0 +1,187 @@
+//
+//  DJIVideoStreamTracker.m
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import "DJIVideoStreamTracker.h"
+
+#define NAL_TYPE_SLICE (1)
+#define NAL_TYPE_IDR (5)
+#define NAL_TYPE_SEI (6)
+#define NAL_TYPE_SPS (7)
+#define NAL_TYPE_PPS (8)
+#define NAL_TYPE_AUD (9)
+
+void videoStreamTrackerInit(VideoStreamTracker* tracker, size_t maxBytes){
+    memset(tracker, 0, sizeof(VideoStreamTracker));
+    tracker->maxBytes = maxBytes;
+    tracker->nalStart = -1;
+    tracker->nalType = -1;
+}
+
+void videoStreamTrackerRelease(VideoStreamTracker* tracker){
+    free(tracker->buffer);
+    tracker->buffer = NULL;
+    tracker->size = 0;
+    tracker->capacity = 0;
+}
+
+void videoStreamTrackerClear(VideoStreamTracker* tracker){
+    tracker->size = 0;
+    tracker->scanned = 0;
+    tracker->hasKeyframe = NO;
+    tracker->keyframeHasSps = NO;
+    tracker->nalStart = -1;
+    tracker->nalType = -1;
+    tracker->accessUnitStart = 0;
+    tracker->accessUnitIsKeyframe = NO;
+    tracker->accessUnitHasSps = NO;
+}
+
+//drop the bytes before `offset`
+static void discardBefore(VideoStreamTracker* tracker, size_t offset){
+    if (offset == 0) {
+        return;
+    }
+    
+    memmove(tracker->buffer, tracker->buffer + offset, tracker->size - offset);
+    tracker->size -= offset;
+    tracker->scanned -= MIN(offset, tracker->scanned);
+    tracker->accessUnitStart -= MIN(offset, tracker->accessUnitStart);
+    if (tracker->nalStart >= 0) {
+        tracker->nalStart -= offset;
+    }
+}
+
+static void storeParameterSet(uint8_t* dst, int* dstSize, const uint8_t* src, size_t size){
+    if (size > VIDEO_STREAM_TRACKER_MAX_PARAMETER_SET) {
+        return;
+    }
+    memcpy(dst, src, size);
+    *dstSize = (int)size;
+}
+
+static BOOL isSlice(int type){
+    return type == NAL_TYPE_SLICE || type == NAL_TYPE_IDR;
+}
+
+static void scan(VideoStreamTracker* tracker){
+    uint8_t* buffer = tracker->buffer;
+    size_t i = tracker->scanned;
+    
+    while (i + 3 < tracker->size) {
+        if (buffer[i] != 0 || buffer[i + 1] != 0 || buffer[i + 2] != 1) {
+            i++;
+            continue;
+        }
+        
+        size_t begin = (i > 0 && buffer[i - 1] == 0 && (long)i - 1 > tracker->nalStart) ? i - 1 : i;
+        int type = buffer[i + 3] & 0x1f;
+        
+        //the unit before ends here
+        if (tracker->nalStart >= 0) {
+            size_t size = begin - tracker->nalStart;
+            if (tracker->nalType == NAL_TYPE_SPS) {
+                storeParameterSet(tracker->sps, &tracker->spsSize, buffer + tracker->nalStart, size);
+            }
+            else if (tracker->nalType == NAL_TYPE_PPS) {
+                storeParameterSet(tracker->pps, &tracker->ppsSize, buffer + tracker->nalStart, size);
+            }
+        }
+        
+        //a new access unit starts with a delimiter, with non slice units after a slice, or with a slice after a
+        //slice, the slices of one IDR picture stay together
+        BOOL afterSlice = isSlice(tracker->nalType);
+        BOOL newAccessUnit = tracker->nalStart < 0 || type == NAL_TYPE_AUD
+            || (afterSlice && (type == NAL_TYPE_SEI || type == NAL_TYPE_SPS || type == NAL_TYPE_PPS))
+            || (afterSlice && isSlice(type) && !(type == NAL_TYPE_IDR && tracker->nalType == NAL_TYPE_IDR));
+        if (newAccessUnit) {
+            tracker->accessUnitStart = begin;
+            tracker->accessUnitIsKeyframe = NO;
+            tracker->accessUnitHasSps = NO;
+        }
+        
+        if (type == NAL_TYPE_SPS) {
+            tracker->accessUnitHasSps = YES;
+        }
+        
+        if ((type == NAL_TYPE_SPS || type == NAL_TYPE_IDR) && !tracker->accessUnitIsKeyframe) {
+            //everything before this access unit is no longer needed
+            tracker->accessUnitIsKeyframe = YES;
+            tracker->hasKeyframe = YES;
+            tracker->keyframeHasSps = tracker->accessUnitHasSps;
+            tracker->statistics.keyframeCount++;
+            
+            size_t offset = tracker->accessUnitStart;
+            tracker->nalStart = begin;
+            tracker->scanned = i;
+            discardBefore(tracker, offset);
+            begin -= offset;
+            i -= offset;
+        }
+        tracker->nalStart = begin;
+        tracker->nalType = type;
+        i += 3;
+    }
+    
+    tracker->scanned = i;
+}
+
+int videoStreamTrackerPush(VideoStreamTracker* tracker, const uint8_t* data, size_t size){
+    if (!tracker || !data || !size) {
+        return 0;
+    }
+    
+    tracker->statistics.trackedBytes += size;
+    
+    if (tracker->size + size > tracker->capacity) {
+        size_t capacity = MAX(tracker->capacity*2, tracker->size + size);
+        uint8_t* buffer = (uint8_t*)realloc(tracker->buffer, capacity);
+        if (!buffer) {
+            videoStreamTrackerClear(tracker);
+            return -1;
+        }
+        tracker->buffer = buffer;
+        tracker->capacity = capacity;
+    }
+    
+    memcpy(tracker->buffer + tracker->size, data, size);
+    tracker->size += size;
+    scan(tracker);
+    
+    if (!tracker->hasKeyframe) {
+        //only the access unit being read may turn into a keyframe, a start code may be split over two pushes
+        size_t keep = tracker->nalStart >= 0 ? tracker->accessUnitStart : (tracker->size > 3 ? tracker->size - 3 : 0);
+        discardBefore(tracker, keep);
+    }
+    else if (tracker->size > tracker->maxBytes) {
+        //the gop is too long to replay, wait for the next keyframe
+        tracker->hasKeyframe = NO;
+        tracker->statistics.overflowCount++;
+        discardBefore(tracker, tracker->accessUnitStart);
+    }
+    return 0;
+}
+
+uint8_t* videoStreamTrackerTake(VideoStreamTracker* tracker, size_t* size){
+    *size = 0;
+    if (!tracker->hasKeyframe) {
+        videoStreamTrackerClear(tracker);
+        return NULL;
+    }
+    
+    size_t parameterSetSize = tracker->keyframeHasSps ? 0 : tracker->spsSize + tracker->ppsSize;
+    uint8_t* stream = (uint8_t*)malloc(parameterSetSize + tracker->size);
+    if (stream) {
+        if (parameterSetSize) {
+            memcpy(stream, tracker->sps, tracker->spsSize);
+            memcpy(stream + tracker->spsSize, tracker->pps, tracker->ppsSize);
+        }
+        memcpy(stream + parameterSetSize, tracker->buffer, tracker->size);
+        *size = parameterSetSize + tracker->size;
+    }
+    
+    videoStreamTrackerClear(tracker);
+    return stream;
+}
@@ -0,0 +1,64 @@
+//
+//  DJIVideoStreamWorker.h
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "DJIStreamCommon.h"
+
+@class DJIVideoProcessorCost;
+
+/**
+ *  Runs one passthrough or consume stream processor on a serial queue of its own. At most `queueDepth` frames wait
+ *  for the processor, a frame beyond that is handled by the backpressure policy, so a slow recorder delays its own
+ *  frames and not the decoder.
+ */
+@interface DJIVideoStreamWorker : NSObject
+
+/**
+ *  @param processor the processor, its queue depth and backpressure policy are read once here.
+ */
+-(id) initWithProcessor:(id<VideoStreamProcessor>)processor;
+
+@property (nonatomic, readonly) id<VideoStreamProcessor> processor;
+@property (nonatomic, readonly) NSUInteger queueDepth;
+
+//resolved policy, never DJIVideoStreamBackpressurePolicy_Default
+@property (nonatomic, readonly) DJIVideoStreamBackpressurePolicy policy;
+
+//records every call into the processor when set
+@property (atomic, strong) DJIVideoProcessorCost* cost;
+
+@property (atomic, readonly) NSUInteger handledFrameCount;
+@property (atomic, readonly) NSUInteger droppedFrameCount;
+
+/**
+ *  Queue a frame for the processor. Only the decode thread submits frames.
+ *
+ *  @param frame the frame.
+ *  @param size size of the frame with its header.
+ *  @param keyframe the frame can be decoded without the frames before it.
+ *  @param copy the worker copies the frame, otherwise it takes the frame over when it returns YES.
+ *
+ *  @return NO when the frame was dropped.
+ */
+-(BOOL) submitFrame:(VideoFrameH264Raw*)frame size:(int)size keyframe:(BOOL)keyframe copy:(BOOL)copy;
+
+/**
+ *  Pass the stream info to the processor after the frames already queued.
+ */
+-(void) submitInfoChanged:(DJIVideoStreamBasicInfo)info;
+
+-(void) submitPause;
+
+/**
+ *  Drop the frames still waiting and reset the processor on its queue.
+ */
+-(void) submitReset;
+
+/**
+ *  Block until the frames queued so far are handled.
+ */
+-(void) waitUntilIdle;
+@end
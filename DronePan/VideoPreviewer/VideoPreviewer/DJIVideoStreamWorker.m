@@ -0,0 +1,144 @@
+//
+//  DJIVideoStreamWorker.m
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import "DJIVideoStreamWorker.h"
+#import "DJIVideoProcessorCost.h"
+#import "DJIVideoClock.h"
+
+@interface DJIVideoStreamWorker ()
+@property (nonatomic, strong) dispatch_queue_t queue;
+//one count per frame that may still be queued
+@property (nonatomic, strong) dispatch_semaphore_t slots;
+@property (nonatomic, assign) DJIVideoStreamProcessorType type;
+@property (atomic, assign) NSUInteger handledFrameCount;
+@property (atomic, assign) NSUInteger droppedFrameCount;
+//frames queued before a reset are dropped when their turn comes
+@property (atomic, assign) uint32_t generation;
+@property (atomic, assign) BOOL waitingForKeyframe;
+@end
+
+@implementation DJIVideoStreamWorker
+
+-(id) initWithProcessor:(id<VideoStreamProcessor>)processor{
+    self = [super init];
+    if (self) {
+        _processor = processor;
+        _type = [processor streamProcessorType];
+
+        _queueDepth = VIDEO_STREAM_WORKER_DEFAULT_QUEUE_DEPTH;
+        if ([processor respondsToSelector:@selector(streamProcessorQueueDepth)]) {
+            _queueDepth = MAX(1, [processor streamProcessorQueueDepth]);
+        }
+
+        _policy = DJIVideoStreamBackpressurePolicy_Default;
+        if ([processor respondsToSelector:@selector(streamProcessorBackpressurePolicy)]) {
+            _policy = [processor streamProcessorBackpressurePolicy];
+        }
+
+        if (_policy == DJIVideoStreamBackpressurePolicy_Default) {
+            //a consumer usually stores or sends the stream, a gap must end at a frame that can be decoded
+            _policy = _type == DJIVideoStreamProcessorType_Consume ?
+                DJIVideoStreamBackpressurePolicy_DropUntilKeyframe : DJIVideoStreamBackpressurePolicy_DropNewest;
+        }
+
+        NSString* label = [NSString stringWithFormat:@"video_stream_worker_%@", NSStringFromClass([processor class])];
+        _queue = dispatch_queue_create(label.UTF8String, DISPATCH_QUEUE_SERIAL);
+        _slots = dispatch_semaphore_create(_queueDepth);
+    }
+    return self;
+}
+
+-(BOOL) submitFrame:(VideoFrameH264Raw*)frame size:(int)size keyframe:(BOOL)keyframe copy:(BOOL)copy{
+    if (!frame || size < (int)sizeof(VideoFrameH264Raw)) {
+        return NO;
+    }
+
+    if (self.waitingForKeyframe && !keyframe) {
+        self.droppedFrameCount++;
+        return NO;
+    }
+
+    dispatch_time_t timeout = _policy == DJIVideoStreamBackpressurePolicy_Block ? DISPATCH_TIME_FOREVER : DISPATCH_TIME_NOW;
+    if (0 != dispatch_semaphore_wait(_slots, timeout)) {
+        if (_policy == DJIVideoStreamBackpressurePolicy_DropUntilKeyframe) {
+            self.waitingForKeyframe = YES;
+        }
+        self.droppedFrameCount++;
+        return NO;
+    }
+    self.waitingForKeyframe = NO;
+
+    VideoFrameH264Raw* queued = frame;
+    if (copy) {
+        queued = (VideoFrameH264Raw*)malloc(size);
+        if (!queued) {
+            dispatch_semaphore_signal(_slots);
+            self.droppedFrameCount++;
+            return NO;
+        }
+        memcpy(queued, frame, size);
+    }
+
+    uint32_t generation = self.generation;
+    dispatch_async(_queue, ^{
+        BOOL kept = NO;
+        if (generation == self.generation && [_processor streamProcessorEnabled]) {
+            uint64_t start = videoClockTimeTag();
+            kept = [_processor streamProcessorHandleFrameRaw:queued];
+            [self.cost recordDuration:videoClockTimeTag() - start];
+            self.handledFrameCount++;
+        }
+
+        //only a consumer keeps the frames it accepts
+        if (!kept || _type != DJIVideoStreamProcessorType_Consume) {
+            free(queued);
+        }
+        dispatch_semaphore_signal(_slots);
+    });
+    return YES;
+}
+
+-(void) submitInfoChanged:(DJIVideoStreamBasicInfo)info{
+    if (![_processor respondsToSelector:@selector(streamProcessorInfoChanged:)]) {
+        return;
+    }
+
+    dispatch_async(_queue, ^{
+        DJIVideoStreamBasicInfo changed = info;
+        [_processor streamProcessorInfoChanged:&changed];
+    });
+}
+
+-(void) submitPause{
+    if (![_processor respondsToSelector:@selector(streamProcessorPause)]) {
+        return;
+    }
+
+    dispatch_async(_queue, ^{
+        [_processor streamProcessorPause];
+    });
+}
+
+-(void) submitReset{
+    self.generation++;
+    if (_policy == DJIVideoStreamBackpressurePolicy_DropUntilKeyframe) {
+        self.waitingForKeyframe = YES;
+    }
+
+    if (![_processor respondsToSelector:@selector(streamProcessorReset)]) {
+        return;
+    }
+
+    dispatch_async(_queue, ^{
+        [_processor streamProcessorReset];
+    });
+}
+
+-(void) waitUntilIdle{
+    dispatch_sync(_queue, ^{});
+}
+
+@end
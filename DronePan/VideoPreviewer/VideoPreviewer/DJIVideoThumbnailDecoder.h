@@ -0,0 +1,76 @@
+//
+//  DJIVideoThumbnailDecoder.h
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "DJIStreamCommon.h"
+
+/**
+ *  Small RGBA picture of one keyframe of the stream.
+ */
+@interface DJIVideoThumbnail : NSObject
+@property (nonatomic, readonly) uint32_t frameUUID;
+@property (nonatomic, readonly) uint64_t timeTag;
+@property (nonatomic, readonly) int width;
+@property (nonatomic, readonly) int height;
+@property (nonatomic, readonly) UIImage* image;
+
+/**
+ *  Scale a decoded frame down to a thumbnail. The frame is halved with the SIMD 2x2 box filter until it is at most
+ *  twice `maxWidth` wide, the color conversion halves it once more.
+ *
+ *  @param frame YUV420 planar frame.
+ *  @param maxWidth largest width of the thumbnail.
+ *
+ *  @return nil when the frame format is not supported.
+ */
++(DJIVideoThumbnail*) thumbnailOfFrame:(const VideoFrameYUV*)frame maxWidth:(int)maxWidth;
+@end
+
+typedef void (^VideoThumbnailHandler)(DJIVideoThumbnail* thumbnail);
+
+/**
+ *  Passthrough stream processor with its own light decoder that only sees the IDR frames of the stream, so the
+ *  cost is bounded by the keyframe rate and the main decoder is not touched. The decoder skips the loop filter,
+ *  uses lowres where the codec supports it and runs on a low priority queue. An IDR that arrives while the previous
+ *  one is still being decoded is dropped. Register it with `registStreamProcessor:`.
+ *
+ *  The IDR frames are found from their slice nal units, since the previewer clears `has_idr` for the Phantom 4. A
+ *  stream that refreshes without IDR frames gets no thumbnails.
+ */
+@interface DJIVideoThumbnailDecoder : NSObject <VideoStreamProcessor>
+@property (nonatomic, assign) BOOL enabled;
+
+//largest thumbnail width, default 160
+@property (nonatomic, assign) int maxWidth;
+
+@property (atomic, readonly) DJIVideoThumbnail* latestThumbnail;
+
+/**
+ *  Receive the thumbnail of the next IDR that is decoded. The handler is called once.
+ *
+ *  @param handler called with the thumbnail.
+ *  @param queue queue for the handler, nil to call it on the thumbnail queue.
+ */
+-(void) requestNextThumbnail:(VideoThumbnailHandler)handler queue:(dispatch_queue_t)queue;
+
+/**
+ *  Receive the thumbnail of the first IDR parsed at or after `timeTag` and before the request is closed with
+ *  `closeThumbnailRequestsAtTimeTag:`. The handler is not called when no such IDR is decoded.
+ *
+ *  @param timeTag videoClockTimeTag from which an IDR is accepted.
+ *  @param handler called with the thumbnail.
+ *  @param queue queue for the handler, nil to call it on the thumbnail queue.
+ */
+-(void) requestThumbnailAfterTimeTag:(uint64_t)timeTag handler:(VideoThumbnailHandler)handler queue:(dispatch_queue_t)queue;
+
+/**
+ *  Close the open requests, an IDR parsed at or after `timeTag` no longer fulfils them. An IDR parsed before it still
+ *  does, even when it is decoded later.
+ *
+ *  @param timeTag videoClockTimeTag when the picture stops showing what was requested, a gimbal move for example.
+ */
+-(void) closeThumbnailRequestsAtTimeTag:(uint64_t)timeTag;
+@end
@@ -0,0 +1,358 @@
+//
+//  DJIVideoThumbnailDecoder.m
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import "DJIVideoThumbnailDecoder.h"
+#import "DJIVideoPyramid.h"
+#import "DJIVideoColorConvert.h"
+#import "DJIVideoHelper.h"
+
+#include "libavcodec/avcodec.h"
+
+//a thumbnail does not need more than a quarter of the decoded size
+#define THUMBNAIL_DECODER_LOWRES (2)
+
+static void releaseThumbnailPixels(void* info, const void* data, size_t size){
+    free((void*)data);
+}
+
+@interface DJIVideoThumbnail ()
+@property (nonatomic, assign) uint32_t frameUUID;
+@property (nonatomic, assign) uint64_t timeTag;
+@property (nonatomic, assign) int width;
+@property (nonatomic, assign) int height;
+@property (nonatomic, strong) UIImage* image;
+@end
+
+@implementation DJIVideoThumbnail
+
++(DJIVideoThumbnail*) thumbnailOfFrame:(const VideoFrameYUV*)frame maxWidth:(int)maxWidth{
+    if (!frame || frame->frameType != VPFrameTypeYUV420Planer || !frame->luma || !frame->chromaB || !frame->chromaR
+        || frame->width < 4 || frame->height < 4 || maxWidth <= 0) {
+        return nil;
+    }
+
+    VideoFrameYUV level = {0};
+    level.frameType = VPFrameTypeYUV420Planer;
+    level.luma = frame->luma;
+    level.chromaB = frame->chromaB;
+    level.chromaR = frame->chromaR;
+    level.width = frame->width & ~1;
+    level.height = frame->height & ~1;
+    level.lumaSlice = frame->lumaSlice ? frame->lumaSlice : frame->width;
+    level.chromaBSlice = frame->chromaBSlice ? frame->chromaBSlice : frame->width/2;
+    level.chromaRSlice = frame->chromaRSlice ? frame->chromaRSlice : frame->width/2;
+
+    //the halved levels ping pong between two buffers sized for the first one
+    size_t levelSize = (size_t)(level.width/2)*(level.height/2)*3/2;
+    uint8_t* buffers[2] = {NULL, NULL};
+    int current = 0;
+
+    while (level.width > 2*maxWidth && level.width >= 8 && level.height >= 8) {
+        if (!buffers[current]) {
+            buffers[current] = (uint8_t*)malloc(levelSize);
+            if (!buffers[current]) {
+                break;
+            }
+        }
+
+        int width = (level.width/2) & ~1;
+        int height = (level.height/2) & ~1;
+        uint8_t* luma = buffers[current];
+        uint8_t* chromaB = luma + width*height;
+        uint8_t* chromaR = chromaB + (width/2)*(height/2);
+
+        downscalePlane2x(level.luma, level.lumaSlice, luma, width, width, height);
+        downscalePlane2x(level.chromaB, level.chromaBSlice, chromaB, width/2, width/2, height/2);
+        downscalePlane2x(level.chromaR, level.chromaRSlice, chromaR, width/2, width/2, height/2);
+
+        level.luma = luma;
+        level.chromaB = chromaB;
+        level.chromaR = chromaR;
+        level.width = width;
+        level.height = height;
+        level.lumaSlice = width;
+        level.chromaBSlice = width/2;
+        level.chromaRSlice = width/2;
+        current ^= 1;
+    }
+
+    int width = level.width/2;
+    int height = level.height/2;
+    uint8_t* pixels = (uint8_t*)malloc(width*height*4);
+
+    VideoColorConvertOptions options = {0};
+    options.halfSize = YES;
+
+    if (!pixels || 0 != convertYUVFrameToRGBA(&level, pixels, width*4, options)) {
+        free(pixels);
+        pixels = NULL;
+    }
+
+    free(buffers[0]);
+    free(buffers[1]);
+
+    if (!pixels) {
+        return nil;
+    }
+
+    CGDataProviderRef provider = CGDataProviderCreateWithData(NULL, pixels, width*height*4, releaseThumbnailPixels);
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    CGImageRef image = CGImageCreate(width, height, 8, 32, width*4, colorSpace,
+                                     kCGBitmapByteOrderDefault | kCGImageAlphaNoneSkipLast, provider, NULL, NO, kCGRenderingIntentDefault);
+    CGColorSpaceRelease(colorSpace);
+    CGDataProviderRelease(provider);
+
+    if (!image) {
+        return nil;
+    }
+
+    DJIVideoThumbnail* thumbnail = [[DJIVideoThumbnail alloc] init];
+    thumbnail.frameUUID = frame->frame_uuid;
+    thumbnail.timeTag = frame->time_tag;
+    thumbnail.width = width;
+    thumbnail.height = height;
+    thumbnail.image = [UIImage imageWithCGImage:image];
+    CGImageRelease(image);
+
+    return thumbnail;
+}
+
+@end
+
+@interface DJIVideoThumbnailRequest : NSObject
+@property (nonatomic, copy) VideoThumbnailHandler handler;
+@property (nonatomic, strong) dispatch_queue_t queue;
+//the accepted IDR frames are parsed in [startTimeTag, endTimeTag)
+@property (nonatomic, assign) uint64_t startTimeTag;
+@property (nonatomic, assign) uint64_t endTimeTag;
+@end
+
+@implementation DJIVideoThumbnailRequest
+@end
+
+@interface DJIVideoThumbnailDecoder (){
+    AVCodecContext* _codecContext;
+    AVFrame* _frame;
+}
+@property (nonatomic, strong) dispatch_queue_t thumbnailQueue;
+//an IDR is being decoded, only the decode thread sets it
+@property (atomic, assign) BOOL busy;
+@property (nonatomic, strong) NSMutableArray* requests;
+@property (atomic, strong) DJIVideoThumbnail* latestThumbnail;
+@end
+
+@implementation DJIVideoThumbnailDecoder
+
+-(id) init{
+    self = [super init];
+    if (self) {
+        _enabled = YES;
+        _maxWidth = 160;
+        _requests = [NSMutableArray array];
+
+        _thumbnailQueue = dispatch_queue_create("video_thumbnail_decoder", DISPATCH_QUEUE_SERIAL);
+        dispatch_set_target_queue(_thumbnailQueue, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0));
+    }
+    return self;
+}
+
+-(void) dealloc{
+    [self closeDecoder];
+}
+
+-(void) openDecoder{
+    if (_codecContext) {
+        return;
+    }
+
+    AVCodec* codec = avcodec_find_decoder(AV_CODEC_ID_H264);
+    if (!codec) {
+        return;
+    }
+
+    _codecContext = avcodec_alloc_context3(codec);
+    _frame = av_frame_alloc();
+    if (!_codecContext || !_frame) {
+        [self closeDecoder];
+        return;
+    }
+
+    //one thread and no deblocking, a thumbnail does not show either
+    _codecContext->thread_count = 1;
+    _codecContext->flags2 |= CODEC_FLAG2_FAST;
+    _codecContext->skip_loop_filter = AVDISCARD_ALL;
+    _codecContext->skip_frame = AVDISCARD_NONKEY;
+    av_codec_set_lowres(_codecContext, MIN(THUMBNAIL_DECODER_LOWRES, av_codec_get_max_lowres(codec)));
+
+    if (avcodec_open2(_codecContext, codec, NULL) < 0) {
+        [self closeDecoder];
+    }
+}
+
+-(void) closeDecoder{
+    if (_frame) {
+        av_frame_free(&_frame);
+    }
+
+    if (_codecContext) {
+        avcodec_close(_codecContext);
+        av_free(_codecContext);
+        _codecContext = NULL;
+    }
+}
+
+-(void) requestNextThumbnail:(VideoThumbnailHandler)handler queue:(dispatch_queue_t)queue{
+    [self requestThumbnailAfterTimeTag:0 handler:handler queue:queue];
+}
+
+-(void) requestThumbnailAfterTimeTag:(uint64_t)timeTag handler:(VideoThumbnailHandler)handler queue:(dispatch_queue_t)queue{
+    if (!handler) {
+        return;
+    }
+
+    DJIVideoThumbnailRequest* request = [[DJIVideoThumbnailRequest alloc] init];
+    request.handler = handler;
+    request.queue = queue;
+    request.startTimeTag = timeTag;
+    request.endTimeTag = UINT64_MAX;
+
+    @synchronized(_requests) {
+        [_requests addObject:request];
+    }
+}
+
+-(void) closeThumbnailRequestsAtTimeTag:(uint64_t)timeTag{
+    @synchronized(_requests) {
+        for (DJIVideoThumbnailRequest* request in _requests) {
+            if (request.endTimeTag == UINT64_MAX) {
+                request.endTimeTag = MAX(timeTag, request.startTimeTag);
+            }
+        }
+    }
+}
+
+-(BOOL) streamProcessorEnabled{
+    return self.enabled;
+}
+
+-(DJIVideoStreamProcessorType) streamProcessorType{
+    return DJIVideoStreamProcessorType_Passthrough;
+}
+
+-(BOOL) streamProcessorHandleFrameRaw:(VideoFrameH264Raw *)frame{
+    //the previewer clears has_idr of the phantom 4 stream before the processors see it
+    if (!frame->frame_info.frame_flag.has_idr && firstSliceNALType(frame->frame_data, frame->frame_size) != IDR_TAG) {
+        return YES;
+    }
+
+    if (self.busy) {
+        return YES;
+    }
+
+    size_t size = sizeof(VideoFrameH264Raw) + frame->frame_size;
+    VideoFrameH264Raw* copy = (VideoFrameH264Raw*)malloc(size);
+    if (!copy) {
+        return YES;
+    }
+
+    //the frame belongs to the decode thread, the copy to the thumbnail queue
+    memcpy(copy, frame, size);
+    self.busy = YES;
+
+    dispatch_async(_thumbnailQueue, ^{
+        [self decodeKeyframe:copy];
+        free(copy);
+        self.busy = NO;
+    });
+    return YES;
+}
+
+-(void) streamProcessorReset{
+    dispatch_async(_thumbnailQueue, ^{
+        if (_codecContext) {
+            avcodec_flush_buffers(_codecContext);
+        }
+    });
+}
+
+-(void) streamProcessorFlush{
+    [self streamProcessorReset];
+}
+
+-(void) decodeKeyframe:(VideoFrameH264Raw*)frame{
+    [self openDecoder];
+    if (!_codecContext) {
+        return;
+    }
+
+    AVPacket packet;
+    av_init_packet(&packet);
+    packet.data = frame->frame_data;
+    packet.size = frame->frame_size;
+
+    int gotPicture = 0;
+    if (avcodec_decode_video2(_codecContext, _frame, &gotPicture, &packet) < 0 || !gotPicture) {
+        return;
+    }
+
+    //a single IDR leaves nothing for later frames to reference
+    avcodec_flush_buffers(_codecContext);
+
+    if (_frame->format != AV_PIX_FMT_YUV420P && _frame->format != AV_PIX_FMT_YUVJ420P) {
+        return;
+    }
+
+    VideoFrameYUV yuv = {0};
+    yuv.frameType = VPFrameTypeYUV420Planer;
+    yuv.luma = _frame->data[0];
+    yuv.chromaB = _frame->data[1];
+    yuv.chromaR = _frame->data[2];
+    yuv.width = _frame->width;
+    yuv.height = _frame->height;
+    yuv.lumaSlice = _frame->linesize[0];
+    yuv.chromaBSlice = _frame->linesize[1];
+    yuv.chromaRSlice = _frame->linesize[2];
+    yuv.frame_uuid = frame->frame_uuid;
+    yuv.time_tag = frame->time_tag;
+    yuv.pts = frame->pts;
+    yuv.frame_info = frame->frame_info;
+
+    DJIVideoThumbnail* thumbnail = [DJIVideoThumbnail thumbnailOfFrame:&yuv maxWidth:self.maxWidth];
+    if (!thumbnail) {
+        return;
+    }
+
+    self.latestThumbnail = thumbnail;
+
+    //a request closed before the frame was parsed is dropped, one opened after it waits for the next IDR
+    NSMutableArray* requests = [NSMutableArray array];
+    @synchronized(_requests) {
+        NSMutableArray* pending = [NSMutableArray array];
+        for (DJIVideoThumbnailRequest* request in _requests) {
+            if (thumbnail.timeTag < request.startTimeTag) {
+                [pending addObject:request];
+            }
+            else if (thumbnail.timeTag < request.endTimeTag) {
+                [requests addObject:request];
+            }
+        }
+        [_requests setArray:pending];
+    }
+
+    for (DJIVideoThumbnailRequest* request in requests) {
+        VideoThumbnailHandler handler = request.handler;
+        if (request.queue) {
+            dispatch_async(request.queue, ^{
+                handler(thumbnail);
+            });
+        }
+        else{
+            handler(thumbnail);
+        }
+    }
+}
+
+@end
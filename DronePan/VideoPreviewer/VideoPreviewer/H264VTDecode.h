@@ -15,6 +15,8 @@
 @optional
 // called when the frame decompression is finished
 -(void) decompressedFrame:(CVImageBufferRef)image frameInfo:(VideoFrameH264Raw*)frame;
+// called when a frame accepted by the session fails to decompress
+-(void) decompressFailedWithFrameInfo:(VideoFrameH264Raw*)frame;
 // called when hardware decoder encounters exception.
 -(void) hardwareDecoderUnavailable;
 @end
@@ -76,6 +76,14 @@ void DJIHWDecoderDidDecompress( void *decompressionOutputRefCon, void *sourceFra
     else
     {
         INFO(@"decode callback status:%d, count:%d", (int)status, decoder.decodeErrorCount);
+        if ([decoder.delegate respondsToSelector:@selector(decompressFailedWithFrameInfo:)]) {
+            VideoFrameH264Raw* rawFrame = nil;
+            int frame_index = (int)sourceFrameRefCon;
+            if (frame_index >=0 && (frame_index < decoder.frameInfoListCount)) {
+                rawFrame = &decoder.frameInfoList[frame_index];
+            }
+            [decoder.delegate decompressFailedWithFrameInfo:rawFrame];
+        }
         decoder.decodeErrorCount ++;
         if (decoder.decodeErrorCount > 1) {
             ERROR(@"decode callback status:%d, count:%d", (int)status, decoder.decodeErrorCount);
@@ -463,11 +471,22 @@ void DJIHWDecoderDidDecompress( void *decompressionOutputRefCon, void *sourceFra
         frame_rate = (int)_fps;
     }
     
+    //hash the session's parameter sets the way they appear in the stream
+    uint8_t param_sets[2*(PPS_SPS_MAX_SIZS + 4)];
+    uint8_t start_code[] = {0, 0, 0, 1};
+    memcpy(param_sets, start_code, 4);
+    memcpy(param_sets + 4, sps_buffer, sps_size);
+    int param_sets_size = 4 + sps_size;
+    memcpy(param_sets + param_sets_size, start_code, 4);
+    memcpy(param_sets + param_sets_size + 4, pps_buffer, pps_size);
+    param_sets_size += 4 + pps_size;
+    
     PrebuildIframeInfo info;
     info.fps = frame_rate;
     info.frame_width = dimension.width;
     info.frame_height = dimension.height;
     info.encoder_type = (int)_encoderType;
+    info.param_set_hash = parameterSetsHash(param_sets, param_sets_size);
     int prebuildFrameSize = loadPrebuildIframe(au_buf, AU_MAX_SIZE, info);
     if (prebuildFrameSize <= 0) {
         ERROR(@"prebuild iframe not found:%d %dx%d p%d" ,
@@ -541,6 +560,14 @@ void DJIHWDecoderDidDecompress( void *decompressionOutputRefCon, void *sourceFra
     timming.decodeTimeStamp = CMTimeMake(1, 30000);
     timming.presentationTimeStamp = CMTimeMake(1, 30000);
     timming.duration = CMTimeMake(1, 30000);
+    if (frame && frame->pts) {
+        //the stream has no b frames, decode order is presentation order
+        timming.presentationTimeStamp = CMTimeMake(frame->pts, 1000000);
+        timming.decodeTimeStamp = timming.presentationTimeStamp;
+        if (frame->frame_info.fps) {
+            timming.duration = CMTimeMake(1, frame->frame_info.fps);
+        }
+    }
     
     OSStatus sample_status = CMSampleBufferCreateReady(
                kCFAllocatorDefault, // CFAllocatorRef allocator
@@ -940,6 +967,14 @@ enum AVPictureType {
     self.videoSize = info->frameSize;
 }
 
+-(void) streamProcessorFlush{
+    //output the pending frames, the session is kept and waits for the next idr
+    [self dequeueAllFrames];
+    au_size = 0;
+    au_nal_count = 0;
+    last_decode_frame_index = -1;
+}
+
 -(BOOL) streamProcessorEnabled{
     return self.enabled;
 }
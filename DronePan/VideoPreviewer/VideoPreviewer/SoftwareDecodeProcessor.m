@@ -66,6 +66,10 @@
 -(void) streamProcessorInfoChanged:(DJIVideoStreamBasicInfo *)info{
 }
 
+-(void) streamProcessorFlush{
+    [_extractor flushDecoder];
+}
+
 -(DJIVideoStreamProcessorType) streamProcessorType{
     return DJIVideoStreamProcessorType_Decoder;
 }
@@ -56,6 +56,9 @@
 @property(nonatomic, readonly) int outputWidth;
 @property(nonatomic, readonly) int outputHeight;
 
+//times the reconstructed presentation times restarted after a stall
+@property(nonatomic, readonly) uint64_t timestampResyncCount;
+
 /**
  *  init extractor
  *
@@ -64,10 +67,22 @@
 -(id)initExtractor;
 
 /**
- *  clean extractor's buffer
+ *  clean extractor's buffer. The opened codec context and its threads are kept, the decoder is flushed and the parser
+ *  is rebuilt before the next data is parsed.
  */
 - (void)clearBuffer;
 
+/**
+ *  release and re-create the codec context. Only needed when the codec is changed.
+ */
+- (void)rebuildExtractor;
+
+/**
+ *  drop the frames buffered inside the decoder. The codec context and the parser are kept, so it is safe to call from
+ *  the decode thread while the stream is parsed.
+ */
+- (void)flushDecoder;
+
 /**
  *  release the extractor
  */
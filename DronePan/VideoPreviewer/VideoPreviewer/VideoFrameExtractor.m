@@ -8,6 +8,8 @@
 
 #import "VideoFrameExtractor.h"
 #import <sys/time.h>
+#import "DJIVideoClock.h"
+#import "DJIVideoJitterBuffer.h"
 
 #include "libavformat/avformat.h"
 #include "libswscale/swscale.h"
@@ -20,6 +22,11 @@
     uint32_t s_frameUuidCounter;
     VideoFrameH264Raw* _frameInfoList;
     int _frameInfoListCount;
+
+    VideoTimestampReconstructor _timestamps;
+    
+    //the parser belongs to the thread pushing the stream, it is rebuilt there
+    volatile BOOL _parserResetPending;
 }
 
 @end
@@ -73,15 +80,23 @@ ss += ll; \
         yuv->width = _pCodecCtx->width;
         yuv->height = _pCodecCtx->height;
         yuv->frame_uuid = H264_FRAME_INVALIED_UUID;
+        yuv->time_tag = 0;
+        yuv->pts = 0;
         memset(&yuv->frame_info, 0, sizeof(VideoFrameH264BasicInfo));
         
         if (_pFrame->poc < _frameInfoListCount) {
             yuv->frame_uuid = _frameInfoList[_pFrame->poc].frame_uuid;
+            yuv->time_tag = _frameInfoList[_pFrame->poc].time_tag;
+            yuv->pts = _frameInfoList[_pFrame->poc].pts;
             yuv->frame_info = _frameInfoList[_pFrame->poc].frame_info;
         }
     }
 }
 
+-(uint64_t) timestampResyncCount{
+    return _timestamps.resyncCount;
+}
+
 -(CVImageBufferRef)getCVImage{
     @synchronized (self) {
         if(!_pFrame) return nil;
@@ -154,6 +169,14 @@ ss += ll; \
 {
     if(_pCodecCtx == NULL) return;
     
+    if (_parserResetPending) {
+        //the parser has no reset api, a new one is cheap compare to the codec context
+        _parserResetPending = NO;
+        if (_pCodecPaser) {
+            av_parser_close(_pCodecPaser);
+            _pCodecPaser = av_parser_init(AV_CODEC_ID_H264);
+        }
+    }
     
     int paserLength_In = length;
     int paserLen;
@@ -253,6 +276,7 @@ ss += ll; \
         
         outputFrame->frame_uuid = s_frameUuidCounter;
         outputFrame->frame_size = frame->size;
+        outputFrame->time_tag = videoClockTimeTag();
         
         { //patch by amanda
             outputFrame->frame_info.frame_index = _pCodecPaser->frame_num;
@@ -272,6 +296,12 @@ ss += ll; \
             outputFrame->frame_info.frame_flag.has_pps = _pCodecPaser->frame_has_pps;
             outputFrame->frame_info.frame_flag.has_idr = (_pCodecPaser->key_frame ==1)?1:0;
             
+            //the stream carries no timestamps, the cadence is rebuilt from frame_num and the frame rate
+            outputFrame->pts = videoTimestampReconstruct(&_timestamps, outputFrame->time_tag,
+                                                         outputFrame->frame_info.frame_index,
+                                                         outputFrame->frame_info.max_frame_index_plus_one,
+                                                         outputFrame->frame_info.fps);
+            
 //            if (outputFrame->frame_info.frame_flag.has_sps) {
 //                NSLog(@"%d %d has sps", outputFrame->frame_uuid, outputFrame->frame_info.frame_index);
 //            }
@@ -405,9 +435,11 @@ ss += ll; \
     AVCodec *pCodec;
     if(_pFrame == NULL)
     {
-        av_register_all();
-        
-        av_log_set_level(AV_LOG_QUIET);
+        static dispatch_once_t onceToken;
+        dispatch_once(&onceToken, ^{
+            av_register_all();
+            av_log_set_level(AV_LOG_QUIET);
+        });
         
         pCodec = avcodec_find_decoder(AV_CODEC_ID_H264);
         if (pCodec == NULL) {
@@ -450,7 +482,6 @@ ss += ll; \
         }
         if (_pCodecPaser) {
             av_parser_close(_pCodecPaser);
-            av_free(_pCodecCtx);
             _pCodecPaser = NULL;
         }
         
@@ -463,14 +494,43 @@ ss += ll; \
 }
 
 - (void)clearBuffer{
+    @synchronized (self) {
+        if (_pCodecCtx && avcodec_is_open(_pCodecCtx)) {
+            //keep the opened context and its thread pool, only the stream state is dropped
+            [self flushDecoder];
+            _parserResetPending = YES;
+            _frameRate = 0;
+            _shouldVerifyVideoStream = YES;
+            videoTimestampReset(&_timestamps);
+            if (_frameInfoList) {
+                memset(_frameInfoList, 0, _frameInfoListCount*sizeof(VideoFrameH264Raw));
+            }
+            return;
+        }
+    }
+    
+    [self rebuildExtractor];
+}
+
+- (void)rebuildExtractor{
     [self freeExtractor];
 
     @synchronized (self) {
+        videoTimestampReset(&_timestamps);
         if(_pFrame == NULL)
         {
             [self setupExtractor];
-            NSLog(@"Init param:%d %d %d %d %d",_pCodecCtx->ticks_per_frame,_pCodecCtx->delay,_pCodecCtx->thread_count,_pCodecCtx->thread_type,_pCodecCtx->active_thread_type);
+            if (_pCodecCtx) {
+                NSLog(@"Init param:%d %d %d %d %d",_pCodecCtx->ticks_per_frame,_pCodecCtx->delay,_pCodecCtx->thread_count,_pCodecCtx->thread_type,_pCodecCtx->active_thread_type);
+            }
+        }
+    }
+}
 
+- (void)flushDecoder{
+    @synchronized (self) {
+        if (_pCodecCtx) {
+            avcodec_flush_buffers(_pCodecCtx);
         }
     }
 }
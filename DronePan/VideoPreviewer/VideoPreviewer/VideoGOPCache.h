@@ -0,0 +1,54 @@
+//
+//  VideoGOPCache.h
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "DJIStreamCommon.h"
+
+/**
+ *  Keeps a copy of the most recent GOP (parameter sets, IDR and the following frames) so the decoder can be
+ *  warmed up after a restart without waiting for the next IDR from the encoder. Thread safe.
+ */
+@interface VideoGOPCache : NSObject
+
+/**
+ *  Creates a cache object.
+ *
+ *  @param count maximum number of frames in one GOP
+ *  @param bytes maximum size of the cached frames in byte
+ *
+ *  @return the created cache
+ */
+- (instancetype)initWithMaxFrameCount:(int)count maxBytes:(int)bytes;
+
+/**
+ *  Copy a parsed frame into the cache. A frame with SPS or IDR starts a new GOP. The cache is dropped when the
+ *  GOP exceeds the limits and stays empty until the next GOP starts.
+ *
+ *  @param frame the parsed frame, the data follows the header
+ */
+- (void)push:(VideoFrameH264Raw *)frame;
+
+/**
+ *  Copies of the cached frames which are before the frame with `uuid` in the same GOP.
+ *
+ *  @param uuid uuid of the frame the decoder is about to decode
+ *
+ *  @return NSData objects holding a VideoFrameH264Raw each. Empty if the frame is not in the cached GOP.
+ */
+- (NSArray *)framesBeforeUUID:(uint32_t)uuid;
+
+/**
+ *  `parameterSetsHash` of the frame that started the cached GOP, 0 when nothing is cached or the GOP started without
+ *  parameter sets.
+ */
+- (uint32_t)paramSetHash;
+
+/**
+ *  Drop the cached GOP.
+ */
+- (void)clear;
+
+@end
@@ -0,0 +1,97 @@
+//
+//  VideoGOPCache.m
+//
+//  Copyright (c) 2016 DJI. All rights reserved.
+//
+
+#import "VideoGOPCache.h"
+#import "DJIVideoHelper.h"
+
+@interface VideoGOPCache (){
+    int _maxFrameCount;
+    int _maxBytes;
+    int _bytes;
+    // NO after an overflow until the next GOP starts
+    BOOL _valid;
+    uint32_t _paramSetHash;
+}
+@property (strong, nonatomic) NSMutableArray* frames;
+@end
+
+@implementation VideoGOPCache
+
+- (instancetype)initWithMaxFrameCount:(int)count maxBytes:(int)bytes{
+    self = [super init];
+    _maxFrameCount = count;
+    _maxBytes = bytes;
+    _bytes = 0;
+    _valid = NO;
+    _frames = [[NSMutableArray alloc] initWithCapacity:count];
+    return self;
+}
+
+- (void)push:(VideoFrameH264Raw *)frame{
+    if (frame == NULL || frame->type_tag != TYPE_TAG_VideoFrameH264Raw) {
+        return;
+    }
+    
+    int size = (int)(sizeof(VideoFrameH264Raw) + frame->frame_size);
+    BOOL gopStart = frame->frame_info.frame_flag.has_sps || frame->frame_info.frame_flag.has_idr;
+    uint32_t paramSetHash = frame->frame_info.frame_flag.has_sps ? parameterSetsHash(frame->frame_data, frame->frame_size) : 0;
+    
+    @synchronized (self) {
+        if (gopStart) {
+            [_frames removeAllObjects];
+            _bytes = 0;
+            _valid = YES;
+            _paramSetHash = paramSetHash;
+        }
+        
+        if (!_valid) {
+            return;
+        }
+        
+        if (_frames.count >= _maxFrameCount || _bytes + size > _maxBytes) {
+            // a partial gop can not be decoded, wait for the next one
+            [_frames removeAllObjects];
+            _bytes = 0;
+            _valid = NO;
+            _paramSetHash = 0;
+            return;
+        }
+        
+        [_frames addObject:[NSData dataWithBytes:frame length:size]];
+        _bytes += size;
+    }
+}
+
+- (NSArray *)framesBeforeUUID:(uint32_t)uuid{
+    @synchronized (self) {
+        NSUInteger index = 0;
+        for (NSData* data in _frames) {
+            const VideoFrameH264Raw* frame = (const VideoFrameH264Raw*)data.bytes;
+            if (frame->frame_uuid == uuid) {
+                return [_frames subarrayWithRange:NSMakeRange(0, index)];
+            }
+            index++;
+        }
+    }
+    return @[];
+}
+
+- (uint32_t)paramSetHash{
+    @synchronized (self) {
+        return _paramSetHash;
+    }
+}
+
+- (void)clear{
+    @synchronized (self) {
+        [_frames removeAllObjects];
+        _bytes = 0;
+        _valid = NO;
+        _paramSetHash = 0;
+    }
+}
+
+@end
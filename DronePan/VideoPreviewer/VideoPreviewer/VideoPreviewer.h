@@ -12,6 +12,15 @@
 #import "MovieGLView.h"
 #import "SoftwareDecodeProcessor.h"
 #import "LB2AUDHackParser.h"
+#import "DJIVideoFrameAnalysis.h"
+#import "DJIVideoExposureStatistics.h"
+#import "DJIVideoPhaseCorrelation.h"
+#import "DJIVideoThumbnailDecoder.h"
+#import "DJIVideoClock.h"
+#import "DJIVideoPanoramaCanvas.h"
+#import "DJIVideoProcessorCost.h"
+#import "DJIVideoDecodePool.h"
+#import "DJIVideoStatistics.h"
 
 #define VIDEO_PREVIEWER_DISPATCH "video_preview_create_thread_dispatcher"
 #define VIDEO_PREVIEWER_EVEN_NOTIFICATIOIN @"video_preview_even_notification"
@@ -35,6 +44,34 @@ typedef enum : NSUInteger {
     VideoDecoderStatus_DecoderError,
 } VideoDecoderStatus;
 
+typedef NS_ENUM(NSUInteger, VideoDecoderRecoveryMode){
+    VideoDecoderRecoveryModeNone,
+    VideoDecoderRecoveryModeResync,   // flush the decoder and skip input until the next IDR or SPS
+    VideoDecoderRecoveryModeRebuild,  // stop the decoding thread and rebuild the decoder
+};
+
+/**
+ *  Time spent recovering from decoding errors. Durations are in milliseconds and measured from the recovery
+ *  request to the next decoded frame.
+ */
+typedef struct{
+    uint32_t resyncCount;
+    uint32_t rebuildCount;
+    double lastResyncDuration;
+    double lastRebuildDuration;
+    double totalResyncDuration;
+    double totalRebuildDuration;
+}VideoDecoderRecoveryStatistics;
+
+/**
+ *  Time from the first data pushed after `start` or `reset` to the first rendered frame, in milliseconds. The
+ *  primed value is measured when the stored keyframe of the product was fed to the decoder first.
+ */
+typedef struct{
+    double coldTimeToFirstFrame;
+    double primedTimeToFirstFrame;
+}VideoPreviewerStartupStatistics;
+
 typedef NS_ENUM(NSUInteger, VideoPreviewerEvent){
     VideoPreviewerEventNoImage,
     VideoPreviewerEventHasImage,
@@ -75,6 +112,36 @@ typedef NS_ENUM(NSUInteger, VideoPreviewerDecoderType){
  */
 @property (nonatomic, readonly) VideoDecoderStatus decoderStatus;
 
+/**
+ *  The error recovery in progress, `VideoDecoderRecoveryModeNone` when the decoder is healthy.
+ */
+@property (nonatomic, readonly) VideoDecoderRecoveryMode recoveryMode;
+
+/**
+ *  Statistics of the error recoveries since the previewer is created.
+ */
+@property (nonatomic, readonly) VideoDecoderRecoveryStatistics recoveryStatistics;
+
+/**
+ *  Latency of the safe resumes since the previewer is created.
+ */
+@property (nonatomic, readonly) VideoResumeStatistics resumeStatistics;
+
+/**
+ *  Longest time in milliseconds a safe resume hides the video waiting for a clean frame, 2000 by default.
+ */
+@property (nonatomic, assign) double safeResumeTimeout;
+
+/**
+ *  Time in milliseconds from the last `reset` to the first decoded frame. 0 before any reset.
+ */
+@property (nonatomic, readonly) double resetToFirstFrameDuration;
+
+/**
+ *  Time to the first frame after the stream starts, with and without the stored keyframe of the product.
+ */
+@property (nonatomic, readonly) VideoPreviewerStartupStatistics startupStatistics;
+
 /**
  *  The display type used by the Video Previewer
  */
@@ -87,6 +154,61 @@ typedef NS_ENUM(NSUInteger, VideoPreviewerDecoderType){
 
 +(VideoPreviewer*) instance;
 
+/**
+ *  A previewer of its own for another stream, a second camera or another feed on a ground station. Its frames are
+ *  decoded on the workers of the pool instead of a thread of its own, so any number of previewers share a fixed
+ *  number of threads. It does not use the stored keyframe of the product. `init` gives a previewer with a thread of
+ *  its own like `instance`.
+ *
+ *  @param pool the pool, `[DJIVideoDecodePool sharedPool]` unless the streams need separate workers.
+ */
+-(instancetype) initWithDecodePool:(DJIVideoDecodePool*)pool;
+
+/**
+ *  The pool decoding the stream, nil for a previewer with a thread of its own.
+ */
+@property (nonatomic, readonly) DJIVideoDecodePool* decodePool;
+
+/**
+ *  Share of the pool's steps the stream gets when the workers are all busy, 1 by default.
+ */
+@property (nonatomic, assign) NSUInteger decodePriority;
+
+/**
+ *  Decode each frame as soon as it arrives instead of holding it in the playout buffer. The buffer smooths the
+ *  arrival jitter of the link at the cost of up to `maxPlayoutDelay` of latency. Default YES, set NO to enable the
+ *  playout buffer.
+ */
+@property (nonatomic, assign) BOOL lowestLatencyPlayout;
+
+/**
+ *  Longest time in milliseconds a frame is held in the playout buffer when `lowestLatencyPlayout` is NO, 100 by
+ *  default.
+ */
+@property (nonatomic, assign) double maxPlayoutDelay;
+
+/**
+ *  Arrival jitter of the stream and the delay of the playout buffer.
+ */
+@property (nonatomic, readonly) VideoPlayoutStatistics playoutStatistics;
+
+/**
+ *  Frames handed to the renderer, and the frames dropped because a newer one arrived before the display refreshed.
+ */
+@property (nonatomic, readonly) VideoFrameMailboxStatistics presentationStatistics;
+
+/**
+ *  While paused or in background, only follow the stream to its latest keyframe instead of parsing and decoding it.
+ *  The decoding restarts from that keyframe on resume. The stream is still parsed when an enabled processor runs on a
+ *  worker, a recorder for example, since it needs every frame. Default YES.
+ */
+@property (nonatomic, assign) BOOL lowPowerTracking;
+
+/**
+ *  Stream followed by the low power tracking.
+ */
+@property (nonatomic, readonly) VideoStreamTrackerStatistics trackingStatistics;
+
 /**
  *  Push video data
  *
@@ -148,7 +270,9 @@ typedef NS_ENUM(NSUInteger, VideoPreviewerDecoderType){
 - (void)resume;
 
 /**
- * Resume the decoding process. When using the hardware decoder, it will skip some frame to avoid abnormal images.
+ * Resume the decoding process. The frames stay hidden until one is decoded from a complete reference chain, a
+ * keyframe or a frame whose references were all decoded, or until `safeResumeTimeout`. `VideoPreviewerEventResumeReady`
+ * is posted then.
  */
 - (void)safeResume;
 
@@ -189,6 +313,26 @@ typedef NS_ENUM(NSUInteger, VideoPreviewerDecoderType){
 -(void) registFrameProcessor:(id<VideoFrameProcessor>)processor;
 -(void) unregistProcessor:(id)processor;
 
+/**
+ *  Cost of every registered stream and frame processor, in the order they were registered. A processor whose recent
+ *  cost per frame is over `slowProcessorFrameShare` of the frame interval is flagged slow.
+ *
+ *  @return array of DJIVideoProcessorCost.
+ */
+-(NSArray*) processorCosts;
+
+/**
+ *  Share of the frame interval a processor may take per frame, 0.25 by default.
+ */
+@property (nonatomic, assign) double slowProcessorFrameShare;
+
+/**
+ *  Move slow frame processors off the decode thread. A moved processor gets copies of the frames on a queue of its
+ *  own and misses the frames that arrive while it is busy. Stream processors are not moved: the modifiers and
+ *  decoders must see every frame in order, the others already run on workers. Default NO.
+ */
+@property (nonatomic, assign) BOOL demoteSlowFrameProcessors;
+
 - (NSUInteger)  __attribute__((deprecated)) runLoopCount;
 - (NSUInteger)  __attribute__((deprecated)) frameCount;
 
@@ -6,34 +6,117 @@
 
 #import "VideoPreviewer.h"
 #import <sys/time.h>
+#import <sched.h>
 #include <OpenGLES/ES2/gl.h>
 #import "SoftwareDecodeProcessor.h"
 #import "LB2AUDHackParser.h"
 #import "H264VTDecode.h"
+#import "DJIVideoHelper.h"
+#import "VideoGOPCache.h"
+#import "DJIVideoKeyframeStore.h"
+#import "DJIVideoPyramid.h"
+#import "DJIVideoStreamWorker.h"
+#import "DJIVideoProcessorSnapshot.h"
+#import "DJIVideoProcessorCost.h"
+#import "DJIVideoClock.h"
+#import "DJIVideoDecodePool.h"
+#import "DJIVideoJitterBuffer.h"
+#import "DJIVideoPresenter.h"
+#import "DJIVideoResumeTracker.h"
+#import "DJIVideoStreamTracker.h"
 #import "DJISDK/DJISDK.h"
 
 #define BEGIN_DISPATCH_QUEUE dispatch_async(_dispatchQueue, ^{
 #define END_DISPATCH_QUEUE   });
 #define __TEST_VIDEO_DELAY__ 0
 
+//share of the frame interval a processor may take per frame before it is flagged slow
+#define VIDEO_PROCESSOR_DEFAULT_SLOW_FRAME_SHARE (0.25)
+//a pooled previewer renders its idle state when no frame arrived for this long, like the queue timeout of the decode thread
+#define VIDEO_DECODE_POOL_IDLE_INTERVAL (2000*1000)
+//longest a frame waits in the playout buffer by default
+#define VIDEO_PLAYOUT_DEFAULT_MAX_DELAY (100*1000)
+//the decode thread checks for a stop this often while it holds a frame
+#define VIDEO_PLAYOUT_WAIT_SLICE (10*1000)
+//failed frames before the decoder tries to recover
+#define VIDEO_DECODER_RECOVERY_FAILED_COUNT (6)
+//resyncs without a decoded frame before the decoder is rebuilt
+#define VIDEO_DECODER_MAX_RESYNC_ATTEMPTS (2)
+//one gop of the supported encoders fits in the cache
+#define VIDEO_GOP_CACHE_MAX_FRAME_COUNT (120)
+#define VIDEO_GOP_CACHE_MAX_BYTES (4*1024*1024)
+
 #if __TEST_VIDEO_DELAY__
 #import "DJITestDelayLogic.h"
 #endif
 
-@interface VideoPreviewer () <H264DecoderOutput, LB2AUDHackParserDelegate>{
+@interface VideoPreviewer () <H264DecoderOutput, LB2AUDHackParserDelegate, DJIVideoDecodePoolStream, DJIVideoPresentTarget>{
     NSThread *_decodeThread;
+    
+    //retained DJIVideoProcessorSnapshot, swapped with an atomic exchange
+    void* _publishedSnapshot;
+    //readers between loading _publishedSnapshot and retaining it, a replaced snapshot is released once it drops to 0
+    int _snapshotReaders;
+    
+    //decode pool
+    long long _lastDecodeStepTime;
+    BOOL _idleStepPending;
+    //frame held by the playout buffer until its time comes
+    VideoFrameH264Raw* _heldFrame;
+    int _heldFrameSize;
+    uint64_t _heldFrameDue;
+    
+    //frames leave the queue at their presentation time plus the playout delay
+    VideoPlayoutBuffer _playout;
     MovieGLView *_glView;
     
     BOOL videoDecoderCanReset;
     int videoDecoderFailedCount;
-    int safe_resume_skip_count;
+    
+    //safe resume, the frames stay hidden until a clean one is decoded
+    BOOL _resumePending;
+    VideoResumeTracker _resumeTracker;
     
     DJIVideoStreamBasicInfo _stream_basic_info;
+    //stream info the processors were last told about
+    DJIVideoStreamBasicInfo _current_stream_info;
     pthread_mutex_t _processor_mutex;
     pthread_mutex_t _render_mutex;
     
     long long _lastDataInputTime;
     long long _lastFrameDecodedTime;
+    
+    //error recovery
+    BOOL _waitingForKeyFrame;
+    //the keyframe after a resync reached the decoders, only the frames decoded from then on end the resync
+    BOOL _resyncKeyframeSubmitted;
+    int _resyncAttempts;
+    long long _recoveryStartTime;
+    uint32_t _lastSeenParamSetHash;
+    uint32_t _decodedParamSetHash;
+    
+    //reset to first frame
+    long long _resetStartTime;
+    
+    //last gop replay
+    BOOL _replayGOPPending;
+    BOOL _suppressFrameOutput;
+    
+    //stored keyframe priming
+    BOOL _primePending;
+    BOOL _primeOutputPending;
+    BOOL _primedWithStoredKeyframe;
+    uint32_t _primingFrameUUID;
+    long long _firstDataTime;
+    
+    //down scaled frames shared by the frame processors
+    VideoFramePyramid _pyramid;
+    
+    //low power tracking, while the video is hidden the stream is only followed to its latest keyframe
+    VideoStreamTracker _streamTracker;
+    BOOL _tracking;
+    BOOL _trackerClearPending;
+    BOOL _catchingUp;
 }
 
 @property (assign, nonatomic) BOOL enableHardwareDecode;
@@ -46,16 +129,25 @@
 @property (strong, nonatomic) SoftwareDecodeProcessor* soft_decoder;
 
 @property (assign, nonatomic) VideoDecoderStatus decoderStatus;
+@property (assign, nonatomic) VideoDecoderRecoveryMode recoveryMode;
 
 @property (assign, nonatomic) VPFrameType frameOutputType;
-//stream processor list
-@property (strong, nonatomic) NSMutableArray* stream_processor_list;
-@property (strong, nonatomic) NSMutableArray* frame_processor_list;
+//registered processors, replaced as a whole under _processor_mutex and read without it
+@property (readonly, nonatomic) DJIVideoProcessorSnapshot* processorSnapshot;
 @property (assign, nonatomic) BOOL grayOutPause;
 
 
 //remove the redundant aud in LB2's stream
 @property (strong, nonatomic) LB2AUDHackParser* lb2Hack;
+
+//the most recent gop, replayed after the decoder restarts
+@property (strong, nonatomic) VideoGOPCache* gopCache;
+
+//last keyframe of the product on disk
+@property (strong, nonatomic) DJIVideoKeyframeStore* keyframeStore;
+
+//renders the newest decoded frame at the cadence of the display
+@property (strong, nonatomic) DJIVideoPresenter* presenter;
 @end
 
 @implementation VideoPreviewer
@@ -64,9 +156,17 @@
 }
 
 -(id)init
+{
+    return [self initWithDecodePool:nil];
+}
+
+-(id)initWithDecodePool:(DJIVideoDecodePool*)pool
 {
     self= [super init];
     
+    _decodePool = pool;
+    _decodePriority = 1;
+    
     memset(&_stream_basic_info, 0, sizeof(_stream_basic_info));
     _stream_basic_info.frameRate = 30;
     _stream_basic_info.encoderType = H264EncoderType_DM368_inspire;
@@ -76,13 +176,23 @@
     _decodeThread = nil;
     _glView = nil;
     _dataQueue = [[VideoPreviewerQueue alloc] initWithSize:100];
+    _gopCache = [[VideoGOPCache alloc] initWithMaxFrameCount:VIDEO_GOP_CACHE_MAX_FRAME_COUNT maxBytes:VIDEO_GOP_CACHE_MAX_BYTES];
     _videoExtractor = [[VideoFrameExtractor alloc] initExtractor];
-    _stream_processor_list = [[NSMutableArray alloc] init];
-    _frame_processor_list = [[NSMutableArray alloc] init];
+    //the stored keyframe belongs to the product of the main previewer
+    _keyframeStore = pool ? nil : [DJIVideoKeyframeStore instance];
+    _publishedSnapshot = (__bridge_retained void*)[[DJIVideoProcessorSnapshot alloc] init];
+    _slowProcessorFrameShare = VIDEO_PROCESSOR_DEFAULT_SLOW_FRAME_SHARE;
+    _presenter = [[DJIVideoPresenter alloc] initWithTarget:self];
+    videoPlayoutInit(&_playout, VIDEO_PLAYOUT_DEFAULT_MAX_DELAY);
+    //the playout buffer is opt-in, a live preview decodes every frame on arrival
+    _playout.lowestLatency = YES;
+    videoStreamTrackerInit(&_streamTracker, VIDEO_GOP_CACHE_MAX_BYTES);
+    _lowPowerTracking = YES;
     pthread_mutex_init(&_processor_mutex, nil);
     pthread_mutex_init(&_render_mutex, nil);
     
-    safe_resume_skip_count = 0;
+    _resumePending = NO;
+    videoResumeInit(&_resumeTracker, VIDEO_RESUME_DEFAULT_TIMEOUT);
 
     _type = VideoPreviewerTypeAutoAdapt;
     memset(&_status, 0, sizeof(VideoPreviewerStatus));
@@ -93,6 +203,9 @@
     [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(appWillEnterForeGround:) name:UIApplicationWillEnterForegroundNotification object:nil];
     
     _decoderStatus = VideoDecoderStatus_Normal;
+    _recoveryMode = VideoDecoderRecoveryModeNone;
+    memset(&_recoveryStatistics, 0, sizeof(_recoveryStatistics));
+    memset(&_startupStatistics, 0, sizeof(_startupStatistics));
     
     _soft_decoder = [[SoftwareDecodeProcessor alloc] initWithExtractor:_videoExtractor];
     _soft_decoder.frameProcessor = self;
@@ -147,14 +260,34 @@
             return;
         }
         
-        if (self.dataQueue.count > 30) {
-            NSLog(@"decode dataqueue drop");
-            [self.dataQueue clear];
-        }
-        [self.dataQueue push:(uint8_t*)frame length:sizeof(VideoFrameH264Raw) + frame->frame_size];
+        [self enqueueFrame:frame];
     }];
 }
 
+-(void) enqueueFrame:(VideoFrameH264Raw*)frame{
+    if (_primeOutputPending) {
+        //the parser outputs the stored keyframe before the first frame from the aircraft
+        _primeOutputPending = NO;
+        _primingFrameUUID = frame->frame_uuid;
+    }else{
+        [_keyframeStore storeFrame:frame];
+    }
+    [_gopCache push:frame];
+    
+    if (_catchingUp) {
+        //the tracked stream only fills the gop cache, it is replayed before the next live frame
+        free(frame);
+        return;
+    }
+    
+    if (self.dataQueue.count > 30) {
+        NSLog(@"decode dataqueue drop");
+        [self.dataQueue clear];
+    }
+    [self.dataQueue push:(uint8_t*)frame length:sizeof(VideoFrameH264Raw) + frame->frame_size];
+    [_decodePool signalStream:self];
+}
+
 - (CGRect) frame {
     if (!_glView) {
         return CGRectZero;
@@ -179,21 +312,35 @@
     
     _lastDataInputTime = [self getTickCount]; // status purpose only
     if (_status.isRunning) {
-        if (_encoderType == H264EncoderType_LightBridge2) {
-            [_lb2Hack parse:videoData inSize:len];
-        }else{
-            [_videoExtractor parseVideo:videoData length:len withFrame:^(VideoFrameH264Raw *frame) {
-                if (!frame) {
-                    return;
-                }
-                
-                if (self.dataQueue.count > 30) {
-                    NSLog(@"decode dataqueue drop");
-                    [self.dataQueue clear];
-                }
-                [self.dataQueue push:(uint8_t*)frame length:sizeof(VideoFrameH264Raw) + frame->frame_size];
-            }];
+        if (!_firstDataTime) {
+            _firstDataTime = _lastDataInputTime;
         }
+        if (_primePending) {
+            [self primeWithStoredKeyframe:parameterSetsHash(videoData, len)];
+        }
+        
+        if (_trackerClearPending) {
+            _trackerClearPending = NO;
+            _tracking = NO;
+            videoStreamTrackerClear(&_streamTracker);
+        }
+        
+        if ([self canTrackStream]) {
+            if (!_tracking) {
+                _tracking = YES;
+                //the frames still queued are older than the keyframe the decoding will restart from
+                [self.dataQueue clear];
+            }
+            videoStreamTrackerPush(&_streamTracker, videoData, len);
+            return;
+        }
+        
+        if (_tracking) {
+            _tracking = NO;
+            [self catchUpTrackedStream];
+        }
+        
+        [self parseVideoData:videoData length:len];
     }
     else
     {
@@ -201,6 +348,52 @@
     }
 }
 
+-(void) parseVideoData:(uint8_t*)videoData length:(int)len{
+    if (_encoderType == H264EncoderType_LightBridge2) {
+        [_lb2Hack parse:videoData inSize:len];
+    }else{
+        [_videoExtractor parseVideo:videoData length:len withFrame:^(VideoFrameH264Raw *frame) {
+            if (!frame) {
+                return;
+            }
+            
+            [self enqueueFrame:frame];
+        }];
+    }
+}
+
+//the video is hidden and no processor on a worker needs the frames
+-(BOOL) canTrackStream{
+    if (!_lowPowerTracking || !(_status.isPause || _status.isBackground)) {
+        return NO;
+    }
+    
+    for (DJIVideoStreamProcessorEntry* entry in self.processorSnapshot.workerEntries) {
+        if ([entry.processor streamProcessorEnabled]) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+//parse the stream tracked since the latest keyframe into the gop cache, the decoders replay it before the next frame
+-(void) catchUpTrackedStream{
+    size_t size = 0;
+    uint8_t* stream = videoStreamTrackerTake(&_streamTracker, &size);
+    if (!stream) {
+        return;
+    }
+    
+    //the tracked stream starts at an access unit, what the parser held before tracking is stale
+    [_videoExtractor clearBuffer];
+    _catchingUp = YES;
+    [self parseVideoData:stream length:(int)size];
+    _catchingUp = NO;
+    free(stream);
+    
+    _replayGOPPending = YES;
+}
+
 -(void) clearVideoData
 {
     [self.dataQueue clear];
@@ -220,6 +413,7 @@
         [_glView adjustSize];
         _status.isGLViewInit = YES;
     });
+    [_presenter start];
     END_DISPATCH_QUEUE
     return NO;
 }
@@ -235,6 +429,8 @@
             _status.isGLViewInit = NO;
         });
     }
+    [_presenter stop];
+    [_presenter clear];
     END_DISPATCH_QUEUE
 }
 
@@ -259,9 +455,8 @@
     BEGIN_DISPATCH_QUEUE
     if(_decodeThread == nil && !_status.isRunning)
     {
-        _decodeThread = [[NSThread alloc] initWithTarget:self selector:@selector(decodeRunloop) object:nil];
-        _decodeThread.qualityOfService = NSQualityOfServiceUserInteractive;
-        [_decodeThread start];
+        [self prepareFirstFrame];
+        [self startDecoding];
     }
     END_DISPATCH_QUEUE
     return YES;
@@ -270,31 +465,38 @@
 -(void) reset
 {
     BEGIN_DISPATCH_QUEUE
-    if(_decodeThread && _status.isRunning)
+    if((_decodeThread || _decodePool) && _status.isRunning)
     {
-        safe_resume_skip_count = 0;
-        _status.isRunning = NO;
-        while (!_status.isFinish) {
-            usleep(10000);
-        }
-        [_decodeThread cancel];
-        while (!_decodeThread.isFinished) {
-            usleep(10000);
+        _resumePending = NO;
+        [self stopDecoding];
+        _resetStartTime = [self getTickCount];
+        //a cleared parser drops every frame until the next sps, which would leave nothing for the gop replay. when
+        //the cached gop was encoded with the current parameter sets the parser keeps them and only the decoder is
+        //flushed, so the next frame is parsed at once and the cache is replayed before it
+        uint32_t cachedParamSetHash = [_gopCache paramSetHash];
+        if (cachedParamSetHash && cachedParamSetHash == _lastSeenParamSetHash) {
+            [_videoExtractor flushDecoder];
+        }else{
+            [_videoExtractor clearBuffer];
         }
-        _decodeThread = nil;
-        [_videoExtractor clearBuffer];
         [_dataQueue clear];
-        _decodeThread = [[NSThread alloc] initWithTarget:self selector:@selector(decodeRunloop) object:nil];
-        [_decodeThread start];
+        [_presenter clear];
+        _replayGOPPending = YES;
+        _trackerClearPending = YES;
+        [self prepareFirstFrame];
+        [self startDecoding];
         
         if (_hw_decoder) {
             [_hw_decoder resetLater];
         }
         
 
-        for (id<VideoStreamProcessor> processor in _stream_processor_list) {
-            if ([processor respondsToSelector:@selector(streamProcessorReset)]) {
-                [processor streamProcessorReset];
+        for (DJIVideoStreamProcessorEntry* entry in self.processorSnapshot.streamEntries) {
+            if (entry.worker) {
+                [entry.worker submitReset];
+            }
+            else if (entry.handlesReset) {
+                [entry.processor streamProcessorReset];
             }
         }
     }
@@ -310,7 +512,8 @@
 
 - (void)safeResume{
     NSLog(@"Try safe resuming");
-    safe_resume_skip_count = 25;
+    _resumePending = YES;
+    _replayGOPPending = YES;
     [self resume];
 }
 
@@ -324,10 +527,15 @@
     _grayOutPause = isGrayout;
     NSLog(@"Pause decoding");
     [self.dataQueue wakeupReader];
+    _idleStepPending = YES;
+    [_decodePool signalStream:self];
     
-    for (id<VideoStreamProcessor> processor in _stream_processor_list) {
-        if ([processor respondsToSelector:@selector(streamProcessorPause)]) {
-            [processor streamProcessorPause];
+    for (DJIVideoStreamProcessorEntry* entry in self.processorSnapshot.streamEntries) {
+        if (entry.worker) {
+            [entry.worker submitPause];
+        }
+        else if (entry.handlesPause) {
+            [entry.processor streamProcessorPause];
         }
     }
     END_DISPATCH_QUEUE
@@ -336,10 +544,17 @@
 - (void)close{
     BEGIN_DISPATCH_QUEUE
     [_dataQueue clear];
+    [_gopCache clear];
+    _trackerClearPending = YES;
     if(_decodeThread!=nil){
         [_decodeThread cancel];
     }
     _status.isRunning = NO;
+    [_decodePool removeStream:self];
+    free(_heldFrame);
+    _heldFrame = NULL;
+    [_presenter stop];
+    [_presenter clear];
     END_DISPATCH_QUEUE
 }
 
@@ -368,6 +583,14 @@
 }
 
 - (BOOL) setDecoderWithProduct:(DJIBaseProduct*)product andDecoderType:(VideoPreviewerDecoderType)decoder {
+    BOOL configured = [self configDecoderWithProduct:product andDecoderType:decoder];
+    if (configured) {
+        [_keyframeStore preloadForProductModel:product.model encoderType:_encoderType];
+    }
+    return configured;
+}
+
+- (BOOL) configDecoderWithProduct:(DJIBaseProduct*)product andDecoderType:(VideoPreviewerDecoderType)decoder {
     if (product == nil) {
         return NO;
     }
@@ -475,6 +698,7 @@
     
     _encoderType = encoderType;
     _stream_basic_info.encoderType = encoderType;
+    [_gopCache clear];
 }
 
 -(void) setEnableHardwareDecode:(BOOL)enableHardwareDecode{
@@ -490,8 +714,9 @@
     if (processor) {
 
         pthread_mutex_lock(&_processor_mutex);
-        [_stream_processor_list addObject:processor];
+        [self publishProcessorSnapshot:[self.processorSnapshot snapshotByAddingStreamProcessor:processor]];
         pthread_mutex_unlock(&_processor_mutex);
+        [self updateProcessorBudgets];
     }
 }
 
@@ -499,19 +724,114 @@
     if (processor) {
         
         pthread_mutex_lock(&_processor_mutex);
-        [_frame_processor_list addObject:processor];
+        [self publishProcessorSnapshot:[self.processorSnapshot snapshotByAddingFrameProcessor:processor]];
         pthread_mutex_unlock(&_processor_mutex);
+        [self updateProcessorBudgets];
     }
 }
 
 -(void) unregistProcessor:(id)processor{
     
     pthread_mutex_lock(&_processor_mutex);
-    [_stream_processor_list removeObject:processor];
-    [_frame_processor_list removeObject:processor];
+    [self publishProcessorSnapshot:[self.processorSnapshot snapshotByRemovingProcessor:processor]];
     pthread_mutex_unlock(&_processor_mutex);
 }
 
+-(DJIVideoProcessorSnapshot*) processorSnapshot{
+    //retained before the reader is counted out, the publisher can not release it in between
+    __atomic_add_fetch(&_snapshotReaders, 1, __ATOMIC_SEQ_CST);
+    CFTypeRef snapshot = CFRetain(__atomic_load_n(&_publishedSnapshot, __ATOMIC_SEQ_CST));
+    __atomic_sub_fetch(&_snapshotReaders, 1, __ATOMIC_SEQ_CST);
+    return CFBridgingRelease(snapshot);
+}
+
+//swap in a new snapshot, called under _processor_mutex
+-(void) publishProcessorSnapshot:(DJIVideoProcessorSnapshot*)snapshot{
+    void* retired = __atomic_exchange_n(&_publishedSnapshot, (__bridge_retained void*)snapshot, __ATOMIC_SEQ_CST);
+    
+    //a reader counted in before the exchange may hold the old snapshot without a retain. one counted in after it
+    //loads the new one, so the old one is released as soon as no reader is left
+    while (__atomic_load_n(&_snapshotReaders, __ATOMIC_SEQ_CST)) {
+        sched_yield();
+    }
+    CFBridgingRelease(retired);
+}
+
+-(NSArray*) processorCosts{
+    DJIVideoProcessorSnapshot* snapshot = self.processorSnapshot;
+    NSMutableArray* costs = [NSMutableArray array];
+    for (DJIVideoStreamProcessorEntry* entry in snapshot.streamEntries) {
+        [costs addObject:entry.cost];
+    }
+    for (DJIVideoFrameProcessorEntry* entry in snapshot.frameEntries) {
+        if (entry.processor != self) {
+            [costs addObject:entry.cost];
+        }
+    }
+    return costs;
+}
+
+-(void) setSlowProcessorFrameShare:(double)slowProcessorFrameShare{
+    _slowProcessorFrameShare = slowProcessorFrameShare;
+    [self updateProcessorBudgets];
+}
+
+//the processors share the interval of one frame at the current frame rate
+-(void) updateProcessorBudgets{
+    int frameRate = _stream_basic_info.frameRate > 0 ? _stream_basic_info.frameRate : 30;
+    uint64_t budget = (uint64_t)MAX(0, 1000000.0/frameRate*_slowProcessorFrameShare);
+    
+    DJIVideoProcessorSnapshot* snapshot = self.processorSnapshot;
+    for (DJIVideoStreamProcessorEntry* entry in snapshot.streamEntries) {
+        entry.cost.budget = budget;
+    }
+    for (DJIVideoFrameProcessorEntry* entry in snapshot.frameEntries) {
+        entry.cost.budget = budget;
+    }
+}
+
+-(BOOL) lowestLatencyPlayout{
+    return _playout.lowestLatency;
+}
+
+-(void) setLowestLatencyPlayout:(BOOL)lowestLatencyPlayout{
+    _playout.lowestLatency = lowestLatencyPlayout;
+}
+
+-(double) maxPlayoutDelay{
+    return _playout.maxDelay/1000.0;
+}
+
+-(void) setMaxPlayoutDelay:(double)maxPlayoutDelay{
+    _playout.maxDelay = (uint32_t)MAX(0, maxPlayoutDelay*1000);
+}
+
+-(VideoPlayoutStatistics) playoutStatistics{
+    VideoPlayoutStatistics statistics = _playout.statistics;
+    statistics.resyncCount = _videoExtractor.timestampResyncCount;
+    return statistics;
+}
+
+-(VideoResumeStatistics) resumeStatistics{
+    return _resumeTracker.statistics;
+}
+
+-(double) safeResumeTimeout{
+    return _resumeTracker.timeout/1000.0;
+}
+
+-(void) setSafeResumeTimeout:(double)safeResumeTimeout{
+    _resumeTracker.timeout = (uint64_t)MAX(0, safeResumeTimeout*1000);
+}
+
+-(VideoFrameMailboxStatistics) presentationStatistics{
+    return _presenter.statistics;
+}
+
+-(VideoStreamTrackerStatistics) trackingStatistics{
+    return _streamTracker.statistics;
+}
+
 #pragma mark - private
 - (void)enterBackground{
     //It is not allowed to call OpenGL's interface in the background. Ensure all work is done before entering the background.
@@ -524,6 +844,7 @@
 - (void)enterForegournd{
     NSLog(@"videoPreviewer active");
     _status.isBackground = NO;
+    _replayGOPPending = YES;
 }
 
 // Update the decoder's status according to the time stamp when the previous data is received
@@ -559,161 +880,360 @@
     return microSec;
 }
 
--(void) decodeRunloop
+//on the decode thread, or on the workers of the pool, called in the dispatch queue
+-(void) startDecoding
+{
+    if (_decodePool) {
+        [self prepareDecodeLoop];
+        _lastDecodeStepTime = [self getTickCount];
+        [_decodePool addStream:self priority:_decodePriority];
+        return;
+    }
+    
+    _decodeThread = [[NSThread alloc] initWithTarget:self selector:@selector(decodeRunloop) object:nil];
+    _decodeThread.qualityOfService = NSQualityOfServiceUserInteractive;
+    [_decodeThread start];
+}
+
+//returns once the decoding has stopped, called in the dispatch queue
+-(void) stopDecoding
+{
+    _status.isRunning = NO;
+    
+    if (_decodePool) {
+        [_decodePool removeStream:self];
+        _status.isFinish = YES;
+        free(_heldFrame);
+        _heldFrame = NULL;
+        return;
+    }
+    
+    while (!_status.isFinish) {
+        usleep(10000);
+    }
+    [_decodeThread cancel];
+    while (!_decodeThread.isFinished) {
+        usleep(10000);
+    }
+    _decodeThread = nil;
+}
+
+-(void) setDecodePriority:(NSUInteger)decodePriority{
+    _decodePriority = MAX(1, decodePriority);
+    [_decodePool setPriority:_decodePriority ofStream:self];
+}
+
+#pragma mark - decode pool
+
+-(BOOL) decodePoolStreamHasWork{
+    if (!_status.isRunning) {
+        return NO;
+    }
+    
+    if (_heldFrame) {
+        return videoClockTimeTag() >= _heldFrameDue;
+    }
+    
+    return _dataQueue.count > 0 || _idleStepPending || [self getTickCount] - _lastDecodeStepTime > VIDEO_DECODE_POOL_IDLE_INTERVAL;
+}
+
+-(void) decodePoolStreamStep{
+    if (!_status.isRunning) {
+        return;
+    }
+    
+    _idleStepPending = NO;
+    _lastDecodeStepTime = [self getTickCount];
+    
+    int queueNodeSize;
+    VideoFrameH264Raw* frameRaw = NULL;
+    if (_heldFrame) {
+        frameRaw = _heldFrame;
+        queueNodeSize = _heldFrameSize;
+        _heldFrame = NULL;
+    }else{
+        frameRaw = (VideoFrameH264Raw*)[_dataQueue tryPull:&queueNodeSize];
+        
+        //a worker never sleeps on a frame, the frame waits here and the pool is signaled when it is due
+        uint64_t due = [self playoutTimeOfFrame:frameRaw size:queueNodeSize];
+        uint64_t now = videoClockTimeTag();
+        if (due > now) {
+            _heldFrame = frameRaw;
+            _heldFrameSize = queueNodeSize;
+            _heldFrameDue = due;
+            
+            __weak VideoPreviewer* weakSelf = self;
+            dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(due - now)*NSEC_PER_USEC),
+                           dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0), ^{
+                VideoPreviewer* strongSelf = weakSelf;
+                [strongSelf.decodePool signalStream:strongSelf];
+            });
+            return;
+        }
+    }
+    [self decodeFrame:frameRaw size:queueNodeSize];
+}
+
+//when the frame should leave the playout buffer, now for frames without a presentation time
+-(uint64_t) playoutTimeOfFrame:(VideoFrameH264Raw*)frameRaw size:(int)queueNodeSize{
+    uint64_t now = videoClockTimeTag();
+    if (!frameRaw || frameRaw->frame_size + sizeof(VideoFrameH264Raw) != queueNodeSize
+        || frameRaw->type_tag != TYPE_TAG_VideoFrameH264Raw || !frameRaw->pts) {
+        return now;
+    }
+    
+    return videoPlayoutTime(&_playout, frameRaw->pts, frameRaw->time_tag, now);
+}
+
+#pragma mark - decode loop
+
+-(void) prepareDecodeLoop
 {
     _status.isRunning = YES;
     _status.isFinish = NO;
-    safe_resume_skip_count = 0;
+    videoResumeCancel(&_resumeTracker);
     
     videoDecoderCanReset = NO;
     videoDecoderFailedCount = 0;
-    DJIVideoStreamBasicInfo current_stream_info = {0};
-    
-    __block long decodeTime = 0;
+    _waitingForKeyFrame = NO;
+    _resyncKeyframeSubmitted = NO;
+    memset(&_current_stream_info, 0, sizeof(_current_stream_info));
+    videoPlayoutReset(&_playout);
+}
+
+-(void) decodeRunloop
+{
+    [self prepareDecodeLoop];
     
     while(_status.isRunning)
     {
         @autoreleasepool
         {
-            VideoFrameH264Raw* frameRaw = nil;
-            int inputDataSize = 0;
-            uint8_t *inputData = nil;
-            
             int queueNodeSize;
-            frameRaw = (VideoFrameH264Raw*)[_dataQueue pull:&queueNodeSize]; //now we have got h264 raw format data in frameRaw
-            if (frameRaw && frameRaw->frame_size + sizeof(VideoFrameH264Raw) == queueNodeSize) {
-                inputData = frameRaw->frame_data;
-                inputDataSize = frameRaw->frame_size;
+            VideoFrameH264Raw* frameRaw = (VideoFrameH264Raw*)[_dataQueue pull:&queueNodeSize]; //now we have got h264 raw format data in frameRaw
+            
+            uint64_t due = [self playoutTimeOfFrame:frameRaw size:queueNodeSize];
+            for (uint64_t now = videoClockTimeTag(); now < due && _status.isRunning; now = videoClockTimeTag()) {
+                usleep((useconds_t)MIN(due - now, VIDEO_PLAYOUT_WAIT_SLICE));
             }
-            [self updateDecoderStatus];
+            [self decodeFrame:frameRaw size:queueNodeSize];
+        }
+    }
+    
+    _status.isFinish = YES;
+}
+
+//one pass of the decode loop, NULL when no frame arrived in time, the frame is released here
+-(void) decodeFrame:(VideoFrameH264Raw*)frameRaw size:(int)queueNodeSize
+{
+    int inputDataSize = 0;
+    uint8_t *inputData = nil;
+    
+    if (frameRaw && frameRaw->frame_size + sizeof(VideoFrameH264Raw) == queueNodeSize) {
+        inputData = frameRaw->frame_data;
+        inputDataSize = frameRaw->frame_size;
+    }
+    [self updateDecoderStatus];
+    
+    if (_resumePending) {
+        _resumePending = NO;
+        videoResumeBegin(&_resumeTracker, videoClockTimeTag());
+    }
+    
+    if(inputData == NULL)
+    {
+        if (_resumeTracker.resuming) {
+            //waiting for safe resume
+            _status.hasImage = NO; // no image, but it won't trigger the NoImage notification
+            [self finishResume:videoResumeCheckTimeout(&_resumeTracker, videoClockTimeTag())];
+            free(frameRaw);
+            return;
+        }
+        
+        videoDecoderCanReset = NO;
+        pthread_mutex_lock(&_render_mutex);
+        if([self glviewCanRender]){
+            // render as grey when it is paused
+            _glView.grayScale = _grayOutPause;
+            [_glView render:nil];
+            _glView.grayScale = NO;
+        }
+        pthread_mutex_unlock(&_render_mutex);
+        
+        if(_status.hasImage && !_status.isPause){
+            _status.hasImage = NO;
+            [[NSNotificationCenter defaultCenter] postNotificationName:VIDEO_PREVIEWER_EVEN_NOTIFICATIOIN object:@(VideoPreviewerEventNoImage)];
+        }
+        free(frameRaw);
+        return;
+    }
+    
+    if(!_status.hasImage){
+        _status.hasImage = YES;
+        [[NSNotificationCenter defaultCenter] postNotificationName:VIDEO_PREVIEWER_EVEN_NOTIFICATIOIN object:@(VideoPreviewerEventHasImage)];
+    }
+    
+    VideoResumeResult resumeResult = VideoResumeResultPending;
+    BOOL stream_info_changed = NO;
+    _stream_basic_info.frameRate = _videoExtractor.frameRate;
+    _stream_basic_info.frameSize = CGSizeMake(_videoExtractor.outputWidth, _videoExtractor.outputHeight);
+    if (memcmp(&_current_stream_info, &_stream_basic_info, sizeof(_current_stream_info)) !=0 ) {
+        _current_stream_info = _stream_basic_info;
+        stream_info_changed = YES;
+    }
+    
+    if (frameRaw->type_tag == TYPE_TAG_VideoFrameH264Raw) {
+        
+        //decoder select
+        if(_hw_decoder && !_hw_decoder.hardware_unavailable && _enableHardwareDecode){
+            //decode use video toolbox
+            _hw_decoder.enabled = YES;
+            _soft_decoder.enabled = NO;
             
-            if(inputData == NULL)
-            {
-                if (safe_resume_skip_count) {
-                    //waiting for safe resume
-                    _status.hasImage = NO; // no image, but it won't trigger the NoImage notification
-                    continue;
+            self.frameOutputType = VPFrameTypeYUV420Planer;
+        }
+        else{
+            _hw_decoder.enabled = NO;
+            _soft_decoder.enabled = YES;
+            self.frameOutputType = VPFrameTypeYUV420Planer;
+        }
+        
+        //phantom 4 hack
+        if (_encoderType == H264EncoderType_1860_phantom4x) {
+            frameRaw->frame_info.frame_flag.has_idr = 0;
+        }
+        
+        if (frameRaw->frame_info.frame_flag.has_sps) {
+            uint32_t paramSetHash = parameterSetsHash(frameRaw->frame_data, frameRaw->frame_size);
+            if (paramSetHash) {
+                _lastSeenParamSetHash = paramSetHash;
+            }
+        }
+        
+        //after a resync the decoder only restarts on a frame it can decode without references
+        BOOL skipDecode = NO;
+        if (_waitingForKeyFrame) {
+            if (frameRaw->frame_info.frame_flag.has_idr
+                || frameRaw->frame_info.frame_flag.has_sps) {
+                _waitingForKeyFrame = NO;
+                _resyncKeyframeSubmitted = YES;
+            }else{
+                skipDecode = YES;
+            }
+        }
+        
+        DJIVideoProcessorSnapshot* snapshot = self.processorSnapshot;
+        
+        //the stored keyframe only warms up the decoders
+        BOOL isPrimingFrame = _primingFrameUUID && frameRaw->frame_uuid == _primingFrameUUID;
+        if (isPrimingFrame) {
+            _primingFrameUUID = 0;
+            _suppressFrameOutput = YES;
+        }
+        
+        if (_replayGOPPending && !_status.isBackground && !skipDecode && !isPrimingFrame) {
+            _replayGOPPending = NO;
+            if ([self replayGOPCacheBeforeFrame:frameRaw decoders:snapshot.decoderEntries]) {
+                //the references are rebuilt, the current frame is safe to show
+                videoResumeChainRebuilt(&_resumeTracker);
+            }
+        }
+        
+        //processors, the modifiers first, then the decoders on this thread, the rest on their workers
+        if (stream_info_changed) {
+            [self updateProcessorBudgets];
+            for (DJIVideoStreamProcessorEntry* entry in snapshot.streamEntries) {
+                if (entry.worker) {
+                    [entry.worker submitInfoChanged:_current_stream_info];
                 }
-                
-                videoDecoderCanReset = NO;
-                pthread_mutex_lock(&_render_mutex);
-                if([self glviewCanRender]){
-                    // render as grey when it is paused
-                    _glView.grayScale = _grayOutPause;
-                    [_glView render:nil];
-                    _glView.grayScale = NO;
+                else if (entry.handlesInfoChanged) {
+                    [entry.processor streamProcessorInfoChanged:&_current_stream_info];
                 }
-                pthread_mutex_unlock(&_render_mutex);
-                
-                if(_status.hasImage && !_status.isPause){
-                    _status.hasImage = NO;
-                    [[NSNotificationCenter defaultCenter] postNotificationName:VIDEO_PREVIEWER_EVEN_NOTIFICATIOIN object:@(VideoPreviewerEventNoImage)];
+            }
+        }
+        
+        if (!isPrimingFrame) {
+            for (DJIVideoStreamProcessorEntry* entry in snapshot.modifyEntries) {
+                if ([entry.processor streamProcessorEnabled]) {
+                    uint64_t beforeModify = videoClockTimeTag();
+                    [entry.processor streamProcessorHandleFrameRaw:frameRaw];
+                    [entry.cost recordDuration:videoClockTimeTag() - beforeModify];
                 }
+            }
+        }
+        
+        BOOL frameDecoded = NO;
+        for (DJIVideoStreamProcessorEntry* entry in snapshot.decoderEntries) {
+            if(![entry.processor streamProcessorEnabled] || _status.isBackground || skipDecode){ // do nothing when it is in background
                 continue;
             }
             
-            if(!_status.hasImage){
-                _status.hasImage = YES;
-                [[NSNotificationCenter defaultCenter] postNotificationName:VIDEO_PREVIEWER_EVEN_NOTIFICATIOIN object:@(VideoPreviewerEventHasImage)];
+            uint64_t beforeDecode = videoClockTimeTag();
+            BOOL decoded = [entry.processor streamProcessorHandleFrameRaw:frameRaw];  //start decode here 
+            [entry.cost recordDuration:videoClockTimeTag() - beforeDecode];
+            if (decoded) {
+                videoDecoderCanReset = YES;
+                frameDecoded = YES;
+            }else{
+                [self videoProcessFailedFrame];
             }
-            
-            BOOL stream_info_changed = NO;
-            _stream_basic_info.frameRate = _videoExtractor.frameRate;
-            _stream_basic_info.frameSize = CGSizeMake(_videoExtractor.outputWidth, _videoExtractor.outputHeight);
-            if (memcmp(&current_stream_info, &_stream_basic_info, sizeof(current_stream_info)) !=0 ) {
-                current_stream_info = _stream_basic_info;
-                stream_info_changed = YES;
+        }
+        
+        //the decoder output feeds the resume tracker, a frame no decoder took never reaches it
+        if (!frameDecoded) {
+            videoResumeChainBroken(&_resumeTracker);
+        }
+        BOOL isKeyframe = frameRaw->frame_info.frame_flag.has_idr || frameRaw->frame_info.frame_flag.has_sps;
+        resumeResult = videoResumeCheckTimeout(&_resumeTracker, videoClockTimeTag());
+        
+        if (!isPrimingFrame) {
+            //the last enabled worker takes the frame itself instead of a copy
+            NSUInteger lastWorker = NSNotFound;
+            NSArray* workerEntries = snapshot.workerEntries;
+            for (NSUInteger i = workerEntries.count; i > 0; i--) {
+                DJIVideoStreamProcessorEntry* entry = workerEntries[i - 1];
+                if ([entry.processor streamProcessorEnabled]) {
+                    lastWorker = i - 1;
+                    break;
+                }
             }
             
-            if (frameRaw->type_tag == TYPE_TAG_VideoFrameH264Raw) {
-                
-                //decoder select
-                if(_hw_decoder && !_hw_decoder.hardware_unavailable && _enableHardwareDecode){
-                    //decode use video toolbox
-                    _hw_decoder.enabled = YES;
-                    _soft_decoder.enabled = NO;
-                    
-                    self.frameOutputType = VPFrameTypeYUV420Planer;
-                }
-                else{
-                    _hw_decoder.enabled = NO;
-                    _soft_decoder.enabled = YES;
-                    self.frameOutputType = VPFrameTypeYUV420Planer;
-                }
-                
-                //phantom 4 hack
-                if (_encoderType == H264EncoderType_1860_phantom4x) {
-                    frameRaw->frame_info.frame_flag.has_idr = 0;
+            for (NSUInteger i = 0; lastWorker != NSNotFound && i <= lastWorker; i++) {
+                DJIVideoStreamProcessorEntry* entry = workerEntries[i];
+                if (i != lastWorker && ![entry.processor streamProcessorEnabled]) {
+                    continue;
                 }
                 
-                pthread_mutex_lock(&_processor_mutex);
-                NSArray* streamProcessorCopyList = [NSArray arrayWithArray:_stream_processor_list];
-                pthread_mutex_unlock(&_processor_mutex);
-                
-                //processors
-                for (id<VideoStreamProcessor> processor in streamProcessorCopyList) {
-                    if (![processor conformsToProtocol:@protocol(VideoStreamProcessor)]) {
-                        continue;
-                    }
-                    
-                    if (stream_info_changed && [processor respondsToSelector:@selector(streamProcessorInfoChanged:)]) {
-                        [processor streamProcessorInfoChanged:&current_stream_info];
-                    }
-                    
-                    if (![processor streamProcessorEnabled]) {
-                        continue;
-                    }
-                    
-                    DJIVideoStreamProcessorType processor_type = [processor streamProcessorType];
-                    
-                    if (processor_type == DJIVideoStreamProcessorType_Decoder)
-                    {
-                        if(!_status.isBackground){ // do nothing when it is in background
-                            long long beforeDecode = [self getTickCount];
-                            if ([processor streamProcessorHandleFrameRaw:frameRaw]) {  //start decode here 
-                                videoDecoderCanReset = YES;
-                            }else{
-                                [self videoProcessFailedFrame];
-                            }
-                            decodeTime = (long)([self getTickCount] - beforeDecode);
-                        }
-                    }
-                    else if(processor_type == DJIVideoStreamProcessorType_Modify
-                             || processor_type == DJIVideoStreamProcessorType_Passthrough){
-                        [processor streamProcessorHandleFrameRaw:frameRaw];
-                    }
-                    else if (processor_type == DJIVideoStreamProcessorType_Consume){
-                        if(processor != _stream_processor_list.lastObject) {
-                            VideoFrameH264Raw* data_copy = (VideoFrameH264Raw*)malloc(queueNodeSize);
-                            memcpy(data_copy, frameRaw, queueNodeSize);
-                            if (![processor streamProcessorHandleFrameRaw:data_copy]) {
-                                free(data_copy);
-                            }
-                        }
-                        else if([processor streamProcessorHandleFrameRaw:frameRaw]){
-                            frameRaw = NULL; // the frame is not released
-                        }
-                    }
-                } //for
-            }//if
-            
-            if(safe_resume_skip_count){
-                safe_resume_skip_count--;
-                NSLog(@"safe resume frame:%d", safe_resume_skip_count);
-                if (safe_resume_skip_count == 0) {
-                    NSLog(@"safe resume complete");
-                    [[NSNotificationCenter defaultCenter] postNotificationName:VIDEO_PREVIEWER_EVEN_NOTIFICATIOIN object:@(VideoPreviewerEventResumeReady)];
+                if ([entry.worker submitFrame:frameRaw size:queueNodeSize keyframe:isKeyframe copy:i != lastWorker]
+                    && i == lastWorker) {
+                    frameRaw = NULL; // the frame is released by the worker
                 }
             }
-            
-            if (frameRaw) {
-                free(frameRaw);
-                frameRaw = NULL;
-            }
         }
+        
+        if (isPrimingFrame) {
+            _suppressFrameOutput = NO;
+        }
+    }//if
+    
+    [self finishResume:resumeResult];
+    
+    if (frameRaw) {
+        free(frameRaw);
+        frameRaw = NULL;
+    }
+}
+
+//post the resume once it ends, clean or timed out
+-(void) finishResume:(VideoResumeResult)result{
+    if (result == VideoResumeResultPending) {
+        return;
     }
     
-    _status.isFinish = YES;
+    VideoResumeStatistics statistics = _resumeTracker.statistics;
+    NSLog(@"safe resume complete after %.1fms, %u frames hidden%@", statistics.lastLatency, statistics.lastHiddenFrameCount,
+          result == VideoResumeResultTimedOut ? @", timed out" : @"");
+    [[NSNotificationCenter defaultCenter] postNotificationName:VIDEO_PREVIEWER_EVEN_NOTIFICATIOIN object:@(VideoPreviewerEventResumeReady)];
 }
 
 -(BOOL) videoProcessorEnabled
@@ -721,67 +1241,261 @@
     return YES;
 }
 
+-(void) presentFrame:(VideoFrameYUV *)frame{
+    pthread_mutex_lock(&_render_mutex);
+    if ([self glviewCanRender]) {
+        [_glView render:frame];
+    }
+    pthread_mutex_unlock(&_render_mutex);
+}
+
 -(void) videoProcessFrame:(VideoFrameYUV *)frame{
     _lastFrameDecodedTime = [self getTickCount];
+    _decodedParamSetHash = _lastSeenParamSetHash;
+    //a flushed decoder may still output the frames it held, they do not end a resync
+    if (_recoveryMode == VideoDecoderRecoveryModeRebuild
+        || (_recoveryMode == VideoDecoderRecoveryModeResync && _resyncKeyframeSubmitted)) {
+        [self finishRecovery];
+    }
+    if (_resetStartTime) {
+        _resetToFirstFrameDuration = (_lastFrameDecodedTime - _resetStartTime)/1000.0;
+        _resetStartTime = 0;
+        NSLog(@"first frame %.1fms after reset", _resetToFirstFrameDuration);
+    }
+    
+    //a frame submitted to the decoder may still fail inside it, so the chain is followed at the output
+    BOOL keyframe = frame->frame_info.frame_flag.has_idr || frame->frame_info.frame_flag.has_sps;
+    [self finishResume:videoResumeFrameDecoded(&_resumeTracker, &frame->frame_info, keyframe, YES, videoClockTimeTag())];
     
-    if (safe_resume_skip_count || _status.isPause) {
+    if (_resumeTracker.resuming || _resumePending || _status.isPause || _suppressFrameOutput) {
         return;
     }
     
-    pthread_mutex_lock(&_render_mutex);
+    if (_firstDataTime) {
+        double duration = (_lastFrameDecodedTime - _firstDataTime)/1000.0;
+        _firstDataTime = 0;
+        if (_primedWithStoredKeyframe) {
+            _startupStatistics.primedTimeToFirstFrame = duration;
+        }else{
+            _startupStatistics.coldTimeToFirstFrame = duration;
+        }
+        NSLog(@"time to first frame %.1fms (%@)", duration, _primedWithStoredKeyframe?@"stored keyframe":@"cold");
+    }
+    
+    //the presenter renders a copy on its own thread, the decoder moves on at once
     if ([self glviewCanRender]) {
-        [_glView render:frame];
+        [_presenter publishFrame:frame];
     }
-    pthread_mutex_unlock(&_render_mutex);
     
-    pthread_mutex_lock(&_processor_mutex);
-    NSArray* frameProcessorCopyList = [NSArray arrayWithArray:_frame_processor_list];
-    pthread_mutex_unlock(&_processor_mutex);
+    NSArray* frameEntries = self.processorSnapshot.frameEntries;
     
-    for (id<VideoFrameProcessor> processor in frameProcessorCopyList) {
-        if (processor == self) {
+    //build the pyramid once, as deep as the deepest subscriber needs
+    int pyramidLevelCount = 0;
+    for (DJIVideoFrameProcessorEntry* entry in frameEntries) {
+        int level = [self pyramidLevelOfEntry:entry];
+        if (level >= 0 && level + 1 > pyramidLevelCount) {
+            pyramidLevelCount = level + 1;
+        }
+    }
+    if (pyramidLevelCount) {
+        pyramidLevelCount = videoPyramidBuild(&_pyramid, frame, pyramidLevelCount);
+    }
+    
+    for (DJIVideoFrameProcessorEntry* entry in frameEntries) {
+        id<VideoFrameProcessor> processor = entry.processor;
+        if (processor == self || ![processor videoProcessorEnabled]) {
             continue;
         }
         
-        if ([processor conformsToProtocol:@protocol(VideoFrameProcessor)]) {
-            
-            if (![processor videoProcessorEnabled]) {
-                continue;
-            }
-            
+        int level = [self pyramidLevelOfEntry:entry];
+        if (level >= pyramidLevelCount) {
+            continue;
+        }
+        VideoFramePyramidLevel* pyramidLevel = level >= 0 ? &_pyramid.levels[level] : NULL;
+        
+        if (entry.isDemoted) {
+            [entry submitFrame:frame level:pyramidLevel];
+            continue;
+        }
+        
+        uint64_t beforeProcess = videoClockTimeTag();
+        if (pyramidLevel) {
+            [processor videoProcessPyramidLevel:pyramidLevel frame:frame];
+        }else{
             [processor videoProcessFrame:frame];
         }
+        [entry.cost recordDuration:videoClockTimeTag() - beforeProcess];
+        
+        if (_demoteSlowFrameProcessors && entry.cost.slow) {
+            [entry demote];
+        }
     }
 }
 
+//-1 when the processor takes the full size frame
+-(int) pyramidLevelOfEntry:(DJIVideoFrameProcessorEntry*)entry{
+    if (!entry.handlesPyramidLevel || entry.processor == self || ![entry.processor videoProcessorEnabled]) {
+        return -1;
+    }
+    
+    int level = [entry.processor videoProcessorPyramidLevel];
+    if (level >= VIDEO_PYRAMID_MAX_LEVEL_COUNT) {
+        level = VIDEO_PYRAMID_MAX_LEVEL_COUNT - 1;
+    }
+    return level;
+}
+
 //单帧解析失败
 -(void) videoProcessFailedFrame{
     
     videoDecoderFailedCount++;
+    videoResumeChainBroken(&_resumeTracker);
     
-    if (videoDecoderFailedCount >= 6) {
+    if (videoDecoderFailedCount >= VIDEO_DECODER_RECOVERY_FAILED_COUNT) {
         if (videoDecoderCanReset || _enableHardwareDecode){
-            [self reset];
+            //flushing is enough for a damaged stream, new parameter sets need a new decoder
+            BOOL paramSetsChanged = _decodedParamSetHash && _lastSeenParamSetHash != _decodedParamSetHash;
+            if (paramSetsChanged || _resyncAttempts >= VIDEO_DECODER_MAX_RESYNC_ATTEMPTS) {
+                [self rebuildDecoder];
+            }else{
+                [self resyncDecoder];
+            }
             videoDecoderCanReset = NO;
         }
         
         videoDecoderFailedCount = 0;
     }
     
-    pthread_mutex_lock(&_processor_mutex);
-    NSArray* frameProcessorCopyList = [NSArray arrayWithArray:_frame_processor_list];
-    pthread_mutex_unlock(&_processor_mutex);
+    for (DJIVideoFrameProcessorEntry* entry in self.processorSnapshot.frameEntries) {
+        if (![entry.processor videoProcessorEnabled]) {
+            continue;
+        }
+        
+        if (entry.isDemoted) {
+            [entry submitFailedFrame];
+        }else{
+            [entry.processor videoProcessFailedFrame];
+        }
+    }
+}
+
+#pragma mark - stored keyframe
+
+//measure the next first frame and prime the extractor when the stream starts, called in the dispatch queue
+-(void) prepareFirstFrame{
+    _firstDataTime = 0;
+    _primedWithStoredKeyframe = NO;
+    _primeOutputPending = NO;
+    _primingFrameUUID = 0;
+    _primePending = YES;
+}
+
+//feed the stored keyframe to the parser ahead of the aircraft's data so decoding starts with the first P frame
+-(void) primeWithStoredKeyframe:(uint32_t)liveParamSetHash{
+    _primePending = NO;
+    if (_encoderType == H264EncoderType_LightBridge2) {
+        return;
+    }
     
-    for (id<VideoFrameProcessor> processor in frameProcessorCopyList) {
-        if ([processor conformsToProtocol:@protocol(VideoFrameProcessor)]) {
-            
-            if (![processor videoProcessorEnabled]) {
-                continue;
+    //a keyframe encoded with other parameter sets corrupts the frames until the next idr. before any parameter sets
+    //were seen the latest keyframe is still used: a product keeps its parameter sets between flights, and a wrong
+    //picture for one gop is preferred to a blank one on every cold start
+    uint32_t paramSetHash = liveParamSetHash ? liveParamSetHash : _lastSeenParamSetHash;
+    NSData* keyframe = paramSetHash ? [_keyframeStore keyframeForParamSetHash:paramSetHash] : [_keyframeStore latestKeyframe];
+    if (keyframe == nil) {
+        return;
+    }
+    
+    _primeOutputPending = YES;
+    _primedWithStoredKeyframe = YES;
+    [_videoExtractor parseVideo:(uint8_t*)keyframe.bytes length:(int)keyframe.length withFrame:^(VideoFrameH264Raw *frame) {
+        if (!frame) {
+            return;
+        }
+        [self enqueueFrame:frame];
+    }];
+}
+
+#pragma mark - gop replay
+
+//feed the cached frames before `frame` to the decoders with the output suppressed, called in the decoding thread
+-(BOOL) replayGOPCacheBeforeFrame:(VideoFrameH264Raw*)frame decoders:(NSArray*)decoderEntries{
+    if (frame->frame_info.frame_flag.has_sps || frame->frame_info.frame_flag.has_idr) {
+        //the decoder can start from this frame directly
+        return NO;
+    }
+    
+    NSArray* cachedFrames = [_gopCache framesBeforeUUID:frame->frame_uuid];
+    if (cachedFrames.count == 0) {
+        return NO;
+    }
+    
+    long long replayStart = [self getTickCount];
+    _suppressFrameOutput = YES;
+    for (NSData* data in cachedFrames) {
+        NSMutableData* frameCopy = [data mutableCopy];
+        VideoFrameH264Raw* cachedFrame = (VideoFrameH264Raw*)frameCopy.mutableBytes;
+        
+        for (DJIVideoStreamProcessorEntry* entry in decoderEntries) {
+            if ([entry.processor streamProcessorEnabled]) {
+                [entry.processor streamProcessorHandleFrameRaw:cachedFrame];
             }
-            
-            [processor videoProcessFailedFrame];
         }
     }
+    _suppressFrameOutput = NO;
+    
+    NSLog(@"replayed %d cached frames in %.1fms", (int)cachedFrames.count, ([self getTickCount] - replayStart)/1000.0);
+    return YES;
+}
+
+#pragma mark - error recovery
+
+-(void) beginRecovery:(VideoDecoderRecoveryMode)mode{
+    _recoveryStartTime = [self getTickCount];
+    self.recoveryMode = mode;
+}
+
+-(void) finishRecovery{
+    double duration = ([self getTickCount] - _recoveryStartTime)/1000.0;
+    
+    if (_recoveryMode == VideoDecoderRecoveryModeResync) {
+        _recoveryStatistics.resyncCount++;
+        _recoveryStatistics.lastResyncDuration = duration;
+        _recoveryStatistics.totalResyncDuration += duration;
+        NSLog(@"decoder resync recovered in %.1fms", duration);
+    }
+    else if (_recoveryMode == VideoDecoderRecoveryModeRebuild) {
+        _recoveryStatistics.rebuildCount++;
+        _recoveryStatistics.lastRebuildDuration = duration;
+        _recoveryStatistics.totalRebuildDuration += duration;
+        NSLog(@"decoder rebuild recovered in %.1fms", duration);
+    }
+    
+    _resyncAttempts = 0;
+    self.recoveryMode = VideoDecoderRecoveryModeNone;
+}
+
+//flush the decoders and wait for the next idr, called in the decoding thread
+-(void) resyncDecoder{
+    NSLog(@"decoder resync");
+    _waitingForKeyFrame = YES;
+    _resyncKeyframeSubmitted = NO;
+    
+    //the hardware decoder outputs its pending frames while it is flushed, before the recovery starts
+    for (DJIVideoStreamProcessorEntry* entry in self.processorSnapshot.decoderEntries) {
+        if (entry.handlesFlush) {
+            [entry.processor streamProcessorFlush];
+        }
+    }
+    
+    [self beginRecovery:VideoDecoderRecoveryModeResync];
+    _resyncAttempts++;
+}
+
+-(void) rebuildDecoder{
+    NSLog(@"decoder rebuild");
+    [self beginRecovery:VideoDecoderRecoveryModeRebuild];
+    [self reset];
 }
 
 - (NSUInteger)runLoopCount{
@@ -800,6 +1514,9 @@
     
     [_videoExtractor freeExtractor];
     [self close];
+    videoPyramidRelease(&_pyramid);
+    videoStreamTrackerRelease(&_streamTracker);
+    CFBridgingRelease(_publishedSnapshot);
     
     [[NSNotificationCenter defaultCenter] removeObserver:self name:UIApplicationDidEnterBackgroundNotification object:nil];
     [[NSNotificationCenter defaultCenter] removeObserver:self name:UIApplicationWillEnterForegroundNotification object:nil];
@@ -877,6 +1594,8 @@
             if (frame && frame->frame_uuid != H264_FRAME_INVALIED_UUID) {
                 yuvImage.frame_info = frame->frame_info;
                 yuvImage.frame_uuid = frame->frame_uuid;
+                yuvImage.time_tag = frame->time_tag;
+                yuvImage.pts = frame->pts;
             }
 
             [self videoProcessFrame:&yuvImage];
@@ -905,6 +1624,8 @@
                  if (frame && frame->frame_uuid != H264_FRAME_INVALIED_UUID) {
                      yuvImage.frame_info = frame->frame_info;
                      yuvImage.frame_uuid = frame->frame_uuid;
+                     yuvImage.time_tag = frame->time_tag;
+                     yuvImage.pts = frame->pts;
                  }
                  yuvImage.cv_pixelbuffer_fastupload = image;
                  [self videoProcessFrame:&yuvImage];
@@ -913,6 +1634,11 @@
              }
 }
 
+-(void) decompressFailedWithFrameInfo:(VideoFrameH264Raw *)frame{
+    //the session already took the frame, its references are lost
+    videoResumeChainBroken(&_resumeTracker);
+}
+
 -(void) hardwareDecoderUnavailable{
     //use soft decoder
     self.enableHardwareDecode = NO;
@@ -59,6 +59,15 @@
  */
 - (uint8_t *)pull:(int *)len;
 
+/**
+ *  Pull data from the queue without waiting.
+ *
+ *  @param len length of data to pull
+ *
+ *  @return Data pulled, NULL when the queue is empty.
+ */
+- (uint8_t *)tryPull:(int *)len;
+
 /**
  *  Returns `YES` if the queue is already full.
  *
@@ -103,12 +103,25 @@ typedef struct{
         ts.tv_sec = tv.tv_sec + 2;
         ts.tv_nsec = tv.tv_usec;
         pthread_cond_timedwait(&_cond, &_mutex, &ts);
-        if(_count == 0)
-        {
-            *len = 0;
-            pthread_mutex_unlock(&_mutex);
-            return NULL;
-        }
+    }
+    uint8_t *tmp = [self popLocked:len];
+    pthread_mutex_unlock(&_mutex);
+    return tmp;
+}
+
+- (uint8_t *)tryPull:(int *)len{
+    pthread_mutex_lock(&_mutex);
+    uint8_t *tmp = [self popLocked:len];
+    pthread_mutex_unlock(&_mutex);
+    return tmp;
+}
+
+//called with the mutex held
+- (uint8_t *)popLocked:(int *)len{
+    if(_count == 0)
+    {
+        *len = 0;
+        return NULL;
     }
     uint8_t *tmp = NULL;
     tmp = _node[_head].ptr;
@@ -116,7 +129,6 @@ typedef struct{
     _head++;
     if(_head>=_size)_head = 0;
     _count--;
-    pthread_mutex_unlock(&_mutex);
     return tmp;
 }
 
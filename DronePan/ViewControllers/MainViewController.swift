@@ -75,6 +75,10 @@ class MainViewController: UIViewController, Analytics {
         self.panoramaController = PanoramaController()
         self.panoramaController!.delegate = self
         self.panoramaController!.cameraControlsDelegate = self
+        self.panoramaController!.overlapVerifier = self.previewController!.overlapVerifier
+        self.panoramaController!.thumbnailDecoder = self.previewController!.thumbnailDecoder
+        self.panoramaController!.frameTimeline = self.previewController!.frameTimeline
+        self.panoramaController!.panoramaPreview = self.previewController!.panoramaPreview
 
         hideWarning()
 
@@ -411,7 +415,7 @@ extension MainViewController: ConnectionControllerDelegate {
     }
 
     func connectedToCamera(camera: DJICamera) {
-        self.panoramaController?.setCamera(camera, preview: self.previewController)
+        self.panoramaController?.setCamera(camera, preview: self.previewController, settleMonitor: self.previewController?.settleMonitor, exposureMonitor: self.previewController?.exposureMonitor)
     }
 
     func disconnectedFromCamera() {
@@ -419,7 +423,7 @@ extension MainViewController: ConnectionControllerDelegate {
     }
 
     func connectedToGimbal(gimbal: DJIGimbal) {
-        self.panoramaController?.setGimbal(gimbal)
+        self.panoramaController?.setGimbal(gimbal, motionMonitor: self.previewController?.motionMonitor)
     }
 
     func disconnectedFromGimbal() {
@@ -113,7 +113,11 @@ class CameraControllerSpyDelegate: CameraControllerDelegate {
         expectation.fulfill()
     }
 
-    func cameraControllerNewMedia(filename: String) {
+    func cameraControllerShutterFired(timeTag: UInt64) {
+        // NOP
+    }
+
+    func cameraControllerNewMedia(filename: String, timeTag: UInt64) {
         // NOP
     }
     
@@ -0,0 +1,38 @@
+/*
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//  Exposes the Project headers of VideoPreviewer to the tests only, the app sees the framework's public headers.
+
+#ifndef DronePanTests_Bridging_Header_h
+#define DronePanTests_Bridging_Header_h
+
+// The framework comes first, its include guards keep the public headers from being read a second time
+#import <VideoPreviewer/VideoPreviewer.h>
+
+#import "DJIVideoPyramid.h"
+#import "DJIVideoColorConvert.h"
+#import "DJIVideoStreamWorker.h"
+#import "DJIVideoJitterBuffer.h"
+#import "DJIVideoFrameMailbox.h"
+#import "DJIVideoPresenter.h"
+#import "DJIVideoProcessorSnapshot.h"
+#import "DJIVideoResumeTracker.h"
+#import "DJIVideoStreamTracker.h"
+#import "DJIVideoStreamRecord.h"
+#import "DJIVideoStreamRecorder.h"
+#import "DJIVideoStreamReplay.h"
+#import "DJIVideoStreamReplayer.h"
+
+#endif
@@ -0,0 +1,101 @@
+/*
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import XCTest
+import QuartzCore
+
+@testable import DronePan
+
+class FrameSettleMonitorTests: XCTestCase {
+    func still(sharpness: Double = 100) -> FrameSettleSample {
+        return FrameSettleSample(sharpness: sharpness, motion: 0.5)
+    }
+
+    func testSettledAfterWindow() {
+        let monitor = FrameSettleMonitor(windowSize: 3)
+
+        monitor.addSample(still())
+        monitor.addSample(still())
+
+        XCTAssertFalse(monitor.settled, "Settled before the window was full")
+
+        monitor.addSample(still())
+
+        XCTAssertTrue(monitor.settled, "Not settled after a full window of still frames")
+    }
+
+    func testMotionIsNotSettled() {
+        let monitor = FrameSettleMonitor(windowSize: 3, maxMotion: 1.5)
+
+        monitor.addSample(still())
+        monitor.addSample(FrameSettleSample(sharpness: 100, motion: 4))
+        monitor.addSample(still())
+
+        XCTAssertFalse(monitor.settled, "Settled while the picture moved")
+    }
+
+    func testFirstFrameIsNotSettled() {
+        let monitor = FrameSettleMonitor(windowSize: 1)
+
+        monitor.addSample(FrameSettleSample(sharpness: 100, motion: nil))
+
+        XCTAssertFalse(monitor.settled, "Settled without a previous frame to compare")
+    }
+
+    func testChangingSharpnessIsNotSettled() {
+        let monitor = FrameSettleMonitor(windowSize: 3, sharpnessTolerance: 0.15)
+
+        monitor.addSample(still(60))
+        monitor.addSample(still(80))
+        monitor.addSample(still(100))
+
+        XCTAssertFalse(monitor.settled, "Settled while the picture was still sharpening")
+
+        monitor.addSample(still(102))
+
+        XCTAssertFalse(monitor.settled, "Window should still hold the 80 sample")
+
+        monitor.addSample(still(101))
+
+        XCTAssertTrue(monitor.settled, "Not settled with a steady sharpness")
+    }
+
+    func testWaitReturnsWhenSettled() {
+        let monitor = FrameSettleMonitor(windowSize: 3)
+
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, Int64(0.2 * Double(NSEC_PER_SEC))), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0)) {
+            for _ in 0..<3 {
+                monitor.addSample(self.still())
+            }
+        }
+
+        let start = CACurrentMediaTime()
+
+        XCTAssertTrue(monitor.waitUntilSettled(5), "Wait did not see the view settle")
+        XCTAssertLessThan(CACurrentMediaTime() - start, 2, "Wait ran to the timeout")
+    }
+
+    func testWaitIgnoresEarlierFrames() {
+        let monitor = FrameSettleMonitor(windowSize: 3)
+
+        for _ in 0..<3 {
+            monitor.addSample(still())
+        }
+
+        XCTAssertTrue(monitor.settled)
+
+        XCTAssertFalse(monitor.waitUntilSettled(0.2), "Wait used frames from before the call")
+    }
+}
@@ -0,0 +1,167 @@
+/*
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import XCTest
+
+import VideoPreviewer
+
+@testable import DronePan
+
+class FrameTimelineTests: XCTestCase {
+    func attitude(yaw yaw: Double, pitch: Double = 0, aircraftYaw: Double = 0) -> TimedAttitude {
+        return TimedAttitude(gimbalPitch: pitch, gimbalYaw: yaw, gimbalRoll: 0, aircraftYaw: aircraftYaw)
+    }
+
+    func testClockIsMonotonic() {
+        let first = videoClockTimeTag()
+
+        NSThread.sleepForTimeInterval(0.01)
+
+        let second = videoClockTimeTag()
+
+        XCTAssertGreaterThan(second, first, "Clock did not advance")
+        XCTAssertGreaterThanOrEqual(second - first, 10000, "Clock is not in microseconds")
+    }
+
+    func testNearestFrame() {
+        let timeline = FrameTimeline()
+
+        // 30 fps
+        for uuid in 1 ... 10 {
+            timeline.addFrame(UInt32(uuid), timeTag: UInt64(uuid) * 33333)
+        }
+
+        XCTAssertEqual(timeline.nearestFrame(100000)?.uuid, 3)
+        XCTAssertEqual(timeline.nearestFrame(120000)?.uuid, 4)
+        XCTAssertEqual(timeline.nearestFrame(0)?.uuid, 1)
+        XCTAssertEqual(timeline.nearestFrame(1000000)?.uuid, 10)
+    }
+
+    func testNearestFrameWithoutFrames() {
+        let timeline = FrameTimeline()
+
+        XCTAssertNil(timeline.nearestFrame(1000))
+    }
+
+    func testFramesOutOfOrder() {
+        let timeline = FrameTimeline()
+
+        timeline.addFrame(1, timeTag: 1000)
+        timeline.addFrame(3, timeTag: 3000)
+        timeline.addFrame(2, timeTag: 2000)
+
+        XCTAssertEqual(timeline.nearestFrame(2100)?.uuid, 2)
+    }
+
+    func testCapacity() {
+        let timeline = FrameTimeline(capacity: 5)
+
+        for uuid in 1 ... 10 {
+            timeline.addFrame(UInt32(uuid), timeTag: UInt64(uuid) * 1000)
+        }
+
+        XCTAssertEqual(timeline.nearestFrame(0)?.uuid, 6, "Oldest frames were not dropped")
+    }
+
+    func testAttitudeInterpolation() {
+        let timeline = FrameTimeline()
+
+        timeline.addAttitude(attitude(yaw: 10, pitch: -30), timeTag: 1000)
+        timeline.addAttitude(attitude(yaw: 20, pitch: -60), timeTag: 2000)
+
+        let result = timeline.attitude(1250)
+
+        XCTAssertEqualWithAccuracy(result?.gimbalYaw ?? 0, 12.5, accuracy: 0.001)
+        XCTAssertEqualWithAccuracy(result?.gimbalPitch ?? 0, -37.5, accuracy: 0.001)
+    }
+
+    func testAttitudeOutsideSpan() {
+        let timeline = FrameTimeline()
+
+        XCTAssertNil(timeline.attitude(1000))
+
+        timeline.addAttitude(attitude(yaw: 10), timeTag: 1000)
+        timeline.addAttitude(attitude(yaw: 20), timeTag: 2000)
+
+        XCTAssertEqualWithAccuracy(timeline.attitude(500)?.gimbalYaw ?? 0, 10, accuracy: 0.001)
+        XCTAssertEqualWithAccuracy(timeline.attitude(5000)?.gimbalYaw ?? 0, 20, accuracy: 0.001)
+    }
+
+    func testYawInterpolatesShortWay() {
+        let timeline = FrameTimeline()
+
+        timeline.addAttitude(attitude(yaw: 170, aircraftYaw: 350), timeTag: 1000)
+        timeline.addAttitude(attitude(yaw: -170, aircraftYaw: 30), timeTag: 2000)
+
+        let result = timeline.attitude(1500)
+
+        XCTAssertEqualWithAccuracy(result?.gimbalYaw ?? 0, 180, accuracy: 0.001)
+        XCTAssertEqualWithAccuracy(result?.aircraftYaw ?? 0, 10, accuracy: 0.001)
+
+        XCTAssertEqualWithAccuracy(timeline.attitude(1750)?.gimbalYaw ?? 0, -175, accuracy: 0.001)
+    }
+
+    func testLinkStill() {
+        let timeline = FrameTimeline()
+
+        for uuid in 1 ... 10 {
+            timeline.addFrame(UInt32(uuid), timeTag: UInt64(uuid) * 100000)
+        }
+
+        timeline.addAttitude(attitude(yaw: 0), timeTag: 200000)
+        timeline.addAttitude(attitude(yaw: 40), timeTag: 600000)
+
+        let link = timeline.linkStill("DJI_0001.JPG", shutterTimeTag: 300000, mediaTimeTag: 900000)
+
+        XCTAssertEqual(link.filename, "DJI_0001.JPG")
+        XCTAssertEqual(link.frameUUID, 3)
+        XCTAssertEqual(link.frameTimeTag, 300000)
+        XCTAssertEqualWithAccuracy(link.attitude?.gimbalYaw ?? 0, 10, accuracy: 0.001)
+
+        timeline.videoLatency = 200000
+
+        XCTAssertEqual(timeline.linkStill("DJI_0002.JPG", shutterTimeTag: 300000, mediaTimeTag: 900000).frameUUID, 5,
+                       "Frame was not taken after the video latency")
+    }
+
+    func testFrameProcessor() {
+        let timeline = FrameTimeline()
+
+        var frame = VideoFrameYUV()
+        frame.frame_uuid = 7
+        frame.time_tag = 5000
+
+        timeline.videoProcessFrame(&frame)
+
+        frame.frame_uuid = 0
+        frame.time_tag = 6000
+
+        timeline.videoProcessFrame(&frame)
+
+        XCTAssertEqual(timeline.nearestFrame(6000)?.uuid, 7, "Frame without uuid was recorded")
+    }
+
+    func testReset() {
+        let timeline = FrameTimeline()
+
+        timeline.addFrame(1, timeTag: 1000)
+        timeline.addAttitude(attitude(yaw: 10), timeTag: 1000)
+
+        timeline.reset()
+
+        XCTAssertNil(timeline.nearestFrame(1000))
+        XCTAssertNil(timeline.attitude(1000))
+    }
+}
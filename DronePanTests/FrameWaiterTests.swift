@@ -0,0 +1,94 @@
+/*
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import XCTest
+import VideoPreviewer
+
+@testable import DronePan
+
+class FrameWaiterTests: XCTestCase {
+    let width = 8
+    let height = 4
+
+    func compare(waiter: FrameWaiter, inout luma: [UInt8], width: Int) -> [UInt8]? {
+        var level = VideoFramePyramidLevel()
+        var previous: [UInt8]? = nil
+
+        luma.withUnsafeMutableBufferPointer { buffer -> () in
+            level.luma = buffer.baseAddress
+            level.width = Int32(width)
+            level.height = Int32(self.height)
+
+            waiter.compareWithPrevious(&level) { previousLuma in
+                previous = Array(UnsafeBufferPointer(start: previousLuma, count: width * self.height))
+            }
+        }
+
+        return previous
+    }
+
+    func testFirstLevelHasNoPrevious() {
+        let waiter = FrameWaiter(label: "FrameWaiterTests")
+        var luma = [UInt8](count: width * height, repeatedValue: 1)
+
+        XCTAssertNil(compare(waiter, luma: &luma, width: width))
+    }
+
+    func testPreviousLevelIsKept() {
+        let waiter = FrameWaiter(label: "FrameWaiterTests")
+        var first = [UInt8](count: width * height, repeatedValue: 1)
+        var second = [UInt8](count: width * height, repeatedValue: 2)
+
+        compare(waiter, luma: &first, width: width)
+
+        XCTAssertEqual(compare(waiter, luma: &second, width: width)!, first)
+    }
+
+    func testSizeChangeDropsPrevious() {
+        let waiter = FrameWaiter(label: "FrameWaiterTests")
+        var first = [UInt8](count: width * height, repeatedValue: 1)
+        var narrow = [UInt8](count: (width / 2) * height, repeatedValue: 2)
+
+        compare(waiter, luma: &first, width: width)
+
+        XCTAssertNil(compare(waiter, luma: &narrow, width: width / 2))
+    }
+
+    func testSignalWakesWaiter() {
+        let waiter = FrameWaiter(label: "FrameWaiterTests")
+        var resetCount = 0
+
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, Int64(0.2 * Double(NSEC_PER_SEC))), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0)) {
+            dispatch_sync(waiter.queue) {
+                waiter.signalWaiters()
+            }
+        }
+
+        XCTAssertTrue(waiter.wait(2.0) {
+            resetCount += 1
+        })
+        XCTAssertEqual(resetCount, 1)
+    }
+
+    func testWaitTimesOut() {
+        let waiter = FrameWaiter(label: "FrameWaiterTests")
+
+        XCTAssertFalse(waiter.wait(0.1) {})
+
+        dispatch_sync(waiter.queue) {
+            XCTAssertFalse(waiter.hasWaiters)
+        }
+    }
+}
@@ -0,0 +1,143 @@
+/*
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import XCTest
+import VideoPreviewer
+
+@testable import DronePan
+
+class GlobalMotionMonitorTests: XCTestCase {
+    // Pyramid level 1 of a 720p frame
+    let width = 320
+    let height = 180
+
+    // Smooth texture so that sub pixel shifts can be rendered
+    func texture(shiftX shiftX: Double = 0, shiftY: Double = 0) -> [UInt8] {
+        var luma = [UInt8](count: width * height, repeatedValue: 0)
+
+        for y in 0..<height {
+            for x in 0..<width {
+                let u = Double(x) - shiftX
+                let v = Double(y) - shiftY
+                let value = 128 + 40 * sin(u * 0.21 + 1) * cos(v * 0.17) + 30 * sin(u * 0.05 + v * 0.11) + 20 * cos(u * 0.37 - v * 0.29)
+
+                luma[y * width + x] = UInt8(value)
+            }
+        }
+
+        return luma
+    }
+
+    func estimate(previous: [UInt8], _ current: [UInt8], searchRange: Int32 = 4) -> VideoGlobalMotion {
+        var previous = previous
+        var current = current
+        var motion = VideoGlobalMotion()
+
+        XCTAssertEqual(estimateGlobalMotion(&previous, Int32(width), &current, Int32(width), Int32(width), Int32(height), searchRange, &motion), 0)
+
+        return motion
+    }
+
+    func testNoMotion() {
+        let luma = texture()
+
+        let motion = estimate(luma, luma)
+
+        XCTAssertEqual(motion.dx, 0)
+        XCTAssertEqual(motion.dy, 0)
+        XCTAssertEqual(motion.cost, 0)
+        XCTAssertFalse(motion.atSearchLimit.boolValue)
+    }
+
+    func testWholePixelMotion() {
+        let motion = estimate(texture(), texture(shiftX: 2, shiftY: -1))
+
+        XCTAssertEqualWithAccuracy(motion.dx, 2, accuracy: 0.05)
+        XCTAssertEqualWithAccuracy(motion.dy, -1, accuracy: 0.05)
+    }
+
+    func testSubPixelMotion() {
+        let motion = estimate(texture(), texture(shiftX: -2.5, shiftY: 1.3))
+
+        XCTAssertEqualWithAccuracy(motion.dx, -2.5, accuracy: 0.3)
+        XCTAssertEqualWithAccuracy(motion.dy, 1.3, accuracy: 0.4)
+    }
+
+    func testMotionBeyondSearchRange() {
+        let motion = estimate(texture(), texture(shiftX: 7))
+
+        XCTAssertTrue(motion.atSearchLimit.boolValue, "Fast motion was not flagged")
+    }
+
+    func testInvalidSearchRange() {
+        var luma = texture()
+        var motion = VideoGlobalMotion()
+
+        XCTAssertEqual(estimateGlobalMotion(&luma, Int32(width), &luma, Int32(width), Int32(width), Int32(height), 0, &motion), -1)
+        XCTAssertEqual(estimateGlobalMotion(&luma, Int32(width), &luma, Int32(width), Int32(width), Int32(height), 64, &motion), -1)
+    }
+
+    func testStillAfterFrames() {
+        let monitor = GlobalMotionMonitor(maxShift: 1, stillFrames: 3)
+
+        monitor.addShift(0.2)
+        monitor.addShift(0.5)
+
+        XCTAssertFalse(monitor.still, "Still before enough frames")
+
+        monitor.addShift(4)
+        monitor.addShift(0.1)
+        monitor.addShift(0.1)
+
+        XCTAssertFalse(monitor.still, "Moving frame did not restart the count")
+
+        monitor.addShift(0.1)
+
+        XCTAssertTrue(monitor.still, "Not still after three still frames")
+
+        monitor.addShift(nil)
+
+        XCTAssertFalse(monitor.still, "Unmeasured motion counted as still")
+    }
+
+    func testWaitUntilStill() {
+        let monitor = GlobalMotionMonitor(maxShift: 1, stillFrames: 2)
+
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, Int64(0.2 * Double(NSEC_PER_SEC))), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0)) {
+            monitor.addShift(3)
+            monitor.addShift(0.3)
+            monitor.addShift(0.2)
+        }
+
+        XCTAssertTrue(monitor.waitUntilStill(5), "Wait did not see the picture come to rest")
+    }
+
+    func testWaitTimesOut() {
+        let monitor = GlobalMotionMonitor()
+
+        XCTAssertFalse(monitor.waitUntilStill(0.2), "Wait returned without frames")
+    }
+
+    // Estimator cost per frame at pyramid level 1 of 720p
+    func testEstimatePerformance() {
+        var previous = texture()
+        var current = texture(shiftX: 1.5, shiftY: 0.5)
+        var motion = VideoGlobalMotion()
+
+        measureBlock {
+            estimateGlobalMotion(&previous, Int32(self.width), &current, Int32(self.width), Int32(self.width), Int32(self.height), 4, &motion)
+        }
+    }
+}
@@ -97,4 +97,41 @@ class PanoramaControllerTests: XCTestCase {
 
         XCTAssertEqual(117, value, "Incorrect heading for 117 \(value)")
     }
+
+    func testYawTurnClockwiseAcrossNorth() {
+        let value = panoramaController.yawTurn(from: 340, to: 40)
+
+        XCTAssertEqual(60, value, "Incorrect turn from 340 to 40 \(value)")
+    }
+
+    func testYawTurnBackwards() {
+        let value = panoramaController.yawTurn(from: 120, to: 90)
+
+        XCTAssertEqual(-30, value, "Incorrect turn from 120 to 90 \(value)")
+    }
+
+    func testYawSpeedTurnsBackToCorrectiveShot() {
+        panoramaController.yawDestination = 90
+        panoramaController.flightControllerUpdateHeading(120)
+
+        XCTAssertEqual(-15, panoramaController.yawSpeed, "Aircraft does not turn back \(panoramaController.yawSpeed)")
+    }
+
+    func testMidpointYaw() {
+        let value = panoramaController.midpointYaw(from: 60, to: 120)
+
+        XCTAssertEqual(90, value, "Incorrect midpoint for 60 to 120 \(value)")
+    }
+
+    func testMidpointYawAcrossNorth() {
+        let value = panoramaController.midpointYaw(from: 340, to: 40)
+
+        XCTAssertEqual(10, value, "Incorrect midpoint for 340 to 40 \(value)")
+    }
+
+    func testMidpointYawTo360() {
+        let value = panoramaController.midpointYaw(from: 300, to: 360)
+
+        XCTAssertEqual(330, value, "Incorrect midpoint for 300 to 360 \(value)")
+    }
 }
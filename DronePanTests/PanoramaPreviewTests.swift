@@ -0,0 +1,201 @@
+/*
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import XCTest
+import VideoPreviewer
+
+@testable import DronePan
+
+class PanoramaPreviewTests: XCTestCase {
+    // Pyramid level 1 of a 720p frame
+    let width: Int32 = 320
+    let height: Int32 = 180
+
+    let canvasWidth: Int32 = 1024
+
+    // Diagonal luma ramp with flat chroma
+    func ramp() -> (luma: [UInt8], chromaB: [UInt8], chromaR: [UInt8]) {
+        var luma = [UInt8](count: Int(width * height), repeatedValue: 0)
+
+        for y in 0 ..< Int(height) {
+            for x in 0 ..< Int(width) {
+                luma[y * Int(width) + x] = UInt8((x + y) & 255)
+            }
+        }
+
+        let chromaCount = Int(width / 2 * height / 2)
+
+        return (luma, [UInt8](count: chromaCount, repeatedValue: 100), [UInt8](count: chromaCount, repeatedValue: 200))
+    }
+
+    // Blend one shot into a new canvas and hand the canvas to the check
+    func blend(pitch pitch: Float, yaw: Float, check: (VideoPanoramaCanvas, VideoPanoramaRemap) -> Void) {
+        var (luma, chromaB, chromaR) = ramp()
+
+        var canvas = VideoPanoramaCanvas()
+        var remap = VideoPanoramaRemap()
+
+        XCTAssertEqual(createPanoramaCanvas(canvasWidth, canvasWidth / 2, &canvas), 0)
+        XCTAssertEqual(buildPanoramaRemap(canvasWidth, canvasWidth / 2, width, height, 84, pitch, &remap), 0)
+
+        luma.withUnsafeMutableBufferPointer { lumaBuffer in
+            chromaB.withUnsafeMutableBufferPointer { chromaBBuffer in
+                chromaR.withUnsafeMutableBufferPointer { chromaRBuffer in
+                    var level = VideoFramePyramidLevel(luma: lumaBuffer.baseAddress, chromaB: chromaBBuffer.baseAddress,
+                                                       chromaR: chromaRBuffer.baseAddress, width: self.width, height: self.height, level: 1)
+
+                    XCTAssertEqual(blendPanoramaShot(&canvas, &remap, &level, yaw), 0)
+                }
+            }
+        }
+
+        check(canvas, remap)
+
+        freePanoramaRemap(&remap)
+        freePanoramaCanvas(&canvas)
+    }
+
+    func testShotCenterLandsAtItsYaw() {
+        blend(pitch: 0, yaw: 90) { canvas, remap in
+            let row = Int(canvas.height / 2)
+            let column = Int(canvas.width) * 3 / 4
+
+            // The source center is (159.5, 89.5), its ramp value 249
+            XCTAssertEqualWithAccuracy(Double(canvas.luma[row * Int(canvas.width) + column]), 249, accuracy: 2)
+            XCTAssertEqual(canvas.chromaB[row / 2 * Int(canvas.width / 2) + column / 2], 100)
+            XCTAssertEqual(canvas.chromaR[row / 2 * Int(canvas.width / 2) + column / 2], 200)
+
+            XCTAssertEqual(canvas.lumaWeight[row * Int(canvas.width) + 100], 0, "Pixel outside the shot was blended")
+            XCTAssertEqual(canvas.luma[row * Int(canvas.width) + 100], 16, "Canvas is not black outside the shot")
+        }
+    }
+
+    func testShotWidthMatchesFieldOfView() {
+        blend(pitch: 0, yaw: 0) { canvas, remap in
+            let row = Int(canvas.height / 2)
+            let covered = (0 ..< Int(canvas.width)).filter { canvas.lumaWeight[row * Int(canvas.width) + $0] > 0 }.count
+
+            // 84 degrees of 360
+            XCTAssertEqualWithAccuracy(Double(covered), 84.0 / 360.0 * Double(canvas.width), accuracy: 2)
+        }
+    }
+
+    func testYawWrapsAroundCanvas() {
+        blend(pitch: 0, yaw: 180) { canvas, remap in
+            let row = Int(canvas.height / 2)
+
+            XCTAssertGreaterThan(canvas.lumaWeight[row * Int(canvas.width)], 0, "Left edge not covered")
+            XCTAssertGreaterThan(canvas.lumaWeight[row * Int(canvas.width) + Int(canvas.width) - 1], 0, "Right edge not covered")
+            XCTAssertEqual(canvas.lumaWeight[row * Int(canvas.width) + Int(canvas.width) / 2], 0)
+        }
+    }
+
+    func testNadirCoversPole() {
+        blend(pitch: -90, yaw: 0) { canvas, remap in
+            let bottom = Int(canvas.height) - 1
+
+            for column in [0, Int(canvas.width) / 4, Int(canvas.width) / 2] {
+                XCTAssertGreaterThan(canvas.lumaWeight[bottom * Int(canvas.width) + column], 0, "Pole not covered at column \(column)")
+            }
+
+            XCTAssertEqual(canvas.lumaWeight[Int(canvas.height) / 2 * Int(canvas.width)], 0, "Horizon covered by a nadir shot")
+        }
+    }
+
+    func testInvalidArguments() {
+        var remap = VideoPanoramaRemap()
+
+        XCTAssertEqual(buildPanoramaRemap(canvasWidth, canvasWidth / 2, width, height, 180, 0, &remap), -1)
+        XCTAssertEqual(buildPanoramaRemap(canvasWidth, canvasWidth / 2, 2, 2, 84, 0, &remap), -1)
+
+        var canvas = VideoPanoramaCanvas()
+
+        XCTAssertEqual(createPanoramaCanvas(1023, 512, &canvas), -1)
+    }
+
+    func testPreviewBlendsShots() {
+        let preview = PanoramaPreview(canvasWidth: canvasWidth)
+        let (luma, chromaB, chromaR) = ramp()
+
+        preview.blendFrame(luma, chromaB: chromaB, chromaR: chromaR, width: width, height: height,
+                           shots: [(pitch: 0, yaw: 120), (pitch: 0, yaw: 180)])
+
+        XCTAssertEqual(preview.shotCount, 2)
+
+        let image = preview.image()
+
+        XCTAssertNotNil(image)
+        XCTAssertEqual(image?.size, CGSize(width: Int(canvasWidth / 2), height: Int(canvasWidth / 4)))
+
+        preview.reset()
+
+        XCTAssertEqual(preview.shotCount, 0)
+    }
+
+    func testPreviewWaitsForShot() {
+        let preview = PanoramaPreview(canvasWidth: canvasWidth)
+        var (luma, chromaB, chromaR) = ramp()
+
+        let process = {
+            luma.withUnsafeMutableBufferPointer { lumaBuffer in
+                chromaB.withUnsafeMutableBufferPointer { chromaBBuffer in
+                    chromaR.withUnsafeMutableBufferPointer { chromaRBuffer in
+                        var level = VideoFramePyramidLevel(luma: lumaBuffer.baseAddress, chromaB: chromaBBuffer.baseAddress,
+                                                           chromaR: chromaRBuffer.baseAddress, width: self.width, height: self.height, level: 1)
+                        var frame = VideoFrameYUV()
+
+                        preview.videoProcessPyramidLevel(&level, frame: &frame)
+                    }
+                }
+            }
+        }
+
+        process()
+
+        XCTAssertEqual(preview.shotCount, 0, "Frame blended without a shot")
+
+        preview.addShot(pitch: -30, yaw: 0)
+        process()
+        process()
+
+        XCTAssertEqual(preview.shotCount, 1, "Shot not blended once")
+    }
+
+    func testBlendPerformance() {
+        var (luma, chromaB, chromaR) = ramp()
+
+        var canvas = VideoPanoramaCanvas()
+        var remap = VideoPanoramaRemap()
+
+        createPanoramaCanvas(canvasWidth, canvasWidth / 2, &canvas)
+        buildPanoramaRemap(canvasWidth, canvasWidth / 2, width, height, 84, -90, &remap)
+
+        luma.withUnsafeMutableBufferPointer { lumaBuffer in
+            chromaB.withUnsafeMutableBufferPointer { chromaBBuffer in
+                chromaR.withUnsafeMutableBufferPointer { chromaRBuffer in
+                    var level = VideoFramePyramidLevel(luma: lumaBuffer.baseAddress, chromaB: chromaBBuffer.baseAddress,
+                                                       chromaR: chromaRBuffer.baseAddress, width: self.width, height: self.height, level: 1)
+
+                    self.measureBlock {
+                        blendPanoramaShot(&canvas, &remap, &level, 45)
+                    }
+                }
+            }
+        }
+
+        freePanoramaRemap(&remap)
+        freePanoramaCanvas(&canvas)
+    }
+}
@@ -47,4 +47,15 @@ class PanoramaTests: XCTestCase {
             XCTAssertEqual(panorama.imageList[i], "File\(i + 1)")
         }
     }
+    
+    func testThumbnails() {
+        let panorama = Panorama()
+        
+        panorama.addFilename("File1")
+        panorama.addThumbnail(UIImage(), forFilename: "File1")
+        
+        XCTAssertEqual(panorama.thumbnails.count, 1)
+        XCTAssertNotNil(panorama.thumbnails["File1"])
+        XCTAssertNil(panorama.thumbnails["File2"])
+    }
 }
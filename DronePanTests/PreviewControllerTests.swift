@@ -29,6 +29,15 @@ class VideoPreviewerAdapter : VideoPreviewerWrapper {
     
     func push(videoData: UnsafeMutablePointer<UInt8>, length len: Int32) {
     }
+    
+    func registFrameProcessor(processor: VideoFrameProcessor) {
+    }
+    
+    func registStreamProcessor(processor: VideoStreamProcessor) {
+    }
+    
+    func unregistProcessor(processor: AnyObject) {
+    }
 }
 
 class PreviewControllerTests: XCTestCase {
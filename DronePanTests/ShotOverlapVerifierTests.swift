@@ -0,0 +1,231 @@
+/*
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import XCTest
+import VideoPreviewer
+
+@testable import DronePan
+
+class ShotOverlapVerifierTests: XCTestCase {
+    // Pyramid level 1 of a 720p frame
+    let width = 320
+    let height = 180
+
+    // Scene wide enough for a whole row of shots
+    let sceneWidth = 960
+    let sceneHeight = 540
+
+    lazy var scene: [UInt8] = self.makeScene()
+
+    // Random blobs, a texture without repeats so that only the true shift matches
+    func makeScene() -> [UInt8] {
+        var values = [Double](count: sceneWidth * sceneHeight, repeatedValue: 128)
+        var seed: UInt32 = 1
+
+        func random() -> Double {
+            seed = seed &* 1664525 &+ 1013904223
+
+            return Double(seed >> 8) / 16777216.0
+        }
+
+        for _ in 0..<1500 {
+            let cx = random() * Double(sceneWidth)
+            let cy = random() * Double(sceneHeight)
+            let radius = 3 + random() * 25
+            let amplitude = random() * 120 - 60
+
+            for y in max(0, Int(cy - radius))..<min(sceneHeight, Int(cy + radius) + 1) {
+                for x in max(0, Int(cx - radius))..<min(sceneWidth, Int(cx + radius) + 1) {
+                    let distance = hypot(Double(x) - cx, Double(y) - cy)
+
+                    if distance < radius {
+                        values[y * sceneWidth + x] += amplitude * (1 - distance / radius)
+                    }
+                }
+            }
+        }
+
+        return values.map { UInt8(max(0, min(255, $0))) }
+    }
+
+    // The view of the scene with its top left corner at x, y
+    func view(x x: Int, y: Int) -> [UInt8] {
+        var luma = [UInt8](count: width * height, repeatedValue: 0)
+
+        for row in 0..<height {
+            for column in 0..<width {
+                luma[row * width + column] = scene[(y + row) * sceneWidth + x + column]
+            }
+        }
+
+        return luma
+    }
+
+    func correlate(first: [UInt8], _ second: [UInt8], size: Int32 = 128) -> VideoPhaseCorrelation {
+        var first = first
+        var second = second
+        var correlation = VideoPhaseCorrelation()
+
+        XCTAssertEqual(phaseCorrelateLuma(&first, Int32(width), &second, Int32(width), Int32(width), Int32(height), size, &correlation), 0)
+
+        return correlation
+    }
+
+    func testSameView() {
+        let luma = view(x: 300, y: 200)
+
+        let correlation = correlate(luma, luma)
+
+        XCTAssertEqualWithAccuracy(correlation.dx, 0, accuracy: 0.5)
+        XCTAssertEqualWithAccuracy(correlation.dy, 0, accuracy: 0.5)
+        XCTAssertEqualWithAccuracy(correlation.peak, 1, accuracy: 0.01)
+        XCTAssertEqualWithAccuracy(correlation.overlap, 1, accuracy: 0.01)
+    }
+
+    func testSmallShift() {
+        // The camera turned left and up, the picture moves right and down
+        let correlation = correlate(view(x: 300, y: 200), view(x: 290, y: 196))
+
+        XCTAssertEqualWithAccuracy(correlation.dx, 10, accuracy: 1)
+        XCTAssertEqualWithAccuracy(correlation.dy, 4, accuracy: 1)
+        XCTAssertGreaterThan(correlation.peak, 0.3)
+    }
+
+    func testShiftOfMoreThanHalfTheView() {
+        let correlation = correlate(view(x: 300, y: 200), view(x: 500, y: 200))
+
+        XCTAssertEqualWithAccuracy(correlation.dx, -200, accuracy: 1.5)
+        XCTAssertEqualWithAccuracy(correlation.dy, 0, accuracy: 1)
+        XCTAssertEqualWithAccuracy(correlation.overlap, 0.375, accuracy: 0.01)
+    }
+
+    func testVerticalShift() {
+        let correlation = correlate(view(x: 300, y: 300), view(x: 300, y: 180), size: 256)
+
+        XCTAssertEqualWithAccuracy(correlation.dx, 0, accuracy: 1)
+        XCTAssertEqualWithAccuracy(correlation.dy, 120, accuracy: 1.5)
+        XCTAssertEqualWithAccuracy(correlation.overlap, 1.0 / 3.0, accuracy: 0.01)
+    }
+
+    func testInvalidSize() {
+        var luma = view(x: 0, y: 0)
+        var correlation = VideoPhaseCorrelation()
+
+        XCTAssertEqual(phaseCorrelateLuma(&luma, Int32(width), &luma, Int32(width), Int32(width), Int32(height), 100, &correlation), -1)
+        XCTAssertEqual(phaseCorrelateLuma(&luma, Int32(width), &luma, Int32(width), Int32(width), Int32(height), 512, &correlation), -1)
+    }
+
+    // Decodes the same frame until the capture has taken one
+    func capture(verifier: ShotOverlapVerifier, _ luma: [UInt8], _ position: ShotPosition) -> Bool {
+        var luma = luma
+        var captured = false
+        let done = dispatch_semaphore_create(0)
+
+        dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0)) {
+            captured = verifier.captureShot(position)
+            dispatch_semaphore_signal(done)
+        }
+
+        while dispatch_semaphore_wait(done, dispatch_time(DISPATCH_TIME_NOW, Int64(10 * NSEC_PER_MSEC))) != 0 {
+            verifier.addFrame(&luma, width: width, height: height)
+        }
+
+        return captured
+    }
+
+    func testCaptureWithoutFrame() {
+        let verifier = ShotOverlapVerifier()
+
+        XCTAssertFalse(verifier.captureShot(ShotPosition(column: 0, row: 0)), "Captured a shot without a frame")
+    }
+
+    func testFrameBeforeCaptureIsNotKept() {
+        let verifier = ShotOverlapVerifier()
+        var luma = view(x: 0, y: 0)
+
+        verifier.addFrame(&luma, width: width, height: height)
+
+        XCTAssertFalse(verifier.captureShot(ShotPosition(column: 0, row: 0), timeout: 0.1), "Frame copied without a capture")
+        XCTAssertEqual(verifier.shotCount, 0)
+    }
+
+    func testVerifyAgainstNeighbours() {
+        let verifier = ShotOverlapVerifier(minOverlap: 0.3)
+
+        XCTAssertTrue(capture(verifier, view(x: 100, y: 100), ShotPosition(column: 0, row: 0)))
+
+        XCTAssertTrue(capture(verifier, view(x: 100, y: 220), ShotPosition(column: 0, row: 1)))
+
+        // Too far along the row for the requested overlap
+        XCTAssertTrue(capture(verifier, view(x: 330, y: 220), ShotPosition(column: 1, row: 1)))
+
+        XCTAssertTrue(verifier.verifyShot(ShotPosition(column: 0, row: 0)).isEmpty, "First shot has no neighbours")
+
+        let column = verifier.verifyShot(ShotPosition(column: 0, row: 1))
+
+        XCTAssertEqual(column.count, 1)
+        XCTAssertEqual(column.first?.neighbour, ShotPosition(column: 0, row: 0))
+        XCTAssertTrue(verifier.shortfalls(column).isEmpty, "Overlap of a third flagged")
+
+        let row = verifier.verifyShot(ShotPosition(column: 1, row: 1))
+
+        XCTAssertEqual(row.count, 1)
+        XCTAssertEqual(row.first?.neighbour, ShotPosition(column: 0, row: 1))
+        XCTAssertEqual(verifier.shortfalls(row).count, 1, "Overlap of 28% not flagged")
+    }
+
+    func testUnrelatedShotIsNotReliable() {
+        let verifier = ShotOverlapVerifier()
+
+        capture(verifier, view(x: 0, y: 0), ShotPosition(column: 0, row: 0))
+
+        // Noise has nothing to match
+        var seed: UInt32 = 7
+        capture(verifier, (0..<(width * height)).map { _ in
+            seed = seed &* 1664525 &+ 1013904223
+
+            return UInt8(seed >> 24)
+        }, ShotPosition(column: 1, row: 0))
+
+        let overlaps = verifier.verifyShot(ShotPosition(column: 1, row: 0))
+
+        XCTAssertEqual(overlaps.count, 1)
+        XCTAssertFalse(overlaps.first?.reliable ?? true, "Noise matched the scene")
+        XCTAssertTrue(verifier.shortfalls(overlaps).isEmpty, "Unreliable overlap needs a corrective shot")
+    }
+
+    func testReset() {
+        let verifier = ShotOverlapVerifier()
+
+        capture(verifier, view(x: 0, y: 0), ShotPosition(column: 0, row: 0))
+
+        XCTAssertEqual(verifier.shotCount, 1)
+
+        verifier.reset()
+
+        XCTAssertEqual(verifier.shotCount, 0)
+    }
+
+    // Cost of one registration at pyramid level 1 of 720p
+    func testCorrelatePerformance() {
+        var first = view(x: 100, y: 100)
+        var second = view(x: 300, y: 130)
+        var correlation = VideoPhaseCorrelation()
+
+        measureBlock {
+            phaseCorrelateLuma(&first, Int32(self.width), &second, Int32(self.width), Int32(self.width), Int32(self.height), 128, &correlation)
+        }
+    }
+}
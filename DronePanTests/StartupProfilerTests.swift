@@ -0,0 +1,99 @@
+/*
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import XCTest
+
+@testable import DronePan
+
+class StartupProfilerTests: XCTestCase {
+
+    func testMeasureRecordsDuration() {
+        let profiler = StartupProfiler()
+
+        let result = profiler.measure("work") {
+            return 42
+        }
+
+        XCTAssertEqual(result, 42, "Measure didn't return the block result")
+
+        let timeline = profiler.timeline()
+
+        XCTAssertEqual(timeline.count, 1, "Incorrect event count \(timeline.count)")
+        XCTAssertEqual(timeline[0].name, "work", "Incorrect name \(timeline[0].name)")
+        XCTAssertNotNil(timeline[0].duration, "Measured event had no duration")
+        XCTAssertGreaterThanOrEqual(timeline[0].start, 0, "Event started before launch")
+    }
+
+    func testEndWithoutBegin() {
+        let profiler = StartupProfiler()
+
+        profiler.end("never started")
+
+        XCTAssertTrue(profiler.timeline().isEmpty, "End without begin recorded an event")
+    }
+
+    func testMarkOnlyKeepsFirst() {
+        let profiler = StartupProfiler()
+
+        profiler.mark("firstVideoData")
+        profiler.mark("firstVideoData")
+
+        let timeline = profiler.timeline()
+
+        XCTAssertEqual(timeline.count, 1, "Repeated mark recorded \(timeline.count) events")
+        XCTAssertNil(timeline[0].duration, "Milestone had a duration")
+    }
+
+    func testTimelineIsOrderedByStart() {
+        let profiler = StartupProfiler()
+
+        profiler.begin("slow")
+        profiler.mark("milestone")
+        profiler.end("slow")
+
+        let timeline = profiler.timeline()
+
+        XCTAssertEqual(timeline.map { $0.name }, ["slow", "milestone"], "Timeline not ordered by start")
+    }
+
+    func testParallelMeasure() {
+        let profiler = StartupProfiler()
+
+        let expectation = expectationWithDescription("all parallel measures recorded")
+
+        let group = dispatch_group_create()
+
+        for i in 0..<10 {
+            dispatch_group_async(group, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0)) {
+                profiler.measure("task\(i)") {
+                    usleep(1000)
+                }
+            }
+        }
+
+        dispatch_group_notify(group, dispatch_get_main_queue()) {
+            expectation.fulfill()
+        }
+
+        waitForExpectationsWithTimeout(2) {
+            error in
+            if let error = error {
+                XCTFail("waitForExpectationsWithTimeout errored: \(error)")
+            }
+
+            XCTAssertEqual(profiler.timeline().count, 10, "Parallel measures were lost")
+        }
+    }
+}
@@ -0,0 +1,194 @@
+/*
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import XCTest
+import VideoPreviewer
+
+@testable import DronePan
+
+class VideoColorConvertTests: XCTestCase {
+    let width = 1280
+    let height = 720
+
+    var luma: [UInt8] = []
+    var chromaB: [UInt8] = []
+    var chromaR: [UInt8] = []
+    var chromaInterleaved: [UInt8] = []
+
+    override func setUp() {
+        super.setUp()
+
+        srand48(42)
+
+        luma = (0..<width * height).map { _ in UInt8(drand48() * 255) }
+        chromaB = (0..<width * height / 4).map { _ in UInt8(drand48() * 255) }
+        chromaR = (0..<width * height / 4).map { _ in UInt8(drand48() * 255) }
+
+        chromaInterleaved = []
+        for i in 0..<chromaB.count {
+            chromaInterleaved.append(chromaB[i])
+            chromaInterleaved.append(chromaR[i])
+        }
+    }
+
+    func withPlanarFrame(block: (UnsafePointer<VideoFrameYUV>) -> ()) {
+        var frame = VideoFrameYUV()
+        frame.width = Int32(width)
+        frame.height = Int32(height)
+        frame.frameType = UInt8(VPFrameType.YUV420Planer.rawValue)
+
+        luma.withUnsafeMutableBufferPointer { lumaPointer in
+            chromaB.withUnsafeMutableBufferPointer { chromaBPointer in
+                chromaR.withUnsafeMutableBufferPointer { chromaRPointer in
+                    frame.luma = lumaPointer.baseAddress
+                    frame.chromaB = chromaBPointer.baseAddress
+                    frame.chromaR = chromaRPointer.baseAddress
+
+                    block(&frame)
+                }
+            }
+        }
+    }
+
+    func withSemiPlanarFrame(block: (UnsafePointer<VideoFrameYUV>) -> ()) {
+        var frame = VideoFrameYUV()
+        frame.width = Int32(width)
+        frame.height = Int32(height)
+        frame.frameType = UInt8(VPFrameType.YUV420SemiPlaner.rawValue)
+        frame.lumaSlice = Int32(width)
+        frame.chromaBSlice = Int32(width)
+
+        luma.withUnsafeMutableBufferPointer { lumaPointer in
+            chromaInterleaved.withUnsafeMutableBufferPointer { chromaPointer in
+                frame.luma = lumaPointer.baseAddress
+                frame.chromaB = chromaPointer.baseAddress
+
+                block(&frame)
+            }
+        }
+    }
+
+    func options(matrix matrix: VideoColorMatrix = .BT601, range: VideoColorRange = .Limited, bgra: Bool = false, halfSize: Bool = false) -> VideoColorConvertOptions {
+        return VideoColorConvertOptions(matrix: matrix, range: range, bgra: ObjCBool(bgra), halfSize: ObjCBool(halfSize))
+    }
+
+    func testMatchesReference() {
+        for matrix in [VideoColorMatrix.BT601, VideoColorMatrix.BT709] {
+            for range in [VideoColorRange.Limited, VideoColorRange.Full] {
+                for halfSize in [false, true] {
+                    let convertOptions = options(matrix: matrix, range: range, halfSize: halfSize)
+                    let outWidth = halfSize ? width / 2 : width
+                    let outHeight = halfSize ? height / 2 : height
+
+                    var reference = [UInt8](count: outWidth * outHeight * 4, repeatedValue: 0)
+                    var planar = reference
+                    var semiPlanar = reference
+
+                    withPlanarFrame { frame in
+                        XCTAssertEqual(convertYUVFrameToRGBAReference(frame, &reference, Int32(outWidth * 4), convertOptions), 0)
+                        XCTAssertEqual(convertYUVFrameToRGBA(frame, &planar, Int32(outWidth * 4), convertOptions), 0)
+                    }
+
+                    withSemiPlanarFrame { frame in
+                        XCTAssertEqual(convertYUVFrameToRGBA(frame, &semiPlanar, Int32(outWidth * 4), convertOptions), 0)
+                    }
+
+                    XCTAssertTrue(planar == reference, "Planar output differs from reference for \(matrix) \(range) half \(halfSize)")
+                    XCTAssertTrue(semiPlanar == reference, "Semi planar output differs from reference for \(matrix) \(range) half \(halfSize)")
+                }
+            }
+        }
+    }
+
+    func testLimitedRangeWhiteAndBlack() {
+        var lumaValues = [UInt8](count: 16, repeatedValue: 235)
+        lumaValues[0] = 16
+        var chromaValues = [UInt8](count: 4, repeatedValue: 128)
+        var chromaValuesR = chromaValues
+
+        var frame = VideoFrameYUV()
+        frame.width = 4
+        frame.height = 4
+        frame.frameType = UInt8(VPFrameType.YUV420Planer.rawValue)
+
+        var pixels = [UInt8](count: 64, repeatedValue: 0)
+
+        lumaValues.withUnsafeMutableBufferPointer { lumaPointer in
+            chromaValues.withUnsafeMutableBufferPointer { chromaBPointer in
+                chromaValuesR.withUnsafeMutableBufferPointer { chromaRPointer in
+                    frame.luma = lumaPointer.baseAddress
+                    frame.chromaB = chromaBPointer.baseAddress
+                    frame.chromaR = chromaRPointer.baseAddress
+
+                    convertYUVFrameToRGBA(&frame, &pixels, 16, options())
+                }
+            }
+        }
+
+        XCTAssertEqual(Array(pixels[0..<4]), [0, 0, 0, 255], "Y 16 is not black")
+        XCTAssertEqual(Array(pixels[4..<8]), [255, 255, 255, 255], "Y 235 is not white")
+    }
+
+    func testUnsupportedFormat() {
+        var frame = VideoFrameYUV()
+        frame.frameType = UInt8(VPFrameType.RGBA.rawValue)
+
+        var pixels = [UInt8](count: 4, repeatedValue: 0)
+
+        XCTAssertEqual(convertYUVFrameToRGBA(&frame, &pixels, 4, options()), -1, "RGBA frame was converted")
+    }
+
+    // Throughput benchmarks for a 720p frame
+
+    func testConvertPerformance() {
+        var pixels = [UInt8](count: width * height * 4, repeatedValue: 0)
+
+        withPlanarFrame { frame in
+            self.measureBlock {
+                convertYUVFrameToRGBA(frame, &pixels, Int32(self.width * 4), self.options())
+            }
+        }
+    }
+
+    func testConvertReferencePerformance() {
+        var pixels = [UInt8](count: width * height * 4, repeatedValue: 0)
+
+        withPlanarFrame { frame in
+            self.measureBlock {
+                convertYUVFrameToRGBAReference(frame, &pixels, Int32(self.width * 4), self.options())
+            }
+        }
+    }
+
+    func testConvertSemiPlanarPerformance() {
+        var pixels = [UInt8](count: width * height * 4, repeatedValue: 0)
+
+        withSemiPlanarFrame { frame in
+            self.measureBlock {
+                convertYUVFrameToRGBA(frame, &pixels, Int32(self.width * 4), self.options())
+            }
+        }
+    }
+
+    func testConvertHalfSizePerformance() {
+        var pixels = [UInt8](count: width * height, repeatedValue: 0)
+
+        withPlanarFrame { frame in
+            self.measureBlock {
+                convertYUVFrameToRGBA(frame, &pixels, Int32(self.width * 2), self.options(halfSize: true))
+            }
+        }
+    }
+}
@@ -0,0 +1,185 @@
+/*
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import XCTest
+import VideoPreviewer
+
+@testable import DronePan
+
+// Shared by the streams of one test
+class PoolActivity {
+    let lock = NSLock()
+
+    var active = 0
+    var maxActive = 0
+
+    func begin() {
+        lock.lock()
+        active += 1
+        maxActive = max(maxActive, active)
+        lock.unlock()
+    }
+
+    func end() {
+        lock.lock()
+        active -= 1
+        lock.unlock()
+    }
+}
+
+class FakePoolStream: NSObject, DJIVideoDecodePoolStream {
+    let activity: PoolActivity
+    let stepDuration: NSTimeInterval
+
+    private let lock = NSLock()
+    private var pending: Int
+    private var running = false
+
+    var steps = 0
+    var overlapped = false
+
+    init(activity: PoolActivity, pending: Int, stepDuration: NSTimeInterval = 0) {
+        self.activity = activity
+        self.pending = pending
+        self.stepDuration = stepDuration
+    }
+
+    func decodePoolStreamHasWork() -> Bool {
+        lock.lock()
+        defer { lock.unlock() }
+
+        return pending > 0
+    }
+
+    func decodePoolStreamStep() {
+        lock.lock()
+        overlapped = overlapped || running
+        running = true
+        lock.unlock()
+
+        activity.begin()
+
+        if stepDuration > 0 {
+            NSThread.sleepForTimeInterval(stepDuration)
+        }
+
+        activity.end()
+
+        lock.lock()
+        running = false
+        pending -= 1
+        steps += 1
+        lock.unlock()
+    }
+
+    var finished: Bool {
+        lock.lock()
+        defer { lock.unlock() }
+
+        return pending <= 0
+    }
+}
+
+class VideoDecodePoolTests: XCTestCase {
+    func waitUntil(timeout: NSTimeInterval = 5, condition: () -> Bool) -> Bool {
+        let deadline = NSDate(timeIntervalSinceNow: timeout)
+
+        while !condition() {
+            if NSDate().compare(deadline) == .OrderedDescending {
+                return false
+            }
+
+            NSThread.sleepForTimeInterval(0.005)
+        }
+
+        return true
+    }
+
+    func testStreamsRunInParallel() {
+        let pool = DJIVideoDecodePool(workerCount: 2)
+        let activity = PoolActivity()
+        let streams = [FakePoolStream(activity: activity, pending: 10, stepDuration: 0.01),
+                       FakePoolStream(activity: activity, pending: 10, stepDuration: 0.01)]
+
+        for stream in streams {
+            pool.addStream(stream, priority: 1)
+        }
+
+        XCTAssertTrue(waitUntil { streams.filter { !$0.finished }.isEmpty }, "Streams not drained")
+        XCTAssertEqual(activity.maxActive, 2, "Workers did not run the streams at the same time")
+
+        for stream in streams {
+            XCTAssertFalse(stream.overlapped, "Two steps of a stream overlapped")
+            XCTAssertEqual(pool.stepCountOfStream(stream), 10)
+
+            pool.removeStream(stream)
+        }
+
+        pool.shutdown()
+    }
+
+    func testOneStreamNeverOverlaps() {
+        let pool = DJIVideoDecodePool(workerCount: 4)
+        let stream = FakePoolStream(activity: PoolActivity(), pending: 50, stepDuration: 0.001)
+
+        pool.addStream(stream, priority: 1)
+
+        XCTAssertTrue(waitUntil { stream.finished })
+        XCTAssertFalse(stream.overlapped)
+
+        pool.removeStream(stream)
+        pool.shutdown()
+    }
+
+    func testPriorityShareUnderContention() {
+        let pool = DJIVideoDecodePool(workerCount: 1)
+        let activity = PoolActivity()
+        let high = FakePoolStream(activity: activity, pending: 1_000_000, stepDuration: 0.0005)
+        let low = FakePoolStream(activity: activity, pending: 1_000_000, stepDuration: 0.0005)
+
+        pool.addStream(high, priority: 3)
+        pool.addStream(low, priority: 1)
+
+        XCTAssertTrue(waitUntil { pool.stepCountOfStream(high) + pool.stepCountOfStream(low) >= 400 })
+
+        pool.removeStream(high)
+        pool.removeStream(low)
+        pool.shutdown()
+
+        let ratio = Double(high.steps) / Double(max(low.steps, 1))
+
+        XCTAssertEqualWithAccuracy(ratio, 3, accuracy: 0.2)
+    }
+
+    func testRemoveWaitsForRunningStep() {
+        let pool = DJIVideoDecodePool(workerCount: 1)
+        let stream = FakePoolStream(activity: PoolActivity(), pending: 1_000, stepDuration: 0.02)
+
+        pool.addStream(stream, priority: 1)
+
+        XCTAssertTrue(waitUntil { stream.steps > 0 })
+
+        pool.removeStream(stream)
+
+        let steps = stream.steps
+
+        NSThread.sleepForTimeInterval(0.1)
+
+        XCTAssertEqual(stream.steps, steps, "Stream stepped after it was removed")
+        XCTAssertEqual(pool.stepCountOfStream(stream), 0)
+
+        pool.shutdown()
+    }
+}
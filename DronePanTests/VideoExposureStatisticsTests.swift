@@ -0,0 +1,154 @@
+/*
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import XCTest
+import VideoPreviewer
+
+@testable import DronePan
+
+class VideoExposureStatisticsTests: XCTestCase {
+    let width = 256
+    let height = 64
+
+    // Every row holds each luma value once
+    func gradient() -> [UInt8] {
+        return (0..<width * height).map { UInt8($0 % 256) }
+    }
+
+    func testHistogramCountsEverySample() {
+        var luma = gradient()
+        var histogram = [UInt32](count: 256, repeatedValue: 0)
+
+        let count = lumaHistogram(&luma, Int32(width), Int32(width), Int32(height), 1, &histogram)
+
+        XCTAssertEqual(count, UInt32(width * height))
+        XCTAssertFalse(histogram.contains { $0 != UInt32(height) }, "Gradient histogram is not flat")
+    }
+
+    func testHistogramGridStep() {
+        var luma = gradient()
+        var histogram = [UInt32](count: 256, repeatedValue: 0)
+
+        let count = lumaHistogram(&luma, Int32(width), Int32(width), Int32(height), 2, &histogram)
+
+        XCTAssertEqual(count, UInt32(width * height / 4))
+        XCTAssertEqual(histogram[0], UInt32(height / 2))
+        XCTAssertEqual(histogram[1], 0, "Odd columns were sampled")
+    }
+
+    func testStatistics() {
+        var histogram = [UInt32](count: 256, repeatedValue: 0)
+        histogram[10] = 10
+        histogram[128] = 80
+        histogram[250] = 10
+
+        var stats = VideoLumaStatistics()
+        lumaStatisticsFromHistogram(&histogram, 16, 235, &stats)
+
+        XCTAssertEqual(stats.sampleCount, 100)
+        XCTAssertEqualWithAccuracy(stats.mean, 128.4, accuracy: 0.01)
+        XCTAssertEqual(stats.percentile5, 10)
+        XCTAssertEqual(stats.median, 128)
+        XCTAssertEqual(stats.percentile95, 250)
+        XCTAssertEqualWithAccuracy(stats.shadowFraction, 0.1, accuracy: 0.0001)
+        XCTAssertEqualWithAccuracy(stats.highlightFraction, 0.1, accuracy: 0.0001)
+    }
+
+    func testPercentile() {
+        var histogram = [UInt32](count: 256, repeatedValue: 0)
+        for i in 0..<100 {
+            histogram[i] = 1
+        }
+
+        XCTAssertEqual(lumaHistogramPercentile(&histogram, 0), 0)
+        XCTAssertEqual(lumaHistogramPercentile(&histogram, 0.05), 4)
+        XCTAssertEqual(lumaHistogramPercentile(&histogram, 1), 99)
+    }
+
+    func testSubscription() {
+        let monitor = DJIVideoExposureMonitor()
+
+        var luma = gradient()
+        var frame = VideoFrameYUV()
+        frame.frame_uuid = 3
+
+        let expectation = expectationWithDescription("Statistics delivered to subscriber")
+
+        var calls = 0
+        let token = monitor.subscribe({ statistics in
+            calls += 1
+
+            XCTAssertEqual(statistics.frameUUID, 3)
+            XCTAssertEqual(statistics.statistics.sampleCount, UInt32(self.width * self.height / 4))
+
+            expectation.fulfill()
+        }, queue: dispatch_get_main_queue())
+
+        luma.withUnsafeMutableBufferPointer { lumaPointer in
+            var level = VideoFramePyramidLevel()
+            level.luma = lumaPointer.baseAddress
+            level.width = Int32(self.width)
+            level.height = Int32(self.height)
+
+            monitor.videoProcessPyramidLevel(&level, frame: &frame)
+
+            monitor.unsubscribe(token)
+
+            monitor.videoProcessPyramidLevel(&level, frame: &frame)
+        }
+
+        waitForExpectationsWithTimeout(2) {
+            error in
+            if let error = error {
+                XCTFail("waitForExpectationsWithTimeout errored: \(error)")
+            }
+
+            XCTAssertEqual(calls, 1, "Unsubscribed handler was called")
+        }
+    }
+
+    func testDynamicRange() {
+        let monitor = DJIVideoExposureMonitor()
+
+        // Half black, half white
+        var luma = (0..<width * height).map { $0 % width < width / 2 ? UInt8(0) : UInt8(255) }
+
+        luma.withUnsafeMutableBufferPointer { lumaPointer in
+            var level = VideoFramePyramidLevel()
+            level.luma = lumaPointer.baseAddress
+            level.width = Int32(self.width)
+            level.height = Int32(self.height)
+
+            var frame = VideoFrameYUV()
+            monitor.videoProcessPyramidLevel(&level, frame: &frame)
+        }
+
+        guard let latest = monitor.latestStatistics else {
+            XCTFail("No statistics measured")
+            return
+        }
+
+        XCTAssertTrue(latest.exceedsDynamicRangeWithClipLimit(0.02), "High contrast scene fits one exposure")
+    }
+
+    func testHistogramPerformance() {
+        var luma = (0..<640 * 360).map { UInt8($0 % 251) }
+        var histogram = [UInt32](count: 256, repeatedValue: 0)
+
+        measureBlock {
+            lumaHistogram(&luma, 640, 640, 360, 2, &histogram)
+        }
+    }
+}
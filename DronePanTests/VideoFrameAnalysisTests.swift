@@ -0,0 +1,200 @@
+/*
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import XCTest
+import VideoPreviewer
+
+@testable import DronePan
+
+class VideoFrameAnalysisTests: XCTestCase {
+    let width = 320
+    let height = 180
+
+    func options(columns columns: Int32 = 4, rows: Int32 = 3, edgeThreshold: Int32 = 64, clipThreshold: Int32 = 230) -> VideoFrameAnalysisOptions {
+        return VideoFrameAnalysisOptions(columns: columns, rows: rows, edgeThreshold: edgeThreshold, clipThreshold: clipThreshold, edgeMask: nil, clipMask: nil)
+    }
+
+    func testMatchesReference() {
+        srand48(42)
+
+        var luma = (0..<width * height).map { _ in UInt8(drand48() * 255) }
+        var edgeMask = [UInt8](count: width * height, repeatedValue: 0)
+        var clipMask = edgeMask
+        var referenceEdgeMask = edgeMask
+        var referenceClipMask = edgeMask
+
+        var result = VideoFrameAnalysisResult()
+        var reference = VideoFrameAnalysisResult()
+
+        var analysisOptions = options(columns: 5, rows: 3)
+
+        edgeMask.withUnsafeMutableBufferPointer { edgePointer in
+            clipMask.withUnsafeMutableBufferPointer { clipPointer in
+                analysisOptions.edgeMask = edgePointer.baseAddress
+                analysisOptions.clipMask = clipPointer.baseAddress
+
+                XCTAssertEqual(analyzeLumaPlane(&luma, Int32(self.width), Int32(self.width), Int32(self.height), &analysisOptions, &result), 0)
+            }
+        }
+
+        referenceEdgeMask.withUnsafeMutableBufferPointer { edgePointer in
+            referenceClipMask.withUnsafeMutableBufferPointer { clipPointer in
+                analysisOptions.edgeMask = edgePointer.baseAddress
+                analysisOptions.clipMask = clipPointer.baseAddress
+
+                XCTAssertEqual(analyzeLumaPlaneReference(&luma, Int32(self.width), Int32(self.width), Int32(self.height), &analysisOptions, &reference), 0)
+            }
+        }
+
+        XCTAssertEqual(memcmp(&result, &reference, sizeofValue(result)), 0, "Scores differ from reference")
+        XCTAssertTrue(edgeMask == referenceEdgeMask, "Edge mask differs from reference")
+        XCTAssertTrue(clipMask == referenceClipMask, "Clip mask differs from reference")
+    }
+
+    func testFlatPlaneHasNoEdges() {
+        var luma = [UInt8](count: width * height, repeatedValue: 128)
+        var analysisOptions = options()
+        var result = VideoFrameAnalysisResult()
+
+        analyzeLumaPlane(&luma, Int32(width), Int32(width), Int32(height), &analysisOptions, &result)
+
+        XCTAssertEqual(result.total.edgeEnergy, 0, "Flat plane has edge energy")
+        XCTAssertEqual(result.total.edgeFraction, 0, "Flat plane has edges")
+        XCTAssertEqual(result.total.clippedFraction, 0, "Flat plane is clipped")
+    }
+
+    func testScoresArePerRegion() {
+        // Sharp checkerboard in the left half, flat highlight in the right half
+        var luma = [UInt8](count: width * height, repeatedValue: 250)
+        for y in 0..<height {
+            for x in 0..<width / 2 {
+                luma[y * width + x] = (x / 2 + y / 2) % 2 == 0 ? 0 : 200
+            }
+        }
+
+        var analysisOptions = options(columns: 2, rows: 1)
+        var result = VideoFrameAnalysisResult()
+
+        analyzeLumaPlane(&luma, Int32(width), Int32(width), Int32(height), &analysisOptions, &result)
+
+        let left = result.regions.0
+        let right = result.regions.1
+
+        XCTAssertGreaterThan(left.edgeEnergy, right.edgeEnergy * 10, "Textured region is not sharper")
+        XCTAssertGreaterThan(left.edgeFraction, 0.5, "Textured region has too few edges")
+        XCTAssertEqual(left.clippedFraction, 0, "Textured region is clipped")
+        XCTAssertEqual(right.clippedFraction, 1, "Highlight region is not clipped")
+    }
+
+    func testInvalidGrid() {
+        var luma = [UInt8](count: width * height, repeatedValue: 0)
+        var analysisOptions = options(columns: 16, rows: 16)
+        var result = VideoFrameAnalysisResult()
+
+        XCTAssertEqual(analyzeLumaPlane(&luma, Int32(width), Int32(width), Int32(height), &analysisOptions, &result), -1, "Grid above the region limit was accepted")
+    }
+
+    func testShaderThresholds() {
+        XCTAssertEqual(edgeThresholdForFocusWarning(3.0), 255)
+        XCTAssertEqual(clipThresholdForOverExposedMark(0.9), 230)
+        XCTAssertEqual(clipThresholdForOverExposedMark(0), 256, "Mark of 0 should disable clipping")
+    }
+
+    func testLaplacianVarianceDropsWithBlur() {
+        srand48(42)
+
+        var sharp = (0..<width * height).map { _ in UInt8(drand48() * 255) }
+        var blurred = sharp
+
+        for y in 1..<height - 1 {
+            for x in 1..<width - 1 {
+                var sum = 0
+                for dy in -1...1 {
+                    for dx in -1...1 {
+                        sum += Int(sharp[(y + dy) * width + x + dx])
+                    }
+                }
+                blurred[y * width + x] = UInt8(sum / 9)
+            }
+        }
+
+        let sharpVariance = lumaLaplacianVariance(&sharp, Int32(width), Int32(width), Int32(height))
+        let blurredVariance = lumaLaplacianVariance(&blurred, Int32(width), Int32(width), Int32(height))
+
+        XCTAssertGreaterThan(sharpVariance, blurredVariance * 4, "Blur did not lower the laplacian variance")
+
+        var flat = [UInt8](count: width * height, repeatedValue: 77)
+        XCTAssertEqual(lumaLaplacianVariance(&flat, Int32(width), Int32(width), Int32(height)), 0, "Flat plane has variance")
+    }
+
+    func testMeanAbsoluteDifference() {
+        var a = [UInt8](count: width * height, repeatedValue: 100)
+        var b = [UInt8](count: width * height, repeatedValue: 103)
+
+        XCTAssertEqual(lumaMeanAbsoluteDifference(&a, Int32(width), &b, Int32(width), Int32(width), Int32(height)), 3)
+        XCTAssertEqual(lumaMeanAbsoluteDifference(&b, Int32(width), &a, Int32(width), Int32(width), Int32(height)), 3)
+        XCTAssertEqual(lumaMeanAbsoluteDifference(&a, Int32(width), &a, Int32(width), Int32(width), Int32(height)), 0)
+    }
+
+    func testAnalyzerReportsPyramidLevel() {
+        let analyzer = DJIVideoFrameAnalyzer()
+
+        var luma = [UInt8](count: width * height, repeatedValue: 255)
+
+        var frame = VideoFrameYUV()
+        frame.frame_uuid = 7
+
+        let expectation = expectationWithDescription("Analysis delivered")
+
+        analyzer.analysisHandler = { analysis in
+            XCTAssertEqual(analysis.frameUUID, 7)
+            XCTAssertEqual(analysis.width, Int32(self.width))
+            XCTAssertEqual(analysis.totalScore.clippedFraction, 1)
+
+            expectation.fulfill()
+        }
+
+        luma.withUnsafeMutableBufferPointer { lumaPointer in
+            var level = VideoFramePyramidLevel()
+            level.luma = lumaPointer.baseAddress
+            level.width = Int32(self.width)
+            level.height = Int32(self.height)
+            level.level = 1
+
+            analyzer.videoProcessPyramidLevel(&level, frame: &frame)
+        }
+
+        XCTAssertNotNil(analyzer.latestAnalysis)
+
+        waitForExpectationsWithTimeout(2) {
+            error in
+            if let error = error {
+                XCTFail("waitForExpectationsWithTimeout errored: \(error)")
+            }
+        }
+    }
+
+    func testAnalyzePerformance() {
+        srand48(42)
+
+        var luma = (0..<width * height).map { _ in UInt8(drand48() * 255) }
+        var analysisOptions = options()
+        var result = VideoFrameAnalysisResult()
+
+        measureBlock {
+            analyzeLumaPlane(&luma, Int32(self.width), Int32(self.width), Int32(self.height), &analysisOptions, &result)
+        }
+    }
+}
@@ -0,0 +1,126 @@
+/*
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import XCTest
+import VideoPreviewer
+
+@testable import DronePan
+
+class VideoJitterBufferTests: XCTestCase {
+    let frameInterval: UInt64 = 33333
+
+    // Deterministic link delay between 0 and 30ms
+    func linkDelay(frame: Int) -> UInt64 {
+        return UInt64((frame * 7919) % 31) * 1000
+    }
+
+    func testCadenceRebuiltFromJitteredArrivals() {
+        var reconstructor = VideoTimestampReconstructor()
+        var lastPts: UInt64 = 0
+
+        for frame in 0 ..< 120 {
+            let sent = 1000000 + UInt64(frame) * frameInterval
+            let pts = videoTimestampReconstruct(&reconstructor, sent + 20000 + linkDelay(frame), Int32(frame % 16), 16, 30)
+
+            XCTAssertLessThanOrEqual(pts, sent + 20000 + linkDelay(frame), "Presentation time after the arrival")
+
+            if frame > 0 {
+                XCTAssertEqualWithAccuracy(Double(pts - lastPts), Double(frameInterval), accuracy: 1000, "Frame \(frame) off the cadence")
+            }
+
+            lastPts = pts
+        }
+
+        XCTAssertEqual(reconstructor.resyncCount, 0)
+    }
+
+    func testMissingFramesKeepTheirPlace() {
+        var reconstructor = VideoTimestampReconstructor()
+
+        let first = videoTimestampReconstruct(&reconstructor, 1000000, 14, 16, 30)
+        // Frames 15 and 0 were lost, frame_num wraps at 16
+        let next = videoTimestampReconstruct(&reconstructor, 1000000 + 3 * frameInterval, 1, 16, 30)
+
+        XCTAssertEqualWithAccuracy(Double(next - first), Double(3 * frameInterval), accuracy: 2)
+    }
+
+    func testStallRestartsTimeline() {
+        var reconstructor = VideoTimestampReconstructor()
+
+        videoTimestampReconstruct(&reconstructor, 1000000, 0, 16, 30)
+        let pts = videoTimestampReconstruct(&reconstructor, 3000000, 1, 16, 30)
+
+        XCTAssertEqual(pts, 3000000)
+        XCTAssertEqual(reconstructor.resyncCount, 1)
+
+        videoTimestampReset(&reconstructor)
+
+        XCTAssertEqual(reconstructor.resyncCount, 1, "Reset cleared the resync count")
+    }
+
+    func testPlayoutDelayCoversJitter() {
+        var buffer = VideoPlayoutBuffer()
+        videoPlayoutInit(&buffer, 100000)
+
+        for frame in 0 ..< 120 {
+            let pts = 1000000 + UInt64(frame) * frameInterval
+            let arrival = pts + linkDelay(frame)
+            let due = videoPlayoutTime(&buffer, pts, arrival, arrival)
+
+            XCTAssertGreaterThanOrEqual(due, arrival)
+        }
+
+        XCTAssertGreaterThan(buffer.statistics.targetDelay, 25)
+        XCTAssertLessThanOrEqual(buffer.statistics.playoutDelay, 100)
+        XCTAssertGreaterThan(buffer.statistics.jitter, 0)
+        XCTAssertEqual(buffer.statistics.frameCount, 120)
+    }
+
+    func testDelayLimitedByMaximum() {
+        var buffer = VideoPlayoutBuffer()
+        videoPlayoutInit(&buffer, 50000)
+
+        let due = videoPlayoutTime(&buffer, 1000000, 1200000, 1000000)
+
+        XCTAssertLessThanOrEqual(due, 1050000)
+        XCTAssertEqualWithAccuracy(buffer.statistics.targetDelay, 50, accuracy: 0.001)
+    }
+
+    func testLateFrameLeavesAtOnce() {
+        var buffer = VideoPlayoutBuffer()
+        videoPlayoutInit(&buffer, 100000)
+
+        let due = videoPlayoutTime(&buffer, 1000000, 1000000, 1200000)
+
+        XCTAssertEqual(due, 1200000)
+        XCTAssertEqual(buffer.statistics.lateFrameCount, 1)
+    }
+
+    func testLowestLatencyHoldsNothing() {
+        var buffer = VideoPlayoutBuffer()
+        videoPlayoutInit(&buffer, 100000)
+        buffer.lowestLatency = true
+
+        for frame in 0 ..< 30 {
+            let pts = 1000000 + UInt64(frame) * frameInterval
+            let arrival = pts + linkDelay(frame)
+
+            XCTAssertEqual(videoPlayoutTime(&buffer, pts, arrival, arrival), arrival)
+        }
+
+        XCTAssertEqual(buffer.statistics.playoutDelay, 0)
+        XCTAssertEqual(buffer.statistics.lateFrameCount, 0)
+    }
+}
@@ -0,0 +1,167 @@
+/*
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import XCTest
+import QuartzCore
+import VideoPreviewer
+
+@testable import DronePan
+
+class FakePresentTarget: NSObject, DJIVideoPresentTarget {
+    var presented: [UInt32] = []
+    var lumaValues: [UInt8] = []
+
+    // Stands in for a present that waits for vsync
+    var presentDelay: NSTimeInterval = 0
+
+    func presentFrame(frame: UnsafeMutablePointer<VideoFrameYUV>) {
+        presented.append(frame.memory.frame_uuid)
+        lumaValues.append(frame.memory.luma[0])
+
+        if presentDelay > 0 {
+            NSThread.sleepForTimeInterval(presentDelay)
+        }
+    }
+}
+
+class VideoPresenterTests: XCTestCase {
+    let width: Int32 = 64
+    let height: Int32 = 48
+
+    // Publish a planar frame whose planes are filled with its uuid
+    func publish(presenter: DJIVideoPresenter, uuid: UInt32) -> Bool {
+        var luma = [UInt8](count: Int(width * height), repeatedValue: UInt8(uuid & 255))
+        var chromaB = [UInt8](count: Int(width * height / 4), repeatedValue: 128)
+        var chromaR = [UInt8](count: Int(width * height / 4), repeatedValue: 128)
+
+        var published = false
+
+        luma.withUnsafeMutableBufferPointer { lumaBuffer in
+            chromaB.withUnsafeMutableBufferPointer { chromaBBuffer in
+                chromaR.withUnsafeMutableBufferPointer { chromaRBuffer in
+                    var frame = VideoFrameYUV()
+                    frame.frameType = UInt8(VPFrameType.YUV420Planer.rawValue)
+                    frame.luma = lumaBuffer.baseAddress
+                    frame.chromaB = chromaBBuffer.baseAddress
+                    frame.chromaR = chromaRBuffer.baseAddress
+                    frame.width = self.width
+                    frame.height = self.height
+                    frame.frame_uuid = uuid
+
+                    published = presenter.publishFrame(&frame)
+                }
+            }
+        }
+
+        return published
+    }
+
+    func testPresentsNewestFrameOnly() {
+        let target = FakePresentTarget()
+        let presenter = DJIVideoPresenter(target: target)
+
+        for uuid in 1 ... 3 {
+            XCTAssertTrue(publish(presenter, uuid: UInt32(uuid)))
+        }
+
+        XCTAssertTrue(presenter.presentNewestFrame())
+        XCTAssertFalse(presenter.presentNewestFrame(), "Frame presented twice")
+
+        XCTAssertEqual(target.presented, [3])
+        XCTAssertEqual(target.lumaValues, [3], "Presented planes belong to another frame")
+
+        let statistics = presenter.statistics
+
+        XCTAssertEqual(statistics.publishedCount, 3)
+        XCTAssertEqual(statistics.presentedCount, 1)
+        XCTAssertEqual(statistics.droppedCount, 2)
+        XCTAssertEqual(statistics.idleTickCount, 1)
+    }
+
+    func testPublishedFrameIsCopied() {
+        let target = FakePresentTarget()
+        let presenter = DJIVideoPresenter(target: target)
+
+        // The planes are released before the presenter runs
+        publish(presenter, uuid: 7)
+        publish(presenter, uuid: 8)
+
+        presenter.presentNewestFrame()
+        publish(presenter, uuid: 9)
+        presenter.presentNewestFrame()
+
+        XCTAssertEqual(target.presented, [8, 9])
+        XCTAssertEqual(target.lumaValues, [8, 9])
+    }
+
+    func testClearDropsPendingFrame() {
+        let target = FakePresentTarget()
+        let presenter = DJIVideoPresenter(target: target)
+
+        publish(presenter, uuid: 1)
+        presenter.clear()
+
+        XCTAssertFalse(presenter.presentNewestFrame())
+        XCTAssertTrue(target.presented.isEmpty)
+        XCTAssertEqual(presenter.statistics.droppedCount, 1)
+    }
+
+    func testUnsupportedFrameRejected() {
+        let presenter = DJIVideoPresenter(target: FakePresentTarget())
+        var frame = VideoFrameYUV()
+
+        XCTAssertFalse(presenter.publishFrame(&frame), "Frame without planes accepted")
+    }
+
+    func testSlowPresentNeverBlocksPublisher() {
+        let target = FakePresentTarget()
+        target.presentDelay = 0.05
+
+        let presenter = DJIVideoPresenter(target: target)
+        let queue = dispatch_queue_create("VideoPresenterTests.vsync", DISPATCH_QUEUE_SERIAL)
+        let done = dispatch_semaphore_create(0)
+
+        // Stand-in for the display link, presenting as fast as the slow target allows
+        var stop = false
+        dispatch_async(queue) {
+            while !stop {
+                presenter.presentNewestFrame()
+            }
+            dispatch_semaphore_signal(done)
+        }
+
+        let start = CACurrentMediaTime()
+
+        for uuid in 1 ... 30 {
+            publish(presenter, uuid: UInt32(uuid))
+        }
+
+        let publishTime = CACurrentMediaTime() - start
+
+        NSThread.sleepForTimeInterval(0.1)
+        stop = true
+        dispatch_semaphore_wait(done, DISPATCH_TIME_FOREVER)
+
+        XCTAssertLessThan(publishTime, 0.05, "Publisher waited for the presenter")
+
+        XCTAssertEqual(target.presented.last, 30, "Newest frame never presented")
+        XCTAssertEqual(target.presented, target.presented.sort(), "Frames presented out of order")
+
+        let statistics = presenter.statistics
+
+        XCTAssertEqual(statistics.presentedCount + statistics.droppedCount, 30)
+        XCTAssertGreaterThan(statistics.droppedCount, 0)
+    }
+}
@@ -0,0 +1,223 @@
+/*
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import XCTest
+import VideoToolbox
+import VideoPreviewer
+
+@testable import DronePan
+
+// One encoded frame as it comes from the aircraft - Annex B with the parameter sets in front of a keyframe
+struct EncodedTestFrame {
+    let bytes: [UInt8]
+    let keyframe: Bool
+}
+
+// Encodes a moving gradient with VideoToolbox so the previewer has a stream it can decode, a single GOP by default
+func encodeTestStream(frameCount: Int, keyframeInterval: Int = 0, width: Int = 320, height: Int = 240) -> [EncodedTestFrame] {
+    var session: VTCompressionSession?
+    guard VTCompressionSessionCreate(nil, Int32(width), Int32(height), kCMVideoCodecType_H264, nil, nil, nil, nil, nil, &session) == noErr,
+        let encoder = session else {
+        return []
+    }
+
+    VTSessionSetProperty(encoder, kVTCompressionPropertyKey_ProfileLevel, kVTProfileLevel_H264_Baseline_AutoLevel)
+    VTSessionSetProperty(encoder, kVTCompressionPropertyKey_AllowFrameReordering, kCFBooleanFalse)
+    VTSessionSetProperty(encoder, kVTCompressionPropertyKey_MaxKeyFrameInterval, keyframeInterval > 0 ? keyframeInterval : frameCount + 1)
+
+    let lock = NSLock()
+    var frames: [EncodedTestFrame] = []
+
+    for index in 0 ..< frameCount {
+        var pixelBuffer: CVPixelBuffer?
+        CVPixelBufferCreate(nil, width, height, kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange, nil, &pixelBuffer)
+
+        guard let buffer = pixelBuffer else {
+            return []
+        }
+
+        CVPixelBufferLockBaseAddress(buffer, 0)
+
+        let luma = UnsafeMutablePointer<UInt8>(CVPixelBufferGetBaseAddressOfPlane(buffer, 0))
+        let lumaStride = CVPixelBufferGetBytesPerRowOfPlane(buffer, 0)
+
+        for y in 0 ..< height {
+            for x in 0 ..< width {
+                luma[y * lumaStride + x] = UInt8(truncatingBitPattern: x + y + index * 4)
+            }
+        }
+
+        memset(CVPixelBufferGetBaseAddressOfPlane(buffer, 1), 128, CVPixelBufferGetBytesPerRowOfPlane(buffer, 1) * height / 2)
+
+        CVPixelBufferUnlockBaseAddress(buffer, 0)
+
+        VTCompressionSessionEncodeFrameWithOutputHandler(encoder, buffer, CMTimeMake(Int64(index), 30), kCMTimeInvalid, nil, nil) { status, _, sampleBuffer in
+            guard status == noErr, let sample = sampleBuffer, frame = annexBFrame(sample) else {
+                return
+            }
+
+            lock.lock()
+            frames.append(frame)
+            lock.unlock()
+        }
+    }
+
+    VTCompressionSessionCompleteFrames(encoder, kCMTimeInvalid)
+    VTCompressionSessionInvalidate(encoder)
+
+    return frames
+}
+
+private func annexBFrame(sample: CMSampleBuffer) -> EncodedTestFrame? {
+    guard let dataBuffer = CMSampleBufferGetDataBuffer(sample), format = CMSampleBufferGetFormatDescription(sample) else {
+        return nil
+    }
+
+    let startCode: [UInt8] = [0, 0, 0, 1]
+    var bytes: [UInt8] = []
+
+    var keyframe = true
+
+    if let attachments = CMSampleBufferGetSampleAttachmentsArray(sample, false) as NSArray?, first = attachments.firstObject as? NSDictionary {
+        keyframe = first[kCMSampleAttachmentKey_NotSync as String] == nil
+    }
+
+    if keyframe {
+        // SPS and PPS
+        for index in 0 ..< 2 {
+            var parameterSet = UnsafePointer<UInt8>()
+            var size = 0
+
+            guard CMVideoFormatDescriptionGetH264ParameterSetAtIndex(format, index, &parameterSet, &size, nil, nil) == noErr else {
+                return nil
+            }
+
+            bytes += startCode + Array(UnsafeBufferPointer(start: parameterSet, count: size))
+        }
+    }
+
+    var length = 0
+    var data: UnsafeMutablePointer<Int8> = nil
+
+    guard CMBlockBufferGetDataPointer(dataBuffer, 0, nil, &length, &data) == noErr else {
+        return nil
+    }
+
+    // The encoder writes 4 byte big endian lengths in front of each NAL unit
+    let nals = UnsafePointer<UInt8>(data)
+    var offset = 0
+
+    while offset + 4 <= length {
+        let nalLength = Int(nals[offset]) << 24 | Int(nals[offset + 1]) << 16 | Int(nals[offset + 2]) << 8 | Int(nals[offset + 3])
+        offset += 4
+
+        bytes += startCode + Array(UnsafeBufferPointer(start: nals + offset, count: min(nalLength, length - offset)))
+        offset += nalLength
+    }
+
+    return EncodedTestFrame(bytes: bytes, keyframe: keyframe)
+}
+
+class FrameOutputCounter: NSObject, VideoFrameProcessor {
+    private let lock = NSLock()
+    private var frames = 0
+
+    var count: Int {
+        lock.lock()
+        defer { lock.unlock() }
+
+        return frames
+    }
+
+    func videoProcessorEnabled() -> Bool {
+        return true
+    }
+
+    func videoProcessFrame(frame: UnsafeMutablePointer<VideoFrameYUV>) {
+        lock.lock()
+        frames += 1
+        lock.unlock()
+    }
+
+    func videoProcessFailedFrame() {
+    }
+
+    func waitForCount(count: Int, timeout: NSTimeInterval) -> Bool {
+        let deadline = NSDate(timeIntervalSinceNow: timeout)
+
+        while self.count < count {
+            if NSDate().compare(deadline) == .OrderedDescending {
+                return false
+            }
+
+            NSThread.sleepForTimeInterval(0.01)
+        }
+
+        return true
+    }
+}
+
+class VideoPreviewerResetTests: XCTestCase {
+    var previewer: VideoPreviewer!
+    var output: FrameOutputCounter!
+
+    override func setUp() {
+        super.setUp()
+
+        previewer = VideoPreviewer()
+        output = FrameOutputCounter()
+
+        previewer.registFrameProcessor(output)
+        XCTAssertTrue(previewer.start())
+    }
+
+    override func tearDown() {
+        previewer.close()
+
+        super.tearDown()
+    }
+
+    func push(frames: ArraySlice<EncodedTestFrame>) {
+        for frame in frames {
+            var bytes = frame.bytes
+            previewer.push(&bytes, length: Int32(bytes.count))
+
+            // Roughly the pace of the aircraft, the data queue would drop frames if pushed all at once
+            NSThread.sleepForTimeInterval(0.005)
+        }
+    }
+
+    func testResetMidGOPResumesBeforeNextKeyframe() {
+        let frames = encodeTestStream(60)
+
+        XCTAssertEqual(frames.count, 60)
+        XCTAssertEqual(frames.filter { $0.keyframe }.count, 1, "Test stream needs a single GOP")
+
+        push(frames[0 ..< 20])
+        XCTAssertTrue(output.waitForCount(10, timeout: 2), "Stream not decoded")
+
+        // Mid GOP, the same happens on a decoder rebuild
+        previewer.reset()
+
+        // The reset runs on the previewer's queue
+        NSThread.sleepForTimeInterval(0.2)
+
+        let countAtReset = output.count
+
+        push(frames[20 ..< 60])
+
+        XCTAssertTrue(output.waitForCount(countAtReset + 10, timeout: 2), "No output after the reset until the next keyframe")
+    }
+}
@@ -0,0 +1,145 @@
+/*
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import XCTest
+import VideoPreviewer
+
+@testable import DronePan
+
+class VideoProcessorCostTests: XCTestCase {
+    func testHistogramBuckets() {
+        let cost = DJIVideoProcessorCost(name: "Test")
+
+        // 50us buckets doubling: 10us in 0, 60us in 1, 150us in 2, one second in the last
+        for duration: UInt64 in [10, 60, 150, 1_000_000] {
+            cost.recordDuration(duration)
+        }
+
+        let histogram = cost.histogram().map { ($0 as! NSNumber).integerValue }
+
+        XCTAssertEqual(histogram.count, Int(VIDEO_PROCESSOR_COST_BUCKET_COUNT))
+        XCTAssertEqual(histogram[0], 1)
+        XCTAssertEqual(histogram[1], 1)
+        XCTAssertEqual(histogram[2], 1)
+        XCTAssertEqual(histogram[Int(VIDEO_PROCESSOR_COST_BUCKET_COUNT) - 1], 1)
+
+        XCTAssertEqual(cost.callCount, 4)
+        XCTAssertEqualWithAccuracy(cost.maxDuration, 1000, accuracy: 0.001)
+        XCTAssertEqualWithAccuracy(cost.averageDuration, (10 + 60 + 150 + 1_000_000) / 4000.0, accuracy: 0.001)
+    }
+
+    func testPercentiles() {
+        let cost = DJIVideoProcessorCost(name: "Test")
+
+        for _ in 0 ..< 90 {
+            cost.recordDuration(20)
+        }
+
+        for _ in 0 ..< 10 {
+            cost.recordDuration(3000)
+        }
+
+        XCTAssertEqualWithAccuracy(cost.durationAtPercentile(50), 0.05, accuracy: 0.0001)
+        XCTAssertEqualWithAccuracy(cost.durationAtPercentile(90), 0.05, accuracy: 0.0001)
+        // 3ms falls in the bucket up to 3.2ms
+        XCTAssertEqualWithAccuracy(cost.durationAtPercentile(99), 3.2, accuracy: 0.0001)
+        XCTAssertEqual(DJIVideoProcessorCost(name: "Empty").durationAtPercentile(50), 0)
+    }
+
+    func testSlowFlagNeedsEnoughCalls() {
+        let cost = DJIVideoProcessorCost(name: "Test")
+        cost.budget = 8000
+
+        for _ in 0 ..< Int(VIDEO_PROCESSOR_COST_MIN_CALLS) - 1 {
+            XCTAssertFalse(cost.recordDuration(20_000))
+        }
+
+        XCTAssertFalse(cost.slow, "Flagged before enough calls")
+        XCTAssertTrue(cost.recordDuration(20_000), "Not flagged once enough calls were seen")
+        XCTAssertTrue(cost.slow)
+        XCTAssertFalse(cost.recordDuration(20_000), "Flagged twice")
+    }
+
+    func testSlowFlagClearsUnderHalfTheBudget() {
+        let cost = DJIVideoProcessorCost(name: "Test")
+        cost.budget = 8000
+
+        for _ in 0 ..< 40 {
+            cost.recordDuration(20_000)
+        }
+
+        XCTAssertTrue(cost.slow)
+
+        // Just under the budget keeps the flag
+        for _ in 0 ..< 100 {
+            cost.recordDuration(6000)
+        }
+
+        XCTAssertTrue(cost.slow, "Flag cleared above half the budget")
+
+        for _ in 0 ..< 100 {
+            cost.recordDuration(1000)
+        }
+
+        XCTAssertFalse(cost.slow, "Flag kept under half the budget")
+    }
+
+    func testNoBudgetNeverFlags() {
+        let cost = DJIVideoProcessorCost(name: "Test")
+
+        for _ in 0 ..< 100 {
+            XCTAssertFalse(cost.recordDuration(1_000_000))
+        }
+
+        XCTAssertFalse(cost.slow)
+    }
+
+    func testReset() {
+        let cost = DJIVideoProcessorCost(name: "Test")
+        cost.budget = 1000
+
+        for _ in 0 ..< 40 {
+            cost.recordDuration(5000)
+        }
+
+        cost.reset()
+
+        XCTAssertEqual(cost.callCount, 0)
+        XCTAssertFalse(cost.slow)
+        XCTAssertEqual(cost.maxDuration, 0)
+        XCTAssertEqual(cost.histogram().map { ($0 as! NSNumber).integerValue }.reduce(0, combine: +), 0)
+    }
+
+    func testStreamWorkerRecordsCost() {
+        let processor = SlowStreamProcessor(type: DJIVideoStreamProcessorType_Passthrough, policy: .Block)
+        let worker = DJIVideoStreamWorker(processor: processor)
+        let cost = DJIVideoProcessorCost(name: "SlowStreamProcessor")
+
+        worker.cost = cost
+        processor.open(3)
+
+        for uuid in 1 ... 3 {
+            let frame = UnsafeMutablePointer<VideoFrameH264Raw>(calloc(1, 64))
+            frame.memory.frame_uuid = UInt32(uuid)
+
+            worker.submitFrame(frame, size: 64, keyframe: true, copy: true)
+            free(frame)
+        }
+
+        worker.waitUntilIdle()
+
+        XCTAssertEqual(cost.callCount, 3)
+    }
+}
@@ -0,0 +1,97 @@
+/*
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import XCTest
+import VideoPreviewer
+
+@testable import DronePan
+
+class PlaneRecorder: NSObject, VideoFrameProcessor {
+    let done = dispatch_semaphore_create(0)
+
+    var luma: [UInt8]?
+    var chromaB: [UInt8]?
+    var chromaR: [UInt8]?
+    var slices: (Int32, Int32, Int32) = (0, 0, 0)
+
+    func videoProcessorEnabled() -> Bool {
+        return true
+    }
+
+    func videoProcessFrame(frame: UnsafeMutablePointer<VideoFrameYUV>) {
+        let width = Int(frame.memory.width)
+        let height = Int(frame.memory.height)
+
+        if frame.memory.luma != nil {
+            luma = Array(UnsafeBufferPointer(start: frame.memory.luma, count: width * height))
+        }
+
+        if frame.memory.chromaB != nil {
+            chromaB = Array(UnsafeBufferPointer(start: frame.memory.chromaB, count: width * height / 4))
+        }
+
+        if frame.memory.chromaR != nil {
+            chromaR = Array(UnsafeBufferPointer(start: frame.memory.chromaR, count: width * height / 4))
+        }
+
+        slices = (frame.memory.lumaSlice, frame.memory.chromaBSlice, frame.memory.chromaRSlice)
+
+        dispatch_semaphore_signal(done)
+    }
+
+    func videoProcessFailedFrame() {
+    }
+}
+
+class VideoProcessorSnapshotTests: XCTestCase {
+    func testDemotedProcessorGetsPackedPlanes() {
+        let width = 16
+        let height = 8
+
+        var luma = (0 ..< width * height).map { UInt8(truncatingBitPattern: $0) }
+        var chromaB = [UInt8](count: width * height / 4, repeatedValue: 100)
+        var chromaR = [UInt8](count: width * height / 4, repeatedValue: 200)
+
+        let recorder = PlaneRecorder()
+        let entry = DJIVideoFrameProcessorEntry(processor: recorder)
+        entry.demote()
+
+        luma.withUnsafeMutableBufferPointer { lumaPlane in
+            chromaB.withUnsafeMutableBufferPointer { chromaBPlane in
+                chromaR.withUnsafeMutableBufferPointer { chromaRPlane in
+                    // The software decoder leaves the slices at 0 for its packed planes
+                    var frame = VideoFrameYUV()
+                    frame.luma = lumaPlane.baseAddress
+                    frame.chromaB = chromaBPlane.baseAddress
+                    frame.chromaR = chromaRPlane.baseAddress
+                    frame.frameType = UInt8(VPFrameType.YUV420Planer.rawValue)
+                    frame.width = Int32(width)
+                    frame.height = Int32(height)
+
+                    XCTAssertTrue(entry.submitFrame(&frame, level: nil))
+                }
+            }
+        }
+
+        XCTAssertEqual(dispatch_semaphore_wait(recorder.done, dispatch_time(DISPATCH_TIME_NOW, Int64(NSEC_PER_SEC))), 0)
+
+        XCTAssertEqual(recorder.luma ?? [], luma)
+        XCTAssertEqual(recorder.chromaB ?? [], chromaB)
+        XCTAssertEqual(recorder.chromaR ?? [], chromaR)
+        XCTAssertEqual(recorder.slices.0, Int32(width))
+        XCTAssertEqual(recorder.slices.1, Int32(width / 2))
+        XCTAssertEqual(recorder.slices.2, Int32(width / 2))
+    }
+}
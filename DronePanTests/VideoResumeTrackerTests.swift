@@ -0,0 +1,132 @@
+/*
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import XCTest
+import VideoPreviewer
+
+@testable import DronePan
+
+class VideoResumeTrackerTests: XCTestCase {
+    let timeout: UInt64 = 2000000
+
+    func frameInfo(index: Int) -> VideoFrameH264BasicInfo {
+        var info = VideoFrameH264BasicInfo()
+        info.frame_index = UInt16(index % 16)
+        info.max_frame_index_plus_one = 16
+
+        return info
+    }
+
+    func decode(inout tracker: VideoResumeTracker, index: Int, keyframe: Bool = false, decoded: Bool = true, at time: UInt64 = 0) -> VideoResumeResult {
+        var info = frameInfo(index)
+
+        return videoResumeFrameDecoded(&tracker, &info, keyframe, decoded, time)
+    }
+
+    func testChainBeforeResumeIsNotTrusted() {
+        var tracker = VideoResumeTracker()
+        videoResumeInit(&tracker, timeout)
+
+        decode(&tracker, index: 0, keyframe: true)
+
+        for index in 1 ..< 5 {
+            decode(&tracker, index: index)
+        }
+
+        videoResumeBegin(&tracker, 1000000)
+
+        // The decoder may have dropped its references while paused
+        XCTAssertEqual(decode(&tracker, index: 5, at: 1033000), VideoResumeResult.Pending)
+        XCTAssertEqual(decode(&tracker, index: 0, keyframe: true, at: 1066000), VideoResumeResult.Clean)
+        XCTAssertEqual(tracker.statistics.lastHiddenFrameCount, 2)
+        XCTAssertEqualWithAccuracy(tracker.statistics.lastLatency, 66, accuracy: 0.001)
+    }
+
+    func testGapWaitsForKeyframe() {
+        var tracker = VideoResumeTracker()
+        videoResumeInit(&tracker, timeout)
+
+        decode(&tracker, index: 0, keyframe: true)
+        // Frames 1 and 2 never arrived
+        decode(&tracker, index: 3)
+
+        videoResumeBegin(&tracker, 0)
+
+        for index in 4 ..< 10 {
+            XCTAssertEqual(decode(&tracker, index: index), VideoResumeResult.Pending, "Frame \(index) shown with missing references")
+        }
+
+        XCTAssertEqual(decode(&tracker, index: 0, keyframe: true, at: 200000), VideoResumeResult.Clean)
+        XCTAssertEqual(tracker.statistics.lastHiddenFrameCount, 7)
+    }
+
+    func testSkippedFrameBreaksChain() {
+        var tracker = VideoResumeTracker()
+        videoResumeInit(&tracker, timeout)
+
+        decode(&tracker, index: 0, keyframe: true)
+        // Decoded in the background or dropped by a resync
+        decode(&tracker, index: 1, decoded: false)
+
+        videoResumeBegin(&tracker, 0)
+
+        XCTAssertEqual(decode(&tracker, index: 2), VideoResumeResult.Pending)
+    }
+
+    func testReplayedGopRebuildsChain() {
+        var tracker = VideoResumeTracker()
+        videoResumeInit(&tracker, timeout)
+
+        videoResumeBegin(&tracker, 0)
+        videoResumeChainRebuilt(&tracker)
+
+        XCTAssertEqual(decode(&tracker, index: 9), VideoResumeResult.Clean)
+    }
+
+    func testFrameNumberWrapIsNotGap() {
+        var tracker = VideoResumeTracker()
+        videoResumeInit(&tracker, timeout)
+
+        decode(&tracker, index: 14, keyframe: true)
+        decode(&tracker, index: 15)
+        decode(&tracker, index: 0)
+
+        XCTAssertTrue(tracker.chainIntact)
+    }
+
+    func testTimeoutFallback() {
+        var tracker = VideoResumeTracker()
+        videoResumeInit(&tracker, timeout)
+
+        videoResumeBegin(&tracker, 1000000)
+
+        XCTAssertEqual(decode(&tracker, index: 3, at: 1500000), VideoResumeResult.Pending)
+        XCTAssertEqual(videoResumeCheckTimeout(&tracker, 2999999), VideoResumeResult.Pending)
+        XCTAssertEqual(videoResumeCheckTimeout(&tracker, 3000000), VideoResumeResult.TimedOut)
+
+        XCTAssertFalse(tracker.resuming)
+        XCTAssertEqual(tracker.statistics.resumeCount, 1)
+        XCTAssertEqual(tracker.statistics.timeoutCount, 1)
+        XCTAssertEqualWithAccuracy(tracker.statistics.maxLatency, 2000, accuracy: 0.001)
+    }
+
+    func testNoResultOutsideResume() {
+        var tracker = VideoResumeTracker()
+        videoResumeInit(&tracker, timeout)
+
+        XCTAssertEqual(decode(&tracker, index: 0, keyframe: true), VideoResumeResult.Pending)
+        XCTAssertEqual(tracker.statistics.resumeCount, 0)
+    }
+}
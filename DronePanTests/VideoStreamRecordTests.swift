@@ -0,0 +1,180 @@
+/*
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import XCTest
+import VideoPreviewer
+
+@testable import DronePan
+
+class VideoStreamRecordTests: XCTestCase {
+    var directory: String!
+
+    override func setUp() {
+        super.setUp()
+
+        directory = (NSTemporaryDirectory() as NSString).stringByAppendingPathComponent(NSUUID().UUIDString)
+        try! NSFileManager.defaultManager().createDirectoryAtPath(directory, withIntermediateDirectories: true, attributes: nil)
+    }
+
+    override func tearDown() {
+        try! NSFileManager.defaultManager().removeItemAtPath(directory)
+
+        super.tearDown()
+    }
+
+    func path(prefix: String, segment: UInt32, fileExtension: String) -> String {
+        return (directory as NSString).stringByAppendingPathComponent(String(format: "%@_%06u.%@", prefix, segment, fileExtension))
+    }
+
+    // Size of the record of frame `index`, every 30th is a keyframe
+    func recordSize(index: Int) -> Int {
+        return index % 30 == 0 ? 15000 : 500 + (index * 37) % 3000
+    }
+
+    func writeRecords(count: Int) -> VideoRecordStatistics {
+        var writer = VideoRecordWriter()
+        XCTAssertEqual(videoRecordWriterOpen(&writer, directory, "flight", 64 * 1024, 300 * 1024, 1000000), 0)
+
+        for index in 0 ..< count {
+            var record = [UInt8](count: recordSize(index), repeatedValue: UInt8(index & 0xff))
+            record[0] = UInt8(index >> 8)
+
+            let time = UInt64(index * 33333)
+            videoRecordWriterAppend(&writer, record, UInt32(record.count), index % 30 == 0 ? 1 : 0, time, 1000000 + time, UInt32(index + 1))
+        }
+
+        videoRecordWriterClose(&writer)
+
+        return writer.statistics
+    }
+
+    func testSegmentsReadBackInOrder() {
+        let statistics = writeRecords(300)
+
+        XCTAssertEqual(statistics.recordCount, 300)
+        XCTAssertEqual(statistics.keyframeCount, 10)
+        XCTAssertEqual(statistics.errorCount, 0)
+        XCTAssertGreaterThan(statistics.segmentCount, 1, "Segment size limit ignored")
+        XCTAssertEqual(statistics.bytesWritten % UInt64(VIDEO_RECORD_PAGE_SIZE), 0, "Write not page aligned")
+
+        var index = 0
+
+        for number in 0 ..< statistics.segmentCount {
+            var segment = VideoRecordSegment()
+            XCTAssertEqual(videoRecordSegmentOpen(&segment, path("flight", segment: number, fileExtension: "vrec")), 0)
+
+            var offset: UInt64 = 0
+            var size: UInt32 = 0
+            var flags: UInt32 = 0
+            var first = true
+
+            while true {
+                let payload = videoRecordSegmentRead(&segment, &offset, &size, &flags)
+                if payload == nil {
+                    break
+                }
+
+                XCTAssertEqual(Int(size), recordSize(index))
+                XCTAssertEqual(Int(payload[0]), index >> 8)
+                XCTAssertEqual(payload[Int(size) - 1], UInt8(index & 0xff))
+
+                if first {
+                    XCTAssertEqual(flags & UInt32(VIDEO_RECORD_FLAG_KEYFRAME), UInt32(VIDEO_RECORD_FLAG_KEYFRAME), "Segment does not start at a keyframe")
+                    first = false
+                }
+
+                index += 1
+            }
+
+            videoRecordSegmentClose(&segment)
+        }
+
+        XCTAssertEqual(index, 300)
+    }
+
+    func testIndexSeeksToKeyframe() {
+        writeRecords(100)
+
+        var segment = VideoRecordSegment()
+        var index = VideoRecordIndex()
+        XCTAssertEqual(videoRecordSegmentOpen(&segment, path("flight", segment: 0, fileExtension: "vrec")), 0)
+        XCTAssertEqual(videoRecordIndexOpen(&index, path("flight", segment: 0, fileExtension: "vidx")), 0)
+
+        XCTAssertEqual(index.count, 4)
+
+        // Frame 45 is shown by decoding from the keyframe at frame 30
+        let entry = videoRecordIndexSeek(&index, 1000000 + 45 * 33333)
+        XCTAssertEqual(entry.memory.uuid, 31)
+
+        var offset = entry.memory.offset
+        var size: UInt32 = 0
+        var flags: UInt32 = 0
+        let payload = videoRecordSegmentRead(&segment, &offset, &size, &flags)
+
+        XCTAssertEqual(size, entry.memory.size)
+        XCTAssertEqual(flags, UInt32(VIDEO_RECORD_FLAG_KEYFRAME))
+        XCTAssertEqual(payload[Int(size) - 1], 30)
+
+        XCTAssertTrue(videoRecordIndexSeek(&index, 999999) == nil, "Keyframe found before the recording")
+
+        videoRecordIndexClose(&index)
+        videoRecordSegmentClose(&segment)
+    }
+
+    func testRecorderKeepsEveryFrame() {
+        let recorder = DJIVideoStreamRecorder(directory: directory)
+
+        XCTAssertFalse(recorder.streamProcessorEnabled())
+        XCTAssertTrue(recorder.startRecording())
+        XCTAssertTrue(recorder.streamProcessorEnabled())
+
+        let frameSize = sizeof(VideoFrameH264Raw)
+
+        for uuid in 1 ... 50 {
+            let frame = UnsafeMutablePointer<VideoFrameH264Raw>(calloc(1, frameSize))
+            frame.memory.frame_uuid = UInt32(uuid)
+
+            // The recorder frees the frame
+            XCTAssertTrue(recorder.streamProcessorHandleFrameRaw(frame))
+        }
+
+        recorder.stopRecording()
+
+        XCTAssertFalse(recorder.streamProcessorEnabled())
+        XCTAssertEqual(recorder.statistics.recordCount, 50)
+
+        var segment = VideoRecordSegment()
+        XCTAssertEqual(videoRecordSegmentOpen(&segment, path(recorder.recordingName, segment: 0, fileExtension: "vrec")), 0)
+
+        var offset: UInt64 = 0
+        var size: UInt32 = 0
+        var flags: UInt32 = 0
+        var uuids: [UInt32] = []
+
+        while true {
+            let payload = videoRecordSegmentRead(&segment, &offset, &size, &flags)
+            if payload == nil {
+                break
+            }
+
+            XCTAssertEqual(Int(size), frameSize)
+            uuids.append(UnsafePointer<VideoFrameH264Raw>(payload).memory.frame_uuid)
+        }
+
+        XCTAssertEqual(uuids, (1 ... 50).map { UInt32($0) })
+
+        videoRecordSegmentClose(&segment)
+    }
+}
@@ -0,0 +1,159 @@
+/*
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import XCTest
+import VideoPreviewer
+
+@testable import DronePan
+
+class VideoStreamReplayTests: XCTestCase {
+    var directory: String!
+    var stream: [UInt8] = []
+    var accessUnitSizes: [Int] = []
+
+    override func setUp() {
+        super.setUp()
+
+        directory = (NSTemporaryDirectory() as NSString).stringByAppendingPathComponent(NSUUID().UUIDString)
+        try! NSFileManager.defaultManager().createDirectoryAtPath(directory, withIntermediateDirectories: true, attributes: nil)
+
+        // A keyframe every 10 frames, some frames with two slices, some with SEI
+        stream = []
+        accessUnitSizes = []
+
+        for frame in 0 ..< 20 {
+            let start = stream.count
+
+            if frame % 10 == 0 {
+                stream += nal(9, length: 1) + nal(7, length: 8) + nal(8, length: 4) + slice(5, length: 300, first: true) + slice(5, length: 200, first: false)
+            } else if frame % 3 == 0 {
+                stream += nal(6, length: 5) + slice(1, length: 100, first: true)
+            } else {
+                stream += slice(1, length: 80, first: true) + slice(1, length: 60, first: false)
+            }
+
+            accessUnitSizes.append(stream.count - start)
+        }
+    }
+
+    override func tearDown() {
+        try! NSFileManager.defaultManager().removeItemAtPath(directory)
+
+        super.tearDown()
+    }
+
+    func nal(type: UInt8, length: Int) -> [UInt8] {
+        return [0, 0, 0, 1, 0x60 | type] + [UInt8](count: length, repeatedValue: 0x33)
+    }
+
+    // The first bit of the slice header is set when first_mb_in_slice is 0
+    func slice(type: UInt8, length: Int, first: Bool) -> [UInt8] {
+        return [0, 0, 0, 1, 0x60 | type, first ? 0x88 : 0x08] + [UInt8](count: length - 1, repeatedValue: 0x33)
+    }
+
+    func writeAnnexB() -> String {
+        let path = (directory as NSString).stringByAppendingPathComponent("capture.h264")
+        NSData(bytes: stream, length: stream.count).writeToFile(path, atomically: true)
+
+        return path
+    }
+
+    func options(pacing: VideoReplayPacing, chunking: VideoReplayChunking = VideoReplayChunkingOriginal, chunkSize: Int = 0, speed: Double = 1) -> VideoReplayOptions {
+        return VideoReplayOptions(pacing: pacing, speed: speed, chunking: chunking, chunkSize: chunkSize, frameRate: 0)
+    }
+
+    func replay(replayer: DJIVideoStreamReplayer) -> (bytes: [UInt8], sizes: [Int]) {
+        var bytes: [UInt8] = []
+        var sizes: [Int] = []
+
+        XCTAssertTrue(replayer.replayWithHandler { data, size in
+            bytes += Array(UnsafeBufferPointer(start: data, count: Int(size)))
+            sizes.append(Int(size))
+        })
+
+        return (bytes, sizes)
+    }
+
+    func testOriginalChunkingSplitsAccessUnits() {
+        let replayer = DJIVideoStreamReplayer(annexBFile: writeAnnexB(), options: options(VideoReplayPacingMaxSpeed))
+        let result = replay(replayer)
+
+        XCTAssertEqual(result.sizes, accessUnitSizes)
+        XCTAssertEqual(result.bytes, stream)
+        XCTAssertEqual(replayer.statistics.unitCount, 20)
+        XCTAssertEqual(replayer.statistics.mediaDuration, 19 * 1000000 / 30)
+    }
+
+    func testFixedChunking() {
+        let replayer = DJIVideoStreamReplayer(annexBFile: writeAnnexB(), options: options(VideoReplayPacingMaxSpeed, chunking: VideoReplayChunkingFixed, chunkSize: 1000))
+        let result = replay(replayer)
+
+        XCTAssertEqual(result.bytes, stream)
+        XCTAssertEqual(result.sizes.dropLast().filter { $0 != 1000 }.count, 0, "Chunk of another size before the last one")
+        XCTAssertEqual(replayer.statistics.byteCount, UInt64(stream.count))
+    }
+
+    func testPacingDoesNotChangeWhatIsPushed() {
+        let path = writeAnnexB()
+
+        let fast = DJIVideoStreamReplayer(annexBFile: path, options: options(VideoReplayPacingMaxSpeed))
+        replay(fast)
+
+        let accelerated = DJIVideoStreamReplayer(annexBFile: path, options: options(VideoReplayPacingAccelerated, speed: 20))
+        replay(accelerated)
+
+        XCTAssertEqual(fast.statistics.checksum, accelerated.statistics.checksum)
+        XCTAssertEqual(fast.statistics.chunkCount, accelerated.statistics.chunkCount)
+        XCTAssertGreaterThanOrEqual(accelerated.statistics.wallDuration, accelerated.statistics.mediaDuration / 20, "Accelerated replay not paced")
+
+        let rechunked = DJIVideoStreamReplayer(annexBFile: path, options: options(VideoReplayPacingMaxSpeed, chunking: VideoReplayChunkingFixed, chunkSize: 1000))
+        replay(rechunked)
+
+        XCTAssertNotEqual(fast.statistics.checksum, rechunked.statistics.checksum)
+    }
+
+    func testRecordingReplaysAtRecordedTimes() {
+        let recorder = DJIVideoStreamRecorder(directory: directory)
+        XCTAssertTrue(recorder.startRecording())
+
+        var offset = 0
+
+        for (index, size) in accessUnitSizes.enumerate() {
+            let frame = UnsafeMutablePointer<VideoFrameH264Raw>(calloc(1, sizeof(VideoFrameH264Raw) + size))
+            frame.memory.frame_uuid = UInt32(index + 1)
+            frame.memory.time_tag = 5000000 + UInt64(index) * 10000
+            frame.memory.frame_size = UInt32(size)
+
+            memcpy(UnsafeMutablePointer<UInt8>(frame) + sizeof(VideoFrameH264Raw), Array(stream[offset ..< offset + size]), size)
+            offset += size
+
+            recorder.streamProcessorHandleFrameRaw(frame)
+        }
+
+        recorder.stopRecording()
+
+        let replayer = DJIVideoStreamReplayer(recording: recorder.recordingName, directory: directory, options: options(VideoReplayPacingRealTime))
+        let result = replay(replayer)
+
+        XCTAssertEqual(result.sizes, accessUnitSizes)
+        XCTAssertEqual(result.bytes, stream)
+        XCTAssertEqual(replayer.statistics.mediaDuration, 190000)
+        XCTAssertGreaterThanOrEqual(replayer.statistics.wallDuration, 190000, "Recorded times not followed")
+    }
+
+    func testMissingCapture() {
+        XCTAssertNil(DJIVideoStreamReplayer(recording: "missing", directory: directory, options: options(VideoReplayPacingMaxSpeed)))
+    }
+}
@@ -0,0 +1,125 @@
+/*
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import XCTest
+import VideoPreviewer
+
+@testable import DronePan
+
+class VideoStreamTrackerTests: XCTestCase {
+    let maxBytes = 1000
+
+    func nal(type: UInt8, length: Int) -> [UInt8] {
+        return [0, 0, 0, 1, 0x60 | type] + [UInt8](count: length, repeatedValue: 0x55 &+ type)
+    }
+
+    func take(inout tracker: VideoStreamTracker) -> [UInt8]? {
+        var size = 0
+        let stream = videoStreamTrackerTake(&tracker, &size)
+
+        if stream == nil {
+            return nil
+        }
+
+        let bytes = Array(UnsafeBufferPointer(start: stream, count: size))
+        free(stream)
+
+        return bytes
+    }
+
+    func testNothingBeforeKeyframe() {
+        var tracker = VideoStreamTracker()
+        videoStreamTrackerInit(&tracker, maxBytes)
+
+        let stream = nal(1, length: 20) + nal(1, length: 20)
+        videoStreamTrackerPush(&tracker, stream, stream.count)
+
+        XCTAssertNil(take(&tracker))
+        XCTAssertEqual(tracker.statistics.trackedBytes, UInt64(stream.count))
+
+        videoStreamTrackerRelease(&tracker)
+    }
+
+    func testKeepsStreamFromKeyframe() {
+        var tracker = VideoStreamTracker()
+        videoStreamTrackerInit(&tracker, maxBytes)
+
+        let before = nal(1, length: 10)
+        let keyframe = nal(9, length: 1) + nal(7, length: 8) + nal(8, length: 4) + nal(5, length: 30) + nal(1, length: 10)
+        let stream = before + keyframe
+
+        // One byte at a time splits every start code
+        for byte in stream {
+            videoStreamTrackerPush(&tracker, [byte], 1)
+        }
+
+        XCTAssertEqual(tracker.statistics.keyframeCount, 1)
+        XCTAssertEqual(take(&tracker)!, keyframe)
+        XCTAssertNil(take(&tracker), "Stream kept after take")
+
+        videoStreamTrackerRelease(&tracker)
+    }
+
+    func testPrependsParameterSets() {
+        var tracker = VideoStreamTracker()
+        videoStreamTrackerInit(&tracker, maxBytes)
+
+        let sps = nal(7, length: 8)
+        let pps = nal(8, length: 4)
+        let first = sps + pps + nal(5, length: 20) + nal(1, length: 10)
+        videoStreamTrackerPush(&tracker, first, first.count)
+        take(&tracker)
+
+        // An IDR without parameter sets of its own
+        let keyframe = nal(5, length: 30) + nal(5, length: 30) + nal(1, length: 10)
+        let stream = nal(1, length: 10) + keyframe
+        videoStreamTrackerPush(&tracker, stream, stream.count)
+
+        XCTAssertEqual(take(&tracker)!, sps + pps + keyframe)
+
+        videoStreamTrackerRelease(&tracker)
+    }
+
+    func testNewerKeyframeReplacesOlder() {
+        var tracker = VideoStreamTracker()
+        videoStreamTrackerInit(&tracker, maxBytes)
+
+        let latest = nal(7, length: 8) + nal(8, length: 4) + nal(5, length: 20) + nal(1, length: 5)
+        let stream = nal(7, length: 8) + nal(8, length: 4) + nal(5, length: 20) + nal(1, length: 10) + latest
+        videoStreamTrackerPush(&tracker, stream, stream.count)
+
+        XCTAssertEqual(tracker.statistics.keyframeCount, 2)
+        XCTAssertEqual(take(&tracker)!, latest)
+
+        videoStreamTrackerRelease(&tracker)
+    }
+
+    func testOverflowWaitsForNextKeyframe() {
+        var tracker = VideoStreamTracker()
+        videoStreamTrackerInit(&tracker, maxBytes)
+
+        var stream = nal(5, length: 20)
+        for _ in 0 ..< 40 {
+            stream += nal(1, length: 30)
+        }
+        videoStreamTrackerPush(&tracker, stream, stream.count)
+
+        XCTAssertEqual(tracker.statistics.overflowCount, 1)
+        XCTAssertLessThan(tracker.size, 100, "Stream kept after the overflow")
+        XCTAssertNil(take(&tracker))
+
+        videoStreamTrackerRelease(&tracker)
+    }
+}
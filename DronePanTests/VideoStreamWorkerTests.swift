@@ -0,0 +1,190 @@
+/*
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import XCTest
+import VideoPreviewer
+
+@testable import DronePan
+
+class SlowStreamProcessor: NSObject, VideoStreamProcessor {
+    let type: DJIVideoStreamProcessorType
+    let policy: DJIVideoStreamBackpressurePolicy
+    let depth: UInt
+
+    // Held by each frame until the test lets it go
+    let gate = dispatch_semaphore_create(0)
+
+    var handled: [UInt32] = []
+    var resetCount = 0
+
+    init(type: DJIVideoStreamProcessorType, policy: DJIVideoStreamBackpressurePolicy = .Default, depth: UInt = 2) {
+        self.type = type
+        self.policy = policy
+        self.depth = depth
+    }
+
+    func open(frames: Int) {
+        for _ in 0 ..< frames {
+            dispatch_semaphore_signal(gate)
+        }
+    }
+
+    func streamProcessorEnabled() -> Bool {
+        return true
+    }
+
+    func streamProcessorType() -> DJIVideoStreamProcessorType {
+        return type
+    }
+
+    func streamProcessorQueueDepth() -> UInt {
+        return depth
+    }
+
+    func streamProcessorBackpressurePolicy() -> DJIVideoStreamBackpressurePolicy {
+        return policy
+    }
+
+    func streamProcessorHandleFrameRaw(frame: UnsafeMutablePointer<VideoFrameH264Raw>) -> Bool {
+        dispatch_semaphore_wait(gate, DISPATCH_TIME_FOREVER)
+
+        handled.append(frame.memory.frame_uuid)
+
+        if type == DJIVideoStreamProcessorType_Consume {
+            free(frame)
+
+            return true
+        }
+
+        return false
+    }
+
+    func streamProcessorReset() {
+        resetCount += 1
+    }
+}
+
+class VideoStreamWorkerTests: XCTestCase {
+    let frameSize: Int32 = 64
+
+    func frame(uuid: UInt32) -> UnsafeMutablePointer<VideoFrameH264Raw> {
+        let frame = UnsafeMutablePointer<VideoFrameH264Raw>(calloc(1, Int(frameSize)))
+        frame.memory.frame_uuid = uuid
+
+        return frame
+    }
+
+    func submit(worker: DJIVideoStreamWorker, uuid: UInt32, keyframe: Bool = false) -> Bool {
+        let raw = frame(uuid)
+        let accepted = worker.submitFrame(raw, size: frameSize, keyframe: keyframe, copy: true)
+
+        free(raw)
+
+        return accepted
+    }
+
+    func testDefaultPolicies() {
+        let passthrough = DJIVideoStreamWorker(processor: SlowStreamProcessor(type: DJIVideoStreamProcessorType_Passthrough))
+        let consume = DJIVideoStreamWorker(processor: SlowStreamProcessor(type: DJIVideoStreamProcessorType_Consume))
+
+        XCTAssertEqual(passthrough.policy, DJIVideoStreamBackpressurePolicy.DropNewest)
+        XCTAssertEqual(consume.policy, DJIVideoStreamBackpressurePolicy.DropUntilKeyframe)
+        XCTAssertEqual(passthrough.queueDepth, 2)
+    }
+
+    func testDropNewestNeverBlocks() {
+        let processor = SlowStreamProcessor(type: DJIVideoStreamProcessorType_Passthrough, policy: .DropNewest)
+        let worker = DJIVideoStreamWorker(processor: processor)
+
+        let accepted = (1 ... 10).filter { submit(worker, uuid: UInt32($0)) }
+
+        XCTAssertEqual(accepted.count, 2, "Queue depth not honoured")
+        XCTAssertEqual(worker.droppedFrameCount, 8)
+
+        processor.open(10)
+        worker.waitUntilIdle()
+
+        XCTAssertEqual(processor.handled, [1, 2])
+        XCTAssertTrue(submit(worker, uuid: 11), "Slot not released")
+    }
+
+    func testDropUntilKeyframe() {
+        let processor = SlowStreamProcessor(type: DJIVideoStreamProcessorType_Consume, policy: .DropUntilKeyframe)
+        let worker = DJIVideoStreamWorker(processor: processor)
+
+        XCTAssertTrue(submit(worker, uuid: 1, keyframe: true))
+        XCTAssertTrue(submit(worker, uuid: 2))
+        XCTAssertFalse(submit(worker, uuid: 3), "Frame beyond the queue depth accepted")
+
+        processor.open(10)
+        worker.waitUntilIdle()
+
+        XCTAssertFalse(submit(worker, uuid: 4), "Frame after a gap accepted before a keyframe")
+        XCTAssertTrue(submit(worker, uuid: 5, keyframe: true))
+        XCTAssertTrue(submit(worker, uuid: 6))
+
+        worker.waitUntilIdle()
+
+        XCTAssertEqual(processor.handled, [1, 2, 5, 6])
+    }
+
+    func testBlockKeepsEveryFrame() {
+        let processor = SlowStreamProcessor(type: DJIVideoStreamProcessorType_Consume, policy: .Block)
+        let worker = DJIVideoStreamWorker(processor: processor)
+
+        processor.open(20)
+
+        for uuid in 1 ... 20 {
+            XCTAssertTrue(submit(worker, uuid: UInt32(uuid)))
+        }
+
+        worker.waitUntilIdle()
+
+        XCTAssertEqual(processor.handled, (1 ... 20).map { UInt32($0) })
+        XCTAssertEqual(worker.droppedFrameCount, 0)
+        XCTAssertEqual(worker.handledFrameCount, 20)
+    }
+
+    func testResetDropsQueuedFrames() {
+        let processor = SlowStreamProcessor(type: DJIVideoStreamProcessorType_Passthrough, policy: .DropNewest, depth: 4)
+        let worker = DJIVideoStreamWorker(processor: processor)
+
+        for uuid in 1 ... 3 {
+            submit(worker, uuid: UInt32(uuid))
+        }
+
+        worker.submitReset()
+        processor.open(10)
+        worker.waitUntilIdle()
+
+        // The first frame may already be in the processor when the reset comes
+        XCTAssertLessThanOrEqual(processor.handled.count, 1)
+        XCTAssertEqual(processor.resetCount, 1)
+    }
+
+    func testWorkerTakesFrameOver() {
+        let processor = SlowStreamProcessor(type: DJIVideoStreamProcessorType_Consume, policy: .Block)
+        let worker = DJIVideoStreamWorker(processor: processor)
+
+        processor.open(1)
+
+        // The consumer frees the frame, the test must not
+        XCTAssertTrue(worker.submitFrame(frame(7), size: frameSize, keyframe: true, copy: false))
+
+        worker.waitUntilIdle()
+
+        XCTAssertEqual(processor.handled, [7])
+    }
+}
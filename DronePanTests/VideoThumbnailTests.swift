@@ -0,0 +1,164 @@
+/*
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import XCTest
+import VideoPreviewer
+
+@testable import DronePan
+
+class VideoThumbnailTests: XCTestCase {
+    let width = 1280
+    let height = 720
+
+    // Uniform frame of one YUV color
+    func thumbnail(y y: UInt8, cb: UInt8, cr: UInt8, maxWidth: Int32) -> DJIVideoThumbnail? {
+        var luma = [UInt8](count: width * height, repeatedValue: y)
+        var chromaB = [UInt8](count: width * height / 4, repeatedValue: cb)
+        var chromaR = [UInt8](count: width * height / 4, repeatedValue: cr)
+
+        var frame = VideoFrameYUV()
+        frame.width = Int32(width)
+        frame.height = Int32(height)
+        frame.frameType = UInt8(VPFrameType.YUV420Planer.rawValue)
+        frame.frame_uuid = 42
+
+        var result: DJIVideoThumbnail? = nil
+
+        luma.withUnsafeMutableBufferPointer { lumaPointer in
+            chromaB.withUnsafeMutableBufferPointer { chromaBPointer in
+                chromaR.withUnsafeMutableBufferPointer { chromaRPointer in
+                    frame.luma = lumaPointer.baseAddress
+                    frame.chromaB = chromaBPointer.baseAddress
+                    frame.chromaR = chromaRPointer.baseAddress
+
+                    result = DJIVideoThumbnail(ofFrame: &frame, maxWidth: maxWidth)
+                }
+            }
+        }
+
+        return result
+    }
+
+    func testThumbnailSize() {
+        let result = thumbnail(y: 128, cb: 128, cr: 128, maxWidth: 160)
+
+        XCTAssertNotNil(result)
+        XCTAssertEqual(result?.width, 160)
+        XCTAssertEqual(result?.height, 90)
+        XCTAssertEqual(result?.frameUUID, 42)
+        XCTAssertEqual(result?.image.size, CGSize(width: 160, height: 90))
+    }
+
+    func testThumbnailSizeBetweenHalvings() {
+        let result = thumbnail(y: 128, cb: 128, cr: 128, maxWidth: 200)
+
+        XCTAssertEqual(result?.width, 160, "Thumbnail wider than the limit")
+    }
+
+    func testThumbnailColor() {
+        guard let image = thumbnail(y: 235, cb: 128, cr: 128, maxWidth: 160)?.image.CGImage else {
+            XCTFail("No thumbnail")
+            return
+        }
+
+        guard let provider = CGImageGetDataProvider(image), data = CGDataProviderCopyData(provider) else {
+            XCTFail("No thumbnail pixels")
+            return
+        }
+
+        let pixels = CFDataGetBytePtr(data)
+
+        XCTAssertEqual(pixels[0], 255, "White luma is not white")
+        XCTAssertEqual(pixels[1], 255, "White luma is not white")
+        XCTAssertEqual(pixels[2], 255, "White luma is not white")
+    }
+
+    func testUnsupportedFormat() {
+        var frame = VideoFrameYUV()
+        frame.frameType = UInt8(VPFrameType.RGBA.rawValue)
+
+        XCTAssertNil(DJIVideoThumbnail(ofFrame: &frame, maxWidth: 160), "RGBA frame gave a thumbnail")
+    }
+
+    // Pushes the frames like the previewer, the flags are left clear as the Phantom 4 stream has them
+    func decode(frames: [EncodedTestFrame], decoder: DJIVideoThumbnailDecoder, timeTag: Int -> UInt64) {
+        for (index, encoded) in frames.enumerate() {
+            let frame = UnsafeMutablePointer<VideoFrameH264Raw>(calloc(1, sizeof(VideoFrameH264Raw) + encoded.bytes.count))
+            frame.memory.frame_uuid = UInt32(index + 1)
+            frame.memory.time_tag = timeTag(index)
+            frame.memory.frame_size = UInt32(encoded.bytes.count)
+
+            memcpy(UnsafeMutablePointer<UInt8>(frame) + sizeof(VideoFrameH264Raw), encoded.bytes, encoded.bytes.count)
+
+            decoder.streamProcessorHandleFrameRaw(frame)
+            free(frame)
+
+            // An IDR that arrives while the last one is decoded is dropped
+            if encoded.keyframe {
+                NSThread.sleepForTimeInterval(0.2)
+            }
+        }
+    }
+
+    func testRequestOnlyTakesKeyframeBeforeClose() {
+        let frames = encodeTestStream(30, keyframeInterval: 10)
+        let keyframes = frames.enumerate().filter { $0.element.keyframe }.map { $0.index }
+
+        guard keyframes.count >= 3 && keyframes[2] - keyframes[1] > 2 else {
+            XCTFail("Test stream needs three GOPs")
+            return
+        }
+
+        let timeTag = { (index: Int) -> UInt64 in UInt64(index + 1) * 33000 }
+
+        let decoder = DJIVideoThumbnailDecoder()
+        let lock = NSLock()
+        var shown: DJIVideoThumbnail?
+        var moved: DJIVideoThumbnail?
+
+        // The shutter fires after the first keyframe, the gimbal moves after the second one
+        decoder.requestThumbnailAfterTimeTag(timeTag(keyframes[0] + 1), handler: { thumbnail in
+            lock.lock()
+            shown = thumbnail
+            lock.unlock()
+        }, queue: nil)
+        decoder.closeThumbnailRequestsAtTimeTag(timeTag(keyframes[1] + 1))
+
+        // No keyframe between this shutter and the next move
+        decoder.requestThumbnailAfterTimeTag(timeTag(keyframes[1] + 1), handler: { thumbnail in
+            lock.lock()
+            moved = thumbnail
+            lock.unlock()
+        }, queue: nil)
+        decoder.closeThumbnailRequestsAtTimeTag(timeTag(keyframes[2] - 1))
+
+        decode(frames, decoder: decoder, timeTag: timeTag)
+        NSThread.sleepForTimeInterval(0.5)
+
+        lock.lock()
+        XCTAssertEqual(shown?.frameUUID, UInt32(keyframes[1] + 1))
+        XCTAssertNil(moved, "Keyframe after the move used")
+        lock.unlock()
+
+        XCTAssertEqual(decoder.latestThumbnail?.frameUUID, UInt32(keyframes[2] + 1), "Keyframe without has_idr missed")
+    }
+
+    // Cost of one thumbnail from a 720p keyframe
+    func testThumbnailPerformance() {
+        measureBlock {
+            self.thumbnail(y: 100, cb: 90, cr: 160, maxWidth: 160)
+        }
+    }
+}